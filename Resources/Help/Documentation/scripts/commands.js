@@ -36,6 +36,7 @@ menu_commands["Mac"]["edit_paste_at_original_pos"]		= "Edit &raquo; Paste At Ori
 menu_commands["Mac"]["edit_select_all"]					= "Edit &raquo; Select All - &#8984;A";
 menu_commands["Mac"]["edit_select_siblings"]			= "Edit &raquo; Select Siblings - &#x2325;&#8984;A";
 menu_commands["Mac"]["edit_select_touching"]			= "Edit &raquo; Select Touching - &#8984;T";
+menu_commands["Mac"]["edit_select_inside"]				= "Edit &raquo; Select Inside - &#x2325;&#8984;T";
 menu_commands["Mac"]["edit_select_by_file_position"]	= "Edit &raquo; Select by Line Number";
 menu_commands["Mac"]["edit_select_none"]				= "Edit &raquo; Select None - &#8679;&#8984;A";
 menu_commands["Mac"]["edit_rotate_tool"]				= "Edit &raquo; Tools &raquo; Rotate Objects Tool - R";
@@ -85,6 +86,7 @@ menu_commands["Windows"]["edit_paste_at_original_pos"]	= "Edit &raquo; Paste At
 menu_commands["Windows"]["edit_select_all"]				= "Edit &raquo; Select All - Ctrl+A";
 menu_commands["Windows"]["edit_select_siblings"]		= "Edit &raquo; Select Siblings - Ctrl+Alt+A";
 menu_commands["Windows"]["edit_select_touching"]		= "Edit &raquo; Select Touching - Ctrl+T";
+menu_commands["Windows"]["edit_select_inside"]			= "Edit &raquo; Select Inside - Ctrl+Alt+T";
 menu_commands["Windows"]["edit_select_by_file_position"]= "Edit &raquo; Select by Line Number";
 menu_commands["Windows"]["edit_select_none"]			= "Edit &raquo; Select None - Ctrl+Shift+A";
 menu_commands["Windows"]["edit_rotate_tool"]			= "Edit &raquo; Tools &raquo; Rotate Objects Tool - R";
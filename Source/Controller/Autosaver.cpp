@@ -21,8 +21,11 @@
 
 #include "IO/FileManager.h"
 #include "IO/MapWriter.h"
+#include "IO/IOException.h"
+#include "IO/MapSnapshot.h"
 #include "Model/MapDocument.h"
 #include "Utility/Console.h"
+#include "Utility/ThreadPool.h"
 
 #include <algorithm>
 #include <cassert>
@@ -70,101 +73,157 @@ namespace TrenchBroom {
             return true;
         }
         
-        void Autosaver::autosave() {
-            const String mapPath = m_document.GetFilename().ToStdString();
-            if (mapPath.empty())
-                return;
-            
-            IO::FileManager fileManager;
-            String basePath = fileManager.deleteLastPathComponent(mapPath);
-            String autosavePath = fileManager.appendPath(basePath, "autosave");
-            String mapFilename = fileManager.pathComponents(mapPath).back();
-            String mapBasename = fileManager.deleteExtension(mapFilename);
+        class Autosaver::AutosaveTask : public Utility::ThreadPool::Task {
+        private:
+            IO::MapSnapshot m_snapshot;
+            String m_mapPath;
+            unsigned int m_maxBackups;
+            Utility::BufferedConsole m_console;
+        protected:
+            void run() {
+                save();
+            }
+        public:
+            AutosaveTask(const Model::Map& map, const String& mapPath, unsigned int maxBackups) :
+            m_snapshot(map),
+            m_mapPath(mapPath),
+            m_maxBackups(maxBackups) {}
             
-            if (!fileManager.exists(autosavePath)) {
-                if (!fileManager.makeDirectory(autosavePath)) {
-                    m_document.console().error("Cannot create autosave directory at %s", autosavePath.c_str());
+            void save() {
+                IO::FileManager fileManager;
+                String basePath = fileManager.deleteLastPathComponent(m_mapPath);
+                String autosavePath = fileManager.appendPath(basePath, "autosave");
+                String mapFilename = fileManager.pathComponents(m_mapPath).back();
+                String mapBasename = fileManager.deleteExtension(mapFilename);
+                
+                if (!fileManager.exists(autosavePath)) {
+                    if (!fileManager.makeDirectory(autosavePath)) {
+                        m_console.error("Cannot create autosave directory at %s", autosavePath.c_str());
+                        return;
+                    }
+                
+                    m_console.info("Autosave directory created at %s", autosavePath.c_str());
+                } else if (!fileManager.isDirectory(autosavePath)) {
+                    m_console.error("Cannot create autosave directory at %s because a file exists at that path", autosavePath.c_str());
                     return;
                 }
                 
-                m_document.console().info("Autosave directory created at %s", autosavePath.c_str());
-            } else if (!fileManager.isDirectory(autosavePath)) {
-                m_document.console().error("Cannot create autosave directory at %s because a file exists at that path", autosavePath.c_str());
-                return;
-            }
-            
-            // collect the actual backup files and determine the highest backup no
-            StringList contents = fileManager.directoryContents(autosavePath, "map");
-            StringList backups;
-            
-            unsigned int highestBackupNo = 0;
-            for (size_t i = 0; i < contents.size(); i++) {
-                const String& filename = contents[i];
-                String basename = fileManager.deleteExtension(filename);
-                unsigned int backupNo;
-                if (isBackupName(basename, mapBasename, backupNo)) {
-                    highestBackupNo = (std::max)(highestBackupNo, backupNo);
-                    backups.push_back(filename);
-                }
-            }
-            
-            if (!backups.empty()) {
-                // sort the backups by their backup nos in ascending order
-                std::sort(backups.begin(), backups.end(), compareByBackupNo);
+                // collect the actual backup files and determine the highest backup no
+                StringList contents = fileManager.directoryContents(autosavePath, "map");
+                StringList backups;
                 
-                // remove the oldest backups until backups.size() == m_maxBackups - 1
-                while (backups.size() > m_maxBackups - 1) {
-                    const String filePath = fileManager.appendPath(autosavePath, backups.front());
-                    if (!fileManager.deleteFile(filePath)) {
-                        m_document.console().error("Cannot delete file %s", filePath.c_str());
-                        return;
-                    } else {
-                        m_document.console().debug("Deleted file %s", filePath.c_str());
+                unsigned int highestBackupNo = 0;
+                for (size_t i = 0; i < contents.size(); i++) {
+                    const String& filename = contents[i];
+                    String basename = fileManager.deleteExtension(filename);
+                    unsigned int backupNo;
+                    if (isBackupName(basename, mapBasename, backupNo)) {
+                        highestBackupNo = (std::max)(highestBackupNo, backupNo);
+                        backups.push_back(filename);
                     }
-                    
-                    backups.erase(backups.begin());
                 }
                 
-                // reorganize the backups and close gaps in the numbering
-                for (unsigned int i = 0; i < backups.size(); i++) {
-                    const String& filename = backups[i];
-                    const String backupFilename = backupName(mapBasename, i + 1);
-                    
-                    if (filename != backupFilename) {
-                        const String filePath = fileManager.appendPath(autosavePath, filename);
-                        const String backupFilePath = fileManager.appendPath(autosavePath, backupFilename);
-                        if (fileManager.exists(backupFilePath)) {
-                            m_document.console().error("Cannot move file %s to %s because a file exists at that path", filePath.c_str(), backupFilePath.c_str());
+                if (!backups.empty()) {
+                    // sort the backups by their backup nos in ascending order
+                    std::sort(backups.begin(), backups.end(), compareByBackupNo);
+                
+                    // remove the oldest backups until backups.size() == m_maxBackups - 1
+                    while (backups.size() > m_maxBackups - 1) {
+                        const String filePath = fileManager.appendPath(autosavePath, backups.front());
+                        if (!fileManager.deleteFile(filePath)) {
+                            m_console.error("Cannot delete file %s", filePath.c_str());
                             return;
+                        } else {
+                            m_console.debug("Deleted file %s", filePath.c_str());
                         }
+                    
+                        backups.erase(backups.begin());
+                    }
+                
+                    // reorganize the backups and close gaps in the numbering
+                    for (unsigned int i = 0; i < backups.size(); i++) {
+                        const String& filename = backups[i];
+                        const String backupFilename = backupName(mapBasename, i + 1);
+                    
+                        if (filename != backupFilename) {
+                            const String filePath = fileManager.appendPath(autosavePath, filename);
+                            const String backupFilePath = fileManager.appendPath(autosavePath, backupFilename);
+                            if (fileManager.exists(backupFilePath)) {
+                                m_console.error("Cannot move file %s to %s because a file exists at that path", filePath.c_str(), backupFilePath.c_str());
+                                return;
+                            }
                         
-                        if (!fileManager.moveFile(filePath, backupFilePath, false)) {
-                            m_document.console().error("Cannot move file %s to %s", filePath.c_str(), backupFilePath.c_str());
-                            return;
-                        } else {
-                            m_document.console().debug("Moved file %s to %s", filePath.c_str(), backupFilePath.c_str());
+                            if (!fileManager.moveFile(filePath, backupFilePath, false)) {
+                                m_console.error("Cannot move file %s to %s", filePath.c_str(), backupFilePath.c_str());
+                                return;
+                            } else {
+                                m_console.debug("Moved file %s to %s", filePath.c_str(), backupFilePath.c_str());
+                            }
                         }
                     }
-                }
 
-                highestBackupNo = static_cast<unsigned int>(backups.size());
+                    highestBackupNo = static_cast<unsigned int>(backups.size());
+                }
+                
+                assert(highestBackupNo == static_cast<unsigned int>(backups.size()));
+                assert(highestBackupNo < m_maxBackups);
+                
+                // save the backup
+                const String backupFilename = backupName(mapBasename, highestBackupNo + 1);
+                const String backupFilePath = fileManager.appendPath(autosavePath, backupFilename);
+                
+                try {
+                    wxStopWatch watch;
+                    IO::MapWriter mapWriter;
+                    mapWriter.writeToFileAtPath(m_snapshot, backupFilePath, true);
+                    m_console.debug("Autosaved to %s in %f seconds", backupFilePath.c_str(), watch.Time() / 1000.0f);
+                } catch (IO::IOException& e) {
+                    m_console.error("%s", e.what());
+                }
             }
+                
+            inline const Utility::BufferedConsole& console() const {
+                return m_console;
+            }
+        };
+        
+        Autosaver::AutosaveTask* Autosaver::createTask() {
+            const String mapPath = m_document.GetFilename().ToStdString();
+            if (mapPath.empty())
+                return NULL;
             
-            assert(highestBackupNo == static_cast<unsigned int>(backups.size()));
-            assert(highestBackupNo < m_maxBackups);
+            wxStopWatch watch;
+            AutosaveTask* task = new AutosaveTask(m_document.map(), mapPath, m_maxBackups);
+            m_document.console().debug("Took autosave snapshot in %f seconds", watch.Time() / 1000.0f);
+            return task;
+        }
+        
+        void Autosaver::finishTask() {
+            assert(m_task != NULL);
+            m_threadPool->wait(*m_task);
             
-            // save the backup
-            const String backupFilename = backupName(mapBasename, highestBackupNo + 1);
-            const String backupFilePath = fileManager.appendPath(autosavePath, backupFilename);
+            const Utility::BufferedConsole& console = m_task->console();
+            console.replay(m_document.console(), 0, console.messageCount());
+            delete m_task;
+            m_task = NULL;
+        }
+        
+        void Autosaver::autosave() {
+            if (m_task != NULL) {
+                m_pending = true;
+                return;
+            }
             
-            wxStopWatch watch;
-            IO::MapWriter mapWriter;
-            mapWriter.writeToFileAtPath(m_document.map(), backupFilePath, true);
-            m_document.console().debug("Autosaved to %s in %f seconds", backupFilePath.c_str(), watch.Time() / 1000.0f);
+            m_task = createTask();
+            if (m_task != NULL)
+                m_threadPool->enqueue(*m_task);
         }
         
         Autosaver::Autosaver(Model::MapDocument& document, time_t saveInterval, time_t idleInterval, unsigned int maxBackups) :
         m_document(document),
+        m_threadPool(new Utility::ThreadPool(1)),
+        m_task(NULL),
+        m_pending(false),
         m_saveInterval(saveInterval),
         m_idleInterval(idleInterval),
         m_maxBackups(maxBackups),
@@ -173,10 +232,31 @@ namespace TrenchBroom {
         m_dirty(false) {}
 
         Autosaver::~Autosaver() {
-            autosave();
+            if (m_task != NULL)
+                finishTask();
+            
+            // the final autosave must be complete before the document goes away
+            AutosaveTask* task = createTask();
+            if (task != NULL) {
+                task->save();
+                const Utility::BufferedConsole& console = task->console();
+                console.replay(m_document.console(), 0, console.messageCount());
+                delete task;
+            }
+            
+            delete m_threadPool;
+            m_threadPool = NULL;
         }
 
         void Autosaver::triggerAutosave() {
+            if (m_task != NULL && m_threadPool->finished(*m_task)) {
+                finishTask();
+                if (m_pending) {
+                    m_pending = false;
+                    autosave();
+                }
+            }
+            
             time_t currentTime = time(NULL);
             IO::FileManager fileManager;
             if (fileManager.exists(m_document.GetFilename().ToStdString()) &&
@@ -29,13 +29,27 @@ namespace TrenchBroom {
         class MapDocument;
     }
     
+    namespace Utility {
+        class ThreadPool;
+    }
+    
     namespace Controller {
         unsigned int backupNoOfFile(const String& path);
         bool compareByBackupNo(const String& file1, const String& file2);
 
+        /*
+         * Takes a snapshot of the map on the main thread and writes it to the autosave directory on a background
+         * thread, where the older backups are also rotated. If another autosave becomes due while one is still being
+         * written, it is started once the running one has finished.
+         */
         class Autosaver {
         protected:
+            class AutosaveTask;
+            
             Model::MapDocument& m_document;
+            Utility::ThreadPool* m_threadPool;
+            AutosaveTask* m_task;
+            bool m_pending;
             
             time_t m_saveInterval;
             time_t m_idleInterval;
@@ -44,8 +58,10 @@ namespace TrenchBroom {
             time_t m_lastModificationTime;
             bool m_dirty;
             
-            String backupName(const String& mapBasename, unsigned int backupNo);
-            bool isBackupName(const String& basename, const String& mapBasename, unsigned int& backupNo);
+            static String backupName(const String& mapBasename, unsigned int backupNo);
+            static bool isBackupName(const String& basename, const String& mapBasename, unsigned int& backupNo);
+            AutosaveTask* createTask();
+            void finishTask();
             void autosave();
         public:
             Autosaver(Model::MapDocument& document, time_t saveInterval = 10 * 60, time_t idleInterval = 3, unsigned int maxBackups = 30);
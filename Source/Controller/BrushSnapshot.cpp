@@ -0,0 +1,238 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "BrushSnapshot.h"
+
+#include "Model/Brush.h"
+#include "Model/Face.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace TrenchBroom {
+    namespace Controller {
+        FaceGeometrySnapshot::FaceGeometrySnapshot(const Model::Face& face) :
+        boundary(face.boundary()) {
+            face.getPoints(points[0], points[1], points[2]);
+        }
+        
+        bool FaceGeometrySnapshot::matches(const Model::Face& face) const {
+            if (boundary.normal != face.boundary().normal || boundary.distance != face.boundary().distance)
+                return false;
+            for (size_t i = 0; i < 3; i++)
+                if (points[i] != face.point(i))
+                    return false;
+            return true;
+        }
+        
+        FaceAttributesSnapshot::FaceAttributesSnapshot(const Model::Face& face) :
+        faceId(face.faceId()),
+        texture(face.texture()),
+        xOffset(face.xOffset()),
+        yOffset(face.yOffset()),
+        rotation(face.rotation()),
+        xScale(face.xScale()),
+        yScale(face.yScale()),
+        filePosition(face.filePosition()) {
+            if (texture == NULL)
+                textureName = face.internedTextureName();
+        }
+        
+        bool FaceAttributesSnapshot::matches(const Model::Face& face) const {
+            if (faceId != face.faceId() ||
+                texture != face.texture() ||
+                xOffset != face.xOffset() ||
+                yOffset != face.yOffset() ||
+                rotation != face.rotation() ||
+                xScale != face.xScale() ||
+                yScale != face.yScale() ||
+                filePosition != face.filePosition())
+                return false;
+            if (texture == NULL && textureName != face.internedTextureName())
+                return false;
+            return true;
+        }
+        
+        template <typename T>
+        static bool blockMatches(const BrushSnapshotBlock<T>& block, size_t first, const Model::FaceList& faces) {
+            assert(first + faces.size() <= block.entries.size());
+            for (size_t i = 0; i < faces.size(); i++)
+                if (!block.entries[first + i].matches(*faces[i]))
+                    return false;
+            return true;
+        }
+        
+        BrushSnapshot::BrushSnapshot(unsigned int uniqueId, size_t faceCount) :
+        m_uniqueId(uniqueId),
+        m_faceCount(faceCount),
+        m_geometryFirst(0),
+        m_attributesFirst(0) {}
+        
+        void BrushSnapshot::setGeometry(FaceGeometryBlock::Ptr geometry, size_t first) {
+            assert(geometry.get() != NULL && first + m_faceCount <= geometry->entries.size());
+            m_geometry = geometry;
+            m_geometryFirst = first;
+        }
+        
+        void BrushSnapshot::setAttributes(FaceAttributesBlock::Ptr attributes, size_t first) {
+            assert(attributes.get() != NULL && first + m_faceCount <= attributes->entries.size());
+            m_attributes = attributes;
+            m_attributesFirst = first;
+        }
+        
+        void BrushSnapshot::share(const Model::Brush& brush, const FaceGeometryBlock::Ptr& geometry, size_t geometryFirst, const FaceAttributesBlock::Ptr& attributes, size_t attributesFirst) {
+            const Model::FaceList& faces = brush.faces();
+            if (faces.size() != m_faceCount)
+                return;
+            if (m_geometry.get() == NULL && geometry.get() != NULL && blockMatches(*geometry, geometryFirst, faces))
+                setGeometry(geometry, geometryFirst);
+            if (m_attributes.get() == NULL && attributes.get() != NULL && blockMatches(*attributes, attributesFirst, faces))
+                setAttributes(attributes, attributesFirst);
+        }
+        
+        void BrushSnapshot::restore(Model::Brush& brush) const {
+            assert(m_geometry.get() != NULL && m_attributes.get() != NULL);
+            
+            Model::FaceList faces;
+            faces.reserve(m_faceCount);
+            
+            for (size_t i = 0; i < m_faceCount; i++) {
+                const FaceGeometrySnapshot& geometry = m_geometry->entries[m_geometryFirst + i];
+                const FaceAttributesSnapshot& attributes = m_attributes->entries[m_attributesFirst + i];
+                const Model::FacePoints facePoints = {geometry.points[0], geometry.points[1], geometry.points[2]};
+                
+                Model::Face* face = new Model::Face(brush.worldBounds(), brush.forceIntegerFacePoints(), attributes.faceId, geometry.boundary, facePoints);
+                if (attributes.texture != NULL)
+                    face->setTexture(attributes.texture);
+                else
+                    face->setTextureName(attributes.textureName);
+                face->setXOffset(attributes.xOffset);
+                face->setYOffset(attributes.yOffset);
+                face->setRotation(attributes.rotation);
+                face->setXScale(attributes.xScale);
+                face->setYScale(attributes.yScale);
+                face->setFilePosition(attributes.filePosition);
+                faces.push_back(face);
+            }
+            
+            brush.restore(faces);
+        }
+        
+        void BrushSnapshotStore::prune() {
+            EntryMap::iterator it = m_entries.begin();
+            while (it != m_entries.end()) {
+                const Entry& entry = it->second;
+                if (entry.geometry.expired() && entry.attributes.expired())
+                    m_entries.erase(it++);
+                else
+                    ++it;
+            }
+            m_pruneSize = std::max(static_cast<size_t>(1024), 2 * m_entries.size());
+        }
+        
+        BrushSnapshotStore::BrushSnapshotStore() :
+        m_pruneSize(1024) {}
+        
+        void BrushSnapshotStore::share(const Model::Brush& brush, BrushSnapshot& snapshot) const {
+            EntryMap::const_iterator it = m_entries.find(brush.uniqueId());
+            if (it == m_entries.end())
+                return;
+            
+            const Entry& entry = it->second;
+            if (entry.faceCount != snapshot.faceCount())
+                return;
+            snapshot.share(brush, entry.geometry.lock(), entry.geometryFirst, entry.attributes.lock(), entry.attributesFirst);
+        }
+        
+        void BrushSnapshotStore::store(const BrushSnapshot& snapshot) {
+            Entry& entry = m_entries[snapshot.uniqueId()];
+            entry.faceCount = snapshot.faceCount();
+            entry.geometry = snapshot.geometry();
+            entry.geometryFirst = snapshot.geometryFirst();
+            entry.attributes = snapshot.attributes();
+            entry.attributesFirst = snapshot.attributesFirst();
+            
+            if (m_entries.size() > m_pruneSize)
+                prune();
+        }
+        
+        void BrushSnapshotStore::clear() {
+            m_entries.clear();
+            m_pruneSize = 1024;
+        }
+        
+        void makeBrushSnapshots(const Model::BrushList& brushes, BrushSnapshotStore& store, const BrushSnapshotList& previous, BrushSnapshotList& snapshots) {
+            BrushSnapshotList result;
+            result.reserve(brushes.size());
+            size_t geometryCount = 0;
+            size_t attributesCount = 0;
+            
+            // first share whatever still matches, preferring the previous snapshots of the command being redone
+            for (unsigned int i = 0; i < brushes.size(); i++) {
+                const Model::Brush& brush = *brushes[i];
+                BrushSnapshot snapshot(brush.uniqueId(), brush.faces().size());
+                
+                BrushSnapshotList::const_iterator it = std::lower_bound(previous.begin(), previous.end(), snapshot);
+                if (it != previous.end() && it->uniqueId() == brush.uniqueId())
+                    snapshot.share(brush, it->geometry(), it->geometryFirst(), it->attributes(), it->attributesFirst());
+                if (snapshot.geometry().get() == NULL || snapshot.attributes().get() == NULL)
+                    store.share(brush, snapshot);
+                
+                if (snapshot.geometry().get() == NULL)
+                    geometryCount += snapshot.faceCount();
+                if (snapshot.attributes().get() == NULL)
+                    attributesCount += snapshot.faceCount();
+                result.push_back(snapshot);
+            }
+            
+            // then copy the remaining faces into new blocks of exactly the required size
+            FaceGeometryBlock::Ptr geometry;
+            if (geometryCount > 0) {
+                geometry = FaceGeometryBlock::Ptr(new FaceGeometryBlock());
+                geometry->entries.reserve(geometryCount);
+            }
+            FaceAttributesBlock::Ptr attributes;
+            if (attributesCount > 0) {
+                attributes = FaceAttributesBlock::Ptr(new FaceAttributesBlock());
+                attributes->entries.reserve(attributesCount);
+            }
+            
+            for (unsigned int i = 0; i < brushes.size(); i++) {
+                const Model::FaceList& faces = brushes[i]->faces();
+                BrushSnapshot& snapshot = result[i];
+                if (snapshot.geometry().get() == NULL) {
+                    const size_t first = geometry->entries.size();
+                    for (unsigned int j = 0; j < faces.size(); j++)
+                        geometry->entries.push_back(FaceGeometrySnapshot(*faces[j]));
+                    snapshot.setGeometry(geometry, first);
+                }
+                if (snapshot.attributes().get() == NULL) {
+                    const size_t first = attributes->entries.size();
+                    for (unsigned int j = 0; j < faces.size(); j++)
+                        attributes->entries.push_back(FaceAttributesSnapshot(*faces[j]));
+                    snapshot.setAttributes(attributes, first);
+                }
+                store.store(snapshot);
+            }
+            
+            std::sort(result.begin(), result.end());
+            snapshots.swap(result);
+        }
+    }
+}
@@ -0,0 +1,193 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TrenchBroom__BrushSnapshot__
+#define __TrenchBroom__BrushSnapshot__
+
+#include "Model/BrushTypes.h"
+#include "Utility/InternedString.h"
+#include "Utility/SharedPointer.h"
+#include "Utility/VecMath.h"
+
+#include <map>
+#include <vector>
+
+using namespace TrenchBroom::VecMath;
+
+namespace TrenchBroom {
+    namespace Model {
+        class Brush;
+        class Face;
+        class Texture;
+    }
+    
+    namespace Controller {
+        /*
+         * A packed array of face data which is shared by the snapshots of many brushes and by many commands. A block
+         * is never changed once the command which created it has finished capturing its brushes.
+         */
+        template <typename T>
+        class BrushSnapshotBlock {
+        public:
+            typedef std::tr1::shared_ptr<BrushSnapshotBlock<T> > Ptr;
+            typedef std::tr1::weak_ptr<BrushSnapshotBlock<T> > WeakPtr;
+            
+            std::vector<T> entries;
+            
+            inline size_t memoryUsage() const {
+                return sizeof(BrushSnapshotBlock<T>) + entries.capacity() * sizeof(T);
+            }
+        };
+        
+        class FaceGeometrySnapshot {
+        public:
+            Vec3f points[3];
+            Planef boundary;
+            
+            FaceGeometrySnapshot(const Model::Face& face);
+            bool matches(const Model::Face& face) const;
+        };
+        
+        class FaceAttributesSnapshot {
+        public:
+            unsigned int faceId;
+            Model::Texture* texture;
+            float xOffset;
+            float yOffset;
+            float rotation;
+            float xScale;
+            float yScale;
+            size_t filePosition;
+            // only used for faces without a texture
+            Utility::InternedString textureName;
+            
+            FaceAttributesSnapshot(const Model::Face& face);
+            bool matches(const Model::Face& face) const;
+        };
+        
+        typedef BrushSnapshotBlock<FaceGeometrySnapshot> FaceGeometryBlock;
+        typedef BrushSnapshotBlock<FaceAttributesSnapshot> FaceAttributesBlock;
+        
+        /*
+         * Refers to the geometry and the texture attributes of the faces of a brush in two blocks. Each of them is
+         * shared with the previous snapshot of the brush if it has not changed since, so moving a brush only copies
+         * its geometry, and changing its textures only copies its texture attributes.
+         */
+        class BrushSnapshot {
+        private:
+            unsigned int m_uniqueId;
+            size_t m_faceCount;
+            FaceGeometryBlock::Ptr m_geometry;
+            size_t m_geometryFirst;
+            FaceAttributesBlock::Ptr m_attributes;
+            size_t m_attributesFirst;
+        public:
+            BrushSnapshot(unsigned int uniqueId, size_t faceCount);
+            
+            inline unsigned int uniqueId() const {
+                return m_uniqueId;
+            }
+            
+            inline size_t faceCount() const {
+                return m_faceCount;
+            }
+            
+            inline const FaceGeometryBlock::Ptr& geometry() const {
+                return m_geometry;
+            }
+            
+            inline size_t geometryFirst() const {
+                return m_geometryFirst;
+            }
+            
+            inline const FaceAttributesBlock::Ptr& attributes() const {
+                return m_attributes;
+            }
+            
+            inline size_t attributesFirst() const {
+                return m_attributesFirst;
+            }
+            
+            inline bool operator< (const BrushSnapshot& other) const {
+                return m_uniqueId < other.m_uniqueId;
+            }
+            
+            void setGeometry(FaceGeometryBlock::Ptr geometry, size_t first);
+            void setAttributes(FaceAttributesBlock::Ptr attributes, size_t first);
+            
+            /*
+             * Uses the given blocks for those parts of this snapshot which have not been set yet, but only if they
+             * match the given brush. Either block may be NULL.
+             */
+            void share(const Model::Brush& brush, const FaceGeometryBlock::Ptr& geometry, size_t geometryFirst, const FaceAttributesBlock::Ptr& attributes, size_t attributesFirst);
+            
+            void restore(Model::Brush& brush) const;
+        };
+        
+        typedef std::vector<BrushSnapshot> BrushSnapshotList;
+        
+        /*
+         * Remembers the most recent snapshot of every brush of a document, so that the next snapshot of the brush can
+         * share those of its blocks which still match the brush. The store does not keep the blocks alive, so it
+         * never holds on to data which the commands have released.
+         */
+        class BrushSnapshotStore {
+        private:
+            class Entry {
+            public:
+                size_t faceCount;
+                FaceGeometryBlock::WeakPtr geometry;
+                size_t geometryFirst;
+                FaceAttributesBlock::WeakPtr attributes;
+                size_t attributesFirst;
+                
+                Entry() :
+                faceCount(0),
+                geometryFirst(0),
+                attributesFirst(0) {}
+            };
+            
+            typedef std::map<unsigned int, Entry> EntryMap;
+            
+            EntryMap m_entries;
+            size_t m_pruneSize;
+            
+            void prune();
+        public:
+            BrushSnapshotStore();
+            
+            /*
+             * Sets the blocks of the given snapshot to those of the stored snapshot of the given brush which are
+             * still alive and which match the brush.
+             */
+            void share(const Model::Brush& brush, BrushSnapshot& snapshot) const;
+            void store(const BrushSnapshot& snapshot);
+            void clear();
+        };
+        
+        /*
+         * Captures the given brushes into the given list, sorted by their IDs. Each brush shares the blocks of its
+         * previous snapshot in the given list (which is sorted by ID) or in the given store if they still match it.
+         * The faces which cannot be shared are copied into one new geometry block and one new attributes block.
+         */
+        void makeBrushSnapshots(const Model::BrushList& brushes, BrushSnapshotStore& store, const BrushSnapshotList& previous, BrushSnapshotList& snapshots);
+    }
+}
+
+#endif /* defined(__TrenchBroom__BrushSnapshot__) */
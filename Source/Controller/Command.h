@@ -23,12 +23,13 @@
 #include "Model/BrushTypes.h"
 #include "Model/EntityTypes.h"
 #include "Model/MapDocument.h"
+#include "Utility/CommandProcessor.h"
 
 #include <wx/cmdproc.h>
 
 namespace TrenchBroom {
     namespace Controller {
-        class Command : public wxCommand {
+        class Command : public MeasuredCommand {
         public:
             typedef enum {
                 LoadMap,
@@ -82,12 +83,12 @@ namespace TrenchBroom {
             }
             
             Command(Type type) :
-            wxCommand(false, ""),
+            MeasuredCommand(false, ""),
             m_type(type),
             m_state(None) {}
 
             Command(Type type, bool undoable, const wxString& name) :
-            wxCommand(undoable, name),
+            MeasuredCommand(undoable, name),
             m_type(type),
             m_state(None) {}
             
@@ -25,6 +25,7 @@
 #include "Model/Face.h"
 #include "Utility/Map.h"
 
+#include <algorithm>
 #include <cassert>
 
 namespace TrenchBroom {
@@ -43,25 +44,12 @@ namespace TrenchBroom {
             entity.setProperties(m_properties, true);
         }
         
-        BrushSnapshot::BrushSnapshot(const Model::Brush& brush) {
-            m_uniqueId = brush.uniqueId();
-            const Model::FaceList& brushFaces = brush.faces();
-            for (unsigned int i = 0; i < brushFaces.size(); i++) {
-                Model::Face* snapshot = new Model::Face(*brushFaces[i]);
-                m_faces.push_back(snapshot);
-            }
-        }
-        
-        BrushSnapshot::~BrushSnapshot() {
-            // must not delete the face snapshots because they are now in use by the original brush!
-        }
-        
-        unsigned int BrushSnapshot::uniqueId() {
-            return m_uniqueId;
-        }
-        
-        void BrushSnapshot::restore(Model::Brush& brush) {
-            brush.restore(m_faces);
+        size_t EntitySnapshot::memoryUsage() const {
+            size_t memoryUsage = sizeof(EntitySnapshot) + m_properties.capacity() * sizeof(Model::Property);
+            Model::PropertyList::const_iterator it, end;
+            for (it = m_properties.begin(), end = m_properties.end(); it != end; ++it)
+                memoryUsage += it->value().capacity();
+            return memoryUsage;
         }
         
         FaceSnapshot::FaceSnapshot(const Model::Face& face) {
@@ -72,14 +60,14 @@ namespace TrenchBroom {
             m_yScale = face.yScale();
             m_rotation = face.rotation();
             m_texture = face.texture();
-            m_textureName = face.textureName();
+            m_textureName = face.internedTextureName();
         }
         
-        unsigned int FaceSnapshot::faceId() {
+        unsigned int FaceSnapshot::faceId() const {
             return m_faceId;
         }
         
-        void FaceSnapshot::restore(Model::Face& face) {
+        void FaceSnapshot::restore(Model::Face& face) const {
             face.setXOffset(m_xOffset);
             face.setYOffset(m_yOffset);
             face.setRotation(m_rotation);
@@ -93,22 +81,22 @@ namespace TrenchBroom {
         void SnapshotCommand::makeSnapshots(const Model::EntityList& entities) {
             for (unsigned int i = 0; i < entities.size(); i++) {
                 Model::Entity& entity = *entities[i];
-                m_entities[entity.uniqueId()] = new EntitySnapshot(entity);
+                EntitySnapshot*& snapshot = m_entities[entity.uniqueId()];
+                delete snapshot; // the command is being redone
+                snapshot = new EntitySnapshot(entity);
             }
         }
         
         void SnapshotCommand::makeSnapshots(const Model::BrushList& brushes) {
-            for (unsigned int i = 0; i < brushes.size(); i++) {
-                Model::Brush& brush = *brushes[i];
-                m_brushes[brush.uniqueId()] = new BrushSnapshot(brush);
-            }
+            makeBrushSnapshots(brushes, document().brushSnapshotStore(), m_brushes, m_brushes);
         }
         
         void SnapshotCommand::makeSnapshots(const Model::FaceList& faces) {
-            for (unsigned int i = 0; i < faces.size(); i++) {
-                Model::Face& face = *faces[i];
-                m_faces[face.faceId()] = new FaceSnapshot(face);
-            }
+            m_faces.clear();
+            m_faces.reserve(faces.size());
+            for (unsigned int i = 0; i < faces.size(); i++)
+                m_faces.push_back(FaceSnapshot(*faces[i]));
+            std::sort(m_faces.begin(), m_faces.end());
         }
         
         void SnapshotCommand::restoreSnapshots(const Model::EntityList& entities) {
@@ -135,8 +123,9 @@ namespace TrenchBroom {
             
             for (unsigned int i = 0; i < brushes.size(); i++) {
                 Model::Brush& brush = *brushes[i];
-                BrushSnapshot& snapshot = *m_brushes[brush.uniqueId()];
-                snapshot.restore(brush);
+                BrushSnapshotList::const_iterator it = std::lower_bound(m_brushes.begin(), m_brushes.end(), BrushSnapshot(brush.uniqueId(), 0));
+                assert(it != m_brushes.end() && it->uniqueId() == brush.uniqueId());
+                it->restore(brush);
             }
         }
         
@@ -148,15 +137,16 @@ namespace TrenchBroom {
             
             for (unsigned int i = 0; i < faces.size(); i++) {
                 Model::Face& face = *faces[i];
-                FaceSnapshot& snapshot = *m_faces[face.faceId()];
-                snapshot.restore(face);
+                FaceSnapshotList::const_iterator it = std::lower_bound(m_faces.begin(), m_faces.end(), FaceSnapshot(face));
+                assert(it != m_faces.end() && it->faceId() == face.faceId());
+                it->restore(face);
             }
         }
 
         void SnapshotCommand::clear() {
             Utility::deleteAll(m_entities);
-            Utility::deleteAll(m_brushes);
-            Utility::deleteAll(m_faces);
+            m_brushes.clear();
+            m_faces.clear();
         }
         
         SnapshotCommand::SnapshotCommand(Command::Type type, Model::MapDocument& document, const wxString& name) :
@@ -165,5 +155,26 @@ namespace TrenchBroom {
         SnapshotCommand::~SnapshotCommand() {
             clear();
         }
+        
+        size_t SnapshotCommand::memoryUsage(SharedBlockSet& countedBlocks) const {
+            size_t memoryUsage = 0;
+            
+            EntitySnapshotMap::const_iterator entityIt, entityEnd;
+            for (entityIt = m_entities.begin(), entityEnd = m_entities.end(); entityIt != entityEnd; ++entityIt)
+                memoryUsage += entityIt->second->memoryUsage();
+            
+            memoryUsage += m_brushes.capacity() * sizeof(BrushSnapshot);
+            BrushSnapshotList::const_iterator brushIt, brushEnd;
+            for (brushIt = m_brushes.begin(), brushEnd = m_brushes.end(); brushIt != brushEnd; ++brushIt) {
+                const BrushSnapshot& snapshot = *brushIt;
+                if (countedBlocks.insert(snapshot.geometry().get()).second)
+                    memoryUsage += snapshot.geometry()->memoryUsage();
+                if (countedBlocks.insert(snapshot.attributes().get()).second)
+                    memoryUsage += snapshot.attributes()->memoryUsage();
+            }
+            
+            memoryUsage += m_faces.capacity() * sizeof(FaceSnapshot);
+            return memoryUsage;
+        }
     }
 }
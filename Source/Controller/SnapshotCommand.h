@@ -20,14 +20,17 @@
 #ifndef __TrenchBroom__SnapshotCommand__
 #define __TrenchBroom__SnapshotCommand__
 
+#include "Controller/BrushSnapshot.h"
 #include "Controller/Command.h"
 
 #include "Model/BrushTypes.h"
 #include "Model/EntityProperty.h"
 #include "Model/EntityTypes.h"
 #include "Model/FaceTypes.h"
+#include "Utility/InternedString.h"
 #include "Utility/String.h"
 
+#include <vector>
 
 namespace TrenchBroom {
     namespace Model {
@@ -46,17 +49,7 @@ namespace TrenchBroom {
             EntitySnapshot(const Model::Entity& entity);
             unsigned int uniqueId();
             void restore(Model::Entity& entity);
-        };
-        
-        class BrushSnapshot {
-        private:
-            unsigned int m_uniqueId;
-            Model::FaceList m_faces;
-        public:
-            BrushSnapshot(const Model::Brush& brush);
-            ~BrushSnapshot();
-            unsigned int uniqueId();
-            void restore(Model::Brush& brush);
+            size_t memoryUsage() const;
         };
         
         class FaceSnapshot {
@@ -68,22 +61,27 @@ namespace TrenchBroom {
             float m_yScale;
             float m_rotation;
             Model::Texture* m_texture;
-            String m_textureName;
+            Utility::InternedString m_textureName;
         public:
             FaceSnapshot(const Model::Face& face);
-            unsigned int faceId();
-            void restore(Model::Face& face);
+            unsigned int faceId() const;
+            void restore(Model::Face& face) const;
+            
+            inline bool operator< (const FaceSnapshot& other) const {
+                return m_faceId < other.m_faceId;
+            }
         };
         
         class SnapshotCommand : public DocumentCommand {
         private:
             typedef std::map<unsigned int, EntitySnapshot*> EntitySnapshotMap;
-            typedef std::map<unsigned int, BrushSnapshot*> BrushSnapshotMap;
-            typedef std::map<unsigned int, FaceSnapshot*> FaceSnapshotMap;
+            // sorted by ID
+            typedef std::vector<FaceSnapshot> FaceSnapshotList;
 
             EntitySnapshotMap m_entities;
-            BrushSnapshotMap m_brushes;
-            FaceSnapshotMap m_faces;
+            // sorted by ID, the face data is shared with the snapshots of other commands
+            BrushSnapshotList m_brushes;
+            FaceSnapshotList m_faces;
         protected:
             void makeSnapshots(const Model::EntityList& entities);
             void makeSnapshots(const Model::BrushList& brushes);
@@ -95,6 +93,8 @@ namespace TrenchBroom {
         public:
             SnapshotCommand(Command::Type type, Model::MapDocument& document, const wxString& name);
             virtual ~SnapshotCommand();
+            
+            size_t memoryUsage(SharedBlockSet& countedBlocks) const;
         };
     }
 }
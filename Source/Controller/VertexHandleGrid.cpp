@@ -0,0 +1,116 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "VertexHandleGrid.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace TrenchBroom {
+    namespace Controller {
+        VertexHandleGrid::VertexHandleGrid(float cellSize) :
+        m_cellSize(cellSize),
+        m_count(0) {
+            assert(m_cellSize > 0.0f);
+        }
+        
+        void VertexHandleGrid::add(const Vec3f& position) {
+            m_cells[cell(position)].push_back(position);
+            m_count++;
+        }
+        
+        bool VertexHandleGrid::remove(const Vec3f& position) {
+            CellMap::iterator cellIt = m_cells.find(cell(position));
+            if (cellIt == m_cells.end())
+                return false;
+            
+            Vec3f::List& positions = cellIt->second;
+            Vec3f::List::iterator it = std::find(positions.begin(), positions.end(), position);
+            if (it == positions.end())
+                return false;
+            
+            // the order within a cell does not matter
+            *it = positions.back();
+            positions.pop_back();
+            if (positions.empty())
+                m_cells.erase(cellIt);
+            
+            assert(m_count > 0);
+            m_count--;
+            return true;
+        }
+        
+        void VertexHandleGrid::clear() {
+            m_cells.clear();
+            m_count = 0;
+        }
+        
+        bool VertexHandleGrid::findCandidates(const Rayf& ray, float maxDistance, float radius, Vec3f::List& result) const {
+            if (m_cells.empty())
+                return true;
+            
+            /*
+             * The ray is sampled once per cell size. Every point within the radius of the ray is within the radius plus
+             * half a cell size of one of the samples, so it suffices to look at the cells which overlap the cubes of
+             * that half size around the samples.
+             */
+            const float halfSize = radius + m_cellSize / 2.0f;
+            const size_t sampleCount = static_cast<size_t>(std::ceil(maxDistance / m_cellSize)) + 1;
+            const size_t cellsPerAxis = static_cast<size_t>(std::ceil(2.0f * halfSize / m_cellSize)) + 1;
+            
+            // looking up a cell takes about as long as testing sixteen handles
+            CellMap::const_iterator cellIt, cellEnd = m_cells.end();
+            if (16 * sampleCount * cellsPerAxis * cellsPerAxis >= m_count)
+                return false;
+            
+            Cell previousMin(1, 1, 1);
+            Cell previousMax(0, 0, 0);
+            for (size_t i = 0; i < sampleCount; i++) {
+                const float distance = std::min(i * m_cellSize, maxDistance);
+                const Vec3f sample = ray.pointAtDistance(distance);
+                const Cell min = cell(sample - Vec3f(halfSize, halfSize, halfSize));
+                const Cell max = cell(sample + Vec3f(halfSize, halfSize, halfSize));
+                
+                for (int x = min.x; x <= max.x; x++) {
+                    for (int y = min.y; y <= max.y; y++) {
+                        for (int z = min.z; z <= max.z; z++) {
+                            /*
+                             * The cubes move monotonically along each axis, so a cell which was visited for an earlier
+                             * sample and overlaps this sample's cube must also overlap the previous sample's cube.
+                             */
+                            if (x >= previousMin.x && x <= previousMax.x &&
+                                y >= previousMin.y && y <= previousMax.y &&
+                                z >= previousMin.z && z <= previousMax.z)
+                                continue;
+                            
+                            cellIt = m_cells.find(Cell(x, y, z));
+                            if (cellIt != cellEnd)
+                                result.insert(result.end(), cellIt->second.begin(), cellIt->second.end());
+                        }
+                    }
+                }
+                
+                previousMin = min;
+                previousMax = max;
+            }
+            return true;
+        }
+    }
+}
@@ -0,0 +1,92 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TrenchBroom__VertexHandleGrid__
+#define __TrenchBroom__VertexHandleGrid__
+
+#include "Utility/VecMath.h"
+
+#include <cmath>
+#include <map>
+#include <vector>
+
+using namespace TrenchBroom::VecMath;
+
+namespace TrenchBroom {
+    namespace Controller {
+        /*
+         * Buckets handle positions into a uniform grid of cubic cells, so that a ray query only needs to look at the
+         * cells along the ray instead of at every handle. Only the occupied cells are stored.
+         */
+        class VertexHandleGrid {
+        private:
+            class Cell {
+            public:
+                int x, y, z;
+                
+                Cell(int i_x, int i_y, int i_z) :
+                x(i_x),
+                y(i_y),
+                z(i_z) {}
+                
+                inline bool operator<(const Cell& other) const {
+                    if (x != other.x)
+                        return x < other.x;
+                    if (y != other.y)
+                        return y < other.y;
+                    return z < other.z;
+                }
+            };
+            
+            typedef std::map<Cell, Vec3f::List> CellMap;
+            
+            float m_cellSize;
+            CellMap m_cells;
+            size_t m_count;
+            
+            inline int cellCoordinate(float value) const {
+                return static_cast<int>(std::floor(value / m_cellSize));
+            }
+            
+            inline Cell cell(const Vec3f& position) const {
+                return Cell(cellCoordinate(position.x()), cellCoordinate(position.y()), cellCoordinate(position.z()));
+            }
+        public:
+            VertexHandleGrid(float cellSize = 64.0f);
+            
+            void add(const Vec3f& position);
+            bool remove(const Vec3f& position);
+            void clear();
+            
+            inline size_t count() const {
+                return m_count;
+            }
+            
+            /*
+             * Collects every position which is no further than the given radius from the part of the given ray that
+             * lies between the ray's origin and the given maximum distance. The result may also contain some positions
+             * which are a little further away. Returns false without collecting anything if there are so few positions
+             * that testing all of them is faster.
+             */
+            bool findCandidates(const Rayf& ray, float maxDistance, float radius, Vec3f::List& result) const;
+        };
+    }
+}
+
+#endif /* defined(__TrenchBroom__VertexHandleGrid__) */
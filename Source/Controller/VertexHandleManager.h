@@ -20,6 +20,7 @@
 #ifndef __TrenchBroom__HandleManager__
 #define __TrenchBroom__HandleManager__
 
+#include "Controller/VertexHandleGrid.h"
 #include "Model/Brush.h"
 #include "Model/BrushGeometryTypes.h"
 #include "Model/Picker.h"
@@ -67,6 +68,9 @@ namespace TrenchBroom {
             Model::VertexToEdgesMap m_selectedEdgeHandles;
             Model::VertexToFacesMap m_unselectedFaceHandles;
             Model::VertexToFacesMap m_selectedFaceHandles;
+            VertexHandleGrid m_vertexHandleGrid;
+            VertexHandleGrid m_edgeHandleGrid;
+            VertexHandleGrid m_faceHandleGrid;
             
             size_t m_totalVertexCount;
             size_t m_selectedVertexCount;
@@ -83,8 +87,12 @@ namespace TrenchBroom {
             bool m_renderStateValid;
             bool m_recreateRenderers;
             
+            /*
+             * Each handle position is kept either in the selected or in the unselected map, and it is kept in the grid
+             * as long as it is in one of them. Moving a handle between the maps therefore leaves the grid unchanged.
+             */
             template <typename Element>
-            inline bool removeHandle(const Vec3f& position, Element& element, std::map<Vec3f, std::vector<Element*>, Vec3f::LexicographicOrder >& map) {
+            inline bool removeHandle(const Vec3f& position, Element& element, std::map<Vec3f, std::vector<Element*>, Vec3f::LexicographicOrder >& map, VertexHandleGrid& grid) {
                 typedef std::vector<Element*> List;
                 typedef std::map<Vec3f, List, Vec3f::LexicographicOrder> Map;
                 
@@ -98,8 +106,10 @@ namespace TrenchBroom {
                     return false;
                 
                 elements.erase(listIt);
-                if (elements.empty())
+                if (elements.empty()) {
                     map.erase(mapIt);
+                    grid.remove(position);
+                }
                 return true;
             }
             
@@ -121,12 +131,7 @@ namespace TrenchBroom {
                 return elementCount;
             }
             
-            inline Model::VertexHandleHit* pickHandle(const Rayf& ray, const Vec3f& position, Model::HitType::Type type) const {
-                Preferences::PreferenceManager& prefs = Preferences::PreferenceManager::preferences();
-                float handleRadius = prefs.getFloat(Preferences::HandleRadius);
-                float scalingFactor = prefs.getFloat(Preferences::HandleScalingFactor);
-                float maxDistance = prefs.getFloat(Preferences::MaximumHandleDistance);
-
+            inline Model::VertexHandleHit* pickHandle(const Rayf& ray, const Vec3f& position, Model::HitType::Type type, float handleRadius, float scalingFactor, float maxDistance) const {
                 float distance = ray.intersectWithSphere(position, 2.0f * handleRadius, scalingFactor, maxDistance);
                 if (!Math<float>::isnan(distance)) {
                     Vec3f hitPoint = ray.pointAtDistance(distance);
@@ -136,6 +141,48 @@ namespace TrenchBroom {
                 return NULL;
             }
             
+            template <typename Element>
+            inline void pickHandles(const Rayf& ray, const std::map<Vec3f, std::vector<Element*>, Vec3f::LexicographicOrder >& handles, Model::HitType::Type type, float handleRadius, float scalingFactor, float maxDistance, Model::PickResult& pickResult) const {
+                typedef std::map<Vec3f, std::vector<Element*>, Vec3f::LexicographicOrder> Map;
+
+                typename Map::const_iterator it, end;
+                for (it = handles.begin(), end = handles.end(); it != end; ++it) {
+                    Model::VertexHandleHit* hit = pickHandle(ray, it->first, type, handleRadius, scalingFactor, maxDistance);
+                    if (hit != NULL)
+                        pickResult.add(hit);
+                }
+            }
+            
+            template <typename Element>
+            inline void pickHandles(const Rayf& ray, const VertexHandleGrid& grid, const std::map<Vec3f, std::vector<Element*>, Vec3f::LexicographicOrder >& unselectedHandles, const std::map<Vec3f, std::vector<Element*>, Vec3f::LexicographicOrder >& selectedHandles, bool pickUnselected, Model::HitType::Type type, Model::PickResult& pickResult) const {
+                Preferences::PreferenceManager& prefs = Preferences::PreferenceManager::preferences();
+                float handleRadius = prefs.getFloat(Preferences::HandleRadius);
+                float scalingFactor = prefs.getFloat(Preferences::HandleScalingFactor);
+                float maxDistance = prefs.getFloat(Preferences::MaximumHandleDistance);
+                
+                // there are usually only a few selected handles, so they are tested directly
+                if (!pickUnselected) {
+                    pickHandles(ray, selectedHandles, type, handleRadius, scalingFactor, maxDistance, pickResult);
+                    return;
+                }
+                
+                // a handle is scaled with its distance to the ray origin, so it is never larger than at the maximum distance
+                const float maxRadius = 2.0f * handleRadius * scalingFactor * maxDistance;
+                Vec3f::List candidates;
+                if (!grid.findCandidates(ray, maxDistance, maxRadius, candidates)) {
+                    pickHandles(ray, unselectedHandles, type, handleRadius, scalingFactor, maxDistance, pickResult);
+                    pickHandles(ray, selectedHandles, type, handleRadius, scalingFactor, maxDistance, pickResult);
+                    return;
+                }
+                
+                Vec3f::List::const_iterator it, end;
+                for (it = candidates.begin(), end = candidates.end(); it != end; ++it) {
+                    Model::VertexHandleHit* hit = pickHandle(ray, *it, type, handleRadius, scalingFactor, maxDistance);
+                    if (hit != NULL)
+                        pickResult.add(hit);
+                }
+            }
+            
             void createRenderers();
             void destroyRenderers();
         public:
@@ -21,10 +21,14 @@
 
 #include <wx/wx.h>
 #include <wx/filename.h>
+#include <wx/stdpaths.h>
 
+#include <cstdio>
 #include <map> 
 
-#ifndef _WIN32
+#ifdef _WIN32
+#include <Windows.h>
+#else
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/mman.h>
@@ -66,7 +70,7 @@ namespace TrenchBroom {
         }
         
         bool AbstractFileManager::makeDirectory(const String& path) {
-            return wxMkdir(path);
+            return wxFileName::Mkdir(path, wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL);
         }
         
         bool AbstractFileManager::deleteFile(const String& path) {
@@ -74,7 +78,32 @@ namespace TrenchBroom {
         }
         
         bool AbstractFileManager::moveFile(const String& sourcePath, const String& destPath, bool overwrite) {
-            return wxRenameFile(sourcePath, destPath, overwrite);
+            /*
+             * The caches and the map writer replace their files by moving a temporary file over them, so this must
+             * replace the destination atomically: readers see either the old or the new file, never a partial one.
+             * wxRenameFile deletes the destination first on Windows.
+             */
+#ifdef _WIN32
+            DWORD flags = MOVEFILE_WRITE_THROUGH;
+            if (overwrite)
+                flags |= MOVEFILE_REPLACE_EXISTING;
+            return MoveFileExA(sourcePath.c_str(), destPath.c_str(), flags) != 0;
+#else
+            if (!overwrite && exists(destPath))
+                return false;
+            return rename(sourcePath.c_str(), destPath.c_str()) == 0;
+#endif
+        }
+        
+        size_t AbstractFileManager::fileSize(const String& path) {
+            const wxULongLong size = wxFileName::GetSize(path);
+            if (size == wxInvalidSize)
+                return 0;
+            return static_cast<size_t>(size.GetValue());
+        }
+        
+        time_t AbstractFileManager::modificationTime(const String& path) {
+            return wxFileModificationTime(path);
         }
         
         char AbstractFileManager::pathSeparator() {
@@ -258,6 +287,10 @@ namespace TrenchBroom {
             return resolvePath(appendPath(folderPath, relativePath));
         }
 
+        String AbstractFileManager::cacheDirectory() {
+            return appendPath(wxStandardPaths::Get().GetUserDataDir().ToStdString(), "Cache");
+        }
+
         String AbstractFileManager::pathExtension(const String& path) {
             size_t pos = path.find_last_of('.');
             if (pos == String::npos) return "";
@@ -304,7 +337,7 @@ namespace TrenchBroom {
                 const size_t size = static_cast<size_t>(lseek(filedesc, 0, SEEK_END));
                 lseek(filedesc, 0, SEEK_SET);
                 char* address = static_cast<char*>(mmap(NULL, size, prot, MAP_FILE | MAP_PRIVATE, filedesc, 0));
-                if (address != NULL)
+                if (address != MAP_FAILED)
                     return MappedFile::Ptr(new PosixMappedFile(filedesc, address, size));
                 close(filedesc);
             }
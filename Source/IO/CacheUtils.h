@@ -0,0 +1,99 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TrenchBroom_CacheUtils_h
+#define TrenchBroom_CacheUtils_h
+
+#include "IO/IOUtils.h"
+#include "Utility/String.h"
+#include "Utility/VecMath.h"
+
+#include <iostream>
+
+#ifdef _MSC_VER
+#include <cstdint>
+#elif defined __GNUC__
+#include <stdint.h>
+#endif
+
+using namespace TrenchBroom::VecMath;
+
+namespace TrenchBroom {
+    namespace IO {
+        /*
+         * Reads from a cache file and remembers whether it has run past the end of the file, so that the values need
+         * not be checked one by one.
+         */
+        class CacheReader {
+        private:
+            char* m_cursor;
+            const char* m_end;
+            bool m_valid;
+            
+            inline bool require(size_t size) {
+                if (m_valid && static_cast<size_t>(m_end - m_cursor) < size)
+                    m_valid = false;
+                return m_valid;
+            }
+        public:
+            CacheReader(char* begin, const char* end) :
+            m_cursor(begin),
+            m_end(end),
+            m_valid(true) {}
+            
+            inline bool valid() const {
+                return m_valid;
+            }
+            
+            template <typename T>
+            inline T read() {
+                if (!require(sizeof(T)))
+                    return T();
+                return IO::read<T>(m_cursor);
+            }
+            
+            inline Vec3f readVec3f() {
+                if (!require(3 * sizeof(float)))
+                    return Vec3f::Null;
+                return IO::readVec3f(m_cursor);
+            }
+            
+            inline String readString() {
+                const size_t length = static_cast<size_t>(read<uint32_t>());
+                if (!require(length))
+                    return "";
+                const String result(m_cursor, length);
+                m_cursor += length;
+                return result;
+            }
+        };
+        
+        inline void writeString(std::ostream& stream, const String& str) {
+            IO::write<uint32_t>(stream, static_cast<uint32_t>(str.size()));
+            stream.write(str.data(), static_cast<std::streamsize>(str.size()));
+        }
+        
+        inline void writeVec3f(std::ostream& stream, const Vec3f& vec) {
+            for (size_t i = 0; i < 3; i++)
+                IO::write<float>(stream, vec[i]);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,349 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "EntityDefinitionCache.h"
+
+#include "IO/CacheUtils.h"
+#include "IO/IOUtils.h"
+#include "Model/EntityDefinition.h"
+#include "Model/PropertyDefinition.h"
+#include "Utility/Hash.h"
+#include "Utility/List.h"
+
+#include <cstring>
+
+namespace TrenchBroom {
+    namespace IO {
+        namespace EntityDefinitionCacheLayout {
+            static const char Magic[4]              = {'T', 'B', 'D', 'C'};
+            static const uint32_t Version           = 1;
+            static const size_t HeaderSize          = 4 + 4 + 8 + 8 + 4 + 4 * 4 + 4;
+            static const uint8_t NoEvaluator        = 0xFF;
+        }
+        
+        namespace {
+            void writePropertyDefinition(std::ostream& stream, const Model::PropertyDefinition& definition) {
+                IO::write<uint8_t>(stream, static_cast<uint8_t>(definition.type()));
+                writeString(stream, definition.name());
+                writeString(stream, definition.description());
+                
+                switch (definition.type()) {
+                    case Model::PropertyDefinition::StringProperty:
+                        writeString(stream, definition.defaultPropertyValue());
+                        break;
+                    case Model::PropertyDefinition::IntegerProperty: {
+                        const Model::IntegerPropertyDefinition& integerDefinition = static_cast<const Model::IntegerPropertyDefinition&>(definition);
+                        IO::write<int32_t>(stream, static_cast<int32_t>(integerDefinition.defaultValue()));
+                        break;
+                    }
+                    case Model::PropertyDefinition::FloatProperty: {
+                        const Model::FloatPropertyDefinition& floatDefinition = static_cast<const Model::FloatPropertyDefinition&>(definition);
+                        IO::write<float>(stream, floatDefinition.defaultValue());
+                        break;
+                    }
+                    case Model::PropertyDefinition::ChoiceProperty: {
+                        const Model::ChoicePropertyDefinition& choiceDefinition = static_cast<const Model::ChoicePropertyDefinition&>(definition);
+                        IO::write<int32_t>(stream, static_cast<int32_t>(choiceDefinition.defaultValue()));
+                        
+                        const Model::ChoicePropertyOption::List& options = choiceDefinition.options();
+                        IO::write<uint32_t>(stream, static_cast<uint32_t>(options.size()));
+                        Model::ChoicePropertyOption::List::const_iterator it, end;
+                        for (it = options.begin(), end = options.end(); it != end; ++it) {
+                            writeString(stream, it->value());
+                            writeString(stream, it->description());
+                        }
+                        break;
+                    }
+                    case Model::PropertyDefinition::FlagsProperty: {
+                        const Model::FlagsPropertyDefinition& flagsDefinition = static_cast<const Model::FlagsPropertyDefinition&>(definition);
+                        
+                        const Model::FlagsPropertyOption::List& options = flagsDefinition.options();
+                        IO::write<uint32_t>(stream, static_cast<uint32_t>(options.size()));
+                        Model::FlagsPropertyOption::List::const_iterator it, end;
+                        for (it = options.begin(), end = options.end(); it != end; ++it) {
+                            IO::write<int32_t>(stream, static_cast<int32_t>(it->value()));
+                            writeString(stream, it->description());
+                            IO::write<uint8_t>(stream, it->isDefault() ? 1 : 0);
+                        }
+                        break;
+                    }
+                    default:
+                        break;
+                }
+            }
+            
+            Model::PropertyDefinition::Ptr readPropertyDefinition(CacheReader& reader) {
+                const Model::PropertyDefinition::Type type = static_cast<Model::PropertyDefinition::Type>(reader.read<uint8_t>());
+                const String name = reader.readString();
+                const String description = reader.readString();
+                
+                switch (type) {
+                    case Model::PropertyDefinition::TargetSourceProperty:
+                    case Model::PropertyDefinition::TargetDestinationProperty:
+                        return Model::PropertyDefinition::Ptr(new Model::PropertyDefinition(name, type, description));
+                    case Model::PropertyDefinition::StringProperty: {
+                        const String defaultValue = reader.readString();
+                        return Model::PropertyDefinition::Ptr(new Model::StringPropertyDefinition(name, description, defaultValue));
+                    }
+                    case Model::PropertyDefinition::IntegerProperty: {
+                        const int defaultValue = static_cast<int>(reader.read<int32_t>());
+                        return Model::PropertyDefinition::Ptr(new Model::IntegerPropertyDefinition(name, description, defaultValue));
+                    }
+                    case Model::PropertyDefinition::FloatProperty: {
+                        const float defaultValue = reader.read<float>();
+                        return Model::PropertyDefinition::Ptr(new Model::FloatPropertyDefinition(name, description, defaultValue));
+                    }
+                    case Model::PropertyDefinition::ChoiceProperty: {
+                        const int defaultValue = static_cast<int>(reader.read<int32_t>());
+                        Model::ChoicePropertyDefinition* definition = new Model::ChoicePropertyDefinition(name, description, defaultValue);
+                        
+                        const size_t optionCount = static_cast<size_t>(reader.read<uint32_t>());
+                        for (size_t i = 0; i < optionCount && reader.valid(); i++) {
+                            const String value = reader.readString();
+                            const String optionDescription = reader.readString();
+                            definition->addOption(value, optionDescription);
+                        }
+                        return Model::PropertyDefinition::Ptr(definition);
+                    }
+                    case Model::PropertyDefinition::FlagsProperty: {
+                        Model::FlagsPropertyDefinition* definition = new Model::FlagsPropertyDefinition(name, description);
+                        
+                        const size_t optionCount = static_cast<size_t>(reader.read<uint32_t>());
+                        for (size_t i = 0; i < optionCount && reader.valid(); i++) {
+                            const int value = static_cast<int>(reader.read<int32_t>());
+                            const String optionDescription = reader.readString();
+                            const bool isDefault = reader.read<uint8_t>() != 0;
+                            definition->addOption(value, optionDescription, isDefault);
+                        }
+                        return Model::PropertyDefinition::Ptr(definition);
+                    }
+                    default:
+                        return Model::PropertyDefinition::Ptr();
+                }
+            }
+            
+            void writeModelDefinition(std::ostream& stream, const Model::ModelDefinition& definition) {
+                writeString(stream, definition.name());
+                IO::write<uint32_t>(stream, static_cast<uint32_t>(definition.skinIndex()));
+                IO::write<uint32_t>(stream, static_cast<uint32_t>(definition.frameIndex()));
+                
+                const Model::ModelDefinitionEvaluator* evaluator = definition.evaluator();
+                if (evaluator == NULL) {
+                    IO::write<uint8_t>(stream, EntityDefinitionCacheLayout::NoEvaluator);
+                    return;
+                }
+                
+                IO::write<uint8_t>(stream, static_cast<uint8_t>(evaluator->type()));
+                if (evaluator->type() == Model::ModelDefinitionEvaluator::PropertyEvaluator) {
+                    const Model::ModelDefinitionPropertyEvaluator& propertyEvaluator = static_cast<const Model::ModelDefinitionPropertyEvaluator&>(*evaluator);
+                    writeString(stream, propertyEvaluator.propertyKey());
+                    writeString(stream, propertyEvaluator.propertyValue());
+                } else if (evaluator->type() == Model::ModelDefinitionEvaluator::FlagEvaluator) {
+                    const Model::ModelDefinitionFlagEvaluator& flagEvaluator = static_cast<const Model::ModelDefinitionFlagEvaluator&>(*evaluator);
+                    writeString(stream, flagEvaluator.propertyKey());
+                    IO::write<int32_t>(stream, static_cast<int32_t>(flagEvaluator.flagValue()));
+                }
+            }
+            
+            Model::ModelDefinition::Ptr readModelDefinition(CacheReader& reader) {
+                const String name = reader.readString();
+                const unsigned int skinIndex = static_cast<unsigned int>(reader.read<uint32_t>());
+                const unsigned int frameIndex = static_cast<unsigned int>(reader.read<uint32_t>());
+                
+                const uint8_t evaluatorType = reader.read<uint8_t>();
+                if (evaluatorType == EntityDefinitionCacheLayout::NoEvaluator)
+                    return Model::ModelDefinition::Ptr(new Model::ModelDefinition(name, skinIndex, frameIndex));
+                
+                if (evaluatorType == Model::ModelDefinitionEvaluator::PropertyEvaluator) {
+                    const String propertyKey = reader.readString();
+                    const String propertyValue = reader.readString();
+                    return Model::ModelDefinition::Ptr(new Model::ModelDefinition(name, skinIndex, frameIndex, propertyKey, propertyValue));
+                }
+                
+                if (evaluatorType == Model::ModelDefinitionEvaluator::FlagEvaluator) {
+                    const String propertyKey = reader.readString();
+                    const int flagValue = static_cast<int>(reader.read<int32_t>());
+                    return Model::ModelDefinition::Ptr(new Model::ModelDefinition(name, skinIndex, frameIndex, propertyKey, flagValue));
+                }
+                
+                return Model::ModelDefinition::Ptr();
+            }
+            
+            inline void writeColor(std::ostream& stream, const Color& color) {
+                for (size_t i = 0; i < 4; i++)
+                    IO::write<float>(stream, color[i]);
+            }
+            
+            inline Color readColor(CacheReader& reader) {
+                const float r = reader.read<float>();
+                const float g = reader.read<float>();
+                const float b = reader.read<float>();
+                const float a = reader.read<float>();
+                return Color(r, g, b, a);
+            }
+            
+            void writeDefinition(std::ostream& stream, const Model::EntityDefinition& definition) {
+                IO::write<uint8_t>(stream, static_cast<uint8_t>(definition.type()));
+                writeString(stream, definition.name());
+                writeColor(stream, definition.color());
+                writeString(stream, definition.description());
+                
+                const Model::PropertyDefinition::List& propertyDefinitions = definition.propertyDefinitions();
+                IO::write<uint32_t>(stream, static_cast<uint32_t>(propertyDefinitions.size()));
+                Model::PropertyDefinition::List::const_iterator propertyIt, propertyEnd;
+                for (propertyIt = propertyDefinitions.begin(), propertyEnd = propertyDefinitions.end(); propertyIt != propertyEnd; ++propertyIt)
+                    writePropertyDefinition(stream, **propertyIt);
+                
+                if (definition.type() == Model::EntityDefinition::PointEntity) {
+                    const Model::PointEntityDefinition& pointDefinition = static_cast<const Model::PointEntityDefinition&>(definition);
+                    writeVec3f(stream, pointDefinition.bounds().min);
+                    writeVec3f(stream, pointDefinition.bounds().max);
+                    
+                    const Model::ModelDefinition::List& modelDefinitions = pointDefinition.modelDefinitions();
+                    IO::write<uint32_t>(stream, static_cast<uint32_t>(modelDefinitions.size()));
+                    Model::ModelDefinition::List::const_iterator modelIt, modelEnd;
+                    for (modelIt = modelDefinitions.begin(), modelEnd = modelDefinitions.end(); modelIt != modelEnd; ++modelIt)
+                        writeModelDefinition(stream, **modelIt);
+                }
+            }
+            
+            Model::EntityDefinition* readDefinition(CacheReader& reader) {
+                const Model::EntityDefinition::Type type = static_cast<Model::EntityDefinition::Type>(reader.read<uint8_t>());
+                const String name = reader.readString();
+                const Color color = readColor(reader);
+                const String description = reader.readString();
+                
+                Model::PropertyDefinition::List propertyDefinitions;
+                const size_t propertyCount = static_cast<size_t>(reader.read<uint32_t>());
+                for (size_t i = 0; i < propertyCount && reader.valid(); i++) {
+                    Model::PropertyDefinition::Ptr propertyDefinition = readPropertyDefinition(reader);
+                    if (propertyDefinition.get() == NULL)
+                        return NULL;
+                    propertyDefinitions.push_back(propertyDefinition);
+                }
+                
+                if (type == Model::EntityDefinition::BrushEntity) {
+                    if (!reader.valid())
+                        return NULL;
+                    return new Model::BrushEntityDefinition(name, color, description, propertyDefinitions);
+                }
+                
+                if (type != Model::EntityDefinition::PointEntity)
+                    return NULL;
+                
+                BBoxf bounds;
+                bounds.min = reader.readVec3f();
+                bounds.max = reader.readVec3f();
+                
+                Model::ModelDefinition::List modelDefinitions;
+                const size_t modelCount = static_cast<size_t>(reader.read<uint32_t>());
+                for (size_t i = 0; i < modelCount && reader.valid(); i++) {
+                    Model::ModelDefinition::Ptr modelDefinition = readModelDefinition(reader);
+                    if (modelDefinition.get() == NULL)
+                        return NULL;
+                    modelDefinitions.push_back(modelDefinition);
+                }
+                
+                if (!reader.valid())
+                    return NULL;
+                return new Model::PointEntityDefinition(name, color, bounds, description, propertyDefinitions, modelDefinitions);
+            }
+        }
+        
+        char* EntityDefinitionCache::readHeader(const MappedFile& file) const {
+            const char* end = file.end();
+            char* cursor = file.begin();
+            
+            if (file.size() < EntityDefinitionCacheLayout::HeaderSize)
+                return NULL;
+            if (memcmp(cursor, EntityDefinitionCacheLayout::Magic, 4) != 0)
+                return NULL;
+            cursor += 4;
+            if (read<uint32_t>(cursor) != EntityDefinitionCacheLayout::Version)
+                return NULL;
+            if (read<uint64_t>(cursor) != static_cast<uint64_t>(m_definitionSize))
+                return NULL;
+            if (read<int64_t>(cursor) != static_cast<int64_t>(m_definitionModificationTime))
+                return NULL;
+            if (read<uint32_t>(cursor) != m_definitionChecksum)
+                return NULL;
+            
+            // DEF files do not always specify a color, so the definitions depend on the default color, too
+            for (size_t i = 0; i < 4; i++)
+                if (read<float>(cursor) != m_defaultColor[i])
+                    return NULL;
+            
+            const size_t pathLength = readSize<uint32_t>(cursor);
+            if (pathLength != m_definitionPath.size() || static_cast<size_t>(end - cursor) < pathLength)
+                return NULL;
+            if (m_definitionPath.compare(0, pathLength, cursor, pathLength) != 0)
+                return NULL;
+            return cursor + pathLength;
+        }
+        
+        EntityDefinitionCache::EntityDefinitionCache(const String& definitionPath, const char* begin, const char* end, time_t definitionModificationTime, const Color& defaultColor) :
+        m_definitionPath(definitionPath),
+        m_definitionSize(static_cast<size_t>(end - begin)),
+        m_definitionModificationTime(definitionModificationTime),
+        m_definitionChecksum(Utility::hash(begin, m_definitionSize)),
+        m_defaultColor(defaultColor) {}
+        
+        bool EntityDefinitionCache::loadDefinitions(const MappedFile& file, Model::EntityDefinitionList& definitions) const {
+            char* body = readHeader(file);
+            if (body == NULL)
+                return false;
+            
+            CacheReader reader(body, file.end());
+            const size_t definitionCount = static_cast<size_t>(reader.read<uint32_t>());
+            
+            Model::EntityDefinitionList result;
+            bool valid = reader.valid();
+            for (size_t i = 0; i < definitionCount && valid; i++) {
+                Model::EntityDefinition* definition = readDefinition(reader);
+                if (definition != NULL)
+                    result.push_back(definition);
+                else
+                    valid = false;
+            }
+            
+            if (!valid) {
+                Utility::deleteAll(result);
+                return false;
+            }
+            
+            definitions.insert(definitions.end(), result.begin(), result.end());
+            return true;
+        }
+        
+        void EntityDefinitionCache::write(std::ostream& stream, const Model::EntityDefinitionList& definitions) const {
+            stream.write(EntityDefinitionCacheLayout::Magic, 4);
+            IO::write<uint32_t>(stream, EntityDefinitionCacheLayout::Version);
+            IO::write<uint64_t>(stream, static_cast<uint64_t>(m_definitionSize));
+            IO::write<int64_t>(stream, static_cast<int64_t>(m_definitionModificationTime));
+            IO::write<uint32_t>(stream, m_definitionChecksum);
+            writeColor(stream, m_defaultColor);
+            writeString(stream, m_definitionPath);
+            
+            IO::write<uint32_t>(stream, static_cast<uint32_t>(definitions.size()));
+            Model::EntityDefinitionList::const_iterator it, end;
+            for (it = definitions.begin(), end = definitions.end(); it != end; ++it)
+                writeDefinition(stream, **it);
+        }
+    }
+}
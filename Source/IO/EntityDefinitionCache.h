@@ -0,0 +1,77 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TrenchBroom__EntityDefinitionCache__
+#define __TrenchBroom__EntityDefinitionCache__
+
+#include "IO/AbstractFileManager.h"
+#include "Model/EntityDefinitionTypes.h"
+#include "Utility/Color.h"
+#include "Utility/String.h"
+
+#include <ctime>
+#include <iostream>
+
+#ifdef _MSC_VER
+#include <cstdint>
+#elif defined __GNUC__
+#include <stdint.h>
+#endif
+
+namespace TrenchBroom {
+    namespace IO {
+        /*
+         * Stores the entity definitions of a DEF or FGD file as the parser returns them, that is, with the properties
+         * of their base classes already merged in, so that they can be recreated without parsing the file again. A
+         * cache file is only used if the path, the size, the modification time and the checksum of the definition
+         * file as well as the default entity color match those it was written with. Like the map cache, the file is
+         * written in native byte order. Locating, mapping and replacing the cache file is left to the caller.
+         */
+        class EntityDefinitionCache {
+        private:
+            String m_definitionPath;
+            size_t m_definitionSize;
+            time_t m_definitionModificationTime;
+            uint32_t m_definitionChecksum;
+            Color m_defaultColor;
+            
+            char* readHeader(const MappedFile& file) const;
+        public:
+            /*
+             * The given range must contain the contents of the definition file at the given path, which was last
+             * modified at the given time.
+             */
+            EntityDefinitionCache(const String& definitionPath, const char* begin, const char* end, time_t definitionModificationTime, const Color& defaultColor);
+            
+            /*
+             * Appends the definitions cached in the given file to the given list, which takes ownership of them.
+             * Returns false and leaves the list unchanged if the file does not match the definition file or is
+             * damaged.
+             */
+            bool loadDefinitions(const MappedFile& file, Model::EntityDefinitionList& definitions) const;
+            
+            /*
+             * Writes a cache file which contains the given definitions to the given stream.
+             */
+            void write(std::ostream& stream, const Model::EntityDefinitionList& definitions) const;
+        };
+    }
+}
+
+#endif /* defined(__TrenchBroom__EntityDefinitionCache__) */
@@ -353,6 +353,10 @@ namespace TrenchBroom {
                     if (properties.count(propertyKey) > 0)
                         throw ParserException(token.line(), token.column(), "Multiple definitions for property " + propertyKey);
                     properties[propertyKey] = parseIntegerProperty(propertyKey);
+                } else if (Utility::equalsString(typeName, "float", false)) {
+                    if (properties.count(propertyKey) > 0)
+                        throw ParserException(token.line(), token.column(), "Multiple definitions for property " + propertyKey);
+                    properties[propertyKey] = parseFloatProperty(propertyKey);
                 } else if (Utility::equalsString(typeName, "choices", false)) {
                     if (properties.count(propertyKey) > 0)
                         throw ParserException(token.line(), token.column(), "Multiple definitions for property " + propertyKey);
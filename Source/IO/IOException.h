@@ -44,6 +44,10 @@ namespace TrenchBroom {
                 return IOException("Unable to open file %s", path.c_str());
             }
             
+            static IOException writeError(const String& path = "") {
+                return IOException("Unable to write file %s", path.c_str());
+            }
+            
             static IOException badStream(const std::istream& stream) {
                 return IOException("Error reading file");
             }
@@ -40,23 +40,7 @@ using namespace TrenchBroom::VecMath;
 namespace TrenchBroom {
     namespace IO {
         inline MappedFile::Ptr findGameFile(const String& filePath, const StringList& searchPaths) {
-            MappedFile::Ptr mappedFile;
-            FileManager fileManager;
-
-            StringList::const_reverse_iterator pathIt, pathEnd;
-            for (pathIt = searchPaths.rbegin(), pathEnd = searchPaths.rend(); pathIt != pathEnd; ++pathIt) {
-                const String& searchPath = *pathIt;
-                const String path = fileManager.appendPath(searchPath, filePath);
-                MappedFile::Ptr file;
-                if (fileManager.exists(path) && !fileManager.isDirectory(path))
-                    file = fileManager.mapFile(path);
-                else
-                    file = PakManager::sharedManager->entry(filePath, searchPath);
-                if (file.get() != NULL)
-                    return file;
-            }
-
-            return mappedFile;
+            return PakManager::sharedManager->findGameFile(filePath, searchPaths);
         }
 
         template <typename T>
@@ -108,6 +92,11 @@ namespace TrenchBroom {
             memcpy(buffer, cursor, n);
             cursor += n;
         }
+
+        template <typename T>
+        inline void write(std::ostream& stream, T value) {
+            stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
     }
 }
 
@@ -0,0 +1,374 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MapCache.h"
+
+#include "IO/CacheUtils.h"
+#include "IO/IOUtils.h"
+#include "Model/Brush.h"
+#include "Model/BrushGeometry.h"
+#include "Model/CompactBrushGeometry.h"
+#include "Model/Entity.h"
+#include "Model/Face.h"
+#include "Model/Map.h"
+#include "Utility/Hash.h"
+#include "Utility/InternedString.h"
+#include "Utility/List.h"
+
+#include <cstring>
+#include <fstream>
+#include <map>
+
+namespace TrenchBroom {
+    namespace IO {
+        namespace MapCacheLayout {
+            static const char Magic[4]              = {'T', 'B', 'M', 'C'};
+            static const uint32_t Version           = 1;
+            static const size_t HeaderSize          = 4 + 4 + 8 + 8 + 4 + 4;
+        }
+        
+        namespace {
+            typedef Model::CompactBrushGeometry::Index Index;
+            
+            void writeBrush(std::ostream& stream, const Model::Brush& brush) {
+                IO::write<uint32_t>(stream, static_cast<uint32_t>(brush.fileLine()));
+                IO::write<uint32_t>(stream, static_cast<uint32_t>(brush.fileLineCount()));
+                IO::write<uint8_t>(stream, brush.forceIntegerFacePoints() ? 1 : 0);
+                
+                std::map<const Model::Face*, Index> faceIndices;
+                const Model::FaceList& faces = brush.faces();
+                IO::write<uint32_t>(stream, static_cast<uint32_t>(faces.size()));
+                for (size_t i = 0; i < faces.size(); i++) {
+                    const Model::Face& face = *faces[i];
+                    faceIndices[&face] = static_cast<Index>(i);
+                    
+                    for (size_t j = 0; j < 3; j++)
+                        writeVec3f(stream, face.point(j));
+                    writeVec3f(stream, face.boundary().normal);
+                    IO::write<float>(stream, face.boundary().distance);
+                    writeString(stream, face.textureName());
+                    IO::write<float>(stream, face.xOffset());
+                    IO::write<float>(stream, face.yOffset());
+                    IO::write<float>(stream, face.rotation());
+                    IO::write<float>(stream, face.xScale());
+                    IO::write<float>(stream, face.yScale());
+                    IO::write<uint32_t>(stream, static_cast<uint32_t>(face.filePosition()));
+                }
+                
+                const Model::CompactBrushGeometry geometry(brush.geometry());
+                writeVec3f(stream, geometry.center());
+                writeVec3f(stream, geometry.bounds().min);
+                writeVec3f(stream, geometry.bounds().max);
+                
+                const Vec3f::List& vertices = geometry.vertices();
+                IO::write<uint32_t>(stream, static_cast<uint32_t>(vertices.size()));
+                for (size_t i = 0; i < vertices.size(); i++)
+                    writeVec3f(stream, vertices[i]);
+                
+                const Model::CompactBrushGeometry::EdgeEntryList& edges = geometry.edges();
+                IO::write<uint32_t>(stream, static_cast<uint32_t>(edges.size()));
+                for (size_t i = 0; i < edges.size(); i++) {
+                    IO::write<uint16_t>(stream, edges[i].start);
+                    IO::write<uint16_t>(stream, edges[i].end);
+                    IO::write<uint16_t>(stream, edges[i].left);
+                    IO::write<uint16_t>(stream, edges[i].right);
+                }
+                
+                // the sides refer to their faces by their index in the brush's face list
+                const Model::CompactBrushGeometry::SideEntryList& sides = geometry.sides();
+                IO::write<uint32_t>(stream, static_cast<uint32_t>(sides.size()));
+                for (size_t i = 0; i < sides.size(); i++) {
+                    const Model::CompactBrushGeometry::SideEntry& side = sides[i];
+                    IO::write<uint16_t>(stream, side.face != NULL ? faceIndices[side.face] : Model::CompactBrushGeometry::NoIndex);
+                    IO::write<uint16_t>(stream, side.count);
+                    for (size_t j = 0; j < side.count; j++)
+                        IO::write<uint16_t>(stream, geometry.sideEdge(i, j));
+                }
+            }
+            
+            Model::Brush* readBrush(CacheReader& reader, const BBoxf& worldBounds) {
+                const size_t firstLine = static_cast<size_t>(reader.read<uint32_t>());
+                const size_t lineCount = static_cast<size_t>(reader.read<uint32_t>());
+                const bool forceIntegerFacePoints = reader.read<uint8_t>() != 0;
+                
+                const size_t faceCount = static_cast<size_t>(reader.read<uint32_t>());
+                if (!reader.valid() || faceCount >= Model::CompactBrushGeometry::NoIndex)
+                    return NULL;
+                
+                // consecutive faces usually share their texture, so the last name is kept to avoid interning it again
+                Utility::InternedString textureName;
+                Model::FaceList faces;
+                for (size_t i = 0; i < faceCount && reader.valid(); i++) {
+                    Model::FacePoints points;
+                    for (size_t j = 0; j < 3; j++)
+                        points[j] = reader.readVec3f();
+                    Planef boundary;
+                    boundary.normal = reader.readVec3f();
+                    boundary.distance = reader.read<float>();
+                    const String name = reader.readString();
+                    if (name != textureName.str())
+                        textureName = Utility::InternedString(name);
+                    
+                    Model::Face* face = new Model::Face(worldBounds, forceIntegerFacePoints, points, boundary, textureName);
+                    face->setXOffset(reader.read<float>());
+                    face->setYOffset(reader.read<float>());
+                    face->setRotation(reader.read<float>());
+                    face->setXScale(reader.read<float>());
+                    face->setYScale(reader.read<float>());
+                    face->setFilePosition(static_cast<size_t>(reader.read<uint32_t>()));
+                    faces.push_back(face);
+                }
+                
+                const Vec3f center = reader.readVec3f();
+                BBoxf bounds;
+                bounds.min = reader.readVec3f();
+                bounds.max = reader.readVec3f();
+                
+                const size_t vertexCount = static_cast<size_t>(reader.read<uint32_t>());
+                Vec3f::List vertices;
+                if (reader.valid() && vertexCount < Model::CompactBrushGeometry::NoIndex) {
+                    vertices.reserve(vertexCount);
+                    for (size_t i = 0; i < vertexCount && reader.valid(); i++)
+                        vertices.push_back(reader.readVec3f());
+                }
+                
+                const size_t edgeCount = static_cast<size_t>(reader.read<uint32_t>());
+                Model::CompactBrushGeometry::EdgeEntryList edges;
+                if (reader.valid() && edgeCount < Model::CompactBrushGeometry::NoIndex) {
+                    edges.reserve(edgeCount);
+                    for (size_t i = 0; i < edgeCount && reader.valid(); i++) {
+                        const Index start = reader.read<uint16_t>();
+                        const Index end = reader.read<uint16_t>();
+                        const Index left = reader.read<uint16_t>();
+                        const Index right = reader.read<uint16_t>();
+                        edges.push_back(Model::CompactBrushGeometry::EdgeEntry(start, end, left, right));
+                    }
+                }
+                
+                const size_t sideCount = static_cast<size_t>(reader.read<uint32_t>());
+                Model::CompactBrushGeometry::SideEntryList sides;
+                Model::CompactBrushGeometry::IndexList sideEdges;
+                if (reader.valid() && sideCount < Model::CompactBrushGeometry::NoIndex) {
+                    sides.reserve(sideCount);
+                    for (size_t i = 0; i < sideCount && reader.valid(); i++) {
+                        const Index faceIndex = reader.read<uint16_t>();
+                        const Index count = reader.read<uint16_t>();
+                        Model::Face* face = faceIndex < faces.size() ? faces[faceIndex] : NULL;
+                        sides.push_back(Model::CompactBrushGeometry::SideEntry(face, static_cast<Index>(sideEdges.size()), count));
+                        for (size_t j = 0; j < count && reader.valid(); j++)
+                            sideEdges.push_back(reader.read<uint16_t>());
+                        if (sideEdges.size() >= Model::CompactBrushGeometry::NoIndex)
+                            break;
+                    }
+                }
+                
+                // check the indices so that a damaged file cannot produce dangling references
+                bool valid = (reader.valid() &&
+                              vertices.size() == vertexCount && vertexCount > 0 &&
+                              edges.size() == edgeCount &&
+                              sides.size() == sideCount);
+                for (size_t i = 0; i < edges.size() && valid; i++) {
+                    const Model::CompactBrushGeometry::EdgeEntry& edge = edges[i];
+                    valid = (edge.start < vertexCount && edge.end < vertexCount &&
+                             (edge.left < sideCount || edge.left == Model::CompactBrushGeometry::NoIndex) &&
+                             (edge.right < sideCount || edge.right == Model::CompactBrushGeometry::NoIndex));
+                }
+                for (size_t i = 0; i < sides.size() && valid; i++) {
+                    const Model::CompactBrushGeometry::SideEntry& side = sides[i];
+                    for (size_t j = side.first; j < side.first + side.count && valid; j++)
+                        valid = sideEdges[j] < edgeCount && (edges[sideEdges[j]].left == i || edges[sideEdges[j]].right == i);
+                }
+                
+                if (!valid) {
+                    Utility::deleteAll(faces);
+                    return NULL;
+                }
+                
+                const Model::CompactBrushGeometry compactGeometry(vertices, edges, sides, sideEdges);
+                Model::BrushGeometry* geometry = compactGeometry.toBrushGeometry();
+                geometry->center = center;
+                geometry->bounds = bounds;
+                
+                Model::Brush* brush = new Model::Brush(worldBounds, forceIntegerFacePoints, faces, geometry);
+                brush->setFilePosition(firstLine, lineCount);
+                return brush;
+            }
+        }
+        
+        bool MapCache::load() {
+            const char* end = m_file->end();
+            char* cursor = m_file->begin();
+            
+            if (m_file->size() < MapCacheLayout::HeaderSize)
+                return false;
+            if (memcmp(cursor, MapCacheLayout::Magic, 4) != 0)
+                return false;
+            cursor += 4;
+            if (read<uint32_t>(cursor) != MapCacheLayout::Version)
+                return false;
+            if (read<uint64_t>(cursor) != static_cast<uint64_t>(m_mapSize))
+                return false;
+            if (read<int64_t>(cursor) != static_cast<int64_t>(m_mapModificationTime))
+                return false;
+            if (read<uint32_t>(cursor) != m_mapChecksum)
+                return false;
+            
+            const size_t pathLength = readSize<uint32_t>(cursor);
+            if (pathLength != m_mapPath.size() || static_cast<size_t>(end - cursor) < pathLength)
+                return false;
+            if (m_mapPath.compare(0, pathLength, cursor, pathLength) != 0)
+                return false;
+            cursor += pathLength;
+            
+            m_body = cursor;
+            return true;
+        }
+        
+        MapCache::MapCache(const String& mapPath, const char* begin, const char* end) :
+        m_mapPath(mapPath),
+        m_body(NULL) {
+            FileManager fileManager;
+            m_mapSize = static_cast<size_t>(end - begin);
+            m_mapModificationTime = fileManager.modificationTime(m_mapPath);
+            m_mapChecksum = Utility::hash(begin, m_mapSize);
+            
+            StringStream fileName;
+            fileName << fileManager.pathComponents(m_mapPath).back() << "-" << std::hex << Utility::hash(m_mapPath.data(), m_mapPath.size()) << ".cache";
+            m_path = fileManager.appendPath(fileManager.appendPath(fileManager.cacheDirectory(), "Maps"), fileName.str());
+            
+            if (fileManager.exists(m_path)) {
+                m_file = fileManager.mapFile(m_path);
+                if (m_file.get() != NULL && !load())
+                    m_file.reset();
+            }
+        }
+        
+        bool MapCache::loadMap(Model::Map& map) const {
+            if (!valid())
+                return false;
+            
+            CacheReader reader(m_body, m_file->end());
+            const BBoxf& worldBounds = map.worldBounds();
+            const bool forceIntegerFacePoints = reader.read<uint8_t>() != 0;
+            const size_t entityCount = static_cast<size_t>(reader.read<uint32_t>());
+            
+            Model::EntityList entities;
+            bool valid = reader.valid();
+            for (size_t i = 0; i < entityCount && valid; i++) {
+                Model::Entity* entity = new Model::Entity(worldBounds);
+                entities.push_back(entity);
+                
+                const size_t firstLine = static_cast<size_t>(reader.read<uint32_t>());
+                const size_t lineCount = static_cast<size_t>(reader.read<uint32_t>());
+                entity->setFilePosition(firstLine, lineCount);
+                
+                const size_t propertyCount = static_cast<size_t>(reader.read<uint32_t>());
+                for (size_t j = 0; j < propertyCount && reader.valid(); j++) {
+                    const String key = reader.readString();
+                    const String value = reader.readString();
+                    if (reader.valid())
+                        entity->setProperty(key, value);
+                }
+                
+                const size_t brushCount = static_cast<size_t>(reader.read<uint32_t>());
+                for (size_t j = 0; j < brushCount && valid; j++) {
+                    Model::Brush* brush = readBrush(reader, worldBounds);
+                    if (brush != NULL)
+                        entity->addBrush(*brush);
+                    else
+                        valid = false;
+                }
+                valid &= reader.valid();
+            }
+            
+            if (!valid) {
+                Utility::deleteAll(entities);
+                return false;
+            }
+            
+            // the brushes already have their face point format, so setting it on the empty map does not rebuild them
+            if (forceIntegerFacePoints)
+                map.setForceIntegerFacePoints(true);
+            
+            Model::EntityList::const_iterator it, end;
+            for (it = entities.begin(), end = entities.end(); it != end; ++it)
+                map.addEntity(**it);
+            return true;
+        }
+        
+        bool MapCache::write(const Model::Map& map) {
+            FileManager fileManager;
+            const String directoryPath = fileManager.deleteLastPathComponent(m_path);
+            if (!fileManager.exists(directoryPath) && !fileManager.makeDirectory(directoryPath))
+                return false;
+            
+            // the mapped file must be closed before it can be replaced
+            m_file.reset();
+            m_body = NULL;
+            
+            const String tempPath = m_path + ".tmp";
+            std::ofstream stream(tempPath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+            if (!stream.is_open())
+                return false;
+            
+            stream.write(MapCacheLayout::Magic, 4);
+            IO::write<uint32_t>(stream, MapCacheLayout::Version);
+            IO::write<uint64_t>(stream, static_cast<uint64_t>(m_mapSize));
+            IO::write<int64_t>(stream, static_cast<int64_t>(m_mapModificationTime));
+            IO::write<uint32_t>(stream, m_mapChecksum);
+            writeString(stream, m_mapPath);
+            
+            IO::write<uint8_t>(stream, map.forceIntegerFacePoints() ? 1 : 0);
+            
+            const Model::EntityList& entities = map.entities();
+            IO::write<uint32_t>(stream, static_cast<uint32_t>(entities.size()));
+            
+            Model::EntityList::const_iterator entityIt, entityEnd;
+            for (entityIt = entities.begin(), entityEnd = entities.end(); entityIt != entityEnd; ++entityIt) {
+                const Model::Entity& entity = **entityIt;
+                IO::write<uint32_t>(stream, static_cast<uint32_t>(entity.fileLine()));
+                IO::write<uint32_t>(stream, static_cast<uint32_t>(entity.fileLineCount()));
+                
+                const Model::PropertyList& properties = entity.properties();
+                IO::write<uint32_t>(stream, static_cast<uint32_t>(properties.size()));
+                Model::PropertyList::const_iterator propertyIt, propertyEnd;
+                for (propertyIt = properties.begin(), propertyEnd = properties.end(); propertyIt != propertyEnd; ++propertyIt) {
+                    writeString(stream, propertyIt->key());
+                    writeString(stream, propertyIt->value());
+                }
+                
+                const Model::BrushList& brushes = entity.brushes();
+                IO::write<uint32_t>(stream, static_cast<uint32_t>(brushes.size()));
+                Model::BrushList::const_iterator brushIt, brushEnd;
+                for (brushIt = brushes.begin(), brushEnd = brushes.end(); brushIt != brushEnd; ++brushIt)
+                    writeBrush(stream, **brushIt);
+            }
+            
+            const bool success = stream.good();
+            stream.close();
+            
+            // the new file only replaces the old one once it is complete, so that a crash never leaves a damaged cache
+            if (!success || !fileManager.moveFile(tempPath, m_path, true)) {
+                fileManager.deleteFile(tempPath);
+                return false;
+            }
+            return true;
+        }
+    }
+}
@@ -0,0 +1,86 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TrenchBroom__MapCache__
+#define __TrenchBroom__MapCache__
+
+#include "IO/FileManager.h"
+#include "Utility/String.h"
+
+#include <ctime>
+
+#ifdef _MSC_VER
+#include <cstdint>
+#elif defined __GNUC__
+#include <stdint.h>
+#endif
+
+namespace TrenchBroom {
+    namespace Model {
+        class Map;
+    }
+    
+    namespace IO {
+        /*
+         * Stores the entities, brushes and faces of a loaded map together with the vertices, edges and sides of the
+         * brush geometries, so that the map can be recreated without parsing it and without clipping the brushes
+         * when it is opened again. A cache file is only used if the path, the size, the modification time and the
+         * checksum of the map file match those it was written with. Like the texture cache, the file is written in
+         * native byte order.
+         */
+        class MapCache {
+        private:
+            String m_path;
+            String m_mapPath;
+            size_t m_mapSize;
+            time_t m_mapModificationTime;
+            uint32_t m_mapChecksum;
+            MappedFile::Ptr m_file;
+            char* m_body;
+            
+            bool load();
+        public:
+            /*
+             * The given range must contain the contents of the map file at the given path.
+             */
+            MapCache(const String& mapPath, const char* begin, const char* end);
+            
+            /*
+             * Indicates whether the cache file exists and matches the map file.
+             */
+            inline bool valid() const {
+                return m_file.get() != NULL;
+            }
+            
+            /*
+             * Adds the cached entities to the given empty map. Returns false and leaves the map unchanged if the cache
+             * file is damaged.
+             */
+            bool loadMap(Model::Map& map) const;
+            
+            /*
+             * Replaces the cache file with one which contains the given map. Returns false if the file could not be
+             * written.
+             */
+            bool write(const Model::Map& map);
+        };
+    }
+}
+
+#endif /* defined(__TrenchBroom__MapCache__) */
@@ -27,94 +27,104 @@
 #include "Utility/Console.h"
 #include "Utility/List.h"
 #include "Utility/ProgressIndicator.h"
+#include "Utility/ThreadPool.h"
 
 namespace TrenchBroom {
     namespace IO {
-        Token MapTokenEmitter::doEmit(Tokenizer& tokenizer) {
-            while (!tokenizer.eof()) {
-                size_t line = tokenizer.line();
-                size_t column = tokenizer.column();
-                const char* c = tokenizer.nextChar();
-                switch (*c) {
-                    case '/':
-                        if (tokenizer.peekChar() == '/') {
-                            tokenizer.nextChar();
-                            if (tokenizer.peekChar() == '/') {
-                                tokenizer.nextChar(); // it's a TB comment
-                            } else {
-                                // eat everything up to and including the next newline
-                                while (*tokenizer.nextChar() != '\n');
-                            }
-                        }
-                        break;
-                    case '{':
-                        return Token(TokenType::OBrace, c, c + 1, tokenizer.offset(c), line, column);
-                    case '}':
-                        return Token(TokenType::CBrace, c, c + 1, tokenizer.offset(c), line, column);
-                    case '(':
-                        return Token(TokenType::OParenthesis, c, c + 1, tokenizer.offset(c), line, column);
-                    case ')':
-                        return Token(TokenType::CParenthesis, c, c + 1, tokenizer.offset(c), line, column);
-                    case '[':
-                        return Token(TokenType::OBracket, c, c + 1, tokenizer.offset(c), line, column);
-                    case ']':
-                        return Token(TokenType::CBracket, c, c + 1, tokenizer.offset(c), line, column);
-                    case '"': { // quoted string
-                        const char* begin = c;
-                        const char* end;
-                        tokenizer.quotedString(begin, end);
-                        return Token(TokenType::String, begin, end, tokenizer.offset(begin), line, column);
-                    }
-                    default: { // whitespace, integer, decimal or word
-                        if (isWhitespace(*c))
-                            break;
-                        
-                        const char* begin = c;
+        class MapParser::BrushBatch : public Utility::ThreadPool::Task {
+        public:
+            class Result {
+            public:
+                Model::Brush* brush;
+                bool valid;
+                bool failed;
+                String error;
+                size_t firstMessage;
+                size_t lastMessage;
 
-                        // try to read a number
-                        if (*c == '-' || isDigit(*c)) {
-                            while (isDigit(*(c = tokenizer.nextChar())));
-                            if (isDelimiter(*c)) {
-                                if (!tokenizer.eof())
-                                    tokenizer.pushChar();
-                                return Token(TokenType::Integer, begin, c, tokenizer.offset(begin), line, column);
-                            }
-                        }
-                        
-                        // try to read a decimal (may start with '.')
-                        if (*c == '.') {
-                            while (isDigit(*(c = tokenizer.nextChar())));
-                            if (isDelimiter(*c)) {
-                                if (!tokenizer.eof())
-                                    tokenizer.pushChar();
-                                return Token(TokenType::Decimal, begin, c, tokenizer.offset(begin), line, column);
-                            }
-                        }
-                        
-                        // try to read decimal in scientific notation
-                        if (*c == 'e') {
-                            c = tokenizer.nextChar();
-                            if (isDigit(*c) || *c == '+' || *c == '-') {
-                                while (isDigit(*(c = tokenizer.nextChar())));
-                                if (isDelimiter(*c)) {
-                                    if (!tokenizer.eof())
-                                        tokenizer.pushChar();
-                                    return Token(TokenType::Decimal, begin, c, tokenizer.offset(begin), line, column);
-                                }
-                            }
+                Result() :
+                brush(NULL),
+                valid(false),
+                failed(false),
+                firstMessage(0),
+                lastMessage(0) {}
+            };
+
+            typedef std::vector<Result> ResultList;
+        private:
+            const MapParser& m_parser;
+            const BBoxf& m_worldBounds;
+            bool m_forceIntegerFacePoints;
+            size_t m_first;
+            size_t m_last;
+            Utility::BufferedConsole m_console;
+            ResultList m_results;
+        protected:
+            void run() {
+                try {
+                    MapParser parser(m_parser.m_begin, m_parser.m_end, m_console);
+                    parser.m_format = m_parser.m_format;
+
+                    for (size_t i = m_first; i < m_last; i++) {
+                        const BrushRange& range = m_parser.m_brushRanges[i];
+                        Result& result = m_results[i - m_first];
+                        result.firstMessage = m_console.messageCount();
+
+                        parser.m_tokenizer.seek(range.begin, range.line, range.column);
+                        try {
+                            result.brush = parser.parseBrush(m_worldBounds, m_forceIntegerFacePoints, NULL);
+                        } catch (MapParserException& e) {
+                            result.failed = true;
+                            result.error = e.what();
                         }
-                        
-                        // read a word
-                        while (!tokenizer.eof() && !isDelimiter(*(c = tokenizer.nextChar())));
-                        if (!tokenizer.eof())
-                            tokenizer.pushChar();
-                        return Token(TokenType::String, begin, c, tokenizer.offset(begin), line, column);
+
+                        result.lastMessage = m_console.messageCount();
+                        result.valid = result.failed || parser.m_tokenizer.position() == range.end;
+                        if (result.failed || !result.valid)
+                            break;
                     }
+                } catch (...) {
+                    // the remaining brushes will be parsed by the main thread
                 }
             }
-            return Token(TokenType::Eof, NULL, NULL, 0, tokenizer.line(), tokenizer.column());
-        }
-        
+        public:
+            BrushBatch(const MapParser& parser, const BBoxf& worldBounds, bool forceIntegerFacePoints, size_t first, size_t last) :
+            m_parser(parser),
+            m_worldBounds(worldBounds),
+            m_forceIntegerFacePoints(forceIntegerFacePoints),
+            m_first(first),
+            m_last(last),
+            m_results(last - first) {
+                assert(first < last);
+            }
+
+            ~BrushBatch() {
+                ResultList::iterator it, end;
+                for (it = m_results.begin(), end = m_results.end(); it != end; ++it) {
+                    Result& result = *it;
+                    delete result.brush;
+                    result.brush = NULL;
+                }
+            }
+
+            inline size_t first() const {
+                return m_first;
+            }
+
+            inline size_t last() const {
+                return m_last;
+            }
+
+            inline Result& result(size_t index) {
+                assert(index >= m_first && index < m_last);
+                return m_results[index - m_first];
+            }
+
+            inline const Utility::BufferedConsole& console() const {
+                return m_console;
+            }
+        };
+
         Vec3f MapParser::parseVector() {
             Token token;
             Vec3f vec;
@@ -162,7 +172,7 @@ namespace TrenchBroom {
                         m_tokenizer.pushToken(token);
                         bool moreBrushes = true;
                         while (moreBrushes) {
-                            Model::Brush* brush = parseBrush(worldBounds, facePointFormat == Integer, indicator);
+                            Model::Brush* brush = nextBrush(worldBounds, facePointFormat == Integer, indicator);
                             if (brush != NULL)
                                 entity->addBrush(*brush);
                             expect(TokenType::OBrace | TokenType::CBrace, token = m_tokenizer.nextToken());
@@ -190,24 +200,201 @@ namespace TrenchBroom {
             return entity;
         }
 
+        bool MapParser::findBrushRanges() {
+            m_brushRanges.clear();
+            
+            // this must agree with MapTokenEmitter on what is a comment, a quoted string or a brace
+            const char* lineBegin = m_begin;
+            const char* cur = m_begin;
+            size_t line = 1;
+            size_t depth = 0;
+            
+            while (cur < m_end) {
+                switch (*cur) {
+                    case '\n':
+                        line++;
+                        lineBegin = ++cur;
+                        break;
+                    case '/':
+                        if (cur + 1 < m_end && *(cur + 1) == '/') {
+                            if (cur + 2 < m_end && *(cur + 2) == '/') {
+                                cur += 3; // TB comment
+                            } else {
+                                while (cur < m_end && *cur != '\n')
+                                    ++cur;
+                            }
+                        } else {
+                            ++cur;
+                        }
+                        break;
+                    case '"':
+                        ++cur;
+                        while (cur < m_end && *cur != '"') {
+                            if (*cur == '\n') {
+                                line++;
+                                lineBegin = cur + 1;
+                            }
+                            ++cur;
+                        }
+                        ++cur;
+                        break;
+                    case '{':
+                        if (depth == 1) {
+                            BrushRange range;
+                            range.begin = static_cast<size_t>(cur - m_begin);
+                            range.line = line;
+                            range.column = static_cast<size_t>(cur - lineBegin) + 1;
+                            m_brushRanges.push_back(range);
+                        }
+                        // within a brush, an opening brace is the first character of a texture name
+                        if (depth < 2)
+                            depth++;
+                        ++cur;
+                        break;
+                    case '}':
+                        if (depth == 0)
+                            return false;
+                        if (depth == 2) {
+                            BrushRange& range = m_brushRanges.back();
+                            range.end = static_cast<size_t>(cur - m_begin) + 1;
+                            range.endLine = line;
+                            range.endColumn = static_cast<size_t>(cur - lineBegin) + 2;
+                        }
+                        depth--;
+                        ++cur;
+                        break;
+                    default:
+                        ++cur;
+                        break;
+                }
+            }
+            
+            return depth == 0;
+        }
+
+        void MapParser::queueBrushBatches(const BBoxf& worldBounds, bool forceIntegerFacePoints, size_t firstRange) {
+            assert(m_threadPool != NULL);
+            assert(m_brushBatches.empty());
+            
+            size_t first = firstRange;
+            while (first < m_brushRanges.size()) {
+                const size_t begin = m_brushRanges[first].begin;
+                size_t last = first + 1;
+                while (last < m_brushRanges.size() && m_brushRanges[last].end - begin < BrushBatchSize)
+                    last++;
+                
+                BrushBatch* batch = new BrushBatch(*this, worldBounds, forceIntegerFacePoints, first, last);
+                m_brushBatches.push_back(batch);
+                m_threadPool->enqueue(*batch);
+                first = last;
+            }
+            
+            m_nextBrushBatch = 0;
+            m_brushBatchesQueued = true;
+        }
+        
+        void MapParser::clearBrushBatches() {
+            for (size_t i = m_nextBrushBatch; i < m_brushBatches.size(); i++) {
+                BrushBatch* batch = m_brushBatches[i];
+                m_threadPool->wait(*batch);
+                delete batch;
+            }
+            m_brushBatches.clear();
+            m_nextBrushBatch = 0;
+            m_brushBatchesQueued = false;
+        }
+
+        Model::Brush* MapParser::nextBrush(const BBoxf& worldBounds, bool forceIntegerFacePoints, Utility::ProgressIndicator* indicator) {
+            if (m_threadPool == NULL)
+                return parseBrush(worldBounds, forceIntegerFacePoints, indicator);
+            
+            const size_t position = m_tokenizer.peekToken().position();
+            while (m_nextBrushRange < m_brushRanges.size() && m_brushRanges[m_nextBrushRange].begin < position)
+                m_nextBrushRange++;
+            if (m_nextBrushRange == m_brushRanges.size() || m_brushRanges[m_nextBrushRange].begin != position)
+                return parseBrush(worldBounds, forceIntegerFacePoints, indicator);
+            
+            const size_t index = m_nextBrushRange++;
+            if (!m_brushBatchesQueued) {
+                // the first brush determines the map format, which the worker threads must know in advance
+                Model::Brush* brush = parseBrush(worldBounds, forceIntegerFacePoints, indicator);
+                if (m_format != Undefined)
+                    queueBrushBatches(worldBounds, forceIntegerFacePoints, index + 1);
+                return brush;
+            }
+            
+            while (m_nextBrushBatch < m_brushBatches.size() && m_brushBatches[m_nextBrushBatch]->last() <= index) {
+                BrushBatch* batch = m_brushBatches[m_nextBrushBatch++];
+                m_threadPool->wait(*batch);
+                delete batch;
+            }
+            if (m_nextBrushBatch == m_brushBatches.size() || m_brushBatches[m_nextBrushBatch]->first() > index)
+                return parseBrush(worldBounds, forceIntegerFacePoints, indicator);
+            
+            BrushBatch& batch = *m_brushBatches[m_nextBrushBatch];
+            m_threadPool->wait(batch);
+            
+            BrushBatch::Result& result = batch.result(index);
+            if (!result.valid)
+                return parseBrush(worldBounds, forceIntegerFacePoints, indicator);
+            
+            batch.console().replay(m_console, result.firstMessage, result.lastMessage);
+            if (result.failed)
+                throw MapParserException(result.error);
+            
+            const BrushRange& range = m_brushRanges[index];
+            m_tokenizer.seek(range.end, range.endLine, range.endColumn);
+            if (indicator != NULL)
+                indicator->update(static_cast<int>(range.end - 1));
+            
+            Model::Brush* brush = result.brush;
+            result.brush = NULL;
+            return brush;
+        }
+        
         MapParser::MapParser(const char* begin, const char* end, Utility::Console& console) :
         m_console(console),
+        m_begin(begin),
+        m_end(end),
         m_tokenizer(begin, end),
         m_format(Undefined),
-        m_size(static_cast<size_t>(end - begin)) {
+        m_size(static_cast<size_t>(end - begin)),
+        m_threadPool(NULL),
+        m_nextBrushRange(0),
+        m_nextBrushBatch(0),
+        m_brushBatchesQueued(false) {
             assert(end >= begin);
         }
 
         MapParser::MapParser(const String& str, Utility::Console& console) :
         m_console(console),
+        m_begin(str.c_str()),
+        m_end(str.c_str() + str.size()),
         m_tokenizer(str.c_str(), str.c_str() + str.size()),
         m_format(Undefined),
-        m_size(str.size()) {}
+        m_size(str.size()),
+        m_threadPool(NULL),
+        m_nextBrushRange(0),
+        m_nextBrushBatch(0),
+        m_brushBatchesQueued(false) {}
 
-        void MapParser::parseMap(Model::Map& map, Utility::ProgressIndicator* indicator) {
+        MapParser::~MapParser() {
+            clearBrushBatches();
+        }
+
+        bool MapParser::parseMap(Model::Map& map, Utility::ProgressIndicator* indicator, Utility::ThreadPool* threadPool) {
             Model::Entity* entity = NULL;
+            bool complete = true;
             
             if (indicator != NULL) indicator->reset(static_cast<int>(m_size));
+            
+            if (threadPool != NULL && threadPool->threadCount() > 1) {
+                m_threadPool = threadPool;
+                m_nextBrushRange = 0;
+                if (!findBrushRanges())
+                    m_threadPool = NULL;
+            }
+            
             try {
                 FacePointFormat facePointFormat = Unknown;
                 while ((entity = parseEntity(map.worldBounds(), facePointFormat, indicator)) != NULL)
@@ -217,10 +404,18 @@ namespace TrenchBroom {
                     map.setForceIntegerFacePoints(true);
             } catch (MapParserException& e) {
                 m_console.error(e.what());
+                complete = false;
+            }
+            
+            if (m_threadPool != NULL) {
+                clearBrushBatches();
+                m_brushRanges.clear();
+                m_threadPool = NULL;
             }
             
             if (indicator != NULL)
                 indicator->update(static_cast<int>(m_size));
+            return complete;
         }
         
         Model::Entity* MapParser::parseEntity(const BBoxf& worldBounds, bool forceIntegerFacePoints, Utility::ProgressIndicator* indicator) {
@@ -345,8 +540,10 @@ namespace TrenchBroom {
             
             if (textureName == Model::Texture::Empty)
                 textureName = "";
+            if (textureName != m_textureName.str())
+                m_textureName = Utility::InternedString(textureName);
             
-            Model::Face* face = new Model::Face(worldBounds, forceIntegerFacePoints, p1, p2, p3, textureName);
+            Model::Face* face = new Model::Face(worldBounds, forceIntegerFacePoints, p1, p2, p3, m_textureName);
             face->setXOffset(xOffset);
             face->setYOffset(yOffset);
             face->setRotation(rotation);
@@ -357,6 +554,23 @@ namespace TrenchBroom {
             return face;
         }
         
+        MapParser::ContentType MapParser::detectContentType() {
+            ContentType contentType = CTUnknown;
+            Token token = m_tokenizer.nextToken();
+            if (token.type() == TokenType::OParenthesis) {
+                contentType = CTFaces;
+            } else if (token.type() == TokenType::OBrace) {
+                token = m_tokenizer.nextToken();
+                if (token.type() == TokenType::OParenthesis)
+                    contentType = CTBrushes;
+                else if (token.type() == TokenType::String || token.type() == TokenType::OBrace || token.type() == TokenType::CBrace)
+                    contentType = CTEntities;
+            }
+            
+            m_tokenizer.reset();
+            return contentType;
+        }
+        
         bool MapParser::parseEntities(const BBoxf& worldBounds, bool forceIntegerFacePoints, Model::EntityList& entities) {
             size_t oldSize = entities.size();
             try {
@@ -21,10 +21,11 @@
 #define __TrenchBroom__MapParser__
 
 #include "IO/ByteBuffer.h"
-#include "IO/StreamTokenizer.h"
+#include "IO/MapTokenEmitter.h"
 #include "Model/BrushTypes.h"
 #include "Model/EntityTypes.h"
 #include "Model/FaceTypes.h"
+#include "Utility/InternedString.h"
 #include "Utility/MessageException.h"
 #include "Utility/VecMath.h"
 
@@ -45,32 +46,10 @@ namespace TrenchBroom {
     namespace Utility {
         class Console;
         class ProgressIndicator;
+        class ThreadPool;
     }
 
     namespace IO {
-        namespace TokenType {
-            static const unsigned int Integer       = 1 <<  0; // integer number
-            static const unsigned int Decimal       = 1 <<  1; // decimal number
-            static const unsigned int String        = 1 <<  2; // string
-            static const unsigned int OParenthesis  = 1 <<  3; // opening parenthesis: (
-            static const unsigned int CParenthesis  = 1 <<  4; // closing parenthesis: )
-            static const unsigned int OBrace        = 1 <<  5; // opening brace: {
-            static const unsigned int CBrace        = 1 <<  6; // closing brace: }
-            static const unsigned int OBracket      = 1 <<  7; // opening bracket: [
-            static const unsigned int CBracket      = 1 <<  8; // closing bracket: ]
-            static const unsigned int Comment       = 1 <<  9; // line comment starting with //
-            static const unsigned int Eof           = 1 << 10; // end of file
-        }
-
-        class MapTokenEmitter : public TokenEmitter<MapTokenEmitter> {
-        protected:
-            bool isDelimiter(char c) {
-                return isWhitespace(c) || c == '(' || c == ')' || c == '{' || c == '}' || c == '?' || c == ';' || c == ',' || c == '=';
-            }
-
-            Token doEmit(Tokenizer& tokenizer);
-        };
-        
         class MapParserException : public TrenchBroom::Utility::MessageException {
         private:
             String type(unsigned int type) {
@@ -122,6 +101,7 @@ namespace TrenchBroom {
             }
         public:
             MapParserException() : MessageException("Reached unexpected end of file") {}
+            MapParserException(const String& message) : MessageException(message) {}
             MapParserException(const Token& token, const String& message) : MessageException(buildMessage(token, message)) {}
             MapParserException(const Token& token, unsigned int expectedType) : MessageException(buildMessage(token, expectedType)) {}
         };
@@ -140,11 +120,44 @@ namespace TrenchBroom {
                 Unknown
             };
             
+            /*
+             * The position of a brush in the map file, from its opening brace up to and including its closing brace.
+             */
+            class BrushRange {
+            public:
+                size_t begin;
+                size_t end;
+                size_t line;
+                size_t column;
+                size_t endLine;
+                size_t endColumn;
+            };
+
+            typedef std::vector<BrushRange> BrushRangeList;
+
+            class BrushBatch;
+            typedef std::vector<BrushBatch*> BrushBatchList;
+            friend class BrushBatch;
+
+            static const size_t BrushBatchSize = 64 * 1024;
+
             Utility::Console& m_console;
+            const char* m_begin;
+            const char* m_end;
             StreamTokenizer<MapTokenEmitter> m_tokenizer;
             MapFormat m_format;
             size_t m_size;
 
+            Utility::ThreadPool* m_threadPool;
+            BrushRangeList m_brushRanges;
+            BrushBatchList m_brushBatches;
+            size_t m_nextBrushRange;
+            size_t m_nextBrushBatch;
+            bool m_brushBatchesQueued;
+
+            // consecutive faces usually share their texture, so the last name is kept to avoid interning it again
+            Utility::InternedString m_textureName;
+
             inline void expect(unsigned int expectedType, const Token& actualToken) const {
                 if ((actualToken.type() & expectedType) == 0)
                     throw MapParserException(actualToken, expectedType);
@@ -153,15 +166,39 @@ namespace TrenchBroom {
             Vec3f parseVector();
 
             Model::Entity* parseEntity(const BBoxf& worldBounds, FacePointFormat& facePointFormat, Utility::ProgressIndicator* indicator);
+
+            bool findBrushRanges();
+            void queueBrushBatches(const BBoxf& worldBounds, bool forceIntegerFacePoints, size_t firstRange);
+            void clearBrushBatches();
+            Model::Brush* nextBrush(const BBoxf& worldBounds, bool forceIntegerFacePoints, Utility::ProgressIndicator* indicator);
         public:
+            typedef enum {
+                CTUnknown,
+                CTEntities,
+                CTBrushes,
+                CTFaces
+            } ContentType;
+            
             MapParser(const char* begin, const char* end, Utility::Console& console);
             MapParser(const String& str, Utility::Console& console);
+            ~MapParser();
             
-            void parseMap(Model::Map& map, Utility::ProgressIndicator* indicator);
+            /*
+             * If a thread pool with more than one thread is given, the brushes are parsed and built by the pool's
+             * worker threads. The resulting map is identical to the one that is loaded without a thread pool. Returns
+             * false if the map file is malformed and could only be loaded partially.
+             */
+            bool parseMap(Model::Map& map, Utility::ProgressIndicator* indicator, Utility::ThreadPool* threadPool = NULL);
             Model::Entity* parseEntity(const BBoxf& worldBounds, bool forceIntegerFacePoints, Utility::ProgressIndicator* indicator);
             Model::Brush* parseBrush(const BBoxf& worldBounds, bool forceIntegerFacePoints, Utility::ProgressIndicator* indicator);
             Model::Face* parseFace(const BBoxf& worldBounds, bool forceIntegerFacePoints);
 
+            /*
+             * Determines from the first tokens whether the text contains entities, brushes or faces, so that only the
+             * matching parse function needs to be called. The tokenizer is reset afterwards.
+             */
+            ContentType detectContentType();
+            
             bool parseEntities(const BBoxf& worldBounds, bool forceIntegerFacePoints, Model::EntityList& entities);
             bool parseBrushes(const BBoxf& worldBounds, bool forceIntegerFacePoints, Model::BrushList& brushes);
             bool parseFaces(const BBoxf& worldBounds, bool forceIntegerFacePoints, Model::FaceList& faces);
@@ -0,0 +1,169 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MapSnapshot.h"
+
+#include "Model/Brush.h"
+#include "Model/Entity.h"
+#include "Model/Face.h"
+#include "Model/Map.h"
+#include "Model/MapExceptions.h"
+#include "Utility/List.h"
+
+#include <map>
+
+namespace TrenchBroom {
+    namespace IO {
+        MapSnapshot::FaceData::FaceData(const Model::Face& face) :
+        textureName(face.internedTextureName()),
+        xOffset(face.xOffset()),
+        yOffset(face.yOffset()),
+        rotation(face.rotation()),
+        xScale(face.xScale()),
+        yScale(face.yScale()) {
+            for (size_t i = 0; i < 3; i++)
+                points[i] = face.point(i);
+        }
+        
+        void MapSnapshot::addEntity(const Model::PropertyList& properties, const Model::BrushList& brushes) {
+            m_entities.push_back(EntityData(properties, m_brushes.size(), brushes.size()));
+            
+            Model::BrushList::const_iterator brushIt, brushEnd;
+            for (brushIt = brushes.begin(), brushEnd = brushes.end(); brushIt != brushEnd; ++brushIt) {
+                m_brushes.push_back(m_faces.size());
+                
+                const Model::FaceList& faces = (*brushIt)->faces();
+                Model::FaceList::const_iterator faceIt, faceEnd;
+                for (faceIt = faces.begin(), faceEnd = faces.end(); faceIt != faceEnd; ++faceIt)
+                    m_faces.push_back(FaceData(**faceIt));
+            }
+        }
+        
+        Model::Face* MapSnapshot::createFace(const BBoxf& worldBounds, bool forceIntegerFacePoints, const FaceData& faceData) const {
+            Model::Face* face = new Model::Face(worldBounds, forceIntegerFacePoints, faceData.points[0], faceData.points[1], faceData.points[2], faceData.textureName);
+            face->setXOffset(faceData.xOffset);
+            face->setYOffset(faceData.yOffset);
+            face->setRotation(faceData.rotation);
+            face->setXScale(faceData.xScale);
+            face->setYScale(faceData.yScale);
+            return face;
+        }
+        
+        MapSnapshot::MapSnapshot(const Model::Map& map) {
+            const Model::EntityList& entities = map.entities();
+            size_t brushCount = 0;
+            size_t faceCount = 0;
+            
+            Model::EntityList::const_iterator entityIt, entityEnd;
+            for (entityIt = entities.begin(), entityEnd = entities.end(); entityIt != entityEnd; ++entityIt) {
+                const Model::BrushList& brushes = (*entityIt)->brushes();
+                brushCount += brushes.size();
+                
+                Model::BrushList::const_iterator brushIt, brushEnd;
+                for (brushIt = brushes.begin(), brushEnd = brushes.end(); brushIt != brushEnd; ++brushIt)
+                    faceCount += (*brushIt)->faces().size();
+            }
+            
+            m_entities.reserve(entities.size());
+            m_brushes.reserve(brushCount + 1);
+            m_faces.reserve(faceCount);
+            
+            for (entityIt = entities.begin(), entityEnd = entities.end(); entityIt != entityEnd; ++entityIt) {
+                const Model::Entity& entity = **entityIt;
+                addEntity(entity.properties(), entity.brushes());
+            }
+            
+            m_brushes.push_back(m_faces.size());
+        }
+        
+        MapSnapshot::MapSnapshot(const Model::EntityList& pointEntities, const Model::BrushList& brushes) {
+            Model::Entity* worldspawn = NULL;
+            
+            typedef std::map<Model::Entity*, Model::BrushList> EntityBrushMap;
+            EntityBrushMap entityToBrushes;
+            
+            Model::BrushList::const_iterator brushIt, brushEnd;
+            for (brushIt = brushes.begin(), brushEnd = brushes.end(); brushIt != brushEnd; ++brushIt) {
+                Model::Brush& brush = **brushIt;
+                Model::Entity& entity = *brush.entity();
+                entityToBrushes[&entity].push_back(&brush);
+                if (entity.worldspawn())
+                    worldspawn = &entity;
+            }
+            
+            if (worldspawn != NULL)
+                addEntity(worldspawn->properties(), entityToBrushes[worldspawn]);
+            
+            Model::EntityList::const_iterator entityIt, entityEnd;
+            for (entityIt = pointEntities.begin(), entityEnd = pointEntities.end(); entityIt != entityEnd; ++entityIt) {
+                const Model::Entity& entity = **entityIt;
+                addEntity(entity.properties(), entity.brushes());
+            }
+            
+            EntityBrushMap::const_iterator it, end;
+            for (it = entityToBrushes.begin(), end = entityToBrushes.end(); it != end; ++it) {
+                if (it->first != worldspawn)
+                    addEntity(it->first->properties(), it->second);
+            }
+            
+            m_brushes.push_back(m_faces.size());
+        }
+        
+        MapSnapshot::MapSnapshot(const Model::FaceList& faces) {
+            m_faces.reserve(faces.size());
+            Model::FaceList::const_iterator it, end;
+            for (it = faces.begin(), end = faces.end(); it != end; ++it)
+                m_faces.push_back(FaceData(**it));
+            m_brushes.push_back(m_faces.size());
+        }
+        
+        void MapSnapshot::createEntities(const BBoxf& worldBounds, bool forceIntegerFacePoints, Model::EntityList& entities) const {
+            EntityDataList::const_iterator entityIt, entityEnd;
+            for (entityIt = m_entities.begin(), entityEnd = m_entities.end(); entityIt != entityEnd; ++entityIt) {
+                const EntityData& entityData = *entityIt;
+                Model::Entity* entity = new Model::Entity(worldBounds);
+                
+                Model::PropertyList::const_iterator propertyIt, propertyEnd;
+                for (propertyIt = entityData.properties.begin(), propertyEnd = entityData.properties.end(); propertyIt != propertyEnd; ++propertyIt)
+                    entity->setProperty(propertyIt->key(), propertyIt->value());
+                
+                for (size_t i = entityData.firstBrush; i < entityData.firstBrush + entityData.brushCount; i++) {
+                    Model::FaceList faces;
+                    for (size_t j = m_brushes[i]; j < m_brushes[i + 1]; j++)
+                        faces.push_back(createFace(worldBounds, forceIntegerFacePoints, m_faces[j]));
+                    
+                    try {
+                        Model::Brush* brush = new Model::Brush(worldBounds, forceIntegerFacePoints, faces);
+                        entity->addBrush(*brush);
+                    } catch (Model::GeometryException&) {
+                        Utility::deleteAll(faces);
+                    }
+                }
+                
+                entities.push_back(entity);
+            }
+        }
+        
+        void MapSnapshot::createFaces(const BBoxf& worldBounds, bool forceIntegerFacePoints, Model::FaceList& faces) const {
+            FaceDataList::const_iterator it, end;
+            for (it = m_faces.begin(), end = m_faces.end(); it != end; ++it)
+                faces.push_back(createFace(worldBounds, forceIntegerFacePoints, *it));
+        }
+    }
+}
@@ -0,0 +1,122 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TrenchBroom__MapSnapshot__
+#define __TrenchBroom__MapSnapshot__
+
+#include "Model/BrushTypes.h"
+#include "Model/EntityProperty.h"
+#include "Model/EntityTypes.h"
+#include "Model/FaceTypes.h"
+#include "Utility/InternedString.h"
+#include "Utility/VecMath.h"
+
+#include <vector>
+
+using namespace TrenchBroom::VecMath;
+
+namespace TrenchBroom {
+    namespace Model {
+        class Face;
+        class Map;
+    }
+    
+    namespace IO {
+        /*
+         * A copy of everything the map writer needs to write a map. Taking it is much cheaper than formatting the
+         * map, and since it does not refer to the model, it can be written on a background thread while the map is
+         * being edited. Snapshots of a selection are also kept by the clipboard, which creates the pasted objects
+         * from them directly instead of parsing the copied text.
+         */
+        class MapSnapshot {
+        public:
+            class FaceData {
+            public:
+                Vec3f points[3];
+                Utility::InternedString textureName;
+                float xOffset;
+                float yOffset;
+                float rotation;
+                float xScale;
+                float yScale;
+                
+                FaceData(const Model::Face& face);
+            };
+            
+            class EntityData {
+            public:
+                Model::PropertyList properties;
+                size_t firstBrush;
+                size_t brushCount;
+                
+                EntityData(const Model::PropertyList& i_properties, size_t i_firstBrush, size_t i_brushCount) :
+                properties(i_properties),
+                firstBrush(i_firstBrush),
+                brushCount(i_brushCount) {}
+            };
+            
+            typedef std::vector<FaceData> FaceDataList;
+            typedef std::vector<EntityData> EntityDataList;
+        private:
+            EntityDataList m_entities;
+            // the index of the first face of each brush, followed by the total number of faces
+            std::vector<size_t> m_brushes;
+            FaceDataList m_faces;
+            
+            void addEntity(const Model::PropertyList& properties, const Model::BrushList& brushes);
+            Model::Face* createFace(const BBoxf& worldBounds, bool forceIntegerFacePoints, const FaceData& faceData) const;
+        public:
+            MapSnapshot(const Model::Map& map);
+            
+            /*
+             * Groups the brushes by their entities in the same way as MapWriter::writeObjectsToStream.
+             */
+            MapSnapshot(const Model::EntityList& pointEntities, const Model::BrushList& brushes);
+            
+            /*
+             * Contains only faces and no entities.
+             */
+            MapSnapshot(const Model::FaceList& faces);
+            
+            /*
+             * Creates new entities with their brushes. Brushes which cannot be built are skipped.
+             */
+            void createEntities(const BBoxf& worldBounds, bool forceIntegerFacePoints, Model::EntityList& entities) const;
+            void createFaces(const BBoxf& worldBounds, bool forceIntegerFacePoints, Model::FaceList& faces) const;
+            
+            inline const EntityDataList& entities() const {
+                return m_entities;
+            }
+            
+            inline size_t firstFace(size_t brushIndex) const {
+                return m_brushes[brushIndex];
+            }
+            
+            inline size_t faceCount(size_t brushIndex) const {
+                return m_brushes[brushIndex + 1] - m_brushes[brushIndex];
+            }
+            
+            inline const FaceDataList& faces() const {
+                return m_faces;
+            }
+        };
+    }
+}
+
+#endif /* defined(__TrenchBroom__MapSnapshot__) */
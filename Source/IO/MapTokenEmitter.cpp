@@ -0,0 +1,109 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MapTokenEmitter.h"
+
+namespace TrenchBroom {
+    namespace IO {
+        Token MapTokenEmitter::doEmit(Tokenizer& tokenizer) {
+            while (!tokenizer.eof()) {
+                size_t line = tokenizer.line();
+                size_t column = tokenizer.column();
+                const char* c = tokenizer.nextChar();
+                switch (*c) {
+                    case '/':
+                        if (tokenizer.peekChar() == '/') {
+                            tokenizer.nextChar();
+                            if (tokenizer.peekChar() == '/') {
+                                tokenizer.nextChar(); // it's a TB comment
+                            } else {
+                                // eat everything up to and including the next newline
+                                while (!tokenizer.eof() && *tokenizer.nextChar() != '\n');
+                            }
+                        }
+                        break;
+                    case '{':
+                        return Token(TokenType::OBrace, c, c + 1, tokenizer.offset(c), line, column);
+                    case '}':
+                        return Token(TokenType::CBrace, c, c + 1, tokenizer.offset(c), line, column);
+                    case '(':
+                        return Token(TokenType::OParenthesis, c, c + 1, tokenizer.offset(c), line, column);
+                    case ')':
+                        return Token(TokenType::CParenthesis, c, c + 1, tokenizer.offset(c), line, column);
+                    case '[':
+                        return Token(TokenType::OBracket, c, c + 1, tokenizer.offset(c), line, column);
+                    case ']':
+                        return Token(TokenType::CBracket, c, c + 1, tokenizer.offset(c), line, column);
+                    case '"': { // quoted string
+                        const char* begin = c;
+                        const char* end;
+                        tokenizer.quotedString(begin, end);
+                        return Token(TokenType::String, begin, end, tokenizer.offset(begin), line, column);
+                    }
+                    default: { // whitespace, integer, decimal or word
+                        if (isWhitespace(*c))
+                            break;
+                        
+                        const char* begin = c;
+
+                        // try to read a number
+                        if (*c == '-' || isDigit(*c)) {
+                            while (isDigit(*(c = tokenizer.nextChar())));
+                            if (isDelimiter(*c)) {
+                                if (!tokenizer.eof())
+                                    tokenizer.pushChar();
+                                return Token(TokenType::Integer, begin, c, tokenizer.offset(begin), line, column);
+                            }
+                        }
+                        
+                        // try to read a decimal (may start with '.')
+                        if (*c == '.') {
+                            while (isDigit(*(c = tokenizer.nextChar())));
+                            if (isDelimiter(*c)) {
+                                if (!tokenizer.eof())
+                                    tokenizer.pushChar();
+                                return Token(TokenType::Decimal, begin, c, tokenizer.offset(begin), line, column);
+                            }
+                        }
+                        
+                        // try to read decimal in scientific notation
+                        if (*c == 'e') {
+                            c = tokenizer.nextChar();
+                            if (isDigit(*c) || *c == '+' || *c == '-') {
+                                while (isDigit(*(c = tokenizer.nextChar())));
+                                if (isDelimiter(*c)) {
+                                    if (!tokenizer.eof())
+                                        tokenizer.pushChar();
+                                    return Token(TokenType::Decimal, begin, c, tokenizer.offset(begin), line, column);
+                                }
+                            }
+                        }
+                        
+                        // read a word
+                        while (!tokenizer.eof() && !isDelimiter(*(c = tokenizer.nextChar())));
+                        if (!tokenizer.eof())
+                            tokenizer.pushChar();
+                        return Token(TokenType::String, begin, c, tokenizer.offset(begin), line, column);
+                    }
+                }
+            }
+            return Token(TokenType::Eof, NULL, NULL, 0, tokenizer.line(), tokenizer.column());
+        }
+    }
+}
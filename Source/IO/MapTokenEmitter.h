@@ -0,0 +1,52 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TrenchBroom_MapTokenEmitter_h
+#define TrenchBroom_MapTokenEmitter_h
+
+#include "IO/StreamTokenizer.h"
+
+namespace TrenchBroom {
+    namespace IO {
+        namespace TokenType {
+            static const unsigned int Integer       = 1 <<  0; // integer number
+            static const unsigned int Decimal       = 1 <<  1; // decimal number
+            static const unsigned int String        = 1 <<  2; // string
+            static const unsigned int OParenthesis  = 1 <<  3; // opening parenthesis: (
+            static const unsigned int CParenthesis  = 1 <<  4; // closing parenthesis: )
+            static const unsigned int OBrace        = 1 <<  5; // opening brace: {
+            static const unsigned int CBrace        = 1 <<  6; // closing brace: }
+            static const unsigned int OBracket      = 1 <<  7; // opening bracket: [
+            static const unsigned int CBracket      = 1 <<  8; // closing bracket: ]
+            static const unsigned int Comment       = 1 <<  9; // line comment starting with //
+            static const unsigned int Eof           = 1 << 10; // end of file
+        }
+
+        class MapTokenEmitter : public TokenEmitter<MapTokenEmitter> {
+        protected:
+            bool isDelimiter(char c) {
+                return isWhitespace(c) || c == '(' || c == ')' || c == '{' || c == '}' || c == '?' || c == ';' || c == ',' || c == '=';
+            }
+
+            Token doEmit(Tokenizer& tokenizer);
+        };
+    }
+}
+
+#endif
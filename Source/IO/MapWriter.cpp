@@ -28,159 +28,198 @@
 #include "Model/Map.h"
 #include "IO/FileManager.h"
 #include "IO/IOException.h"
+#include "Utility/FormatFloat.h"
+#include "Utility/List.h"
+#include "Utility/ThreadPool.h"
 
 #include <cassert>
+#include <cstdio>
 #include <fstream>
 #include <limits>
 
+#if defined _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
 namespace TrenchBroom {
     namespace IO {
-        size_t MapWriter::writeFace(Model::Face& face, const size_t lineNumber, FILE* stream) {
-            const String textureName = Utility::isBlank(face.textureName()) ? Model::Texture::Empty : face.textureName();
-
-            std::fprintf(stream, FaceFormat.c_str(),
-                    face.point(0).x(),
-                    face.point(0).y(),
-                    face.point(0).z(),
-                    face.point(1).x(),
-                    face.point(1).y(),
-                    face.point(1).z(),
-                    face.point(2).x(),
-                    face.point(2).y(),
-                    face.point(2).z(),
-                    textureName.c_str(),
-                    face.xOffset(),
-                    face.yOffset(),
-                    face.rotation(),
-                    face.xScale(),
-                    face.yScale());
+        class MapWriter::FormatTask : public Utility::ThreadPool::Task {
+        private:
+            MapWriter& m_writer;
+            const Model::EntityList& m_entities;
+            size_t m_firstEntity;
+            size_t m_firstItem;
+            size_t m_lastEntity;
+            size_t m_lastItem;
+            size_t m_firstLine;
+            String m_buffer;
+        protected:
+            void run() {
+                format();
+            }
+        public:
+            /*
+             * Formats the items from (firstEntity, firstItem) up to, but not including, (lastEntity, lastItem). Item 0
+             * of an entity is its header, items 1 to n are its brushes and item n + 1 is its footer.
+             */
+            FormatTask(MapWriter& writer, const Model::EntityList& entities, size_t firstEntity, size_t firstItem, size_t lastEntity, size_t lastItem, size_t firstLine) :
+            m_writer(writer),
+            m_entities(entities),
+            m_firstEntity(firstEntity),
+            m_firstItem(firstItem),
+            m_lastEntity(lastEntity),
+            m_lastItem(lastItem),
+            m_firstLine(firstLine) {}
+            
+            void format() {
+                size_t entityIndex = m_firstEntity;
+                size_t item = m_firstItem;
+                size_t lineNumber = m_firstLine;
+                
+                while (entityIndex < m_lastEntity || (entityIndex == m_lastEntity && item < m_lastItem)) {
+                    Model::Entity& entity = *m_entities[entityIndex];
+                    const Model::BrushList& brushes = entity.brushes();
+                    if (item == 0) {
+                        lineNumber += m_writer.writeEntityHeader(entity.properties(), m_buffer);
+                        item++;
+                    } else if (item <= brushes.size()) {
+                        lineNumber += m_writer.writeBrush(*brushes[item - 1], lineNumber, m_buffer);
+                        item++;
+                    } else {
+                        lineNumber += m_writer.writeEntityFooter(m_buffer);
+                        entityIndex++;
+                        item = 0;
+                    }
+                }
+            }
+            
+            inline String& buffer() {
+                return m_buffer;
+            }
+        };
+        
+        void MapWriter::writeFile(const StringList& buffers, const String& path) {
+            FileManager fileManager;
+            const String tempPath = path + ".tmp";
+            FILE* stream = fopen(tempPath.c_str(), "w");
+            if (stream == NULL)
+                throw IOException::openError(tempPath);
+            
+            bool success = true;
+            for (size_t i = 0; i < buffers.size() && success; i++) {
+                const String& buffer = buffers[i];
+                success = fwrite(buffer.data(), 1, buffer.size(), stream) == buffer.size();
+            }
+            
+            success = success && fflush(stream) == 0;
+#if defined _WIN32
+            success = success && _commit(_fileno(stream)) == 0;
+#else
+            success = success && fsync(fileno(stream)) == 0;
+#endif
+            success = fclose(stream) == 0 && success;
+            
+            if (!success) {
+                fileManager.deleteFile(tempPath);
+                throw IOException::writeError(tempPath);
+            }
+            
+            if (!fileManager.moveFile(tempPath, path, true)) {
+                fileManager.deleteFile(tempPath);
+                throw IOException::writeError(path);
+            }
+        }
+        
+        void MapWriter::writeFace(const MapSnapshot::FaceData& face, String& buffer) {
+            for (size_t i = 0; i < 3; i++) {
+                const Vec3f& point = face.points[i];
+                buffer += "( ";
+                Utility::appendFloat(buffer, point.x(), FloatPrecision);
+                buffer += ' ';
+                Utility::appendFloat(buffer, point.y(), FloatPrecision);
+                buffer += ' ';
+                Utility::appendFloat(buffer, point.z(), FloatPrecision);
+                buffer += " ) ";
+            }
+            
+            const String& textureName = face.textureName.str();
+            buffer += Utility::isBlank(textureName) ? Model::Texture::Empty : textureName;
+            buffer += ' ';
+            Utility::appendFloat(buffer, face.xOffset, 6);
+            buffer += ' ';
+            Utility::appendFloat(buffer, face.yOffset, 6);
+            buffer += ' ';
+            Utility::appendFloat(buffer, face.rotation, 6);
+            buffer += ' ';
+            Utility::appendFloat(buffer, face.xScale, 6);
+            buffer += ' ';
+            Utility::appendFloat(buffer, face.yScale, 6);
+            buffer += '\n';
+        }
+        
+        size_t MapWriter::writeFace(Model::Face& face, const size_t lineNumber, String& buffer) {
+            writeFace(MapSnapshot::FaceData(face), buffer);
             face.setFilePosition(lineNumber);
             return 1;
         }
         
-        size_t MapWriter::writeBrush(Model::Brush& brush, const size_t lineNumber, FILE* stream) {
+        size_t MapWriter::writeBrush(Model::Brush& brush, const size_t lineNumber, String& buffer) {
             size_t lineCount = 0;
-            std::fprintf(stream, "{\n"); lineCount++;
+            buffer += "{\n"; lineCount++;
             const Model::FaceList& faces = brush.faces();
             Model::FaceList::const_iterator faceIt, faceEnd;
             for (faceIt = faces.begin(), faceEnd = faces.end(); faceIt != faceEnd; ++faceIt) {
-                lineCount += writeFace(**faceIt, lineNumber + lineCount, stream);
+                lineCount += writeFace(**faceIt, lineNumber + lineCount, buffer);
             }
-            std::fprintf(stream, "}\n"); lineCount++;
+            buffer += "}\n"; lineCount++;
             brush.setFilePosition(lineNumber, lineCount);
             return lineCount;
         }
         
-        size_t MapWriter::writeEntityHeader(Model::Entity& entity, FILE* stream) {
+        size_t MapWriter::writeEntityHeader(const Model::PropertyList& properties, String& buffer) {
             size_t lineCount = 0;
-            std::fprintf(stream, "{\n"); lineCount++;
+            buffer += "{\n"; lineCount++;
             
-            const Model::PropertyList& properties = entity.properties();
             Model::PropertyList::const_iterator it, end;
             for (it = properties.begin(), end = properties.end(); it != end; ++it) {
                 const Model::Property& property = *it;
-                std::fprintf(stream, "\"%s\" \"%s\"\n", property.key().c_str(), property.value().c_str()); lineCount++;
+                buffer += '"';
+                buffer += property.key();
+                buffer += "\" \"";
+                buffer += property.value();
+                buffer += "\"\n"; lineCount++;
             }
             return lineCount;
         }
         
-        size_t MapWriter::writeEntityFooter(FILE* stream) {
-            std::fprintf(stream, "}\n");
+        size_t MapWriter::writeEntityFooter(String& buffer) {
+            buffer += "}\n";
             return 1;
         }
         
-        size_t MapWriter::writeEntity(Model::Entity& entity, const size_t lineNumber, FILE* stream) {
-            size_t lineCount = writeEntityHeader(entity, stream);
-            const Model::BrushList& brushes = entity.brushes();
-            for (unsigned int i = 0; i < brushes.size(); i++)
-                lineCount += writeBrush(*brushes[i], lineNumber + lineCount, stream);
-            lineCount += writeEntityFooter(stream);
-            entity.setFilePosition(lineNumber, lineCount);
-            return lineCount;
-        }
-
-        void MapWriter::writeFace(const Model::Face& face, std::ostream& stream) {
-            const String textureName = Utility::isBlank(face.textureName()) ? Model::Texture::Empty : face.textureName();
-            
-            stream.precision(FloatPrecision);
-            stream <<
-            "( " <<
-            face.point(0).x() << " " <<
-            face.point(0).y() << " " <<
-            face.point(0).z() <<
-            " ) ( "           <<
-            face.point(1).x() << " " <<
-            face.point(1).y() << " " <<
-            face.point(1).z() <<
-            " ) ( "           <<
-            face.point(2).x() << " " <<
-            face.point(2).y() << " " <<
-            face.point(2).z() <<
-            " ) ";
-
-            stream.precision(6);
-            stream <<
-            textureName     << " " <<
-            face.xOffset()  << " " <<
-            face.yOffset()  << " " <<
-            face.rotation() << " " <<
-            face.xScale()   << " " <<
-            face.yScale()   << "\n";
-        }
-
-        void MapWriter::writeBrush(const Model::Brush& brush, std::ostream& stream) {
-            stream << "{\n";
+        void MapWriter::writeBrush(const Model::Brush& brush, String& buffer) {
+            buffer += "{\n";
             const Model::FaceList& faces = brush.faces();
             Model::FaceList::const_iterator faceIt, faceEnd;
             for (faceIt = faces.begin(), faceEnd = faces.end(); faceIt != faceEnd; ++faceIt)
-                writeFace(**faceIt, stream);
-            stream << "}\n";
-        }
-
-        void MapWriter::writeEntityHeader(const Model::Entity& entity, std::ostream& stream) {
-            stream << "{\n";
-            
-            const Model::PropertyList& properties = entity.properties();
-            Model::PropertyList::const_iterator it, end;
-            for (it = properties.begin(), end = properties.end(); it != end; ++it) {
-                const Model::Property& property = *it;
-                stream << "\"" << property.key() << "\" \"" << property.value() << "\"" << "\n";
-            }
+                writeFace(MapSnapshot::FaceData(**faceIt), buffer);
+            buffer += "}\n";
         }
         
-        void MapWriter::writeEntityFooter(std::ostream& stream) {
-            stream << "}\n";
-        }
-
-        void MapWriter::writeEntity(const Model::Entity& entity, std::ostream& stream) {
-            writeEntityHeader(entity, stream);
+        void MapWriter::writeEntity(const Model::Entity& entity, String& buffer) {
+            writeEntityHeader(entity.properties(), buffer);
             const Model::BrushList& brushes = entity.brushes();
             for (unsigned int i = 0; i < brushes.size(); i++)
-                writeBrush(*brushes[i], stream);
-            writeEntityFooter(stream);
+                writeBrush(*brushes[i], buffer);
+            writeEntityFooter(buffer);
         }
 
-        MapWriter::MapWriter() {
-            StringStream str;
-            str <<
-            "( %." << FloatPrecision << "g " <<
-              "%." << FloatPrecision << "g " <<
-              "%." << FloatPrecision << "g ) " <<
-            "( %." << FloatPrecision << "g " <<
-              "%." << FloatPrecision << "g " <<
-              "%." << FloatPrecision << "g ) " <<
-            "( %." << FloatPrecision << "g " <<
-              "%." << FloatPrecision << "g " <<
-              "%." << FloatPrecision << "g ) " <<
-            "%s %.6g %.6g %.6g %.6g %.6g\n";
-            
-            FaceFormat = str.str();
-        }
-        
         void MapWriter::writeObjectsToStream(const Model::EntityList& pointEntities, const Model::BrushList& brushes, std::ostream& stream) {
             assert(stream.good());
-            stream.unsetf(std::ios::floatfield);
 
+            String buffer;
             Model::Entity* worldspawn = NULL;
             
             // group the brushes by their containing entities
@@ -199,18 +238,18 @@ namespace TrenchBroom {
             // write worldspawn first
             if (worldspawn != NULL) {
                 Model::BrushList& brushList = entityToBrushes[worldspawn];
-                writeEntityHeader(*worldspawn, stream);
+                writeEntityHeader(worldspawn->properties(), buffer);
                 for (brushIt = brushList.begin(), brushEnd = brushList.end(); brushIt != brushEnd; ++brushIt) {
-                    writeBrush(**brushIt, stream);
+                    writeBrush(**brushIt, buffer);
                 }
-                writeEntityFooter(stream);
+                writeEntityFooter(buffer);
             }
             
             // now write the point entities
             Model::EntityList::const_iterator entityIt, entityEnd;
             for (entityIt = pointEntities.begin(), entityEnd = pointEntities.end(); entityIt != entityEnd; ++entityIt) {
                 Model::Entity& entity = **entityIt;
-                writeEntity(entity, stream);
+                writeEntity(entity, buffer);
             }
 
             // finally write the brush entities
@@ -219,33 +258,37 @@ namespace TrenchBroom {
                 Model::Entity* entity = it->first;
                 if (entity != worldspawn) {
                     Model::BrushList& brushList = it->second;
-                    writeEntityHeader(*entity, stream);
+                    writeEntityHeader(entity->properties(), buffer);
                     for (brushIt = brushList.begin(), brushEnd = brushList.end(); brushIt != brushEnd; ++brushIt) {
-                        writeBrush(**brushIt, stream);
+                        writeBrush(**brushIt, buffer);
                     }
-                    writeEntityFooter(stream);
+                    writeEntityFooter(buffer);
                 }
             }
+            
+            stream.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
         }
         
         void MapWriter::writeFacesToStream(const Model::FaceList& faces, std::ostream& stream) {
             assert(stream.good());
-            stream.unsetf(std::ios::floatfield);
             
+            String buffer;
             for (unsigned int i = 0; i < faces.size(); i++)
-                writeFace(*faces[i], stream);
+                writeFace(MapSnapshot::FaceData(*faces[i]), buffer);
+            stream.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
         }
 
         void MapWriter::writeToStream(const Model::Map& map, std::ostream& stream) {
             assert(stream.good());
-            stream.unsetf(std::ios::floatfield);
             
+            String buffer;
             const Model::EntityList& entities = map.entities();
             for (unsigned int i = 0; i < entities.size(); i++)
-                writeEntity(*entities[i], stream);
+                writeEntity(*entities[i], buffer);
+            stream.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
         }
         
-        void MapWriter::writeToFileAtPath(Model::Map& map, const String& path, bool overwrite) {
+        void MapWriter::writeToFileAtPath(Model::Map& map, const String& path, bool overwrite, Utility::ThreadPool* threadPool) {
             FileManager fileManager;
             if (fileManager.exists(path) && !overwrite)
                 return;
@@ -254,16 +297,93 @@ namespace TrenchBroom {
             if (!fileManager.exists(directoryPath))
                 fileManager.makeDirectory(directoryPath);
             
-            FILE* stream = fopen(path.c_str(), "w");
-            if (stream == NULL)
-                throw IOException::openError(path);
-            // std::fstream stream(path.c_str(), std::ios::out | std::ios::trunc);
-
-            size_t lineNumber = 1;
+            // Cut the map into batches of roughly FormatBatchLineCount lines at brush and entity boundaries. The line
+            // numbers of the entities are known up front, the brushes and faces are numbered by the batches.
             const Model::EntityList& entities = map.entities();
-            for (unsigned int i = 0; i < entities.size(); i++)
-                lineNumber += writeEntity(*entities[i], lineNumber, stream);
-            fclose(stream);
+            std::vector<FormatTask*> tasks;
+            Utility::ThreadPool::TaskList taskList;
+            
+            size_t firstEntity = 0;
+            size_t firstItem = 0;
+            size_t firstLine = 1;
+            size_t lineNumber = 1;
+            for (size_t i = 0; i < entities.size(); i++) {
+                Model::Entity& entity = *entities[i];
+                const Model::BrushList& brushes = entity.brushes();
+                const size_t entityLine = lineNumber;
+                
+                for (size_t item = 0; item <= brushes.size() + 1; item++) {
+                    if (lineNumber - firstLine >= FormatBatchLineCount) {
+                        FormatTask* task = new FormatTask(*this, entities, firstEntity, firstItem, i, item, firstLine);
+                        tasks.push_back(task);
+                        taskList.push_back(task);
+                        firstEntity = i;
+                        firstItem = item;
+                        firstLine = lineNumber;
+                    }
+                    
+                    if (item == 0)
+                        lineNumber += 1 + entity.properties().size();
+                    else if (item <= brushes.size())
+                        lineNumber += 2 + brushes[item - 1]->faces().size();
+                    else
+                        lineNumber += 1;
+                }
+                
+                entity.setFilePosition(entityLine, lineNumber - entityLine);
+            }
+            
+            if (lineNumber > firstLine) {
+                FormatTask* task = new FormatTask(*this, entities, firstEntity, firstItem, entities.size(), 0, firstLine);
+                tasks.push_back(task);
+                taskList.push_back(task);
+            }
+            
+            if (threadPool != NULL) {
+                threadPool->enqueue(taskList);
+                threadPool->wait(taskList);
+            } else {
+                for (size_t i = 0; i < tasks.size(); i++)
+                    tasks[i]->format();
+            }
+            
+            StringList buffers(tasks.size());
+            for (size_t i = 0; i < tasks.size(); i++)
+                buffers[i].swap(tasks[i]->buffer());
+            Utility::deleteAll(tasks);
+            
+            writeFile(buffers, path);
+        }
+        
+        void MapWriter::writeToFileAtPath(const MapSnapshot& snapshot, const String& path, bool overwrite) {
+            FileManager fileManager;
+            if (fileManager.exists(path) && !overwrite)
+                return;
+            
+            const String directoryPath = fileManager.deleteLastPathComponent(path);
+            if (!fileManager.exists(directoryPath))
+                fileManager.makeDirectory(directoryPath);
+            
+            StringList buffers(1);
+            String& buffer = buffers.front();
+            
+            const MapSnapshot::EntityDataList& entities = snapshot.entities();
+            const MapSnapshot::FaceDataList& faces = snapshot.faces();
+            MapSnapshot::EntityDataList::const_iterator it, end;
+            for (it = entities.begin(), end = entities.end(); it != end; ++it) {
+                const MapSnapshot::EntityData& entity = *it;
+                writeEntityHeader(entity.properties, buffer);
+                for (size_t i = entity.firstBrush; i < entity.firstBrush + entity.brushCount; i++) {
+                    buffer += "{\n";
+                    const size_t firstFace = snapshot.firstFace(i);
+                    for (size_t j = firstFace; j < firstFace + snapshot.faceCount(i); j++)
+                        writeFace(faces[j], buffer);
+                    buffer += "}\n";
+                }
+                writeEntityFooter(buffer);
+            }
+            
+            writeFile(buffers, path);
         }
     }
 }
@@ -22,10 +22,11 @@
 
 #include "Model/EntityTypes.h"
 #include "Model/BrushTypes.h"
+#include "Model/EntityProperty.h"
 #include "Model/FaceTypes.h"
+#include "IO/MapSnapshot.h"
 #include "Utility/String.h"
 
-#include <cstdio>
 #include <ostream>
 
 #if defined _MSC_VER
@@ -42,29 +43,44 @@ namespace TrenchBroom {
         class Map;
     }
     
+    namespace Utility {
+        class ThreadPool;
+    }
+    
     namespace IO {
         class MapWriter {
         private:
             static const int FloatPrecision = 100;
-            String FaceFormat;
-        protected:
-            size_t writeFace(Model::Face& face, const size_t lineNumber, FILE* stream);
-            size_t writeBrush(Model::Brush& brush, const size_t lineNumber, FILE* stream);
-            size_t writeEntityHeader(Model::Entity& entity, FILE* stream);
-            size_t writeEntityFooter(FILE* stream);
-            size_t writeEntity(Model::Entity& entity, const size_t lineNumber, FILE* stream);
+            static const size_t FormatBatchLineCount = 16384;
+            
+            class FormatTask;
             
-            void writeFace(const Model::Face& face, std::ostream& stream);
-            void writeBrush(const Model::Brush& brush, std::ostream& stream);
-            void writeEntityHeader(const Model::Entity& entity, std::ostream& stream);
-            void writeEntityFooter(std::ostream& stream);
-            void writeEntity(const Model::Entity& entity, std::ostream& stream);
+            void writeFile(const StringList& buffers, const String& path);
+        protected:
+            void writeFace(const MapSnapshot::FaceData& face, String& buffer);
+            size_t writeFace(Model::Face& face, const size_t lineNumber, String& buffer);
+            size_t writeBrush(Model::Brush& brush, const size_t lineNumber, String& buffer);
+            size_t writeEntityHeader(const Model::PropertyList& properties, String& buffer);
+            size_t writeEntityFooter(String& buffer);
+            void writeBrush(const Model::Brush& brush, String& buffer);
+            void writeEntity(const Model::Entity& entity, String& buffer);
         public:
-            MapWriter();
             void writeObjectsToStream(const Model::EntityList& pointEntities, const Model::BrushList& brushes, std::ostream& stream);
             void writeFacesToStream(const Model::FaceList& faces, std::ostream& stream);
             void writeToStream(const Model::Map& map, std::ostream& stream);
-            void writeToFileAtPath(Model::Map& map, const String& path, bool overwrite);
+            
+            /*
+             * Writes the map to a temporary file next to the given path and moves it into place once it has been
+             * flushed to disk, so that the original file stays intact if saving fails. If a thread pool is given, the
+             * entities are formatted on its worker threads.
+             */
+            void writeToFileAtPath(Model::Map& map, const String& path, bool overwrite, Utility::ThreadPool* threadPool = NULL);
+            
+            /*
+             * Writes a snapshot of a map in the same way. The snapshot is formatted on the calling thread and the file
+             * positions of the map objects are not updated.
+             */
+            void writeToFileAtPath(const MapSnapshot& snapshot, const String& path, bool overwrite);
         };
     }
 }
@@ -51,12 +51,12 @@ namespace TrenchBroom {
 
                 char* entryBegin = m_file->begin() + entryAddress;
                 char* entryEnd = entryBegin + entryLength;
-                m_directory[Utility::toLower(entryName)] = PakEntry(entryName, entryBegin, entryEnd);
+                m_directory[Utility::toLower(entryName)] = PakEntry(entryName, m_file, entryBegin, entryEnd);
             }
         }
         
-        MappedFile::Ptr Pak::entry(const String& name) {
-            PakDirectory::iterator it = m_directory.find(Utility::toLower(name));
+        MappedFile::Ptr Pak::entry(const String& name) const {
+            PakDirectory::const_iterator it = m_directory.find(Utility::toLower(name));
             if (it == m_directory.end())
                 return MappedFile::Ptr();
             
@@ -66,19 +66,17 @@ namespace TrenchBroom {
 
         PakManager* PakManager::sharedManager = NULL;
         
-        bool PakManager::findPaks(const String& path, PakList& result) {
+        const PakManager::PakList* PakManager::findPaks(const String& path) {
             String lowerPath = Utility::toLower(path);
             PakMap::iterator it = m_paks.find(lowerPath);
             
-            if (it != m_paks.end()) {
-                result = it->second;
-                return true;
-            }
+            if (it != m_paks.end())
+                return &it->second;
             
             FileManager fileManager;
             const StringList pakNames = fileManager.directoryContents(path, "pak");
             if (!pakNames.empty()) {
-                PakList newPaks;
+                PakList& newPaks = m_paks[lowerPath];
                 for (unsigned int i = 0; i < pakNames.size(); i++) {
                     String pakPath = fileManager.appendPath(path, pakNames[i]);
                     if (!fileManager.isDirectory(pakPath)) {
@@ -89,19 +87,66 @@ namespace TrenchBroom {
                 }
 
                 std::sort(newPaks.begin(), newPaks.end(), ComparePaksByPath());
-                m_paks[lowerPath] = newPaks;
-                result = newPaks;
-                return true;
+                return &newPaks;
             }
             
-            return false;
+            return NULL;
         }
-
+        
+        const PakManager::GameDirectory& PakManager::findDirectory(FileManager& fileManager, const String& path) {
+            const String lowerPath = Utility::toLower(path);
+            GameDirectoryMap::iterator it = m_directories.find(lowerPath);
+            if (it != m_directories.end())
+                return it->second;
+            
+            // the names are collected first because listing a directory changes the working directory
+            const StringList fileNames = fileManager.directoryContents(path, "", false, true);
+            const StringList directoryNames = fileManager.directoryContents(path, "", true, false);
+            
+            GameDirectory& directory = m_directories[lowerPath];
+            StringList::const_iterator nameIt, nameEnd;
+            for (nameIt = fileNames.begin(), nameEnd = fileNames.end(); nameIt != nameEnd; ++nameIt)
+                directory.files[Utility::toLower(*nameIt)] = *nameIt;
+            for (nameIt = directoryNames.begin(), nameEnd = directoryNames.end(); nameIt != nameEnd; ++nameIt)
+                directory.directories[Utility::toLower(*nameIt)] = *nameIt;
+            return directory;
+        }
+        
+        PakManager::GameFileIndex& PakManager::findIndex(const StringList& searchPaths) {
+            String key;
+            StringList::const_iterator it, end;
+            for (it = searchPaths.begin(), end = searchPaths.end(); it != end; ++it) {
+                key += Utility::toLower(*it);
+                key += '\n';
+            }
+            return m_indices[key];
+        }
+        
+        String PakManager::findLooseFile(FileManager& fileManager, const String& searchPath, const StringList& nameComponents) {
+            if (nameComponents.empty())
+                return "";
+            
+            String path = searchPath;
+            for (size_t i = 0; i < nameComponents.size() - 1; i++) {
+                const GameDirectory& directory = findDirectory(fileManager, path);
+                GameDirectory::NameMap::const_iterator it = directory.directories.find(nameComponents[i]);
+                if (it == directory.directories.end())
+                    return "";
+                path = fileManager.appendPath(path, it->second);
+            }
+            
+            const GameDirectory& directory = findDirectory(fileManager, path);
+            GameDirectory::NameMap::const_iterator it = directory.files.find(nameComponents.back());
+            if (it == directory.files.end())
+                return "";
+            return fileManager.appendPath(path, it->second);
+        }
+        
         MappedFile::Ptr PakManager::entry(const String& name, const String& searchPath) {
-            PakList paks;
-            if (findPaks(searchPath, paks)) {
-                PakList::reverse_iterator pak, endPak;
-                for (pak = paks.rbegin(), endPak = paks.rend(); pak != endPak; ++pak) {
+            const PakList* paks = findPaks(searchPath);
+            if (paks != NULL) {
+                PakList::const_reverse_iterator pak, endPak;
+                for (pak = paks->rbegin(), endPak = paks->rend(); pak != endPak; ++pak) {
                     MappedFile::Ptr data = pak->entry(name);
                     if (data.get() != NULL)
                         return data;
@@ -110,5 +155,44 @@ namespace TrenchBroom {
             
             return MappedFile::Ptr();
         }
+        
+        MappedFile::Ptr PakManager::resolveGameFile(const String& lowerName, const StringList& searchPaths) {
+            FileManager fileManager;
+            const StringList nameComponents = Utility::split(lowerName, '/');
+            
+            StringList::const_reverse_iterator pathIt, pathEnd;
+            for (pathIt = searchPaths.rbegin(), pathEnd = searchPaths.rend(); pathIt != pathEnd; ++pathIt) {
+                const String& searchPath = *pathIt;
+                const String path = findLooseFile(fileManager, searchPath, nameComponents);
+                if (!path.empty())
+                    return fileManager.mapFile(path);
+                
+                MappedFile::Ptr data = entry(lowerName, searchPath);
+                if (data.get() != NULL)
+                    return data;
+            }
+            
+            return MappedFile::Ptr();
+        }
+        
+        MappedFile::Ptr PakManager::findGameFile(const String& name, const StringList& searchPaths) {
+            String lowerName = Utility::toLower(name);
+            std::replace(lowerName.begin(), lowerName.end(), '\\', '/');
+            
+            GameFileIndex& index = findIndex(searchPaths);
+            GameFileIndex::const_iterator it = index.find(lowerName);
+            if (it != index.end())
+                return it->second;
+            
+            MappedFile::Ptr file = resolveGameFile(lowerName, searchPaths);
+            index[lowerName] = file;
+            return file;
+        }
+        
+        void PakManager::invalidate() {
+            m_indices.clear();
+            m_directories.clear();
+            m_paks.clear();
+        }
     }
 }
@@ -27,6 +27,12 @@
 #include <map>
 #include <vector>
 
+#if defined _WIN32
+#include <unordered_map>
+#else
+#include <tr1/unordered_map>
+#endif
+
 #ifdef _MSC_VER
 #include <cstdint>
 #elif defined __GNUC__
@@ -43,15 +49,27 @@ namespace TrenchBroom {
             static const String HeaderMagic             = "PACK";
         }
 
+        /*
+         * The contents of an entry of a pak file. It keeps the pak file mapped for as long as it is used.
+         */
+        class PakEntryData : public MappedFile {
+        private:
+            MappedFile::Ptr m_pakFile;
+        public:
+            PakEntryData(MappedFile::Ptr pakFile, char* begin, char* end) :
+            MappedFile(begin, end),
+            m_pakFile(pakFile) {}
+        };
+        
         class PakEntry {
             String m_name;
             MappedFile::Ptr m_view;
         public:
             PakEntry() {}
 
-            PakEntry(const String& name, char* begin, char* end) :
+            PakEntry(const String& name, MappedFile::Ptr pakFile, char* begin, char* end) :
             m_name(name),
-            m_view(MappedFile::Ptr(new MappedFile(begin, end))) {}
+            m_view(MappedFile::Ptr(new PakEntryData(pakFile, begin, end))) {}
 
             inline const String& name() const {
                 return m_name;
@@ -63,9 +81,9 @@ namespace TrenchBroom {
         };
 
         class Pak {
-        private:
+        public:
             typedef std::map<String, PakEntry> PakDirectory;
-
+        private:
             String m_path;
             MappedFile::Ptr m_file;
             PakDirectory m_directory;
@@ -75,8 +93,15 @@ namespace TrenchBroom {
             inline const String& path() const {
                 return m_path;
             }
+            
+            /*
+             * Maps the lower case names of the entries to the entries.
+             */
+            inline const PakDirectory& directory() const {
+                return m_directory;
+            }
 
-            MappedFile::Ptr entry(const String& name);
+            MappedFile::Ptr entry(const String& name) const;
         };
 
         class ComparePaksByPath {
@@ -90,13 +115,57 @@ namespace TrenchBroom {
         private:
             typedef std::vector<Pak> PakList;
             typedef std::map<String, PakList> PakMap;
+            
+            /*
+             * The contents of a directory in a search path, mapping the lower case names of its files and
+             * subdirectories to their actual names.
+             */
+            class GameDirectory {
+            public:
+                typedef std::map<String, String> NameMap;
+                
+                NameMap files;
+                NameMap directories;
+            };
+            
+            typedef std::map<String, GameDirectory> GameDirectoryMap;
+            
+            /*
+             * The merged contents of a set of search paths, mapping the lower case names of the requested files to
+             * their contents, or to an empty pointer if there is no such file.
+             */
+            typedef std::tr1::unordered_map<String, MappedFile::Ptr> GameFileIndex;
+            typedef std::tr1::unordered_map<String, GameFileIndex> GameFileIndexMap;
 
             PakMap m_paks;
-            bool findPaks(const String& path, PakList& result);
+            GameDirectoryMap m_directories;
+            GameFileIndexMap m_indices;
+            
+            const PakList* findPaks(const String& path);
+            const GameDirectory& findDirectory(FileManager& fileManager, const String& path);
+            GameFileIndex& findIndex(const StringList& searchPaths);
+            String findLooseFile(FileManager& fileManager, const String& searchPath, const StringList& nameComponents);
+            MappedFile::Ptr resolveGameFile(const String& lowerName, const StringList& searchPaths);
         public:
             static PakManager* sharedManager;
 
             MappedFile::Ptr entry(const String& name, const String& searchPath);
+            
+            /*
+             * Finds a file in the given search paths and in the pak files they contain. A later search path takes
+             * precedence over an earlier one, and a loose file takes precedence over the pak files in the same search
+             * path, of which those with greater names take precedence. A file is resolved when it is requested for the
+             * first time, using the listings of the directories on its path, which are listed only once. The result,
+             * including a missing file, is kept in an index per set of search paths, so every later request for the
+             * same file is answered from that index without accessing the file system.
+             */
+            MappedFile::Ptr findGameFile(const String& name, const StringList& searchPaths);
+            
+            /*
+             * Forgets all indexed files, listed directories and pak files. This must be called when files were added to
+             * or removed from the search paths or when pak files have changed.
+             */
+            void invalidate();
         };
     }
 }
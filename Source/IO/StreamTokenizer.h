@@ -21,18 +21,114 @@
 #define __TrenchBroom__StreamTokenizer__
 
 #include "IO/ParserException.h"
-#include "Utility/Allocator.h"
 
 #include <cassert>
-#include <cstdlib>
 #include <cstring>
 #include <istream>
-#include <memory>
-#include <stack>
+#include <limits>
+#include <locale>
+#include <sstream>
 
 namespace TrenchBroom {
     namespace IO {
-        class Token : public Utility::Allocator<Token> {
+        class Token {
+        private:
+            /*
+             * Parses a number of the form [+-]digits[.digits][(e|E)[+-]digits] directly from the given range. The
+             * result is the same as that of atof, but it does not depend on the current locale and does not need to
+             * copy the characters. Numbers which cannot be converted exactly using double precision arithmetic are
+             * handed to the standard library using the classic locale.
+             */
+            static double parseDouble(const char* begin, const char* end) {
+                static const double PowersOfTen[] = {
+                    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+                };
+                static const unsigned long long MaxExactMantissa = 1ull << 53;
+
+                const char* cur = begin;
+                bool negative = false;
+                if (cur < end && (*cur == '-' || *cur == '+'))
+                    negative = *cur++ == '-';
+
+                unsigned long long mantissa = 0;
+                int exponent = 0;
+                size_t digits = 0;
+                const char* firstDigit = cur;
+
+                while (cur < end && *cur >= '0' && *cur <= '9') {
+                    if (mantissa > 0 || *cur != '0') {
+                        mantissa = 10 * mantissa + static_cast<unsigned long long>(*cur - '0');
+                        digits++;
+                    }
+                    ++cur;
+                }
+                if (cur < end && *cur == '.') {
+                    ++cur;
+                    while (cur < end && *cur >= '0' && *cur <= '9') {
+                        if (mantissa > 0 || *cur != '0') {
+                            mantissa = 10 * mantissa + static_cast<unsigned long long>(*cur - '0');
+                            digits++;
+                        }
+                        exponent--;
+                        ++cur;
+                    }
+                }
+                if (cur == firstDigit || (cur == firstDigit + 1 && *firstDigit == '.'))
+                    return 0.0; // not a number
+
+                if (cur < end && (*cur == 'e' || *cur == 'E')) {
+                    const char* exp = cur + 1;
+                    bool negativeExponent = false;
+                    if (exp < end && (*exp == '-' || *exp == '+'))
+                        negativeExponent = *exp++ == '-';
+                    if (exp < end && *exp >= '0' && *exp <= '9') {
+                        int value = 0;
+                        while (exp < end && *exp >= '0' && *exp <= '9') {
+                            if (value < 10000)
+                                value = 10 * value + (*exp - '0');
+                            ++exp;
+                        }
+                        exponent += negativeExponent ? -value : value;
+                        cur = exp;
+                    }
+                }
+
+                if (mantissa == 0)
+                    return negative ? -0.0 : 0.0;
+
+                if (digits > 19 || mantissa > MaxExactMantissa || exponent < -22 || exponent > 22) {
+                    std::istringstream stream(String(begin, static_cast<size_t>(cur - begin)));
+                    stream.imbue(std::locale::classic());
+                    double value = 0.0;
+                    stream >> value;
+                    if (stream.fail()) {
+                        // out of range
+                        value = exponent < 0 ? 0.0 : std::numeric_limits<double>::infinity();
+                        return negative ? -value : value;
+                    }
+                    return value;
+                }
+
+                double value = static_cast<double>(mantissa);
+                if (exponent < 0)
+                    value /= PowersOfTen[-exponent];
+                else
+                    value *= PowersOfTen[exponent];
+                return negative ? -value : value;
+            }
+
+            static int parseInteger(const char* begin, const char* end) {
+                const char* cur = begin;
+                bool negative = false;
+                if (cur < end && (*cur == '-' || *cur == '+'))
+                    negative = *cur++ == '-';
+
+                int value = 0;
+                while (cur < end && *cur >= '0' && *cur <= '9')
+                    value = 10 * value + (*cur++ - '0');
+                return negative ? -value : value;
+            }
         protected:
             unsigned int m_type;
             const char* m_begin;
@@ -84,26 +180,19 @@ namespace TrenchBroom {
             }
 
             inline float toFloat() const {
-                static char buffer[64];
-                memcpy(buffer, m_begin, length());
-                buffer[length()] = 0;
-                float f = static_cast<float>(std::atof(buffer));
-                return f;
+                return static_cast<float>(parseDouble(m_begin, m_end));
             }
 
             inline int toInteger() const {
-                static char buffer[64];
-                memcpy(buffer, m_begin, length());
-                buffer[length()] = 0;
-                int i = static_cast<int>(std::atoi(buffer));
-                return i;
+                return parseInteger(m_begin, m_end);
             }
         };
 
         template <typename Emitter>
         class StreamTokenizer {
         private:
-            typedef std::stack<Token> TokenStack;
+            // the parsers never push back more than a couple of tokens, so a small fixed size stack will do
+            static const size_t MaxPushedTokens = 8;
 
             const char* m_begin;
             const char* m_end;
@@ -113,13 +202,12 @@ namespace TrenchBroom {
             size_t m_lastColumn;
 
             Emitter m_emitter;
-            TokenStack m_tokenStack;
+            Token m_tokenStack[MaxPushedTokens];
+            size_t m_pushedTokens;
         protected:
             inline Token popToken() {
-                assert(!m_tokenStack.empty());
-                Token token = m_tokenStack.top();
-                m_tokenStack.pop();
-                return token;
+                assert(m_pushedTokens > 0);
+                return m_tokenStack[--m_pushedTokens];
             }
         public:
             StreamTokenizer(const char* begin, const char* end) :
@@ -128,7 +216,8 @@ namespace TrenchBroom {
             m_cur(begin),
             m_line(1),
             m_column(1),
-            m_lastColumn(0) {}
+            m_lastColumn(0),
+            m_pushedTokens(0) {}
 
             inline size_t line() const {
                 return m_line;
@@ -143,6 +232,10 @@ namespace TrenchBroom {
                 return static_cast<size_t>(ptr - m_begin);
             }
 
+            inline size_t position() const {
+                return offset(m_cur);
+            }
+
             inline const char* nextChar() {
                 if (eof())
                     return 0;
@@ -181,7 +274,7 @@ namespace TrenchBroom {
             }
 
             inline Token nextToken() {
-                return !m_tokenStack.empty() ? popToken() : m_emitter.emit(*this);
+                return m_pushedTokens > 0 ? popToken() : m_emitter.emit(*this);
             }
 
             inline Token peekToken() {
@@ -191,7 +284,8 @@ namespace TrenchBroom {
             }
 
             inline void pushToken(Token& token) {
-                m_tokenStack.push(token);
+                assert(m_pushedTokens < MaxPushedTokens);
+                m_tokenStack[m_pushedTokens++] = token;
             }
 
             inline String remainder(unsigned int delimiterType) {
@@ -222,6 +316,15 @@ namespace TrenchBroom {
                 m_line = 1;
                 m_column = 1;
                 m_cur = m_begin;
+                m_pushedTokens = 0;
+            }
+
+            inline void seek(size_t offset, size_t line, size_t column) {
+                assert(m_begin + offset <= m_end);
+                m_cur = m_begin + offset;
+                m_line = line;
+                m_column = column;
+                m_pushedTokens = 0;
             }
         };
 
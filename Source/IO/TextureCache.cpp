@@ -0,0 +1,179 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TextureCache.h"
+
+#include "IO/IOUtils.h"
+#include "Utility/Hash.h"
+
+#include <cstring>
+#include <fstream>
+
+namespace TrenchBroom {
+    namespace IO {
+        namespace TextureCacheLayout {
+            static const char Magic[4]              = {'T', 'B', 'T', 'C'};
+            static const uint32_t Version           = 1;
+            static const size_t HeaderSize          = 4 + 4 + 8 + 8 + 4 + 4;
+            static const size_t EntrySize           = 4 + 4 + 4 * 4 + 8;
+        }
+        
+        bool TextureCache::load() {
+            const char* end = m_file->end();
+            char* cursor = m_file->begin();
+            
+            if (m_file->size() < TextureCacheLayout::HeaderSize)
+                return false;
+            if (memcmp(cursor, TextureCacheLayout::Magic, 4) != 0)
+                return false;
+            cursor += 4;
+            if (read<uint32_t>(cursor) != TextureCacheLayout::Version)
+                return false;
+            if (read<uint64_t>(cursor) != static_cast<uint64_t>(m_wadSize))
+                return false;
+            if (read<int64_t>(cursor) != static_cast<int64_t>(m_wadModificationTime))
+                return false;
+            if (read<uint32_t>(cursor) != m_paletteChecksum)
+                return false;
+            
+            const size_t pathLength = readSize<uint32_t>(cursor);
+            if (pathLength != m_wadPath.size() || static_cast<size_t>(end - cursor) < pathLength)
+                return false;
+            if (m_wadPath.compare(0, pathLength, cursor, pathLength) != 0)
+                return false;
+            cursor += pathLength;
+            
+            if (static_cast<size_t>(end - cursor) < 4)
+                return false;
+            const size_t entryCount = readSize<uint32_t>(cursor);
+            for (size_t i = 0; i < entryCount; i++) {
+                if (static_cast<size_t>(end - cursor) < 4)
+                    return false;
+                const size_t nameLength = readSize<uint32_t>(cursor);
+                if (static_cast<size_t>(end - cursor) < nameLength + TextureCacheLayout::EntrySize)
+                    return false;
+                const String name(cursor, nameLength);
+                cursor += nameLength;
+                
+                Entry entry;
+                entry.width = readUnsignedInt<uint32_t>(cursor);
+                entry.height = readUnsignedInt<uint32_t>(cursor);
+                for (size_t j = 0; j < 4; j++)
+                    entry.averageColor[j] = read<float>(cursor);
+                entry.offset = readSize<uint64_t>(cursor);
+                
+                const size_t imageSize = static_cast<size_t>(entry.width) * entry.height * 3;
+                if (entry.offset > m_file->size() || m_file->size() - entry.offset < imageSize)
+                    return false;
+                m_entries[name] = entry;
+            }
+            
+            return true;
+        }
+        
+        TextureCache::TextureCache(const String& wadPath, uint32_t paletteChecksum) :
+        m_wadPath(wadPath),
+        m_paletteChecksum(paletteChecksum) {
+            FileManager fileManager;
+            m_wadSize = fileManager.fileSize(m_wadPath);
+            m_wadModificationTime = fileManager.modificationTime(m_wadPath);
+            
+            StringStream fileName;
+            fileName << fileManager.pathComponents(m_wadPath).back() << "-" << std::hex << Utility::hash(m_wadPath.data(), m_wadPath.size()) << ".cache";
+            m_path = fileManager.appendPath(fileManager.appendPath(fileManager.cacheDirectory(), "Textures"), fileName.str());
+            
+            if (fileManager.exists(m_path)) {
+                m_file = fileManager.mapFile(m_path);
+                if (m_file.get() != NULL && !load()) {
+                    m_file.reset();
+                    m_entries.clear();
+                }
+            }
+        }
+        
+        unsigned char* TextureCache::image(const String& name, unsigned int width, unsigned int height, Color& averageColor) const {
+            EntryMap::const_iterator it = m_entries.find(name);
+            if (it == m_entries.end())
+                return NULL;
+            
+            const Entry& entry = it->second;
+            if (entry.width != width || entry.height != height)
+                return NULL;
+            
+            const size_t imageSize = static_cast<size_t>(width) * height * 3;
+            unsigned char* rgbImage = new unsigned char[imageSize];
+            memcpy(rgbImage, m_file->begin() + entry.offset, imageSize);
+            averageColor = entry.averageColor;
+            return rgbImage;
+        }
+        
+        bool TextureCache::write(const ImageList& images) {
+            FileManager fileManager;
+            const String directoryPath = fileManager.deleteLastPathComponent(m_path);
+            if (!fileManager.exists(directoryPath) && !fileManager.makeDirectory(directoryPath))
+                return false;
+            
+            // the images are stored behind the directory, so their offsets are known once the header is complete
+            size_t offset = TextureCacheLayout::HeaderSize + m_wadPath.size() + 4;
+            for (size_t i = 0; i < images.size(); i++)
+                offset += 4 + images[i].name.size() + TextureCacheLayout::EntrySize;
+            
+            const String tempPath = m_path + ".tmp";
+            std::ofstream stream(tempPath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+            if (!stream.is_open())
+                return false;
+            
+            stream.write(TextureCacheLayout::Magic, 4);
+            IO::write<uint32_t>(stream, TextureCacheLayout::Version);
+            IO::write<uint64_t>(stream, static_cast<uint64_t>(m_wadSize));
+            IO::write<int64_t>(stream, static_cast<int64_t>(m_wadModificationTime));
+            IO::write<uint32_t>(stream, m_paletteChecksum);
+            IO::write<uint32_t>(stream, static_cast<uint32_t>(m_wadPath.size()));
+            stream.write(m_wadPath.data(), static_cast<std::streamsize>(m_wadPath.size()));
+            
+            IO::write<uint32_t>(stream, static_cast<uint32_t>(images.size()));
+            for (size_t i = 0; i < images.size(); i++) {
+                const Image& image = images[i];
+                IO::write<uint32_t>(stream, static_cast<uint32_t>(image.name.size()));
+                stream.write(image.name.data(), static_cast<std::streamsize>(image.name.size()));
+                IO::write<uint32_t>(stream, image.width);
+                IO::write<uint32_t>(stream, image.height);
+                for (size_t j = 0; j < 4; j++)
+                    IO::write<float>(stream, image.averageColor[j]);
+                IO::write<uint64_t>(stream, static_cast<uint64_t>(offset));
+                offset += static_cast<size_t>(image.width) * image.height * 3;
+            }
+            
+            for (size_t i = 0; i < images.size(); i++) {
+                const Image& image = images[i];
+                stream.write(reinterpret_cast<const char*>(image.rgbImage), static_cast<std::streamsize>(image.width * image.height * 3));
+            }
+            
+            const bool success = stream.good();
+            stream.close();
+            
+            // the new file only replaces the old one once it is complete, so that a crash never leaves a damaged cache
+            if (!success || !fileManager.moveFile(tempPath, m_path, true)) {
+                fileManager.deleteFile(tempPath);
+                return false;
+            }
+            return true;
+        }
+    }
+}
@@ -0,0 +1,109 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TrenchBroom__TextureCache__
+#define __TrenchBroom__TextureCache__
+
+#include "IO/FileManager.h"
+#include "Utility/Color.h"
+#include "Utility/String.h"
+
+#include <ctime>
+#include <map>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <cstdint>
+#elif defined __GNUC__
+#include <stdint.h>
+#endif
+
+namespace TrenchBroom {
+    namespace IO {
+        /*
+         * Stores the converted RGB images and the average colors of all textures of a wad file so that they need not
+         * be decoded again when the wad file is loaded the next time. A cache file is only used if the path, the size
+         * and the modification time of the wad file and the checksum of the palette match those it was written with.
+         * The file is written in native byte order because it is never shared between machines.
+         */
+        class TextureCache {
+        public:
+            class Image {
+            public:
+                String name;
+                unsigned int width;
+                unsigned int height;
+                const unsigned char* rgbImage;
+                Color averageColor;
+                
+                Image(const String& i_name, unsigned int i_width, unsigned int i_height, const unsigned char* i_rgbImage, const Color& i_averageColor) :
+                name(i_name),
+                width(i_width),
+                height(i_height),
+                rgbImage(i_rgbImage),
+                averageColor(i_averageColor) {}
+            };
+            
+            typedef std::vector<Image> ImageList;
+        private:
+            class Entry {
+            public:
+                unsigned int width;
+                unsigned int height;
+                Color averageColor;
+                size_t offset;
+            };
+            
+            typedef std::map<String, Entry> EntryMap;
+            
+            String m_path;
+            String m_wadPath;
+            size_t m_wadSize;
+            time_t m_wadModificationTime;
+            uint32_t m_paletteChecksum;
+            MappedFile::Ptr m_file;
+            EntryMap m_entries;
+            
+            bool load();
+        public:
+            TextureCache(const String& wadPath, uint32_t paletteChecksum);
+            
+            /*
+             * Indicates whether the cache file exists and matches the wad file and the palette.
+             */
+            inline bool valid() const {
+                return m_file.get() != NULL;
+            }
+            
+            /*
+             * Returns a copy of the cached image of the texture with the given name and dimensions, or NULL if the
+             * texture is not in the cache. May be called from several threads at once.
+             */
+            unsigned char* image(const String& name, unsigned int width, unsigned int height, Color& averageColor) const;
+            
+            /*
+             * Replaces the cache file with one which contains the given images. Returns false if the file could not
+             * be written.
+             */
+            bool write(const ImageList& images);
+        };
+    }
+}
+
+#endif /* defined(__TrenchBroom__TextureCache__) */
@@ -45,16 +45,18 @@ namespace TrenchBroom {
             assert(m_pictures.size() == m_times.size());
         }
 
-        AliasSkin::~AliasSkin() {
-            Utility::deleteAll(m_pictures);
-        }
-
-        AliasSingleFrame::AliasSingleFrame(const String& name, const AliasFrameTriangleList& triangles, const Vec3f& center, const BBoxf& bounds) :
+        AliasSingleFrame::AliasSingleFrame(const String& name, const unsigned char* packedVertices) :
         m_name(name),
-        m_triangles(triangles),
-        m_center(center),
-        m_bounds(bounds) {}
-
+        m_packedVertices(packedVertices),
+        m_decoded(false) {}
+
+        void AliasSingleFrame::setDecoded(Renderer::FaceVertex::List& vertices, const Vec3f& center, const BBoxf& bounds) {
+            m_vertices.swap(vertices);
+            m_center = center;
+            m_bounds = bounds;
+            m_decoded = true;
+        }
+        
         AliasSingleFrame* AliasSingleFrame::firstFrame() {
             return this;
         }
@@ -63,14 +65,6 @@ namespace TrenchBroom {
         m_times(times),
         m_frames(frames) {
             assert(m_times.size() == m_frames.size());
-
-            if (!m_frames.empty()) {
-                m_bounds = m_frames[0]->bounds();
-                for (size_t i = 1; i < m_frames.size(); i++)
-                    m_bounds.mergeWith(m_frames[i]->bounds());
-            } else {
-                m_bounds.min = m_bounds.max = Vec3f::Null;
-            }
         }
 
         AliasFrameGroup::~AliasFrameGroup() {
@@ -81,76 +75,58 @@ namespace TrenchBroom {
             return m_frames[0];
         }
 
-        Vec3f Alias::unpackFrameVertex(const AliasPackedFrameVertex& packedVertex, const Vec3f& origin, const Vec3f& size) {
-            Vec3f vertex;
-            for (size_t i = 0; i < 3; i++)
-                vertex[i] = size[i] * packedVertex[i] + origin[i];
-            return vertex;
-        }
-
-        AliasSingleFrame* Alias::readFrame(char*& cursor, const Vec3f& origin, const Vec3f& scale, unsigned int skinWidth, unsigned int skinHeight, const AliasSkinVertexList& vertices, const AliasSkinTriangleList& triangles) {
+        AliasSingleFrame* Alias::readFrame(char*& cursor) {
             using namespace IO;
             
             char name[AliasLayout::SimpleFrameLength];
             cursor += AliasLayout::SimpleFrameName;
             readBytes(cursor, name, AliasLayout::SimpleFrameLength);
 
-            std::vector<AliasPackedFrameVertex> packedFrameVertices(vertices.size());
-            readBytes(cursor, reinterpret_cast<char*>(&packedFrameVertices[0]), vertices.size() * 4);
-
-            Vec3f::List frameVertices(vertices.size());
-            Vec3f center;
-            BBoxf bounds;
-
-            frameVertices[0] = unpackFrameVertex(packedFrameVertices[0], origin, scale);
-            center = frameVertices[0];
-            bounds.min = frameVertices[0];
-            bounds.max = frameVertices[0];
+            const unsigned char* packedVertices = reinterpret_cast<const unsigned char*>(cursor);
+            cursor += m_vertexCount * AliasLayout::FrameVertexSize;
+            
+            return new AliasSingleFrame(name, packedVertices);
+        }
 
-            for (unsigned int i = 1; i < vertices.size(); i++) {
-                frameVertices[i] = unpackFrameVertex(packedFrameVertices[i], origin, scale);
-                center += frameVertices[i];
-                bounds.mergeWith(frameVertices[i]);
+        void Alias::decodeFrame(AliasSingleFrame& frame) const {
+            assert(m_vertexCount > 0);
+            
+            const unsigned char* packedVertices = frame.packedVertices();
+            Vec3f::List positions(m_vertexCount);
+            for (size_t i = 0; i < m_vertexCount; i++) {
+                const unsigned char* packedVertex = packedVertices + i * AliasLayout::FrameVertexSize;
+                for (size_t j = 0; j < 3; j++)
+                    positions[i][j] = m_scale[j] * packedVertex[j] + m_origin[j];
             }
-
-            center /= static_cast<float>(vertices.size());
-
-            AliasFrameTriangleList frameTriangles;
-            frameTriangles.reserve(triangles.size());
-            for (unsigned int i = 0; i < triangles.size(); i++) {
-                AliasFrameTriangle* frameTriangle = new AliasFrameTriangle();
-                for (unsigned int j = 0; j < 3; j++) {
-                    size_t index = triangles[i].vertices[j];
-
-                    Vec2f texCoords;
-                    texCoords[0] = static_cast<float>(vertices[index].s) / static_cast<float>(skinWidth);
-                    texCoords[1] = static_cast<float>(vertices[index].t) / static_cast<float>(skinHeight);
-
-                    if (vertices[index].onseam && !triangles[i].front)
-                        texCoords[0] += 0.5f;
-
-                    (*frameTriangle)[j].setPosition(frameVertices[index]);
-                    (*frameTriangle)[j].setNormal(AliasNormals[packedFrameVertices[index][3]]);
-                    (*frameTriangle)[j].setTexCoords(texCoords);
-                }
-
-                frameTriangles.push_back(frameTriangle);
+            
+            Vec3f center = positions[0];
+            BBoxf bounds(positions[0], positions[0]);
+            for (size_t i = 1; i < m_vertexCount; i++) {
+                center += positions[i];
+                bounds.mergeWith(positions[i]);
             }
-
-            return new AliasSingleFrame(name, frameTriangles, center, bounds);
-        }
-
-        AliasSingleFrame::~AliasSingleFrame() {
-            Utility::deleteAll(m_triangles);
+            center /= static_cast<float>(m_vertexCount);
+
+            Renderer::FaceVertex::List vertices;
+            vertices.reserve(m_triangleVertices.size());
+            for (size_t i = 0; i < m_triangleVertices.size(); i++) {
+                const unsigned int index = m_triangleVertices[i];
+                const unsigned char normalIndex = packedVertices[index * AliasLayout::FrameVertexSize + 3];
+                vertices.push_back(Renderer::FaceVertex(positions[index], AliasNormals[normalIndex], m_triangleTexCoords[i]));
+            }
+            
+            frame.setDecoded(vertices, center, bounds);
         }
 
-        Alias::Alias(const String& name, char* begin, char* end) :
-        m_name(name) {
+        Alias::Alias(const String& name, IO::MappedFile::Ptr file) :
+        m_name(name),
+        m_file(file) {
             using namespace IO;
             
+            char* begin = m_file->begin();
             char* cursor = begin + AliasLayout::HeaderScale;
-            Vec3f scale = readVec3f(cursor);
-            Vec3f origin = readVec3f(cursor);
+            m_scale = readVec3f(cursor);
+            m_origin = readVec3f(cursor);
 
             cursor = begin + AliasLayout::HeaderNumSkins;
             unsigned int skinCount = readUnsignedInt<int32_t>(cursor);
@@ -161,14 +137,14 @@ namespace TrenchBroom {
             unsigned int vertexCount = readUnsignedInt<int32_t>(cursor);
             unsigned int triangleCount = readUnsignedInt<int32_t>(cursor);
             unsigned int frameCount = readUnsignedInt<int32_t>(cursor);
-            frameCount = frameCount; // dummy to suppress "unused" warning
+            m_vertexCount = vertexCount;
             
             cursor = begin + AliasLayout::Skins;
             for (unsigned int i = 0; i < skinCount; i++) {
                 unsigned int skinGroup = readUnsignedInt<int32_t>(cursor);
                 if (skinGroup == 0) {
-                    unsigned char* skinPicture = new unsigned char[skinSize];
-                    readBytes(cursor, skinPicture, skinSize);
+                    const unsigned char* skinPicture = reinterpret_cast<const unsigned char*>(cursor);
+                    cursor += skinSize;
 
                     AliasSkin* skin = new AliasSkin(skinPicture, skinWidth, skinHeight);
                     m_skins.push_back(skin);
@@ -181,13 +157,9 @@ namespace TrenchBroom {
                     for (size_t j = 0; j < static_cast<size_t>(numPics); j++) {
                         cursor = base + j * sizeof(float);
                         times[j] = readFloat<float>(cursor);
-
-                        unsigned char* skinPicture = new unsigned char[skinSize];
-                        cursor = base + numPics * 4 + j * skinSize;
-                        readBytes(cursor, skinPicture, skinSize);
-
-                        skinPictures[j] = skinPicture;
+                        skinPictures[j] = reinterpret_cast<const unsigned char*>(base + numPics * 4 + j * skinSize);
                     }
+                    cursor = base + numPics * 4 + numPics * skinSize;
 
                     AliasSkin* skin = new AliasSkin(skinPictures, times, numPics, skinWidth, skinHeight);
                     m_skins.push_back(skin);
@@ -195,26 +167,36 @@ namespace TrenchBroom {
             }
 
             // now cursor is at the first skin vertex
-            std::vector<AliasSkinVertex> vertices(vertexCount);
+            AliasSkinVertexList vertices(vertexCount);
             for (unsigned int i = 0; i < vertexCount; i++) {
                 vertices[i].onseam = readBool<int32_t>(cursor);
                 vertices[i].s = readInt<int32_t>(cursor);
                 vertices[i].t = readInt<int32_t>(cursor);
             }
 
-            // now cursor is at the first skin triangle
-            std::vector<AliasSkinTriangle> triangles(triangleCount);
+            // now cursor is at the first skin triangle, the texture coordinates are the same for every frame
+            m_triangleVertices.resize(3 * triangleCount);
+            m_triangleTexCoords.resize(3 * triangleCount);
             for (unsigned int i = 0; i < triangleCount; i++) {
-                triangles[i].front = readBool<int32_t>(cursor);
-                for (unsigned int j = 0; j < 3; j++)
-                    triangles[i].vertices[j] = readUnsignedInt<int32_t>(cursor);
+                const bool front = readBool<int32_t>(cursor);
+                for (unsigned int j = 0; j < 3; j++) {
+                    const unsigned int index = readUnsignedInt<int32_t>(cursor);
+                    
+                    Vec2f& texCoords = m_triangleTexCoords[3 * i + j];
+                    texCoords[0] = static_cast<float>(vertices[index].s) / static_cast<float>(skinWidth);
+                    texCoords[1] = static_cast<float>(vertices[index].t) / static_cast<float>(skinHeight);
+                    if (vertices[index].onseam && !front)
+                        texCoords[0] += 0.5f;
+                    
+                    m_triangleVertices[3 * i + j] = index;
+                }
             }
 
-            // now cursor is at the first frame
+            // now cursor is at the first frame, only the locations of the frames are recorded here
             for (unsigned int i = 0; i < frameCount; i++) {
                 int type = readInt<int32_t>(cursor);
                 if (type == 0) { // single frame
-                    m_frames.push_back(readFrame(cursor, origin, scale, skinWidth, skinHeight, vertices, triangles));
+                    m_frames.push_back(readFrame(cursor));
                 } else { // frame group
                     char* base = cursor;
                     unsigned int groupFrameCount = readUnsignedInt<int32_t>(cursor);
@@ -225,51 +207,22 @@ namespace TrenchBroom {
                     AliasTimeList groupFrameTimes(groupFrameCount);
                     AliasSingleFrameList groupFrames(groupFrameCount);
                     for (unsigned int j = 0; j < groupFrameCount; j++) {
-                        groupFrameTimes[i] = readFloat<float>(timeCursor);
-                        groupFrames[j] = readFrame(frameCursor, origin, scale, skinWidth, skinHeight, vertices, triangles);
+                        groupFrameTimes[j] = readFloat<float>(timeCursor);
+                        groupFrames[j] = readFrame(frameCursor);
                     }
 
                     m_frames.push_back(new AliasFrameGroup(groupFrameTimes, groupFrames));
                     cursor = frameCursor;
                 }
             }
+            
+            if (!m_frames.empty())
+                decodeFrame(*m_frames[0]->firstFrame());
         }
 
         Alias::~Alias() {
             Utility::deleteAll(m_frames);
             Utility::deleteAll(m_skins);
         }
-
-        AliasManager* AliasManager::sharedManager = NULL;
-
-        Alias const * const AliasManager::alias(const String& name, const StringList& paths, Utility::Console& console) {
-            String pathList = Utility::join(paths, ",");
-            String key = pathList + ":" + name;
-
-            AliasMap::iterator it = m_aliases.find(key);
-            if (it != m_aliases.end())
-                return it->second;
-
-            console.info("Loading '%s' (searching %s)", name.c_str(), pathList.c_str());
-
-            IO::MappedFile::Ptr file = IO::findGameFile(name, paths);
-            if (file.get() != NULL) {
-                Alias* alias = new Alias(name, file->begin(), file->end());
-                m_aliases[key] = alias;
-                return alias;
-            }
-
-            console.warn("Unable to find MDL '%s'", name.c_str());
-            return NULL;
-        }
-
-        AliasManager::AliasManager() {}
-
-        AliasManager::~AliasManager() {
-            AliasMap::iterator it, end;
-            for (it = m_aliases.begin(), end = m_aliases.end(); it != end; ++it)
-                delete it->second;
-            m_aliases.clear();
-        }
     }
 }
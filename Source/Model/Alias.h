@@ -20,8 +20,8 @@
 #ifndef TrenchBroom_Alias_h
 #define TrenchBroom_Alias_h
 
-#include "IO/Pak.h"
-#include "Utility/Console.h"
+#include "IO/AbstractFileManager.h"
+#include "Renderer/FaceVertex.h"
 #include "Utility/String.h"
 #include "Utility/VecMath.h"
 
@@ -63,78 +63,14 @@ namespace TrenchBroom {
         
         typedef std::vector<AliasSkinTriangle> AliasSkinTriangleList;
         
-        class AliasPackedFrameVertex {
-        private:
-            unsigned char m_values[4];
-        public:
-            AliasPackedFrameVertex() {
-                for (size_t i = 0; i < 4; i++)
-                    m_values[i] = 0;
-            }
-            
-            inline const unsigned char& operator[](const size_t index) const {
-                assert(index < 4);
-                return m_values[index];
-            }
-            
-            inline unsigned char& operator[](const size_t index) {
-                assert(index < 4);
-                return m_values[index];
-            }
-        };
-        
         // publicly visible classes below
         
-        class AliasFrameVertex {
-        private:
-            Vec3f m_position;
-            Vec3f m_normal;
-            Vec2f m_texCoords;
-        public:
-            inline const Vec3f& position() const {
-                return m_position;
-            }
-            
-            inline void setPosition(const Vec3f& position) {
-                m_position = position;
-            }
-            
-            inline const Vec3f& normal() const {
-                return m_normal;
-            }
-            
-            inline void setNormal(const Vec3f& normal) {
-                m_normal = normal;
-            }
-            
-            inline const Vec2f& texCoords() const {
-                return m_texCoords;
-            }
-            
-            inline void setTexCoords(const Vec2f& texCoords) {
-                m_texCoords = texCoords;
-            }
-        };
-        
-        class AliasFrameTriangle {
-        private:
-            AliasFrameVertex m_vertices[3];
-        public:
-            inline AliasFrameVertex& operator[] (const size_t index) {
-                assert(index < 3);
-                return m_vertices[index];
-            }
-            
-            inline const AliasFrameVertex& operator[] (const size_t index) const {
-                assert(index < 3);
-                return m_vertices[index];
-            }
-        };
-        
-        typedef std::vector<AliasFrameTriangle*> AliasFrameTriangleList;
         typedef std::vector<float> AliasTimeList;
         typedef std::vector<const unsigned char*> AliasPictureList;
         
+        /*
+         * The pictures of a skin point directly into the model file, which is kept mapped by the model.
+         */
         class AliasSkin {
         public:
         private:
@@ -146,7 +82,6 @@ namespace TrenchBroom {
         public:
             AliasSkin(const unsigned char* picture, unsigned int width, unsigned int height);
             AliasSkin(const AliasPictureList& pictures, const AliasTimeList& times, unsigned int count, unsigned int width, unsigned int height);
-            ~AliasSkin();
             
             inline unsigned int width() const {
                 return m_width;
@@ -173,32 +108,51 @@ namespace TrenchBroom {
         
         typedef std::vector<AliasFrame*> AliasFrameList;
         
+        /*
+         * A frame only remembers where its packed vertices are located in the model file until it is decoded by its
+         * model. The decoded vertices are stored in triangle order, three per triangle, with the layout of the face
+         * vertices so that they can be copied into a vertex buffer as they are.
+         */
         class AliasSingleFrame : public AliasFrame {
         private:
             String m_name;
-            AliasFrameTriangleList m_triangles;
+            const unsigned char* m_packedVertices;
+            Renderer::FaceVertex::List m_vertices;
             Vec3f m_center;
             BBoxf m_bounds;
+            bool m_decoded;
         public:
-            AliasSingleFrame(const String& name, const AliasFrameTriangleList& triangles, const Vec3f& center, const BBoxf& bounds);
-            ~AliasSingleFrame();
+            AliasSingleFrame(const String& name, const unsigned char* packedVertices);
             
             inline const String& name() const {
                 return m_name;
             }
             
-            inline const AliasFrameTriangleList& triangles() const {
-                return m_triangles;
+            inline const unsigned char* packedVertices() const {
+                return m_packedVertices;
+            }
+            
+            inline bool decoded() const {
+                return m_decoded;
+            }
+            
+            inline const Renderer::FaceVertex::List& vertices() const {
+                assert(m_decoded);
+                return m_vertices;
             }
             
             inline const Vec3f& center() const {
+                assert(m_decoded);
                 return m_center;
             }
             
             inline const BBoxf& bounds() const {
+                assert(m_decoded);
                 return m_bounds;
             }
             
+            void setDecoded(Renderer::FaceVertex::List& vertices, const Vec3f& center, const BBoxf& bounds);
+            
             AliasSingleFrame* firstFrame();
         };
         
@@ -206,23 +160,44 @@ namespace TrenchBroom {
         private:
             AliasTimeList m_times;
             AliasSingleFrameList m_frames;
-            BBoxf m_bounds;
         public:
             AliasFrameGroup(const AliasTimeList& times, const AliasSingleFrameList& frames);
             ~AliasFrameGroup();
+            
+            inline const AliasTimeList& times() const {
+                return m_times;
+            }
+            
+            inline const AliasSingleFrameList& frames() const {
+                return m_frames;
+            }
+            
             AliasSingleFrame* firstFrame();
         };
         
+        /*
+         * Keeps the model file mapped and decodes its frames when they are first accessed. Only the first frame is
+         * decoded when the model is loaded. Since the other frames are decoded by frame, a model must not be accessed
+         * from several threads at once.
+         */
         class Alias {
         private:
             String m_name;
+            IO::MappedFile::Ptr m_file;
             AliasFrameList m_frames;
             AliasSkinList m_skins;
             
-            Vec3f unpackFrameVertex(const AliasPackedFrameVertex& packedVertex, const Vec3f& origin, const Vec3f& size);
-            AliasSingleFrame* readFrame(char*& cursor, const Vec3f& origin, const Vec3f& scale, unsigned int skinWidth, unsigned int skinHeight, const AliasSkinVertexList& vertices, const AliasSkinTriangleList& triangles);
+            // the frame independent part of the triangles, three entries per triangle
+            Vec3f m_origin;
+            Vec3f m_scale;
+            size_t m_vertexCount;
+            std::vector<unsigned int> m_triangleVertices;
+            Vec2f::List m_triangleTexCoords;
+            
+            AliasSingleFrame* readFrame(char*& cursor);
+            void decodeFrame(AliasSingleFrame& frame) const;
         public:
-            Alias(const String& name, char* begin, char* end);
+            Alias(const String& name, IO::MappedFile::Ptr file);
             ~Alias();
             
             inline const String& name() const {
@@ -235,29 +210,20 @@ namespace TrenchBroom {
             
             inline AliasSingleFrame& frame(size_t index) const {
                 assert(index < m_frames.size());
-                return *m_frames[index]->firstFrame();
+                AliasSingleFrame& frame = *m_frames[index]->firstFrame();
+                if (!frame.decoded())
+                    decodeFrame(frame);
+                return frame;
             }
             
             inline AliasSingleFrame& firstFrame() const {
-                return *m_frames[0]->firstFrame();
+                return frame(0);
             }
             
             inline const AliasSkinList& skins() const {
                 return m_skins;
             }
         };
-        
-        class AliasManager {
-        private:
-            typedef std::map<String, Alias*> AliasMap;
-            
-            AliasMap m_aliases;
-        public:
-            static AliasManager* sharedManager;
-            AliasManager();
-            ~AliasManager();
-            Alias const * const alias(const String& name, const StringList& paths, Utility::Console& console);
-        };
     }
 }
 #endif
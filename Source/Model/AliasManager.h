@@ -0,0 +1,46 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TrenchBroom__AliasManager__
+#define __TrenchBroom__AliasManager__
+
+#include "Model/Alias.h"
+#include "Model/EntityModelManager.h"
+#include "Utility/Console.h"
+#include "Utility/String.h"
+
+namespace TrenchBroom {
+    namespace Model {
+        class AliasManager : public EntityModelManager<Alias> {
+        public:
+            static AliasManager* sharedManager;
+            AliasManager();
+            
+            inline Alias const * const alias(const String& name, const StringList& paths, Utility::Console& console) {
+                return model(name, paths, console);
+            }
+            
+            inline Alias const * const requestAlias(const String& name, const StringList& paths, Utility::Console& console, bool& loading) {
+                return requestModel(name, paths, console, loading);
+            }
+        };
+    }
+}
+
+#endif /* defined(__TrenchBroom__AliasManager__) */
@@ -53,6 +53,27 @@ namespace TrenchBroom {
             rebuildGeometry();
         }
 
+        Brush::Brush(const BBoxf& worldBounds, bool forceIntegerFacePoints, const FaceList& faces, BrushGeometry* geometry) :
+        MapObject(),
+        m_geometry(geometry),
+        m_worldBounds(worldBounds),
+        m_forceIntegerFacePoints(forceIntegerFacePoints) {
+            init();
+
+            FaceList::const_iterator it, end;
+            for (it = faces.begin(), end = faces.end(); it != end; ++it) {
+                Face* face = *it;
+                face->setBrush(this);
+                m_faces.push_back(face);
+            }
+
+            const SideList& sides = m_geometry->sides;
+            for (size_t i = 0; i < sides.size(); i++) {
+                if (sides[i]->face != NULL)
+                    sides[i]->face->setSide(sides[i]);
+            }
+        }
+
         Brush::Brush(const BBoxf& worldBounds, bool forceIntegerFacePoints, const Brush& brushTemplate) :
         MapObject(),
         m_geometry(NULL),
@@ -596,7 +617,7 @@ namespace TrenchBroom {
         }
 
         bool Brush::containsBrush(const Brush& brush) const {
-            if (bounds().contains(brush.bounds()))
+            if (!bounds().contains(brush.bounds()))
                 return false;
 
             const VertexList& theirVertices = brush.vertices();
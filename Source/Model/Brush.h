@@ -56,6 +56,12 @@ namespace TrenchBroom {
             Brush(const BBoxf& worldBounds, bool forceIntegerFacePoints, const FaceList& faces);
             Brush(const BBoxf& worldBounds, bool forceIntegerFacePoints, const Brush& brushTemplate);
             Brush(const BBoxf& worldBounds, bool forceIntegerFacePoints, const BBoxf& brushBounds, Texture* texture);
+            
+            /*
+             * Takes ownership of the given geometry, which must have been built from the given faces, instead of
+             * building it again. Used by the map cache.
+             */
+            Brush(const BBoxf& worldBounds, bool forceIntegerFacePoints, const FaceList& faces, BrushGeometry* geometry);
             ~Brush();
 
             void restore(const Brush& brushTemplate, bool checkId = false);
@@ -129,6 +135,10 @@ namespace TrenchBroom {
                 return m_geometry->edges;
             }
 
+            inline const BrushGeometry& geometry() const {
+                return *m_geometry;
+            }
+
             inline bool closed() const {
                 return m_geometry->closed();
             }
@@ -21,6 +21,7 @@
 
 #include "Model/Face.h"
 #include "Utility/List.h"
+#include "Utility/PackedPolygon.h"
 
 #include <map>
 #include <cstdio>
@@ -168,54 +169,14 @@ namespace TrenchBroom {
             const Vec3f hit = ray.pointAtDistance(dist);
             const Vec3f projectedHit = cPlane.swizzle(hit);
 
-            const Vertex* vertex = vertices.back();
-            Vec3f v0 = cPlane.swizzle(vertex->position) - projectedHit;
-
-            int c = 0;
+            PackedPolygon polygon;
+            polygon.reset(vertices.size());
             for (unsigned int i = 0; i < vertices.size(); i++) {
-                vertex = vertices[i];
-                Vec3f v1 = cPlane.swizzle(vertex->position) - projectedHit;
-
-                if ((Math<float>::zero(v0.x()) && Math<float>::zero(v0.y())) ||
-                    (Math<float>::zero(v1.x()) && Math<float>::zero(v1.y()))) {
-                    // the point is identical to a polygon vertex, cancel search
-                    c = 1;
-                    break;
-                }
-
-                /*
-                 * A polygon edge intersects with the positive X axis if the
-                 * following conditions are met: The Y coordinates of its
-                 * vertices must have different signs (we assign a negative sign
-                 * to 0 here in order to count it as a negative number) and one
-                 * of the following two conditions must be met: Either the X
-                 * coordinates of the vertices are both positive or the X
-                 * coordinates of the edge have different signs (again, we
-                 * assign a negative sign to 0 here). In the latter case, we
-                 * must calculate the point of intersection between the edge and
-                 * the X axis and determine whether its X coordinate is positive
-                 * or zero.
-                 */
-
-                // do the Y coordinates have different signs?
-                if ((v0.y() > 0.0f && v1.y() <= 0.0f) || (v0.y() <= 0.0f && v1.y() > 0.0f)) {
-                    // Is segment entirely on the positive side of the X axis?
-                    if (v0.x() > 0.0f && v1.x() > 0.0f) {
-                        c += 1; // edge intersects with the X axis
-                        // if not, do the X coordinates have different signs?
-                    } else if ((v0.x() > 0.0f && v1.x() <= 0.0f) || (v0.x() <= 0.0f && v1.x() > 0.0f)) {
-                        // calculate the point of intersection between the edge
-                        // and the X axis
-                        const float x = -v0.y() * (v1.x() - v0.x()) / (v1.y() - v0.y()) + v0.x();
-                        if (x >= 0)
-                            c += 1; // edge intersects with the X axis
-                    }
-                }
-
-                v0 = v1;
+                const Vec3f v = cPlane.swizzle(vertices[i]->position) - projectedHit;
+                polygon.setVertex(i, v.x(), v.y());
             }
 
-            if (c % 2 == 0)
+            if (!polygon.containsOrigin())
                 return Math<float>::nan();
             return dist;
         }
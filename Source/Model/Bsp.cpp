@@ -28,8 +28,9 @@
 
 namespace TrenchBroom {
     namespace Model {
-        BspTexture::BspTexture(const String& name, const unsigned char* image, unsigned int width, unsigned int height) :
+        BspTexture::BspTexture(const String& name, size_t index, const unsigned char* image, unsigned int width, unsigned int height) :
         m_name(name),
+        m_index(index),
         m_image(image),
         m_width(width),
         m_height(height) {}
@@ -79,7 +80,7 @@ namespace TrenchBroom {
                 cursor = base + textureOffset + mip0Offset;
                 readBytes(cursor, mip0, width * height);
 
-                BspTexture* texture = new BspTexture(textureName, mip0, width, height);
+                BspTexture* texture = new BspTexture(textureName, i, mip0, width, height);
                 m_textures[i] = texture;
             }
         }
@@ -151,10 +152,11 @@ namespace TrenchBroom {
             }
         }
 
-        Bsp::Bsp(const String& name, char* begin, char* end) :
+        Bsp::Bsp(const String& name, IO::MappedFile::Ptr file) :
         m_name(name) {
             using namespace IO;
             
+            char* begin = file->begin();
             char* cursor = begin;
             readInt<int32_t>(cursor); // version
             cursor = begin + BspLayout::DirTexturesAddress;
@@ -285,34 +287,7 @@ namespace TrenchBroom {
 
         BspManager* BspManager::sharedManager = NULL;
 
-        const Bsp* BspManager::bsp(const String& name, const StringList& paths, Utility::Console& console) {
-            String pathList = Utility::join(paths, ",");
-            String key = pathList + ":" + name;
-
-            BspMap::iterator it = m_bsps.find(key);
-            if (it != m_bsps.end())
-                return it->second;
-
-            console.info("Loading '%s' (searching %s)", name.c_str(), pathList.c_str());
-
-            IO::MappedFile::Ptr file = IO::findGameFile(name, paths);
-            if (file.get() != NULL) {
-                Bsp* bsp = new Bsp(name, file->begin(), file->end());
-                m_bsps[key] = bsp;
-                return bsp;
-            }
-
-            console.warn("Unable to find BSP '%s'", name.c_str());
-            return NULL;
-        }
-
-        BspManager::BspManager() {}
-
-        BspManager::~BspManager() {
-            BspMap::iterator it, end;
-            for (it = m_bsps.begin(), end = m_bsps.end(); it != end; ++it)
-                delete it->second;
-            m_bsps.clear();
-        }
+        BspManager::BspManager() :
+        EntityModelManager("BSP") {}
     }
 }
@@ -21,6 +21,7 @@
 #define TrenchBroom_Bsp_h
 
 #include "IO/Pak.h"
+#include "Model/EntityModelManager.h"
 #include "Utility/Console.h"
 #include "Utility/VecMath.h"
 
@@ -96,17 +97,22 @@ namespace TrenchBroom {
         class BspTexture {
         private:
             String m_name;
+            size_t m_index;
             const unsigned char* m_image;
             unsigned int m_width;
             unsigned int m_height;
         public:
-            BspTexture(const String& name, const unsigned char* image, unsigned int width, unsigned int height);
+            BspTexture(const String& name, size_t index, const unsigned char* image, unsigned int width, unsigned int height);
             ~BspTexture();
             
             inline const String& name() const {
                 return m_name;
             }
             
+            inline size_t index() const {
+                return m_index;
+            }
+            
             inline const unsigned char* image() const {
                 return m_image;
             }
@@ -197,7 +203,7 @@ namespace TrenchBroom {
             void readFaces(char*& cursor, unsigned int count, BspFaceInfoList& faces);
             void readFaceEdges(char*& cursor, unsigned int count, BspFaceEdgeIndexList& indices);
         public:
-            Bsp(const String& name, char* begin, char* end);
+            Bsp(const String& name, IO::MappedFile::Ptr file);
             ~Bsp();
             
             inline const BspModelList& models() const {
@@ -205,18 +211,19 @@ namespace TrenchBroom {
             }
         };
         
-        class BspManager {
-        private:
-            typedef std::map<String, Bsp*> BspMap;
-            
-            BspMap m_bsps;
+        class BspManager : public EntityModelManager<Bsp> {
         public:
             static BspManager* sharedManager;
             
             BspManager();
-            ~BspManager();
 
-            const Bsp* bsp(const String& name, const StringList& paths, Utility::Console& console);
+            inline const Bsp* bsp(const String& name, const StringList& paths, Utility::Console& console) {
+                return model(name, paths, console);
+            }
+            
+            inline const Bsp* requestBsp(const String& name, const StringList& paths, Utility::Console& console, bool& loading) {
+                return requestModel(name, paths, console, loading);
+            }
         };
     }
 }
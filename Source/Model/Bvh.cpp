@@ -0,0 +1,474 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Bvh.h"
+
+#include "Model/Brush.h"
+#include "Model/Entity.h"
+#include "Model/Map.h"
+#include "Model/MapObject.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+namespace TrenchBroom {
+    namespace Model {
+        // the bounds are enlarged a little when testing them against a ray so that no hit is lost due to rounding errors
+        static const float RaySlack = 0.1f;
+        
+        class Bvh::CompareEntriesByCenter {
+        private:
+            size_t m_axis;
+        public:
+            CompareEntriesByCenter(size_t axis) :
+            m_axis(axis) {}
+            
+            inline bool operator()(const Entry& left, const Entry& right) const {
+                return left.bounds.min[m_axis] + left.bounds.max[m_axis] < right.bounds.min[m_axis] + right.bounds.max[m_axis];
+            }
+        };
+        
+        static inline size_t splitBin(const BBoxf& bounds, const BBoxf& centers, size_t axis, size_t binCount) {
+            const float center = (bounds.min[axis] + bounds.max[axis]) / 2.0f;
+            const float offset = (center - centers.min[axis]) / (centers.max[axis] - centers.min[axis]);
+            return std::min(static_cast<size_t>(offset * static_cast<float>(binCount)), binCount - 1);
+        }
+        
+        static inline float surfaceArea(const BBoxf& bounds) {
+            const Vec3f size = bounds.size();
+            return 2.0f * (size[0] * size[1] + size[1] * size[2] + size[2] * size[0]);
+        }
+        
+        class Bvh::EntryInBins {
+        private:
+            const BBoxf& m_centers;
+            size_t m_axis;
+            size_t m_lastBin;
+        public:
+            EntryInBins(const BBoxf& centers, size_t axis, size_t lastBin) :
+            m_centers(centers),
+            m_axis(axis),
+            m_lastBin(lastBin) {}
+            
+            inline bool operator()(const Entry& entry) const {
+                return splitBin(entry.bounds, m_centers, m_axis, SplitBinCount) <= m_lastBin;
+            }
+        };
+        
+        Bvh::RayTest::RayTest(const Rayf& ray) :
+        m_origin(ray.origin) {
+            for (size_t i = 0; i < 3; i++) {
+                m_parallel[i] = ray.direction[i] == 0.0f;
+                m_invDirection[i] = m_parallel[i] ? 0.0f : 1.0f / ray.direction[i];
+            }
+        }
+        
+        bool Bvh::RayTest::intersects(const BBoxf& bounds, float& distance) const {
+            float near = -std::numeric_limits<float>::max();
+            float far = std::numeric_limits<float>::max();
+            
+            for (size_t i = 0; i < 3; i++) {
+                const float min = bounds.min[i] - RaySlack;
+                const float max = bounds.max[i] + RaySlack;
+                if (m_parallel[i]) {
+                    if (m_origin[i] < min || m_origin[i] > max)
+                        return false;
+                } else {
+                    float t1 = (min - m_origin[i]) * m_invDirection[i];
+                    float t2 = (max - m_origin[i]) * m_invDirection[i];
+                    if (t1 > t2)
+                        std::swap(t1, t2);
+                    if (t1 > near)
+                        near = t1;
+                    if (t2 < far)
+                        far = t2;
+                    if (near > far || far < 0.0f)
+                        return false;
+                }
+            }
+            
+            distance = near;
+            return true;
+        }
+        
+        void Bvh::build() {
+            EntryList entries;
+            entries.reserve(m_entries.size() - m_detachedCount);
+            
+            EntryList::const_iterator it, end;
+            for (it = m_entries.begin(), end = m_entries.end(); it != end; ++it) {
+                const Entry& entry = *it;
+                if (entry.object != NULL)
+                    entries.push_back(Entry(entry.object, entry.object->bounds()));
+            }
+            
+            m_entries.swap(entries);
+            m_nodes.clear();
+            m_entryIndices.clear();
+            
+            if (!m_entries.empty()) {
+                m_nodes.reserve(2 * m_entries.size() / MaxLeafSize + 1);
+                buildNode(0, m_entries.size(), NoNode);
+            }
+            
+            for (size_t i = 0; i < m_entries.size(); i++)
+                m_entryIndices[m_entries[i].object] = i;
+            m_indexedCount = m_entries.size();
+            m_detachedCount = 0;
+        }
+        
+        unsigned int Bvh::buildNode(size_t first, size_t last, unsigned int parent) {
+            assert(first < last);
+            
+            BBoxf bounds = m_entries[first].bounds;
+            BBoxf centers(m_entries[first].bounds.center(), m_entries[first].bounds.center());
+            for (size_t i = first + 1; i < last; i++) {
+                bounds.mergeWith(m_entries[i].bounds);
+                centers.mergeWith(m_entries[i].bounds.center());
+            }
+            
+            const unsigned int index = static_cast<unsigned int>(m_nodes.size());
+            m_nodes.push_back(Node(bounds, parent));
+            
+            if (last - first <= MaxLeafSize) {
+                Node& node = m_nodes[index];
+                node.offset = static_cast<unsigned int>(first);
+                node.count = static_cast<unsigned int>(last - first);
+                for (size_t i = first; i < last; i++)
+                    m_entries[i].node = index;
+                return index;
+            }
+            
+            const size_t mid = split(first, last, centers);
+            buildNode(first, mid, index);
+            const unsigned int second = buildNode(mid, last, index);
+            m_nodes[index].offset = second;
+            return index;
+        }
+        
+        size_t Bvh::split(size_t first, size_t last, const BBoxf& centers) {
+            const Vec3f size = centers.size();
+            size_t axis = 0;
+            if (size[1] > size[axis])
+                axis = 1;
+            if (size[2] > size[axis])
+                axis = 2;
+            
+            if (size[axis] > 0.0f) {
+                // choose the split between two bins which minimizes the surface area heuristic
+                size_t counts[SplitBinCount];
+                BBoxf bounds[SplitBinCount];
+                for (size_t i = 0; i < SplitBinCount; i++)
+                    counts[i] = 0;
+                
+                for (size_t i = first; i < last; i++) {
+                    const BBoxf& entryBounds = m_entries[i].bounds;
+                    const size_t bin = splitBin(entryBounds, centers, axis, SplitBinCount);
+                    if (counts[bin]++ == 0)
+                        bounds[bin] = entryBounds;
+                    else
+                        bounds[bin].mergeWith(entryBounds);
+                }
+                
+                float leftCosts[SplitBinCount];
+                size_t leftCount = 0;
+                BBoxf leftBounds;
+                for (size_t i = 0; i < SplitBinCount - 1; i++) {
+                    if (counts[i] > 0) {
+                        if (leftCount == 0)
+                            leftBounds = bounds[i];
+                        else
+                            leftBounds.mergeWith(bounds[i]);
+                    }
+                    leftCount += counts[i];
+                    leftCosts[i] = static_cast<float>(leftCount) * surfaceArea(leftBounds);
+                }
+                
+                size_t bestBin = SplitBinCount;
+                float bestCost = std::numeric_limits<float>::max();
+                size_t rightCount = 0;
+                BBoxf rightBounds;
+                for (size_t i = SplitBinCount - 1; i > 0; i--) {
+                    if (counts[i] > 0) {
+                        if (rightCount == 0)
+                            rightBounds = bounds[i];
+                        else
+                            rightBounds.mergeWith(bounds[i]);
+                    }
+                    rightCount += counts[i];
+                    const float cost = leftCosts[i - 1] + static_cast<float>(rightCount) * surfaceArea(rightBounds);
+                    if (rightCount < last - first && rightCount > 0 && cost < bestCost) {
+                        bestCost = cost;
+                        bestBin = i - 1;
+                    }
+                }
+                
+                if (bestBin < SplitBinCount) {
+                    EntryList::iterator mid = std::partition(m_entries.begin() + static_cast<long>(first),
+                                                             m_entries.begin() + static_cast<long>(last),
+                                                             EntryInBins(centers, axis, bestBin));
+                    return static_cast<size_t>(mid - m_entries.begin());
+                }
+            }
+            
+            // all centers are in the same spot, so just split in half
+            const size_t mid = (first + last) / 2;
+            std::nth_element(m_entries.begin() + static_cast<long>(first),
+                             m_entries.begin() + static_cast<long>(mid),
+                             m_entries.begin() + static_cast<long>(last),
+                             CompareEntriesByCenter(axis));
+            return mid;
+        }
+        
+        void Bvh::refit(unsigned int nodeIndex) {
+            while (nodeIndex != NoNode) {
+                Node& node = m_nodes[nodeIndex];
+                
+                BBoxf bounds;
+                if (node.leaf()) {
+                    bounds = m_entries[node.offset].bounds;
+                    for (unsigned int i = 1; i < node.count; i++)
+                        bounds.mergeWith(m_entries[node.offset + i].bounds);
+                } else {
+                    bounds = m_nodes[nodeIndex + 1].bounds;
+                    bounds.mergeWith(m_nodes[node.offset].bounds);
+                }
+                
+                if (bounds == node.bounds)
+                    return;
+                node.bounds = bounds;
+                nodeIndex = node.parent;
+            }
+        }
+        
+        bool Bvh::needsRebuild() const {
+            const size_t unindexedCount = m_entries.size() - m_indexedCount;
+            if (m_indexedCount == 0)
+                return unindexedCount > 0;
+            return unindexedCount > 32 + m_indexedCount / 8 || m_detachedCount > m_indexedCount / 4;
+        }
+        
+        Bvh::Bvh(Map& map) :
+        m_map(map),
+        m_indexedCount(0),
+        m_detachedCount(0) {}
+        
+        void Bvh::loadMap() {
+            clear();
+            
+            const EntityList& entities = m_map.entities();
+            for (size_t i = 0; i < entities.size(); i++) {
+                Entity* entity = entities[i];
+                m_entries.push_back(Entry(entity, entity->bounds()));
+                const BrushList& brushes = entity->brushes();
+                for (size_t j = 0; j < brushes.size(); j++) {
+                    Brush* brush = brushes[j];
+                    m_entries.push_back(Entry(brush, brush->bounds()));
+                }
+            }
+            
+            build();
+        }
+        
+        void Bvh::clear() {
+            m_nodes.clear();
+            m_entries.clear();
+            m_entryIndices.clear();
+            m_indexedCount = 0;
+            m_detachedCount = 0;
+        }
+        
+        void Bvh::addObject(MapObject& object) {
+            EntryIndexMap::iterator it = m_entryIndices.lower_bound(&object);
+            if (it != m_entryIndices.end() && it->first == &object) {
+                Entry& entry = m_entries[it->second];
+                assert(entry.object == NULL);
+                entry.object = &object;
+                entry.bounds = object.bounds();
+                if (entry.node != NoNode) {
+                    m_detachedCount--;
+                    refit(entry.node);
+                }
+            } else {
+                m_entryIndices.insert(it, EntryIndexMap::value_type(&object, m_entries.size()));
+                m_entries.push_back(Entry(&object, object.bounds()));
+            }
+        }
+        
+        void Bvh::addObjects(const MapObjectList& objects) {
+            MapObjectList::const_iterator it, end;
+            for (it = objects.begin(), end = objects.end(); it != end; ++it)
+                addObject(**it);
+        }
+        
+        void Bvh::removeObject(MapObject& object) {
+            EntryIndexMap::iterator it = m_entryIndices.find(&object);
+            assert(it != m_entryIndices.end());
+            if (it == m_entryIndices.end())
+                return;
+            
+            const size_t index = it->second;
+            Entry& entry = m_entries[index];
+            assert(entry.object == &object);
+            
+            if (entry.node != NoNode) {
+                // keep the slot in case the object is added again after it has changed
+                entry.object = NULL;
+                m_detachedCount++;
+            } else {
+                if (index != m_entries.size() - 1) {
+                    entry = m_entries.back();
+                    m_entryIndices[entry.object] = index;
+                }
+                m_entries.pop_back();
+                m_entryIndices.erase(it);
+            }
+        }
+        
+        void Bvh::removeObjects(const MapObjectList& objects) {
+            MapObjectList::const_iterator it, end;
+            for (it = objects.begin(), end = objects.end(); it != end; ++it)
+                removeObject(**it);
+        }
+        
+        size_t Bvh::count() const {
+            return m_entries.size() - m_detachedCount;
+        }
+        
+        void Bvh::intersect(const Rayf& ray, MapObjectList& result) {
+            if (needsRebuild())
+                build();
+            
+            const RayTest rayTest(ray);
+            float distance;
+            
+            if (!m_nodes.empty() && rayTest.intersects(m_nodes[0].bounds, distance)) {
+                m_stack.clear();
+                unsigned int nodeIndex = 0;
+                
+                while (true) {
+                    const Node& node = m_nodes[nodeIndex];
+                    if (node.leaf()) {
+                        for (unsigned int i = node.offset; i < node.offset + node.count; i++) {
+                            const Entry& entry = m_entries[i];
+                            if (entry.object != NULL && rayTest.intersects(entry.bounds, distance))
+                                result.push_back(entry.object);
+                        }
+                    } else {
+                        const unsigned int first = nodeIndex + 1;
+                        const unsigned int second = node.offset;
+                        float firstDistance, secondDistance;
+                        const bool firstHit = rayTest.intersects(m_nodes[first].bounds, firstDistance);
+                        const bool secondHit = rayTest.intersects(m_nodes[second].bounds, secondDistance);
+                        
+                        if (firstHit && secondHit) {
+                            if (firstDistance <= secondDistance) {
+                                m_stack.push_back(second);
+                                nodeIndex = first;
+                            } else {
+                                m_stack.push_back(first);
+                                nodeIndex = second;
+                            }
+                            continue;
+                        } else if (firstHit) {
+                            nodeIndex = first;
+                            continue;
+                        } else if (secondHit) {
+                            nodeIndex = second;
+                            continue;
+                        }
+                    }
+                    
+                    if (m_stack.empty())
+                        break;
+                    nodeIndex = m_stack.back();
+                    m_stack.pop_back();
+                }
+            }
+            
+            for (size_t i = m_indexedCount; i < m_entries.size(); i++) {
+                const Entry& entry = m_entries[i];
+                if (rayTest.intersects(entry.bounds, distance))
+                    result.push_back(entry.object);
+            }
+        }
+        
+        MapObjectList Bvh::intersect(const Rayf& ray) {
+            MapObjectList result;
+            intersect(ray, result);
+            return result;
+        }
+        
+        void Bvh::intersect(const BBoxf& bounds, MapObjectList& result) {
+            if (needsRebuild())
+                build();
+            
+            if (!m_nodes.empty() && bounds.intersects(m_nodes[0].bounds)) {
+                m_stack.clear();
+                unsigned int nodeIndex = 0;
+                
+                while (true) {
+                    const Node& node = m_nodes[nodeIndex];
+                    if (node.leaf()) {
+                        for (unsigned int i = node.offset; i < node.offset + node.count; i++) {
+                            const Entry& entry = m_entries[i];
+                            if (entry.object != NULL && bounds.intersects(entry.bounds))
+                                result.push_back(entry.object);
+                        }
+                    } else {
+                        const unsigned int first = nodeIndex + 1;
+                        const unsigned int second = node.offset;
+                        const bool firstHit = bounds.intersects(m_nodes[first].bounds);
+                        const bool secondHit = bounds.intersects(m_nodes[second].bounds);
+                        
+                        if (firstHit && secondHit) {
+                            m_stack.push_back(second);
+                            nodeIndex = first;
+                            continue;
+                        } else if (firstHit) {
+                            nodeIndex = first;
+                            continue;
+                        } else if (secondHit) {
+                            nodeIndex = second;
+                            continue;
+                        }
+                    }
+                    
+                    if (m_stack.empty())
+                        break;
+                    nodeIndex = m_stack.back();
+                    m_stack.pop_back();
+                }
+            }
+            
+            for (size_t i = m_indexedCount; i < m_entries.size(); i++) {
+                const Entry& entry = m_entries[i];
+                if (bounds.intersects(entry.bounds))
+                    result.push_back(entry.object);
+            }
+        }
+        
+        MapObjectList Bvh::intersect(const BBoxf& bounds) {
+            MapObjectList result;
+            intersect(bounds, result);
+            return result;
+        }
+    }
+}
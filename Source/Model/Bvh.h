@@ -0,0 +1,138 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TrenchBroom_Bvh_h
+#define TrenchBroom_Bvh_h
+
+#include "Model/MapObjectTypes.h"
+#include "Utility/VecMath.h"
+
+#include <map>
+#include <vector>
+
+using namespace TrenchBroom::VecMath;
+
+namespace TrenchBroom {
+    namespace Model {
+        class Map;
+        
+        /*
+         * A bounding volume hierarchy over the entities and brushes of a map. The nodes are stored in a single array in
+         * depth first order, so the first child of an inner node immediately follows it and only the index of the second
+         * child must be stored. The objects are stored in another array such that the objects of each leaf are contiguous.
+         *
+         * Removing an object only detaches it from its slot. If it is added again (which is what happens when an object
+         * is changed), it is put back into its slot and the bounds of the slot's ancestors are refit. Objects which are
+         * new to the hierarchy are kept in an unsorted list until there are enough of them to warrant a rebuild.
+         */
+        class Bvh {
+        private:
+            static const unsigned int MaxLeafSize = 4;
+            static const size_t SplitBinCount = 16;
+            static const unsigned int NoNode = 0xFFFFFFFF;
+            
+            class Node {
+            public:
+                BBoxf bounds;
+                unsigned int parent;
+                unsigned int offset; // index of the second child of an inner node or the first entry of a leaf
+                unsigned int count;  // 0 for inner nodes
+                
+                Node(const BBoxf& i_bounds, unsigned int i_parent) :
+                bounds(i_bounds),
+                parent(i_parent),
+                offset(0),
+                count(0) {}
+                
+                inline bool leaf() const {
+                    return count > 0;
+                }
+            };
+            
+            class Entry {
+            public:
+                MapObject* object;
+                BBoxf bounds;
+                unsigned int node;
+                
+                Entry(MapObject* i_object, const BBoxf& i_bounds) :
+                object(i_object),
+                bounds(i_bounds),
+                node(NoNode) {}
+            };
+            
+            class RayTest {
+            private:
+                Vec3f m_origin;
+                Vec3f m_invDirection;
+                bool m_parallel[3];
+            public:
+                RayTest(const Rayf& ray);
+                bool intersects(const BBoxf& bounds, float& distance) const;
+            };
+            
+            class CompareEntriesByCenter;
+            class EntryInBins;
+            
+            typedef std::vector<Node> NodeList;
+            typedef std::vector<Entry> EntryList;
+            typedef std::map<MapObject*, size_t> EntryIndexMap;
+            
+            Map& m_map;
+            NodeList m_nodes;
+            EntryList m_entries;
+            EntryIndexMap m_entryIndices;
+            size_t m_indexedCount;
+            size_t m_detachedCount;
+            std::vector<unsigned int> m_stack;
+            
+            void build();
+            unsigned int buildNode(size_t first, size_t last, unsigned int parent);
+            size_t split(size_t first, size_t last, const BBoxf& centers);
+            void refit(unsigned int nodeIndex);
+            bool needsRebuild() const;
+        public:
+            Bvh(Map& map);
+            
+            void loadMap();
+            void clear();
+            void addObject(MapObject& object);
+            void addObjects(const MapObjectList& objects);
+            void removeObject(MapObject& object);
+            void removeObjects(const MapObjectList& objects);
+            
+            size_t count() const;
+            
+            /*
+             * Collects every object whose bounds are hit by the given ray. The tree is traversed front to back, so the
+             * objects are roughly ordered by distance.
+             */
+            void intersect(const Rayf& ray, MapObjectList& result);
+            MapObjectList intersect(const Rayf& ray);
+            
+            /*
+             * Collects every object whose bounds intersect the given box.
+             */
+            void intersect(const BBoxf& bounds, MapObjectList& result);
+            MapObjectList intersect(const BBoxf& bounds);
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,1543 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CompactBrushGeometry.h"
+
+#include "Model/Face.h"
+
+#include <algorithm>
+#include <map>
+
+namespace TrenchBroom {
+    namespace Model {
+        namespace {
+            inline CompactBrushGeometry::Index checkedIndex(size_t index) {
+                if (index >= CompactBrushGeometry::NoIndex)
+                    throw GeometryException("Brush geometry exceeds the maximum number of elements");
+                return static_cast<CompactBrushGeometry::Index>(index);
+            }
+
+            /*
+             * Replaces the edges between the given indices of a side's edge loop (exclusively) by the given edge,
+             * see Side::replaceEdges.
+             */
+            void replaceEdges(CompactBrushGeometry::IndexList& loop, size_t index1, size_t index2, CompactBrushGeometry::Index edge) {
+                CompactBrushGeometry::IndexList::iterator it1, it2;
+                if (index2 > index1) {
+                    std::advance(it1 = loop.begin(), index1 + 1);
+                    std::advance(it2 = loop.begin(), index2);
+                    loop.erase(it1, it2);
+
+                    std::advance(it1 = loop.begin(), index1 + 1);
+                    loop.insert(it1, edge);
+                } else {
+                    std::advance(it1 = loop.begin(), index1 + 1);
+                    loop.erase(it1, loop.end());
+
+                    std::advance(it2 = loop.begin(), index2);
+                    loop.erase(loop.begin(), it2);
+                    loop.push_back(edge);
+                }
+            }
+
+            void shiftLoop(CompactBrushGeometry::IndexList& loop, size_t offset) {
+                if (offset % loop.size() == 0)
+                    return;
+
+                CompactBrushGeometry::IndexList::iterator middle;
+                std::advance(middle = loop.begin(), offset % loop.size());
+                std::rotate(loop.begin(), middle, loop.end());
+            }
+        }
+
+        const CompactBrushGeometry::Index CompactBrushGeometry::NoIndex;
+
+        void CompactBrushGeometry::assign(const BrushGeometry& geometry) {
+            typedef std::map<const Vertex*, Index> VertexIndexMap;
+            typedef std::map<const Side*, Index> SideIndexMap;
+
+            VertexIndexMap vertexIndices;
+            SideIndexMap sideIndices;
+
+            m_vertices.clear();
+            m_edges.clear();
+            m_sides.clear();
+            m_sideEdges.clear();
+
+            m_vertices.reserve(geometry.vertices.size());
+            for (size_t i = 0; i < geometry.vertices.size(); i++) {
+                const Vertex* vertex = geometry.vertices[i];
+                vertexIndices[vertex] = checkedIndex(i);
+                m_vertices.push_back(vertex->position);
+            }
+
+            for (size_t i = 0; i < geometry.sides.size(); i++)
+                sideIndices[geometry.sides[i]] = checkedIndex(i);
+
+            std::map<const Edge*, Index> edgeIndices;
+            m_edges.reserve(geometry.edges.size());
+            for (size_t i = 0; i < geometry.edges.size(); i++) {
+                const Edge* edge = geometry.edges[i];
+                SideIndexMap::const_iterator left = sideIndices.find(edge->left);
+                SideIndexMap::const_iterator right = sideIndices.find(edge->right);
+                edgeIndices[edge] = checkedIndex(i);
+                m_edges.push_back(EdgeEntry(vertexIndices[edge->start],
+                                            vertexIndices[edge->end],
+                                            left != sideIndices.end() ? left->second : NoIndex,
+                                            right != sideIndices.end() ? right->second : NoIndex));
+            }
+
+            m_sides.reserve(geometry.sides.size());
+            for (size_t i = 0; i < geometry.sides.size(); i++) {
+                const Side* side = geometry.sides[i];
+                m_sides.push_back(SideEntry(side->face, checkedIndex(m_sideEdges.size()), checkedIndex(side->edges.size())));
+                for (size_t j = 0; j < side->edges.size(); j++)
+                    m_sideEdges.push_back(edgeIndices[side->edges[j]]);
+            }
+
+            m_bounds = geometry.bounds;
+            m_center = geometry.center;
+        }
+
+        void CompactBrushGeometry::updateBounds() {
+            assert(!m_vertices.empty());
+
+            m_bounds.min = m_bounds.max = m_center = m_vertices[0];
+            for (size_t i = 1; i < m_vertices.size(); i++) {
+                m_bounds.mergeWith(m_vertices[i]);
+                m_center += m_vertices[i];
+            }
+            m_center /= static_cast<float>(m_vertices.size());
+        }
+
+        CompactBrushGeometry::CompactBrushGeometry(const BBoxf& bounds) {
+            // same vertex, edge and side order as BrushGeometry(const BBoxf&)
+            static const Index edgeVertices[12][2] = {
+                {0, 2}, {2, 3}, {3, 1}, {1, 0},
+                {4, 5}, {5, 7}, {7, 6}, {6, 4},
+                {1, 5}, {4, 0}, {2, 6}, {7, 3}
+            };
+            static const Index edgeSides[12][2] = {
+                {5, 0}, {3, 0}, {4, 0}, {2, 0},
+                {2, 1}, {4, 1}, {3, 1}, {5, 1},
+                {4, 2}, {5, 2}, {5, 3}, {4, 3}
+            };
+            static const Index sideEdges[6][4] = {
+                { 0,  1,  2,  3},
+                { 4,  5,  6,  7},
+                { 8,  4,  9,  3},
+                {11,  1, 10,  6},
+                { 2, 11,  5,  8},
+                { 9,  7, 10,  0}
+            };
+
+            m_vertices.reserve(8);
+            for (unsigned int i = 0; i < 8; i++)
+                m_vertices.push_back(Vec3f((i & 4) == 0 ? bounds.min.x() : bounds.max.x(),
+                                           (i & 2) == 0 ? bounds.min.y() : bounds.max.y(),
+                                           (i & 1) == 0 ? bounds.min.z() : bounds.max.z()));
+
+            m_edges.reserve(12);
+            for (unsigned int i = 0; i < 12; i++)
+                m_edges.push_back(EdgeEntry(edgeVertices[i][0], edgeVertices[i][1], edgeSides[i][0], edgeSides[i][1]));
+
+            m_sides.reserve(6);
+            m_sideEdges.reserve(24);
+            for (unsigned int i = 0; i < 6; i++) {
+                m_sides.push_back(SideEntry(NULL, static_cast<Index>(m_sideEdges.size()), 4));
+                m_sideEdges.insert(m_sideEdges.end(), sideEdges[i], sideEdges[i] + 4);
+            }
+
+            updateBounds();
+            m_bounds = bounds;
+        }
+
+        CompactBrushGeometry::CompactBrushGeometry(const BrushGeometry& geometry) {
+            assign(geometry);
+        }
+
+        CompactBrushGeometry::CompactBrushGeometry(const Vec3f::List& vertices, const EdgeEntryList& edges, const SideEntryList& sides, const IndexList& sideEdges) :
+        m_vertices(vertices),
+        m_edges(edges),
+        m_sides(sides),
+        m_sideEdges(sideEdges) {
+            updateBounds();
+        }
+
+        Vec3f::List CompactBrushGeometry::sideVertices(size_t side) const {
+            Vec3f::List result;
+            result.reserve(m_sides[side].count);
+            for (size_t i = 0; i < m_sides[side].count; i++)
+                result.push_back(sideVertex(side, i));
+            return result;
+        }
+
+        bool CompactBrushGeometry::closed() const {
+            for (size_t i = 0; i < m_sides.size(); i++)
+                if (m_sides[i].face == NULL)
+                    return false;
+            return true;
+        }
+
+        size_t CompactBrushGeometry::memoryUsage() const {
+            return (sizeof(CompactBrushGeometry) +
+                    m_vertices.capacity() * sizeof(Vec3f) +
+                    m_edges.capacity() * sizeof(EdgeEntry) +
+                    m_sides.capacity() * sizeof(SideEntry) +
+                    m_sideEdges.capacity() * sizeof(Index));
+        }
+
+        BrushGeometry* CompactBrushGeometry::toBrushGeometry() const {
+            VertexList vertices;
+            vertices.reserve(m_vertices.size());
+            for (size_t i = 0; i < m_vertices.size(); i++) {
+                const Vec3f& position = m_vertices[i];
+                vertices.push_back(new Vertex(position.x(), position.y(), position.z()));
+            }
+
+            SideList sides;
+            sides.reserve(m_sides.size());
+            for (size_t i = 0; i < m_sides.size(); i++) {
+                Side* side = new Side();
+                side->face = m_sides[i].face;
+                sides.push_back(side);
+            }
+
+            EdgeList edges;
+            edges.reserve(m_edges.size());
+            for (size_t i = 0; i < m_edges.size(); i++) {
+                const EdgeEntry& entry = m_edges[i];
+                edges.push_back(new Edge(vertices[entry.start],
+                                         vertices[entry.end],
+                                         entry.left != NoIndex ? sides[entry.left] : NULL,
+                                         entry.right != NoIndex ? sides[entry.right] : NULL));
+            }
+
+            for (size_t i = 0; i < m_sides.size(); i++) {
+                Side* side = sides[i];
+                const SideEntry& entry = m_sides[i];
+                side->edges.reserve(entry.count);
+                side->vertices.reserve(entry.count);
+                for (size_t j = 0; j < entry.count; j++) {
+                    Edge* edge = edges[m_sideEdges[entry.first + j]];
+                    side->edges.push_back(edge);
+                    side->vertices.push_back(edge->startVertex(side));
+                }
+            }
+
+            return new BrushGeometry(vertices, edges, sides);
+        }
+
+        CompactBrushGeometry::CutResult CompactBrushGeometry::addFace(Face& face, FaceSet& droppedFaces) {
+            // if all of the face's points are on a previous face, it's a duplicate
+            for (size_t i = 0; i < m_sides.size(); i++) {
+                const Face* previousFace = m_sides[i].face;
+                if (previousFace != NULL) {
+                    unsigned int onPrevious = 0;
+                    for (size_t j = 0; j < 3; j++) {
+                        if (previousFace->boundary().pointStatus(face.point(j)) == PointStatus::PSInside)
+                            onPrevious++;
+                    }
+                    if (onPrevious == 3)
+                        return BrushGeometry::Redundant;
+                }
+            }
+
+            const Planef boundary = face.boundary();
+            const size_t vertexCount = m_vertices.size();
+
+            unsigned int keep = 0;
+            unsigned int drop = 0;
+            unsigned int undecided = 0;
+
+            // mark vertices
+            std::vector<Vertex::Mark> vertexMarks;
+            vertexMarks.reserve(vertexCount + m_edges.size());
+            for (size_t i = 0; i < vertexCount; i++) {
+                PointStatus::Type vs = boundary.pointStatus(m_vertices[i], 0.1f);
+                if (vs == PointStatus::PSAbove) {
+                    vertexMarks.push_back(Vertex::Drop);
+                    drop++;
+                } else if (vs == PointStatus::PSBelow) {
+                    vertexMarks.push_back(Vertex::Keep);
+                    keep++;
+                } else {
+                    vertexMarks.push_back(Vertex::Undecided);
+                    undecided++;
+                }
+            }
+
+            if (keep + undecided == vertexCount)
+                return BrushGeometry::Redundant;
+
+            if (drop + undecided == vertexCount)
+                return BrushGeometry::Null;
+
+            // mark and split edges, see Edge::updateMark and Edge::split
+            std::vector<Edge::Mark> edgeMarks;
+            edgeMarks.reserve(m_edges.size() + m_sides.size());
+            for (size_t i = 0; i < m_edges.size(); i++) {
+                EdgeEntry& edge = m_edges[i];
+                const Vertex::Mark startMark = vertexMarks[edge.start];
+                const Vertex::Mark endMark = vertexMarks[edge.end];
+
+                if ((startMark == Vertex::Keep && endMark == Vertex::Drop) ||
+                    (startMark == Vertex::Drop && endMark == Vertex::Keep)) {
+                    const Vec3f start = m_vertices[edge.start];
+                    const Vec3f end = m_vertices[edge.end];
+                    const float startDist = boundary.pointDistance(start);
+                    const float endDist = boundary.pointDistance(end);
+
+                    assert(startDist != endDist);
+                    const float dot = startDist / (startDist - endDist);
+
+                    Vec3f position;
+                    for (unsigned int j = 0; j < 3; j++) {
+                        if (boundary.normal[j] == 1.0f)
+                            position[j] = boundary.distance;
+                        else if (boundary.normal[j] == -1.0f)
+                            position[j] = -boundary.distance;
+                        else
+                            position[j] = start[j] + dot * (end[j] - start[j]);
+                    }
+                    position.correct();
+
+                    const Index newVertex = checkedIndex(m_vertices.size());
+                    m_vertices.push_back(position);
+                    vertexMarks.push_back(Vertex::New);
+
+                    if (startMark == Vertex::Drop)
+                        edge.start = newVertex;
+                    else
+                        edge.end = newVertex;
+                    edgeMarks.push_back(Edge::Split);
+                } else if (startMark == Vertex::Keep || endMark == Vertex::Keep) {
+                    edgeMarks.push_back(Edge::Keep);
+                } else if (startMark == Vertex::Drop || endMark == Vertex::Drop) {
+                    edgeMarks.push_back(Edge::Drop);
+                } else {
+                    edgeMarks.push_back(Edge::Undecided);
+                }
+            }
+
+            // mark, split and drop sides, see Side::split; the new side temporarily gets the index one past the
+            // last existing side
+            const Index sideCount = static_cast<Index>(m_sides.size());
+            const Index newSide = sideCount;
+
+            IndexList sideIndices(static_cast<size_t>(sideCount) + 1, NoIndex);
+            IndexList newEdges;
+            SideEntryList sides;
+            IndexList sideEdges;
+            sides.reserve(m_sides.size() + 1);
+            sideEdges.reserve(m_sideEdges.size() + m_sides.size());
+
+            for (Index s = 0; s < sideCount; s++) {
+                const SideEntry& side = m_sides[s];
+                const Index* loop = &m_sideEdges[side.first];
+                const size_t count = side.count;
+
+                unsigned int sideKeep = 0;
+                unsigned int sideDrop = 0;
+                unsigned int sideUndecided = 0;
+                Index undecidedEdge = NoIndex;
+
+                int splitIndex1 = -2;
+                int splitIndex2 = -2;
+
+                Edge::Mark lastMark = edgeMarks[loop[count - 1]];
+                for (size_t i = 0; i < count; i++) {
+                    const Edge::Mark currentMark = edgeMarks[loop[i]];
+                    if (currentMark == Edge::Split) {
+                        if (vertexMarks[m_edges[loop[i]].startVertex(s)] == Vertex::Keep)
+                            splitIndex1 = static_cast<int>(i);
+                        else
+                            splitIndex2 = static_cast<int>(i);
+                    } else if (currentMark == Edge::Undecided) {
+                        sideUndecided++;
+                        undecidedEdge = loop[i];
+                    } else if (currentMark == Edge::Keep) {
+                        if (lastMark == Edge::Drop)
+                            splitIndex2 = static_cast<int>(i);
+                        sideKeep++;
+                    } else if (currentMark == Edge::Drop) {
+                        if (lastMark == Edge::Keep)
+                            splitIndex1 = i > 0 ? static_cast<int>(i) - 1 : static_cast<int>(count - 1);
+                        sideDrop++;
+                    }
+                    lastMark = currentMark;
+                }
+
+                const Index first = checkedIndex(sideEdges.size());
+                if (sideKeep == count) {
+                    sideEdges.insert(sideEdges.end(), loop, loop + count);
+                } else if (sideUndecided == 1 && sideKeep == count - 1) {
+                    // the edge is an undecided edge, so it needs to be flipped in order to act as a new edge
+                    if (m_edges[undecidedEdge].right != s)
+                        m_edges[undecidedEdge].flip();
+                    newEdges.push_back(undecidedEdge);
+                    sideEdges.insert(sideEdges.end(), loop, loop + count);
+                } else if (sideDrop + sideUndecided == count) {
+                    if (side.face != NULL)
+                        droppedFaces.insert(side.face);
+                    continue;
+                } else {
+                    // the side's edges do not cross the boundary exactly twice, which only happens if the brush is
+                    // numerically degenerate
+                    if (splitIndex1 < 0 || splitIndex2 < 0)
+                        throw GeometryException("Invalid brush detected during side split");
+
+                    const size_t index1 = static_cast<size_t>(splitIndex1);
+                    const size_t index2 = static_cast<size_t>(splitIndex2);
+                    const Index newEdge = checkedIndex(m_edges.size());
+                    m_edges.push_back(EdgeEntry(m_edges[loop[index1]].endVertex(s),
+                                                m_edges[loop[index2]].startVertex(s),
+                                                newSide, s));
+                    edgeMarks.push_back(Edge::New);
+                    newEdges.push_back(newEdge);
+
+                    if (index2 > index1) {
+                        sideEdges.insert(sideEdges.end(), loop, loop + index1 + 1);
+                        sideEdges.push_back(newEdge);
+                        sideEdges.insert(sideEdges.end(), loop + index2, loop + count);
+                    } else {
+                        sideEdges.insert(sideEdges.end(), loop + index2, loop + index1 + 1);
+                        sideEdges.push_back(newEdge);
+                    }
+                }
+
+                sideIndices[s] = static_cast<Index>(sides.size());
+                sides.push_back(SideEntry(side.face, first, checkedIndex(sideEdges.size() - first)));
+            }
+
+            // create new side from newly created edges
+            // first, sort the new edges to form a polygon in clockwise order
+            for (size_t i = 0; i + 1 < newEdges.size(); i++) {
+                const EdgeEntry& edge = m_edges[newEdges[i]];
+                for (size_t j = i + 2; j < newEdges.size(); j++) {
+                    const Index candidate = newEdges[j];
+                    if (edge.start == m_edges[candidate].end) {
+                        newEdges[j] = newEdges[i + 1];
+                        newEdges[i + 1] = candidate;
+                        break;
+                    }
+                }
+            }
+
+            // now create the new side
+            const Index first = checkedIndex(sideEdges.size());
+            for (size_t i = 0; i < newEdges.size(); i++) {
+                m_edges[newEdges[i]].left = newSide;
+                sideEdges.push_back(newEdges[i]);
+            }
+            sideIndices[newSide] = static_cast<Index>(sides.size());
+            sides.push_back(SideEntry(&face, first, checkedIndex(newEdges.size())));
+
+            // clean up
+            // drop vertices
+            IndexList vertexIndices(m_vertices.size(), NoIndex);
+            Vec3f::List vertices;
+            vertices.reserve(m_vertices.size());
+            for (size_t i = 0; i < m_vertices.size(); i++) {
+                if (vertexMarks[i] != Vertex::Drop) {
+                    vertexIndices[i] = static_cast<Index>(vertices.size());
+                    vertices.push_back(m_vertices[i]);
+                }
+            }
+
+            // drop edges and update their vertex and side indices
+            IndexList edgeIndices(m_edges.size(), NoIndex);
+            EdgeEntryList edges;
+            edges.reserve(m_edges.size());
+            for (size_t i = 0; i < m_edges.size(); i++) {
+                if (edgeMarks[i] != Edge::Drop) {
+                    const EdgeEntry& edge = m_edges[i];
+                    assert(vertexIndices[edge.start] != NoIndex && vertexIndices[edge.end] != NoIndex);
+                    edgeIndices[i] = static_cast<Index>(edges.size());
+                    edges.push_back(EdgeEntry(vertexIndices[edge.start],
+                                              vertexIndices[edge.end],
+                                              edge.left != NoIndex ? sideIndices[edge.left] : NoIndex,
+                                              edge.right != NoIndex ? sideIndices[edge.right] : NoIndex));
+                }
+            }
+
+            for (size_t i = 0; i < sideEdges.size(); i++) {
+                assert(edgeIndices[sideEdges[i]] != NoIndex);
+                sideEdges[i] = edgeIndices[sideEdges[i]];
+            }
+
+            m_vertices.swap(vertices);
+            m_edges.swap(edges);
+            m_sides.swap(sides);
+            m_sideEdges.swap(sideEdges);
+
+            updateBounds();
+            return BrushGeometry::Split;
+        }
+
+        bool CompactBrushGeometry::addFaces(const FaceList& faces, FaceSet& droppedFaces) {
+            for (size_t i = 0; i < faces.size(); i++) {
+                CutResult result = addFace(*faces[i], droppedFaces);
+                if (result == BrushGeometry::Redundant)
+                    droppedFaces.insert(faces[i]);
+                else if (result == BrushGeometry::Null)
+                    throw GeometryException("Empty brush");
+            }
+            for (size_t i = 0; i < m_vertices.size(); i++)
+                m_vertices[i].correct();
+            return true;
+        }
+
+        CompactBrushGeometry::FaceManager::~FaceManager() {
+            CopyMap::iterator mapIt, mapEnd;
+            for (mapIt = m_newFaces.begin(), mapEnd = m_newFaces.end(); mapIt != mapEnd; ++mapIt) {
+                FaceSet& faces = mapIt->second;
+                FaceSet::iterator faceIt, faceEnd;
+                for (faceIt = faces.begin(), faceEnd = faces.end(); faceIt != faceEnd; ++faceIt)
+                    delete *faceIt;
+            }
+        }
+
+        void CompactBrushGeometry::FaceManager::addFace(Face* original, Face* copy) {
+            assert(original != NULL);
+            assert(copy != NULL);
+            assert(original != copy);
+            m_newFaces[original].insert(copy);
+        }
+
+        void CompactBrushGeometry::FaceManager::dropFace(SideEntryList& sides, Index side) {
+            Face* face = sides[side].face;
+            assert(face != NULL);
+
+            CopyMap::iterator copyIt = m_newFaces.find(face);
+            if (copyIt != m_newFaces.end()) {
+                // the face is an original, so it takes the place of one of its copies
+                FaceSet& copies = copyIt->second;
+                assert(!copies.empty());
+
+                FaceSet::iterator faceIt = copies.begin();
+                Face* copy = *faceIt;
+                copies.erase(faceIt);
+
+                for (size_t i = 0; i < sides.size(); i++) {
+                    if (sides[i].face == copy) {
+                        sides[i].face = face;
+                        break;
+                    }
+                }
+
+                if (copies.empty())
+                    m_newFaces.erase(copyIt);
+
+                delete copy;
+            } else {
+                bool wasCopy = false;
+                CopyMap::iterator copyEnd;
+                for (copyIt = m_newFaces.begin(), copyEnd = m_newFaces.end(); copyIt != copyEnd; ++copyIt) {
+                    FaceSet& copies = copyIt->second;
+                    assert(!copies.empty());
+
+                    if (copies.erase(face) > 0) {
+                        wasCopy = true;
+                        if (copies.empty())
+                            m_newFaces.erase(copyIt);
+                        delete face;
+                        break;
+                    }
+                }
+                if (!wasCopy)
+                    m_droppedFaces.insert(face);
+            }
+            sides[side].face = NULL;
+        }
+
+        void CompactBrushGeometry::FaceManager::getFaces(FaceSet& newFaces, FaceSet& droppedFaces) {
+            newFaces.clear();
+
+            CopyMap::const_iterator it, end;
+            for (it = m_newFaces.begin(), end = m_newFaces.end(); it != end; ++it)
+                newFaces.insert(it->second.begin(), it->second.end());
+            droppedFaces = m_droppedFaces;
+
+            m_newFaces.clear();
+            m_droppedFaces.clear();
+        }
+
+        CompactBrushGeometry::IndexList CompactBrushGeometry::sideLoop(Index side) const {
+            const SideEntry& entry = m_sides[side];
+            IndexList::const_iterator first = m_sideEdges.begin() + entry.first;
+            return IndexList(first, first + entry.count);
+        }
+
+        void CompactBrushGeometry::setSideLoop(Index side, const IndexList& loop) {
+            SideEntry& entry = m_sides[side];
+            const Index first = entry.first;
+            const Index count = entry.count;
+            const Index newCount = checkedIndex(loop.size());
+
+            IndexList::iterator begin = m_sideEdges.begin() + first;
+            if (newCount == count) {
+                std::copy(loop.begin(), loop.end(), begin);
+                return;
+            }
+
+            m_sideEdges.erase(begin, begin + count);
+            m_sideEdges.insert(m_sideEdges.begin() + first, loop.begin(), loop.end());
+            checkedIndex(m_sideEdges.size());
+
+            entry.count = newCount;
+            for (size_t i = 0; i < m_sides.size(); i++) {
+                if (m_sides[i].first > first)
+                    m_sides[i].first = static_cast<Index>(m_sides[i].first + newCount - count);
+            }
+        }
+
+        CompactBrushGeometry::Index CompactBrushGeometry::sideVertexIndex(Index side, size_t index) const {
+            return m_edges[sideEdge(side, index)].startVertex(side);
+        }
+
+        size_t CompactBrushGeometry::findSideEdge(Index side, Index edge) const {
+            const SideEntry& entry = m_sides[side];
+            for (size_t i = 0; i < entry.count; i++)
+                if (m_sideEdges[entry.first + i] == edge)
+                    return i;
+            return entry.count;
+        }
+
+        size_t CompactBrushGeometry::findSideVertex(Index side, Index vertex) const {
+            const SideEntry& entry = m_sides[side];
+            for (size_t i = 0; i < entry.count; i++)
+                if (sideVertexIndex(side, i) == vertex)
+                    return i;
+            return entry.count;
+        }
+
+        bool CompactBrushGeometry::sideHasVertices(Index side, const Vec3f::List& positions) const {
+            const size_t count = positions.size();
+            if (m_sides[side].count != count)
+                return false;
+
+            for (size_t i = 0; i < count; i++) {
+                bool equal = true;
+                for (size_t j = 0; j < count && equal; j++)
+                    equal = sideVertex(side, (i + j) % count).equals(positions[j], Math<float>::AlmostZero);
+                if (equal)
+                    return true;
+            }
+            return false;
+        }
+
+        CompactBrushGeometry::IndexList CompactBrushGeometry::incidentSides(Index vertex) const {
+            IndexList result;
+
+            // find any edge that is incident to vertex
+            Index edge = NoIndex;
+            for (size_t i = 0; i < m_edges.size() && edge == NoIndex; i++) {
+                if (m_edges[i].start == vertex || m_edges[i].end == vertex)
+                    edge = static_cast<Index>(i);
+            }
+
+            assert(edge != NoIndex);
+
+            // iterate over the incident sides in clockwise order
+            Index side = m_edges[edge].start == vertex ? m_edges[edge].right : m_edges[edge].left;
+            do {
+                result.push_back(side);
+                const size_t i = findSideEdge(side, edge);
+                edge = sideEdge(side, pred(i, m_sides[side].count));
+                side = m_edges[edge].start == vertex ? m_edges[edge].right : m_edges[edge].left;
+            } while (side != result.front());
+
+            return result;
+        }
+
+        size_t CompactBrushGeometry::isCollinearTriangle(Index side) const {
+            const size_t count = m_sides[side].count;
+            assert(count >= 3);
+            if (count > 3)
+                return count;
+
+            const EdgeEntry& edge1 = m_edges[sideEdge(side, 0)];
+            const EdgeEntry& edge2 = m_edges[sideEdge(side, 1)];
+            const Vec3f edgeVector1 = m_vertices[edge1.end] - m_vertices[edge1.start];
+            const Vec3f edgeVector2 = m_vertices[edge2.end] - m_vertices[edge2.start];
+            if (!edgeVector1.parallelTo(edgeVector2))
+                return count;
+
+            const EdgeEntry& edge3 = m_edges[sideEdge(side, 2)];
+            const Vec3f edgeVector3 = m_vertices[edge3.end] - m_vertices[edge3.start];
+            const float length1 = edgeVector1.lengthSquared();
+            const float length2 = edgeVector2.lengthSquared();
+            const float length3 = edgeVector3.lengthSquared();
+
+            // return the index of the longest of the three edges
+            if (length1 > length2)
+                return length1 > length3 ? 0 : 2;
+            return length2 > length3 ? 1 : 2;
+        }
+
+        CompactBrushGeometry::Index CompactBrushGeometry::findVertex(const Vec3f& position) const {
+            for (size_t i = 0; i < m_vertices.size(); i++)
+                if (m_vertices[i].equals(position, Math<float>::AlmostZero))
+                    return static_cast<Index>(i);
+            return NoIndex;
+        }
+
+        CompactBrushGeometry::Index CompactBrushGeometry::findEdge(const Vec3f& position1, const Vec3f& position2) const {
+            for (size_t i = 0; i < m_edges.size(); i++) {
+                const Vec3f& start = m_vertices[m_edges[i].start];
+                const Vec3f& end = m_vertices[m_edges[i].end];
+                if ((start.equals(position1) && end.equals(position2, Math<float>::AlmostZero)) ||
+                    (start.equals(position2) && end.equals(position1, Math<float>::AlmostZero)))
+                    return static_cast<Index>(i);
+            }
+            return NoIndex;
+        }
+
+        CompactBrushGeometry::Index CompactBrushGeometry::findSide(const Vec3f::List& positions) const {
+            for (size_t i = 0; i < m_sides.size(); i++)
+                if (sideHasVertices(static_cast<Index>(i), positions))
+                    return static_cast<Index>(i);
+            return NoIndex;
+        }
+
+        void CompactBrushGeometry::removeVertex(Index vertex, Index& movedVertex) {
+            m_vertices.erase(m_vertices.begin() + vertex);
+            for (size_t i = 0; i < m_edges.size(); i++) {
+                EdgeEntry& edge = m_edges[i];
+                assert(edge.start != vertex && edge.end != vertex);
+                if (edge.start > vertex)
+                    edge.start--;
+                if (edge.end > vertex)
+                    edge.end--;
+            }
+
+            if (movedVertex == vertex)
+                movedVertex = NoIndex;
+            else if (movedVertex != NoIndex && movedVertex > vertex)
+                movedVertex--;
+        }
+
+        void CompactBrushGeometry::removeEdge(Index edge) {
+            m_edges.erase(m_edges.begin() + edge);
+            for (size_t i = 0; i < m_sideEdges.size(); i++) {
+                assert(m_sideEdges[i] != edge);
+                if (m_sideEdges[i] > edge)
+                    m_sideEdges[i]--;
+            }
+        }
+
+        void CompactBrushGeometry::removeSide(Index side) {
+            setSideLoop(side, IndexList());
+            m_sides.erase(m_sides.begin() + side);
+            for (size_t i = 0; i < m_edges.size(); i++) {
+                EdgeEntry& edge = m_edges[i];
+                if (edge.left == side)
+                    edge.left = NoIndex;
+                else if (edge.left != NoIndex && edge.left > side)
+                    edge.left--;
+                if (edge.right == side)
+                    edge.right = NoIndex;
+                else if (edge.right != NoIndex && edge.right > side)
+                    edge.right--;
+            }
+        }
+
+        void CompactBrushGeometry::chop(Index side, size_t index, FaceManager& faceManager) {
+            // see Side::chop
+            IndexList loop = sideLoop(side);
+            const size_t count = loop.size();
+            assert(count > 3);
+            assert(index < count);
+
+            const Index nextVertex = sideVertexIndex(side, succ(index, count));
+            const Index prevVertex = sideVertexIndex(side, pred(index, count));
+
+            EdgeEntry& edge = m_edges[loop[index]];
+            EdgeEntry& prevEdge = m_edges[loop[pred(index, count)]];
+
+            const Index newSide = checkedIndex(m_sides.size());
+            const Index newEdge = checkedIndex(m_edges.size());
+
+            if (prevEdge.left == side)
+                prevEdge.left = newSide;
+            else
+                prevEdge.right = newSide;
+            if (edge.left == side)
+                edge.left = newSide;
+            else
+                edge.right = newSide;
+
+            const Index newLoop[] = {loop[pred(index, count)], loop[index], newEdge};
+            m_edges.push_back(EdgeEntry(prevVertex, nextVertex, newSide, side));
+
+            Face* face = m_sides[side].face;
+            Face* newFace = new Face(face->worldBounds(), face->forceIntegerFacePoints(), *face);
+            m_sides.push_back(SideEntry(newFace, checkedIndex(m_sideEdges.size()), 3));
+            m_sideEdges.insert(m_sideEdges.end(), newLoop, newLoop + 3);
+            checkedIndex(m_sideEdges.size());
+
+            replaceEdges(loop, pred(index, count, 2), succ(index, count), newEdge);
+            setSideLoop(side, loop);
+
+            faceManager.addFace(face, newFace);
+        }
+
+        void CompactBrushGeometry::deleteDegenerateTriangle(Index side, Index& edge, FaceManager& faceManager) {
+            // see BrushGeometry::deleteDegenerateTriangle
+            assert(m_sides[side].count == 3);
+
+            IndexList loop = sideLoop(side);
+            shiftLoop(loop, findSideEdge(side, edge));
+            setSideLoop(side, loop);
+
+            const Index keepEdge = loop[1];
+            const Index dropEdge = loop[2];
+            const Index neighbour = m_edges[dropEdge].left == side ? m_edges[dropEdge].right : m_edges[dropEdge].left;
+
+            if (m_edges[keepEdge].left == side)
+                m_edges[keepEdge].left = neighbour;
+            else
+                m_edges[keepEdge].right = neighbour;
+
+            IndexList neighbourLoop = sideLoop(neighbour);
+            const size_t deleteIndex = findSideEdge(neighbour, dropEdge);
+            replaceEdges(neighbourLoop,
+                         pred(deleteIndex, neighbourLoop.size()),
+                         succ(deleteIndex, neighbourLoop.size()),
+                         keepEdge);
+            setSideLoop(neighbour, neighbourLoop);
+
+            faceManager.dropFace(m_sides, side);
+            removeSide(side);
+            removeEdge(dropEdge);
+            if (edge > dropEdge)
+                edge--;
+        }
+
+        void CompactBrushGeometry::mergeEdges(Index& movedVertex) {
+            // see BrushGeometry::mergeEdges
+            for (size_t i = 0; i < m_edges.size(); i++) {
+                const Index edge = static_cast<Index>(i);
+                const Vec3f edgeVector = m_vertices[m_edges[edge].end] - m_vertices[m_edges[edge].start];
+                for (size_t j = i + 1; j < m_edges.size(); j++) {
+                    const Index candidate = static_cast<Index>(j);
+                    const EdgeEntry& e = m_edges[edge];
+                    EdgeEntry& c = m_edges[candidate];
+                    if (e.start != c.start && e.start != c.end && e.end != c.start && e.end != c.end)
+                        continue;
+
+                    const Vec3f candidateVector = m_vertices[c.end] - m_vertices[c.start];
+                    if (!edgeVector.parallelTo(candidateVector, 0.01f))
+                        continue;
+
+                    if (e.end == c.end)
+                        c.flip();
+                    if (e.end == c.start && e.start != c.end && e.left == c.left && e.right == c.right) {
+                        const Index leftSide = e.left;
+                        const Index rightSide = e.right;
+                        assert(leftSide != rightSide);
+                        assert(m_sides[leftSide].count > 3);
+                        assert(m_sides[rightSide].count > 3);
+
+                        const Index newEdge = checkedIndex(m_edges.size());
+                        const Index dropVertex = c.start;
+                        m_edges.push_back(EdgeEntry(e.start, c.end, leftSide, rightSide));
+
+                        IndexList leftLoop = sideLoop(leftSide);
+                        IndexList rightLoop = sideLoop(rightSide);
+                        const size_t leftIndex = findSideEdge(leftSide, candidate);
+                        const size_t rightIndex = findSideEdge(rightSide, candidate);
+                        replaceEdges(leftLoop, pred(leftIndex, leftLoop.size()), succ(leftIndex, leftLoop.size(), 2), newEdge);
+                        replaceEdges(rightLoop, pred(rightIndex, rightLoop.size(), 2), succ(rightIndex, rightLoop.size()), newEdge);
+                        setSideLoop(leftSide, leftLoop);
+                        setSideLoop(rightSide, rightLoop);
+
+                        removeEdge(candidate);
+                        removeEdge(edge);
+                        removeVertex(dropVertex, movedVertex);
+                        break;
+                    }
+
+                    if (e.start == c.start)
+                        c.flip();
+                    if (e.start == c.end && e.end != c.start && e.left == c.left && e.right == c.right) {
+                        const Index leftSide = e.left;
+                        const Index rightSide = e.right;
+                        assert(leftSide != rightSide);
+                        assert(m_sides[leftSide].count > 3);
+                        assert(m_sides[rightSide].count > 3);
+
+                        const Index newEdge = checkedIndex(m_edges.size());
+                        const Index dropVertex = c.end;
+                        m_edges.push_back(EdgeEntry(c.start, e.end, leftSide, rightSide));
+
+                        IndexList leftLoop = sideLoop(leftSide);
+                        IndexList rightLoop = sideLoop(rightSide);
+                        const size_t leftIndex = findSideEdge(leftSide, candidate);
+                        const size_t rightIndex = findSideEdge(rightSide, candidate);
+                        replaceEdges(leftLoop, pred(leftIndex, leftLoop.size(), 2), succ(leftIndex, leftLoop.size()), newEdge);
+                        replaceEdges(rightLoop, pred(rightIndex, rightLoop.size()), succ(rightIndex, rightLoop.size(), 2), newEdge);
+                        setSideLoop(leftSide, leftLoop);
+                        setSideLoop(rightSide, rightLoop);
+
+                        removeEdge(candidate);
+                        removeEdge(edge);
+                        removeVertex(dropVertex, movedVertex);
+                        break;
+                    }
+                }
+            }
+        }
+
+        void CompactBrushGeometry::mergeNeighbours(Index side, size_t edgeIndex, FaceManager& faceManager, Index& movedVertex) {
+            // see BrushGeometry::mergeNeighbours
+            IndexList sideEdges = sideLoop(side);
+            const Index edge = sideEdges[edgeIndex];
+            const Index neighbour = m_edges[edge].left != side ? m_edges[edge].left : m_edges[edge].right;
+            IndexList neighbourEdges = sideLoop(neighbour);
+
+            size_t sideEdgeIndex = edgeIndex;
+            size_t neighbourEdgeIndex = findSideEdge(neighbour, edge);
+            assert(neighbourEdgeIndex < neighbourEdges.size());
+
+            do {
+                sideEdgeIndex = succ(sideEdgeIndex, sideEdges.size());
+                neighbourEdgeIndex = pred(neighbourEdgeIndex, neighbourEdges.size());
+            } while (sideEdges[sideEdgeIndex] == neighbourEdges[neighbourEdgeIndex]);
+
+            // now sideEdgeIndex points to the last edge (in CW order) of side that should not be deleted
+            // and neighbourEdgeIndex points to the first edge (in CW order) of neighbour that should not be deleted
+
+            int count = -1;
+            do {
+                sideEdgeIndex = pred(sideEdgeIndex, sideEdges.size());
+                neighbourEdgeIndex = succ(neighbourEdgeIndex, neighbourEdges.size());
+                count++;
+            } while (sideEdges[sideEdgeIndex] == neighbourEdges[neighbourEdgeIndex]);
+
+            // now sideEdgeIndex points to the first edge (in CW order) of side that should not be deleted
+            // now neighbourEdgeIndex points to the last edge (in CW order) of neighbour that should not be deleted
+            // and count is the number of shared edges between side and neighbour
+
+            assert(count >= 0);
+            const size_t sharedCount = static_cast<size_t>(count);
+            const size_t totalCount = sideEdges.size() + neighbourEdges.size() - 2 * sharedCount;
+
+            // shift the two sides so that their shared edges are at the end of both's edge lists
+            shiftLoop(sideEdges, succ(sideEdgeIndex, sideEdges.size(), sharedCount + 1));
+            shiftLoop(neighbourEdges, neighbourEdgeIndex);
+            sideEdges.resize(sideEdges.size() - sharedCount);
+
+            IndexList dropEdges;
+            IndexList dropVertices;
+            for (size_t i = 0; i < neighbourEdges.size(); i++) {
+                EdgeEntry& neighbourEdge = m_edges[neighbourEdges[i]];
+                if (i < neighbourEdges.size() - sharedCount) {
+                    if (neighbourEdge.left == neighbour)
+                        neighbourEdge.left = side;
+                    else
+                        neighbourEdge.right = side;
+                    sideEdges.push_back(neighbourEdges[i]);
+                } else {
+                    dropEdges.push_back(neighbourEdges[i]);
+                    if (i > neighbourEdges.size() - sharedCount)
+                        dropVertices.push_back(neighbourEdge.startVertex(neighbour));
+                }
+            }
+
+            assert(sideEdges.size() == totalCount);
+            setSideLoop(side, sideEdges);
+
+            faceManager.dropFace(m_sides, neighbour);
+            removeSide(neighbour);
+
+            // remove from back to front so that the remaining indices stay valid
+            std::sort(dropEdges.begin(), dropEdges.end());
+            std::sort(dropVertices.begin(), dropVertices.end());
+            for (size_t i = dropEdges.size(); i > 0; i--)
+                removeEdge(dropEdges[i - 1]);
+            for (size_t i = dropVertices.size(); i > 0; i--)
+                removeVertex(dropVertices[i - 1], movedVertex);
+        }
+
+        void CompactBrushGeometry::mergeSides(FaceManager& faceManager, Index& movedVertex) {
+            // see BrushGeometry::mergeSides
+            for (unsigned int i = 0; i < m_sides.size(); i++) {
+                const Index side = static_cast<Index>(i);
+                Planef sideBoundary;
+                sideBoundary.setPoints(sideVertex(side, 0), sideVertex(side, 1), sideVertex(side, 2));
+
+                for (unsigned int j = 0; j < m_sides[side].count; j++) {
+                    const EdgeEntry& edge = m_edges[sideEdge(side, j)];
+                    const Index neighbour = edge.left != side ? edge.left : edge.right;
+                    Planef neighbourBoundary;
+                    neighbourBoundary.setPoints(sideVertex(neighbour, 0), sideVertex(neighbour, 1), sideVertex(neighbour, 2));
+
+                    if (sideBoundary.equals(neighbourBoundary, Math<float>::ColinearEpsilon)) {
+                        mergeNeighbours(side, j, faceManager, movedVertex);
+                        i -= 1;
+                        break;
+                    }
+                }
+            }
+        }
+
+        MoveVertexResult::Type CompactBrushGeometry::moveVertex(Index& vertex, bool mergeWithAdjacentVertex, const Vec3f& start, const Vec3f& end, FaceManager& faceManager) {
+            // see BrushGeometry::moveVertex for an explanation of the individual steps
+            assert(vertex != NoIndex);
+            assert(start != end);
+
+            float lastFrac = 0.0f;
+            while (!m_vertices[vertex].equals(end, 0.0f)) {
+                const Vec3f lastPosition = m_vertices[vertex];
+                IndexList affectedSides = incidentSides(vertex);
+
+                // turn all sides incident to the vertex into triangles
+                for (size_t i = 0; i < affectedSides.size(); i++) {
+                    const Index side = affectedSides[i];
+                    if (m_sides[side].count > 3) {
+                        const Planef& boundary = m_sides[side].face->boundary();
+                        const float dot = end.dot(boundary.normal) - boundary.distance;
+
+                        if (Math<float>::neg(dot)) {
+                            chop(side, findSideVertex(side, vertex), faceManager);
+                        } else {
+                            for (unsigned int j = 1; j < m_sides[side].count - 1u; j++)
+                                chop(side, succ(findSideVertex(side, vertex), m_sides[side].count), faceManager);
+                        }
+                    }
+                }
+                affectedSides = incidentSides(vertex);
+
+                // compute the next point to which the vertex can be moved without making the brush concave
+                float minFrac = 1.0f;
+                for (size_t i = 0; i < affectedSides.size(); i++) {
+                    Planef plane;
+                    float startDot, endDot, frac;
+
+                    const Index side = affectedSides[i];
+                    const Index next = affectedSides[succ(i, affectedSides.size())];
+                    const size_t sideCount = m_sides[side].count;
+
+                    const size_t sideIndex0 = findSideVertex(side, vertex);
+                    const size_t nextIndex0 = findSideVertex(next, vertex);
+                    assert(sideIndex0 < sideCount);
+                    assert(nextIndex0 < m_sides[next].count);
+
+                    const size_t sideIndex1 = succ(sideIndex0, sideCount);
+                    const size_t sideIndex2 = succ(sideIndex0, sideCount, 2);
+                    const size_t nextIndex1 = succ(nextIndex0, m_sides[next].count, 2);
+
+                    if (!plane.setPoints(sideVertex(side, sideIndex1), sideVertex(side, sideIndex2), sideVertex(next, nextIndex1))) {
+                        mergeSides(faceManager, vertex);
+                        mergeEdges(vertex);
+                        return MoveVertexResult::VertexUnchanged;
+                    }
+
+                    startDot = start.dot(plane.normal) - plane.distance;
+                    endDot = end.dot(plane.normal) - plane.distance;
+
+                    if (std::abs(startDot) >= 0.001f || std::abs(endDot) >= 0.001f) {
+                        if ((startDot > 0.0f) != (endDot >  0.0f)) {
+                            frac = std::abs(startDot) < 0.001f ? 1.0f : std::abs(startDot) / (std::abs(startDot) + std::abs(endDot));
+                            if (frac > lastFrac && frac < minFrac)
+                                minFrac = frac;
+                        }
+                    }
+
+                    // the boundary of the neighbour of side which is not incident to the vertex
+                    const EdgeEntry& neighbourEdge = m_edges[sideEdge(side, sideIndex1)];
+                    const Index neighbourSide = neighbourEdge.left == side ? neighbourEdge.right : neighbourEdge.left;
+                    if (!plane.setPoints(sideVertex(neighbourSide, 0), sideVertex(neighbourSide, 1), sideVertex(neighbourSide, 2))) {
+                        mergeSides(faceManager, vertex);
+                        mergeEdges(vertex);
+                        return MoveVertexResult::VertexUnchanged;
+                    }
+
+                    startDot = start.dot(plane.normal) - plane.distance;
+                    endDot = end.dot(plane.normal) - plane.distance;
+
+                    if (std::abs(startDot) >= 0.001f || std::abs(endDot) >= 0.001f) {
+                        if ((startDot > 0.0f) != (endDot >  0.0f)) {
+                            frac = std::abs(startDot) < 0.001f ? 1.0f : std::abs(startDot) / (std::abs(startDot) + std::abs(endDot));
+                            if (frac > lastFrac && frac < minFrac)
+                                minFrac = frac;
+                        }
+                    }
+                }
+
+                assert(minFrac > lastFrac);
+                lastFrac = minFrac;
+                m_vertices[vertex] = start + lastFrac * (end - start);
+
+                // check whether the vertex landed on another vertex
+                for (size_t i = 0; i < m_vertices.size(); i++) {
+                    const Index candidate = static_cast<Index>(i);
+                    if (candidate == vertex || !m_vertices[vertex].equals(m_vertices[candidate]))
+                        continue;
+
+                    Index connectingEdge = NoIndex;
+                    for (size_t j = 0; j < m_edges.size() && connectingEdge == NoIndex; j++) {
+                        const EdgeEntry& edge = m_edges[j];
+                        if ((edge.start == vertex && edge.end == candidate) || (edge.start == candidate && edge.end == vertex))
+                            connectingEdge = static_cast<Index>(j);
+                    }
+
+                    if (connectingEdge == NoIndex || !mergeWithAdjacentVertex) {
+                        m_vertices[vertex] = lastPosition;
+                        mergeSides(faceManager, vertex);
+                        mergeEdges(vertex);
+                        return MoveVertexResult::VertexUnchanged;
+                    }
+
+                    // the vertex was dragged onto an adjacent vertex, so merge them
+                    for (size_t j = 0; j < m_edges.size(); j++) {
+                        EdgeEntry& edge = m_edges[j];
+                        if (j != connectingEdge) {
+                            if (edge.start == candidate)
+                                edge.start = vertex;
+                            else if (edge.end == candidate)
+                                edge.end = vertex;
+                        }
+                    }
+
+                    deleteDegenerateTriangle(m_edges[connectingEdge].left, connectingEdge, faceManager);
+                    deleteDegenerateTriangle(m_edges[connectingEdge].right, connectingEdge, faceManager);
+                    removeEdge(connectingEdge);
+                    removeVertex(candidate, vertex);
+                    break;
+                }
+
+                // abort if any of the incident sides has become colinear
+                affectedSides = incidentSides(vertex);
+                for (size_t i = 0; i < affectedSides.size(); i++) {
+                    if (isCollinearTriangle(affectedSides[i]) < m_sides[affectedSides[i]].count) {
+                        m_vertices[vertex] = lastPosition;
+                        mergeSides(faceManager, vertex);
+                        mergeEdges(vertex);
+                        return MoveVertexResult::VertexUnchanged;
+                    }
+                }
+
+                mergeSides(faceManager, vertex);
+                mergeEdges(vertex);
+                updateBounds();
+
+                if (vertex == NoIndex)
+                    return MoveVertexResult::VertexDeleted;
+            }
+
+            return MoveVertexResult::VertexMoved;
+        }
+
+        CompactBrushGeometry::Index CompactBrushGeometry::splitEdge(Index edge) {
+            // see BrushGeometry::splitEdge
+            const EdgeEntry split = m_edges[edge];
+            IndexList leftLoop = sideLoop(split.left);
+            IndexList rightLoop = sideLoop(split.right);
+            shiftLoop(leftLoop, findSideEdge(split.left, edge) + 1);
+            shiftLoop(rightLoop, findSideEdge(split.right, edge) + 1);
+
+            const Index newVertex = checkedIndex(m_vertices.size());
+            m_vertices.push_back((m_vertices[split.start] + m_vertices[split.end]) / 2.0f);
+
+            const Index newEdge1 = checkedIndex(m_edges.size());
+            const Index newEdge2 = checkedIndex(m_edges.size() + 1);
+            m_edges.push_back(EdgeEntry(split.start, newVertex, split.left, split.right));
+            m_edges.push_back(EdgeEntry(newVertex, split.end, split.left, split.right));
+
+            // replace the split edge, which is now the last edge of both incident sides
+            leftLoop.pop_back();
+            rightLoop.pop_back();
+            leftLoop.push_back(newEdge2);
+            leftLoop.push_back(newEdge1);
+            rightLoop.push_back(newEdge1);
+            rightLoop.push_back(newEdge2);
+            setSideLoop(split.left, leftLoop);
+            setSideLoop(split.right, rightLoop);
+
+            removeEdge(edge);
+            return newVertex;
+        }
+
+        CompactBrushGeometry::Index CompactBrushGeometry::splitFace(Index side, FaceManager& faceManager) {
+            // see BrushGeometry::splitFace
+            const IndexList loop = sideLoop(side);
+            const Vec3f::List positions = sideVertices(side);
+            Face* face = m_sides[side].face;
+
+            Vec3f center = positions[0];
+            for (size_t i = 1; i < positions.size(); i++)
+                center += positions[i];
+            center /= static_cast<float>(positions.size());
+
+            const Index newVertex = checkedIndex(m_vertices.size());
+            m_vertices.push_back(center);
+
+            const Index firstEdge = checkedIndex(m_edges.size());
+            m_edges.push_back(EdgeEntry(newVertex, m_edges[loop[0]].startVertex(side), NoIndex, NoIndex));
+
+            Index lastEdge = firstEdge;
+            for (size_t i = 0; i < loop.size(); i++) {
+                const Index sideEdge = loop[i];
+                const Index newSide = checkedIndex(m_sides.size());
+
+                Index newEdge;
+                if (i == loop.size() - 1) {
+                    newEdge = firstEdge;
+                } else {
+                    newEdge = checkedIndex(m_edges.size());
+                    m_edges.push_back(EdgeEntry(newVertex, m_edges[sideEdge].endVertex(side), NoIndex, NoIndex));
+                }
+
+                m_edges[lastEdge].right = newSide;
+                if (m_edges[sideEdge].left == side)
+                    m_edges[sideEdge].left = newSide;
+                else
+                    m_edges[sideEdge].right = newSide;
+                m_edges[newEdge].left = newSide;
+
+                Face* newFace = new Face(face->worldBounds(), face->forceIntegerFacePoints(), *face);
+                m_sides.push_back(SideEntry(newFace, checkedIndex(m_sideEdges.size()), 3));
+                m_sideEdges.push_back(lastEdge);
+                m_sideEdges.push_back(sideEdge);
+                m_sideEdges.push_back(newEdge);
+                checkedIndex(m_sideEdges.size());
+                faceManager.addFace(face, newFace);
+
+                lastEdge = newEdge;
+            }
+
+            faceManager.dropFace(m_sides, side);
+            removeSide(side);
+            return newVertex;
+        }
+
+        void CompactBrushGeometry::updateFacePoints(FaceManager& faceManager) {
+            for (size_t i = 0; i < m_sides.size(); i++) {
+                try {
+                    m_sides[i].face->updatePointsFromVertices(sideVertices(i));
+                    m_sides[i].face->updatePointsFromBoundary();
+                } catch (GeometryException&) {
+                    // only called at the end of a vertex operation, just before the geometry is rebuilt anyway
+                    faceManager.dropFace(m_sides, static_cast<Index>(i));
+                }
+            }
+        }
+
+        void CompactBrushGeometry::correct(FaceSet& newFaces, FaceSet& droppedFaces, float epsilon) {
+            assert(epsilon >= 0.0f);
+
+            Vec3f::Map positions;
+            for (size_t i = 0; i < m_vertices.size(); i++) {
+                const Vec3f& start = m_vertices[i];
+                const Vec3f end = start.corrected(epsilon);
+                if (!start.equals(end, 0.0f))
+                    positions[start] = end;
+            }
+
+            if (positions.empty())
+                return;
+
+            FaceManager faceManager;
+            Vec3f::Map::const_iterator posIt, posEnd;
+            for (posIt = positions.begin(), posEnd = positions.end(); posIt != posEnd; ++posIt) {
+                Index vertex = findVertex(posIt->first);
+                if (vertex != NoIndex)
+                    moveVertex(vertex, true, posIt->first, posIt->second, faceManager);
+                updateFacePoints(faceManager);
+            }
+
+            faceManager.getFaces(newFaces, droppedFaces);
+        }
+
+        void CompactBrushGeometry::snap(FaceSet& newFaces, FaceSet& droppedFaces, unsigned int snapTo) {
+            assert(snapTo > 0);
+
+            Vec3f::Map positions;
+            for (size_t i = 0; i < m_vertices.size(); i++) {
+                const Vec3f& start = m_vertices[i];
+                Vec3f end;
+                for (size_t j = 0; j < 3; j++)
+                    end[j] = snapTo * Math<float>::round(start[j] / snapTo);
+                if (!start.equals(end, 0.0f))
+                    positions[start] = end;
+            }
+
+            if (positions.empty())
+                return;
+
+            FaceManager faceManager;
+            Vec3f::Map::const_iterator posIt, posEnd;
+            for (posIt = positions.begin(), posEnd = positions.end(); posIt != posEnd; ++posIt) {
+                Index vertex = findVertex(posIt->first);
+                if (vertex != NoIndex)
+                    moveVertex(vertex, true, posIt->first, posIt->second, faceManager);
+                updateFacePoints(faceManager);
+            }
+
+            faceManager.getFaces(newFaces, droppedFaces);
+        }
+
+        bool CompactBrushGeometry::canMoveVertices(const BBoxf& worldBounds, const Vec3f::List& vertexPositions, const Vec3f& delta) const {
+            FaceManager faceManager;
+            CompactBrushGeometry testGeometry(*this);
+
+            Vec3f::List sortedVertexPositions = vertexPositions;
+            std::sort(sortedVertexPositions.begin(), sortedVertexPositions.end(), Vec3f::InverseDotOrder(delta));
+
+            bool canMove = true;
+            for (size_t i = 0; i < sortedVertexPositions.size() && canMove; i++) {
+                Index vertex = testGeometry.findVertex(sortedVertexPositions[i]);
+                assert(vertex != NoIndex);
+
+                const Vec3f start = testGeometry.m_vertices[vertex];
+                canMove = testGeometry.moveVertex(vertex, true, start, start + delta, faceManager) != MoveVertexResult::VertexUnchanged;
+            }
+
+            canMove &= testGeometry.m_sides.size() >= 3;
+            canMove &= worldBounds.contains(testGeometry.m_bounds);
+            return canMove;
+        }
+
+        Vec3f::List CompactBrushGeometry::moveVertices(const BBoxf& worldBounds, const Vec3f::List& vertexPositions, const Vec3f& delta, FaceSet& newFaces, FaceSet& droppedFaces) {
+            assert(canMoveVertices(worldBounds, vertexPositions, delta));
+
+            FaceManager faceManager;
+            Vec3f::List newVertexPositions;
+            Vec3f::List sortedVertexPositions = vertexPositions;
+            std::sort(sortedVertexPositions.begin(), sortedVertexPositions.end(), Vec3f::InverseDotOrder(delta));
+
+            for (size_t i = 0; i < sortedVertexPositions.size(); i++) {
+                Index vertex = findVertex(sortedVertexPositions[i]);
+                assert(vertex != NoIndex);
+
+                const Vec3f start = m_vertices[vertex];
+                if (moveVertex(vertex, true, start, start + delta, faceManager) == MoveVertexResult::VertexMoved)
+                    newVertexPositions.push_back(m_vertices[vertex]);
+                updateFacePoints(faceManager);
+            }
+
+            faceManager.getFaces(newFaces, droppedFaces);
+            return newVertexPositions;
+        }
+
+        bool CompactBrushGeometry::canMoveEdges(const BBoxf& worldBounds, const EdgeInfoList& edgeInfos, const Vec3f& delta) const {
+            FaceManager faceManager;
+            CompactBrushGeometry testGeometry(*this);
+
+            Vec3f::List sortedVertexPositions;
+            for (size_t i = 0; i < edgeInfos.size(); i++) {
+                sortedVertexPositions.push_back(edgeInfos[i].start);
+                sortedVertexPositions.push_back(edgeInfos[i].end);
+            }
+            std::sort(sortedVertexPositions.begin(), sortedVertexPositions.end(), Vec3f::InverseDotOrder(delta));
+
+            bool canMove = true;
+            for (size_t i = 0; i < sortedVertexPositions.size() && canMove; i++) {
+                Index vertex = testGeometry.findVertex(sortedVertexPositions[i]);
+                if (vertex == NoIndex) {
+                    canMove = false;
+                } else {
+                    const Vec3f start = testGeometry.m_vertices[vertex];
+                    canMove = testGeometry.moveVertex(vertex, false, start, start + delta, faceManager) == MoveVertexResult::VertexMoved;
+                }
+            }
+
+            for (size_t i = 0; i < edgeInfos.size() && canMove; i++)
+                canMove = testGeometry.findEdge(edgeInfos[i].start + delta, edgeInfos[i].end + delta) != NoIndex;
+
+            canMove &= testGeometry.m_sides.size() >= 3;
+            canMove &= worldBounds.contains(testGeometry.m_bounds);
+            return canMove;
+        }
+
+        EdgeInfoList CompactBrushGeometry::moveEdges(const BBoxf& worldBounds, const EdgeInfoList& edgeInfos, const Vec3f& delta, FaceSet& newFaces, FaceSet& droppedFaces) {
+            assert(canMoveEdges(worldBounds, edgeInfos, delta));
+
+            FaceManager faceManager;
+            Vec3f::List sortedVertexPositions;
+            for (size_t i = 0; i < edgeInfos.size(); i++) {
+                sortedVertexPositions.push_back(edgeInfos[i].start);
+                sortedVertexPositions.push_back(edgeInfos[i].end);
+            }
+            std::sort(sortedVertexPositions.begin(), sortedVertexPositions.end(), Vec3f::InverseDotOrder(delta));
+
+            for (size_t i = 0; i < sortedVertexPositions.size(); i++) {
+                Index vertex = findVertex(sortedVertexPositions[i]);
+                assert(vertex != NoIndex);
+
+                const Vec3f start = m_vertices[vertex];
+                const MoveVertexResult::Type result = moveVertex(vertex, false, start, start + delta, faceManager);
+                assert(result == MoveVertexResult::VertexMoved);
+                updateFacePoints(faceManager);
+            }
+
+            faceManager.getFaces(newFaces, droppedFaces);
+
+            EdgeInfoList result;
+            for (size_t i = 0; i < edgeInfos.size(); i++) {
+                assert(findEdge(edgeInfos[i].start + delta, edgeInfos[i].end + delta) != NoIndex);
+                result.push_back(EdgeInfo(edgeInfos[i].start + delta, edgeInfos[i].end + delta));
+            }
+            return result;
+        }
+
+        bool CompactBrushGeometry::canMoveFaces(const BBoxf& worldBounds, const FaceInfoList& faceInfos, const Vec3f& delta) const {
+            FaceManager faceManager;
+            CompactBrushGeometry testGeometry(*this);
+
+            Vec3f::List sortedVertexPositions;
+            for (size_t i = 0; i < faceInfos.size(); i++)
+                sortedVertexPositions.insert(sortedVertexPositions.end(), faceInfos[i].vertices.begin(), faceInfos[i].vertices.end());
+            std::sort(sortedVertexPositions.begin(), sortedVertexPositions.end(), Vec3f::InverseDotOrder(delta));
+
+            bool canMove = true;
+            for (size_t i = 0; i < sortedVertexPositions.size() && canMove; i++) {
+                Index vertex = testGeometry.findVertex(sortedVertexPositions[i]);
+                if (vertex == NoIndex) {
+                    canMove = false;
+                } else {
+                    const Vec3f start = testGeometry.m_vertices[vertex];
+                    canMove = testGeometry.moveVertex(vertex, false, start, start + delta, faceManager) == MoveVertexResult::VertexMoved;
+                }
+            }
+
+            canMove &= testGeometry.m_sides.size() >= 3;
+            canMove &= worldBounds.contains(testGeometry.m_bounds);
+
+            for (size_t i = 0; i < faceInfos.size() && canMove; i++)
+                canMove = testGeometry.findSide(faceInfos[i].translated(delta).vertices) != NoIndex;
+            return canMove;
+        }
+
+        FaceInfoList CompactBrushGeometry::moveFaces(const BBoxf& worldBounds, const FaceInfoList& faceInfos, const Vec3f& delta, FaceSet& newFaces, FaceSet& droppedFaces) {
+            assert(canMoveFaces(worldBounds, faceInfos, delta));
+
+            FaceManager faceManager;
+            Vec3f::List sortedVertexPositions;
+            for (size_t i = 0; i < faceInfos.size(); i++)
+                sortedVertexPositions.insert(sortedVertexPositions.end(), faceInfos[i].vertices.begin(), faceInfos[i].vertices.end());
+            std::sort(sortedVertexPositions.begin(), sortedVertexPositions.end(), Vec3f::InverseDotOrder(delta));
+
+            for (size_t i = 0; i < sortedVertexPositions.size(); i++) {
+                Index vertex = findVertex(sortedVertexPositions[i]);
+                assert(vertex != NoIndex);
+
+                const Vec3f start = m_vertices[vertex];
+                const MoveVertexResult::Type result = moveVertex(vertex, false, start, start + delta, faceManager);
+                assert(result == MoveVertexResult::VertexMoved);
+            }
+
+            updateFacePoints(faceManager);
+            faceManager.getFaces(newFaces, droppedFaces);
+
+            FaceInfoList result;
+            for (size_t i = 0; i < faceInfos.size(); i++) {
+                const FaceInfo translated = faceInfos[i].translated(delta);
+                assert(findSide(translated.vertices) != NoIndex);
+                result.push_back(translated);
+            }
+            return result;
+        }
+
+        bool CompactBrushGeometry::canSplitEdge(const BBoxf& worldBounds, const EdgeInfo& edgeInfo, const Vec3f& delta) const {
+            const Index edge = findEdge(edgeInfo.start, edgeInfo.end);
+            if (edge == NoIndex)
+                return false;
+
+            // detect whether the drag would make the incident faces invalid
+            const Vec3f& leftNorm = m_sides[m_edges[edge].left].face->boundary().normal;
+            const Vec3f& rightNorm = m_sides[m_edges[edge].right].face->boundary().normal;
+
+            // we allow a bit more leeway when testing here, as otherwise edges sometimes cannot be split
+            if (Math<float>::neg(delta.dot(leftNorm), 0.01f) ||
+                Math<float>::neg(delta.dot(rightNorm), 0.01f))
+                return false;
+
+            FaceManager faceManager;
+            CompactBrushGeometry testGeometry(*this);
+
+            Index newVertex = testGeometry.splitEdge(edge);
+            const Vec3f start = testGeometry.m_vertices[newVertex];
+            bool canSplit = testGeometry.moveVertex(newVertex, false, start, start + delta, faceManager) == MoveVertexResult::VertexMoved;
+            canSplit &= testGeometry.m_sides.size() >= 3;
+            canSplit &= worldBounds.contains(testGeometry.m_bounds);
+            return canSplit;
+        }
+
+        Vec3f CompactBrushGeometry::splitEdge(const BBoxf& worldBounds, const EdgeInfo& edgeInfo, const Vec3f& delta, FaceSet& newFaces, FaceSet& droppedFaces) {
+            assert(canSplitEdge(worldBounds, edgeInfo, delta));
+
+            FaceManager faceManager;
+            Index newVertex = splitEdge(findEdge(edgeInfo.start, edgeInfo.end));
+            const Vec3f start = m_vertices[newVertex];
+            const MoveVertexResult::Type result = moveVertex(newVertex, false, start, start + delta, faceManager);
+            assert(result == MoveVertexResult::VertexMoved);
+            const Vec3f position = m_vertices[newVertex];
+
+            updateFacePoints(faceManager);
+            faceManager.getFaces(newFaces, droppedFaces);
+            return position;
+        }
+
+        bool CompactBrushGeometry::canSplitFace(const BBoxf& worldBounds, const FaceInfo& faceInfo, const Vec3f& delta) const {
+            const Index side = findSide(faceInfo.vertices);
+            if (side == NoIndex)
+                return false;
+
+            const Face* face = m_sides[side].face;
+            assert(face != NULL);
+
+            // detect whether the drag would lead to an indented face
+            const Vec3f& norm = face->boundary().normal;
+            if (Math<float>::zero(delta.dot(norm)))
+                return false;
+
+            FaceManager faceManager;
+            CompactBrushGeometry testGeometry(*this);
+
+            Index newVertex = testGeometry.splitFace(side, faceManager);
+            const Vec3f start = testGeometry.m_vertices[newVertex];
+            bool canSplit = testGeometry.moveVertex(newVertex, false, start, start + delta, faceManager) == MoveVertexResult::VertexMoved;
+            canSplit &= testGeometry.m_sides.size() >= 3;
+            canSplit &= worldBounds.contains(testGeometry.m_bounds);
+            return canSplit;
+        }
+
+        Vec3f CompactBrushGeometry::splitFace(const BBoxf& worldBounds, const FaceInfo& faceInfo, const Vec3f& delta, FaceSet& newFaces, FaceSet& droppedFaces) {
+            assert(canSplitFace(worldBounds, faceInfo, delta));
+
+            const Index side = findSide(faceInfo.vertices);
+            assert(side != NoIndex);
+
+            FaceManager faceManager;
+            Index newVertex = splitFace(side, faceManager);
+            const Vec3f start = m_vertices[newVertex];
+            const MoveVertexResult::Type result = moveVertex(newVertex, false, start, start + delta, faceManager);
+            assert(result == MoveVertexResult::VertexMoved);
+            const Vec3f position = m_vertices[newVertex];
+
+            updateFacePoints(faceManager);
+            faceManager.getFaces(newFaces, droppedFaces);
+            return position;
+        }
+    }
+}
@@ -0,0 +1,216 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TrenchBroom__CompactBrushGeometry__
+#define __TrenchBroom__CompactBrushGeometry__
+
+#include "Model/BrushGeometry.h"
+#include "Model/BrushGeometryTypes.h"
+#include "Model/FaceTypes.h"
+#include "Utility/VecMath.h"
+
+#include <map>
+#include <vector>
+
+using namespace TrenchBroom::VecMath;
+
+namespace TrenchBroom {
+    namespace Model {
+        class Face;
+
+        /*
+         * Stores the same topology as BrushGeometry, but instead of allocating every vertex, edge and side
+         * separately and linking them by pointers, the vertex positions, edges and side loops are kept in three
+         * contiguous arrays per brush and refer to each other by 16 bit indices. A side is a range of edge
+         * indices in the shared loop array; its vertices are the start vertices of its edges as seen from the
+         * side.
+         *
+         * Clipping by faces and the vertex editing operations work directly on the arrays. They follow the
+         * same steps as their counterparts in BrushGeometry and produce exactly the same vertices, edges and
+         * loops in the same order. Unlike BrushGeometry, the faces are never bound to the sides, so the faces'
+         * side pointers are left untouched.
+         */
+        class CompactBrushGeometry {
+        public:
+            typedef unsigned short Index;
+            static const Index NoIndex = 0xFFFF;
+
+            class EdgeEntry {
+            public:
+                Index start;
+                Index end;
+                Index left;
+                Index right;
+
+                EdgeEntry(Index i_start, Index i_end, Index i_left, Index i_right) :
+                start(i_start),
+                end(i_end),
+                left(i_left),
+                right(i_right) {}
+
+                inline Index startVertex(Index side) const {
+                    return left == side ? end : start;
+                }
+
+                inline Index endVertex(Index side) const {
+                    return left == side ? start : end;
+                }
+
+                inline void flip() {
+                    std::swap(start, end);
+                    std::swap(left, right);
+                }
+            };
+
+            class SideEntry {
+            public:
+                Face* face;
+                Index first;
+                Index count;
+
+                SideEntry(Face* i_face, Index i_first, Index i_count) :
+                face(i_face),
+                first(i_first),
+                count(i_count) {}
+            };
+
+            typedef std::vector<Index> IndexList;
+            typedef std::vector<EdgeEntry> EdgeEntryList;
+            typedef std::vector<SideEntry> SideEntryList;
+
+            typedef BrushGeometry::CutResult CutResult;
+        private:
+            class FaceManager {
+            private:
+                typedef std::map<Face*, FaceSet> CopyMap;
+                CopyMap m_newFaces;
+                FaceSet m_droppedFaces;
+            public:
+                ~FaceManager();
+
+                void addFace(Face* original, Face* copy);
+                void dropFace(SideEntryList& sides, Index side);
+                void getFaces(FaceSet& newFaces, FaceSet& droppedFaces);
+            };
+
+            Vec3f::List m_vertices;
+            EdgeEntryList m_edges;
+            SideEntryList m_sides;
+            IndexList m_sideEdges;
+            Vec3f m_center;
+            BBoxf m_bounds;
+
+            void assign(const BrushGeometry& geometry);
+            void updateBounds();
+
+            IndexList sideLoop(Index side) const;
+            void setSideLoop(Index side, const IndexList& loop);
+            Index sideVertexIndex(Index side, size_t index) const;
+            size_t findSideEdge(Index side, Index edge) const;
+            size_t findSideVertex(Index side, Index vertex) const;
+            bool sideHasVertices(Index side, const Vec3f::List& positions) const;
+            IndexList incidentSides(Index vertex) const;
+            size_t isCollinearTriangle(Index side) const;
+
+            Index findVertex(const Vec3f& position) const;
+            Index findEdge(const Vec3f& position1, const Vec3f& position2) const;
+            Index findSide(const Vec3f::List& positions) const;
+
+            void removeVertex(Index vertex, Index& movedVertex);
+            void removeEdge(Index edge);
+            void removeSide(Index side);
+
+            void chop(Index side, size_t index, FaceManager& faceManager);
+            void deleteDegenerateTriangle(Index side, Index& edge, FaceManager& faceManager);
+            void mergeEdges(Index& movedVertex);
+            void mergeNeighbours(Index side, size_t edgeIndex, FaceManager& faceManager, Index& movedVertex);
+            void mergeSides(FaceManager& faceManager, Index& movedVertex);
+
+            MoveVertexResult::Type moveVertex(Index& vertex, bool mergeWithAdjacentVertex, const Vec3f& start, const Vec3f& end, FaceManager& faceManager);
+            Index splitEdge(Index edge);
+            Index splitFace(Index side, FaceManager& faceManager);
+            void updateFacePoints(FaceManager& faceManager);
+        public:
+            CompactBrushGeometry(const BBoxf& bounds);
+            CompactBrushGeometry(const BrushGeometry& geometry);
+            CompactBrushGeometry(const Vec3f::List& vertices, const EdgeEntryList& edges, const SideEntryList& sides, const IndexList& sideEdges);
+
+            inline const Vec3f::List& vertices() const {
+                return m_vertices;
+            }
+
+            inline const EdgeEntryList& edges() const {
+                return m_edges;
+            }
+
+            inline const SideEntryList& sides() const {
+                return m_sides;
+            }
+
+            inline Index sideEdge(size_t side, size_t index) const {
+                assert(side < m_sides.size());
+                assert(index < m_sides[side].count);
+                return m_sideEdges[m_sides[side].first + index];
+            }
+
+            inline const Vec3f& sideVertex(size_t side, size_t index) const {
+                const EdgeEntry& edge = m_edges[sideEdge(side, index)];
+                return m_vertices[edge.startVertex(static_cast<Index>(side))];
+            }
+
+            inline const Vec3f& center() const {
+                return m_center;
+            }
+
+            inline const BBoxf& bounds() const {
+                return m_bounds;
+            }
+
+            Vec3f::List sideVertices(size_t side) const;
+            bool closed() const;
+            size_t memoryUsage() const;
+
+            /*
+             * Creates an equivalent BrushGeometry. The caller takes ownership of the result; the faces are not
+             * bound to its sides.
+             */
+            BrushGeometry* toBrushGeometry() const;
+
+            CutResult addFace(Face& face, FaceSet& droppedFaces);
+            bool addFaces(const FaceList& faces, FaceSet& droppedFaces);
+
+            void correct(FaceSet& newFaces, FaceSet& droppedFaces, float epsilon);
+            void snap(FaceSet& newFaces, FaceSet& droppedFaces, unsigned int snapTo);
+
+            bool canMoveVertices(const BBoxf& worldBounds, const Vec3f::List& vertexPositions, const Vec3f& delta) const;
+            Vec3f::List moveVertices(const BBoxf& worldBounds, const Vec3f::List& vertexPositions, const Vec3f& delta, FaceSet& newFaces, FaceSet& droppedFaces);
+            bool canMoveEdges(const BBoxf& worldBounds, const EdgeInfoList& edgeInfos, const Vec3f& delta) const;
+            EdgeInfoList moveEdges(const BBoxf& worldBounds, const EdgeInfoList& edgeInfos, const Vec3f& delta, FaceSet& newFaces, FaceSet& droppedFaces);
+            bool canMoveFaces(const BBoxf& worldBounds, const FaceInfoList& faceInfos, const Vec3f& delta) const;
+            FaceInfoList moveFaces(const BBoxf& worldBounds, const FaceInfoList& faceInfos, const Vec3f& delta, FaceSet& newFaces, FaceSet& droppedFaces);
+
+            bool canSplitEdge(const BBoxf& worldBounds, const EdgeInfo& edgeInfo, const Vec3f& delta) const;
+            Vec3f splitEdge(const BBoxf& worldBounds, const EdgeInfo& edgeInfo, const Vec3f& delta, FaceSet& newFaces, FaceSet& droppedFaces);
+            bool canSplitFace(const BBoxf& worldBounds, const FaceInfo& faceInfo, const Vec3f& delta) const;
+            Vec3f splitFace(const BBoxf& worldBounds, const FaceInfo& faceInfo, const Vec3f& delta, FaceSet& newFaces, FaceSet& droppedFaces);
+        };
+    }
+}
+
+#endif /* defined(__TrenchBroom__CompactBrushGeometry__) */
@@ -0,0 +1,177 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ConvexVolume.h"
+
+#include "Model/Brush.h"
+#include "Model/BrushGeometry.h"
+#include "Model/Face.h"
+
+#include <cmath>
+#include <limits>
+
+namespace TrenchBroom {
+    namespace Model {
+        // two edge directions are considered parallel if the sine of the angle between them is smaller than this
+        static const float ParallelEpsilon = 0.001f;
+        
+        void ConvexVolume::addEdgeDirection(const Vec3f& direction) {
+            const Vec3f normalized = direction.normalized();
+            Vec3f::List::const_iterator it, end;
+            for (it = m_edgeDirections.begin(), end = m_edgeDirections.end(); it != end; ++it)
+                if (crossed(*it, normalized).lengthSquared() < ParallelEpsilon * ParallelEpsilon)
+                    return;
+            m_edgeDirections.push_back(normalized);
+        }
+        
+        void ConvexVolume::project(const Vec3f& axis, float& min, float& max) const {
+            min = std::numeric_limits<float>::max();
+            max = -std::numeric_limits<float>::max();
+            for (size_t i = 0; i < m_vertices.size(); i++) {
+                const float dot = axis.dot(m_vertices[i]);
+                if (dot < min)
+                    min = dot;
+                if (dot > max)
+                    max = dot;
+            }
+        }
+        
+        float ConvexVolume::minDistance(const Planef& plane) const {
+            float min = std::numeric_limits<float>::max();
+            for (size_t i = 0; i < m_vertices.size(); i++) {
+                const float distance = plane.pointDistance(m_vertices[i]);
+                if (distance < min)
+                    min = distance;
+            }
+            return min;
+        }
+        
+        bool ConvexVolume::separatedByFaces(const ConvexVolume& other, float gap) const {
+            for (size_t i = 0; i < m_planes.size(); i++)
+                if (other.minDistance(m_planes[i]) > gap)
+                    return true;
+            return false;
+        }
+        
+        bool ConvexVolume::separatedByEdges(const ConvexVolume& other, float gap) const {
+            for (size_t i = 0; i < m_edgeDirections.size(); i++) {
+                for (size_t j = 0; j < other.m_edgeDirections.size(); j++) {
+                    Vec3f axis = crossed(m_edgeDirections[i], other.m_edgeDirections[j]);
+                    if (axis.lengthSquared() < ParallelEpsilon * ParallelEpsilon)
+                        continue;
+                    axis.normalize();
+                    
+                    float myMin, myMax, theirMin, theirMax;
+                    project(axis, myMin, myMax);
+                    other.project(axis, theirMin, theirMax);
+                    if (theirMin - myMax > gap || myMin - theirMax > gap)
+                        return true;
+                }
+            }
+            return false;
+        }
+        
+        ConvexVolume::ConvexVolume() {}
+        
+        ConvexVolume::ConvexVolume(const Brush& brush) {
+            set(brush);
+        }
+        
+        ConvexVolume::ConvexVolume(const BBoxf& bounds) {
+            set(bounds);
+        }
+        
+        void ConvexVolume::set(const Brush& brush) {
+            m_bounds = brush.bounds();
+            m_vertices.clear();
+            m_planes.clear();
+            m_edgeDirections.clear();
+            
+            const VertexList& vertices = brush.vertices();
+            m_vertices.reserve(vertices.size());
+            VertexList::const_iterator vertexIt, vertexEnd;
+            for (vertexIt = vertices.begin(), vertexEnd = vertices.end(); vertexIt != vertexEnd; ++vertexIt)
+                m_vertices.push_back((*vertexIt)->position);
+            
+            const FaceList& faces = brush.faces();
+            m_planes.reserve(faces.size());
+            FaceList::const_iterator faceIt, faceEnd;
+            for (faceIt = faces.begin(), faceEnd = faces.end(); faceIt != faceEnd; ++faceIt)
+                m_planes.push_back((*faceIt)->boundary());
+            
+            const EdgeList& edges = brush.edges();
+            EdgeList::const_iterator edgeIt, edgeEnd;
+            for (edgeIt = edges.begin(), edgeEnd = edges.end(); edgeIt != edgeEnd; ++edgeIt)
+                addEdgeDirection((*edgeIt)->vector());
+        }
+        
+        void ConvexVolume::set(const BBoxf& bounds) {
+            m_bounds = bounds;
+            m_vertices.clear();
+            m_planes.clear();
+            m_edgeDirections.clear();
+            
+            for (unsigned int i = 0; i < 8; i++)
+                m_vertices.push_back(Vec3f((i & 1) == 0 ? bounds.min.x() : bounds.max.x(),
+                                           (i & 2) == 0 ? bounds.min.y() : bounds.max.y(),
+                                           (i & 4) == 0 ? bounds.min.z() : bounds.max.z()));
+            
+            for (size_t i = 0; i < 3; i++) {
+                const Vec3f axis = Vec3f::axis(i);
+                m_planes.push_back(Planef(axis, bounds.max[i]));
+                m_planes.push_back(Planef(-axis, -bounds.min[i]));
+                m_edgeDirections.push_back(axis);
+            }
+        }
+        
+        bool ConvexVolume::containsPoint(const Vec3f& point) const {
+            for (size_t i = 0; i < m_planes.size(); i++)
+                if (m_planes[i].pointDistance(point) > Math<float>::PointStatusEpsilon)
+                    return false;
+            return true;
+        }
+        
+        bool ConvexVolume::overlaps(const ConvexVolume& other, float gap) const {
+            if (!m_bounds.intersects(other.m_bounds))
+                return false;
+            
+            // separating axis theorem
+            // http://www.geometrictools.com/Documentation/MethodOfSeparatingAxes.pdf
+            return !separatedByFaces(other, gap) && !other.separatedByFaces(*this, gap) && !separatedByEdges(other, gap);
+        }
+        
+        bool ConvexVolume::intersects(const ConvexVolume& other) const {
+            return overlaps(other, -Math<float>::PointStatusEpsilon);
+        }
+        
+        bool ConvexVolume::touches(const ConvexVolume& other) const {
+            return overlaps(other, Math<float>::PointStatusEpsilon);
+        }
+        
+        bool ConvexVolume::contains(const ConvexVolume& other) const {
+            if (!m_bounds.contains(other.m_bounds))
+                return false;
+            
+            for (size_t i = 0; i < other.m_vertices.size(); i++)
+                if (!containsPoint(other.m_vertices[i]))
+                    return false;
+            return true;
+        }
+    }
+}
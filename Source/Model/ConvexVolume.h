@@ -0,0 +1,78 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TrenchBroom__ConvexVolume__
+#define __TrenchBroom__ConvexVolume__
+
+#include "Utility/VecMath.h"
+
+#include <vector>
+
+using namespace TrenchBroom::VecMath;
+
+namespace TrenchBroom {
+    namespace Model {
+        class Brush;
+        
+        /*
+         * A copy of the geometry of a brush or a box which is packed into flat arrays so that the separating axis tests
+         * don't have to chase the pointers of the brush geometry. Parallel edges only contribute one direction, which
+         * keeps the number of edge pair axes small for the axis aligned brushes that make up most maps.
+         */
+        class ConvexVolume {
+        private:
+            typedef std::vector<Planef> PlaneList;
+            
+            BBoxf m_bounds;
+            Vec3f::List m_vertices;
+            PlaneList m_planes;
+            Vec3f::List m_edgeDirections;
+            
+            void addEdgeDirection(const Vec3f& direction);
+            void project(const Vec3f& axis, float& min, float& max) const;
+            float minDistance(const Planef& plane) const;
+            bool separatedByFaces(const ConvexVolume& other, float gap) const;
+            bool separatedByEdges(const ConvexVolume& other, float gap) const;
+            bool overlaps(const ConvexVolume& other, float gap) const;
+        public:
+            ConvexVolume();
+            ConvexVolume(const Brush& brush);
+            ConvexVolume(const BBoxf& bounds);
+            
+            void set(const Brush& brush);
+            void set(const BBoxf& bounds);
+            
+            inline const BBoxf& bounds() const {
+                return m_bounds;
+            }
+            
+            bool containsPoint(const Vec3f& point) const;
+            
+            /*
+             * Returns whether the interiors of the two volumes overlap. Volumes which only share a face, an edge or
+             * a vertex do not intersect, but they do touch.
+             */
+            bool intersects(const ConvexVolume& other) const;
+            bool touches(const ConvexVolume& other) const;
+            bool contains(const ConvexVolume& other) const;
+        };
+    }
+}
+
+#endif /* defined(__TrenchBroom__ConvexVolume__) */
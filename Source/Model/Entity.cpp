@@ -99,7 +99,7 @@ namespace TrenchBroom {
             EntityList::iterator it = m_linkTargets.begin();
             while (it != m_linkTargets.end()) {
                 Entity& target = **it;
-                const PropertyValue* currentTargetname = target.propertyForKey(TargetnameKey);
+                const PropertyValue* currentTargetname = target.propertyForKey(PropertyKeyTable::TargetnameAtom);
                 if (currentTargetname == NULL) { // gracefully remove this one
                     it = m_linkTargets.erase(it);
                     continue;
@@ -131,7 +131,7 @@ namespace TrenchBroom {
             EntityList::iterator it = m_killTargets.begin();
             while (it != m_killTargets.end()) {
                 Entity& target = **it;
-                const PropertyValue* currentTargetname = target.propertyForKey(TargetnameKey);
+                const PropertyValue* currentTargetname = target.propertyForKey(PropertyKeyTable::TargetnameAtom);
                 if (currentTargetname == NULL) { // gracefully remove this one
                     it = m_killTargets.erase(it);
                     continue;
@@ -286,13 +286,13 @@ namespace TrenchBroom {
             const String* classn = classname();
             if (classn != NULL) {
                 if (Utility::startsWith(*classn, "light")) {
-                    if (propertyForKey(MangleKey) != NULL) {
+                    if (propertyForKey(PropertyKeyTable::MangleAtom) != NULL) {
                         // spotlight without a target, update mangle
                         type = RTEulerAngles;
                         property = MangleKey;
-                    } else if (propertyForKey(TargetKey) == NULL) {
+                    } else if (propertyForKey(PropertyKeyTable::TargetAtom) == NULL) {
                         // not a spotlight, but might have a rotatable model, so change angle or angles
-                        if (propertyForKey(AnglesKey) != NULL) {
+                        if (propertyForKey(PropertyKeyTable::AnglesAtom) != NULL) {
                             type = RTEulerAngles;
                             property = AnglesKey;
                         } else {
@@ -305,10 +305,10 @@ namespace TrenchBroom {
                 } else {
                     bool brushEntity = !m_brushes.empty() || (m_definition != NULL && m_definition->type() == EntityDefinition::BrushEntity);
                     if (brushEntity) {
-                        if (propertyForKey(AnglesKey) != NULL) {
+                        if (propertyForKey(PropertyKeyTable::AnglesAtom) != NULL) {
                             type = RTEulerAngles;
                             property = AnglesKey;
-                        } else if (propertyForKey(AngleKey) != NULL) {
+                        } else if (propertyForKey(PropertyKeyTable::AngleAtom) != NULL) {
                             type = RTZAngleWithUpDown;
                             property = AngleKey;
                         }
@@ -318,7 +318,7 @@ namespace TrenchBroom {
                         // if the origin of the definition's bounding box is not in its center, don't apply the rotation
                         const Vec3f offset = origin() - center();
                         if (offset.x() == 0.0f && offset.y() == 0.0f) {
-                            if (propertyForKey(AnglesKey) != NULL) {
+                            if (propertyForKey(PropertyKeyTable::AnglesAtom) != NULL) {
                                 type = RTEulerAngles;
                                 property = AnglesKey;
                             } else {
@@ -465,7 +465,7 @@ namespace TrenchBroom {
             addAllLinkTargets();
             addAllKillTargets();
 
-            const PropertyValue* targetname = propertyForKey(TargetnameKey);
+            const PropertyValue* targetname = propertyForKey(PropertyKeyTable::TargetnameAtom);
             if (targetname != NULL && !targetname->empty()) {
                 addAllLinkSources(*targetname);
                 addAllKillSources(*targetname);
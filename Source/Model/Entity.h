@@ -162,6 +162,10 @@ namespace TrenchBroom {
                 return m_propertyStore.propertyValue(key);
             }
 
+            inline const PropertyValue* propertyForKey(PropertyKeyAtom atom) const {
+                return m_propertyStore.propertyValue(atom);
+            }
+
             static bool propertyIsMutable(const PropertyKey& key);
             static bool propertyKeyIsMutable(const PropertyKey& key);
 
@@ -195,7 +199,7 @@ namespace TrenchBroom {
             }
 
             inline const PropertyValue* classname() const {
-                return propertyForKey(ClassnameKey);
+                return propertyForKey(PropertyKeyTable::ClassnameAtom);
             }
             
             inline const PropertyValue& safeClassname() const {
@@ -210,22 +214,23 @@ namespace TrenchBroom {
             }
 
             inline const Vec3f origin() const {
-                const PropertyValue* value = propertyForKey(OriginKey);
+                const PropertyValue* value = propertyForKey(PropertyKeyTable::OriginAtom);
                 if (value == NULL)
                     return Vec3f::Null;
                 return Vec3f(*value);
             }
 
             inline bool rotated() const {
-                if (classname() == NULL)
+                const PropertyValue* classn = classname();
+                if (classn == NULL)
                     return false;
-                if (Utility::startsWith(*classname(), "light")) {
-                    if (propertyForKey(MangleKey) != NULL)
+                if (Utility::startsWith(*classn, "light")) {
+                    if (propertyForKey(PropertyKeyTable::MangleAtom) != NULL)
                         return true;
                 } else {
-                    if (propertyForKey(AngleKey) != NULL)
+                    if (propertyForKey(PropertyKeyTable::AngleAtom) != NULL)
                         return true;
-                    if (propertyForKey(AnglesKey) != NULL)
+                    if (propertyForKey(PropertyKeyTable::AnglesAtom) != NULL)
                         return true;
                 }
                 return false;
@@ -41,8 +41,15 @@ namespace TrenchBroom {
         public:
             typedef std::tr1::shared_ptr<ModelDefinitionEvaluator> Ptr;
             
+            enum Type {
+                PropertyEvaluator,
+                FlagEvaluator,
+                PropertiesEvaluator
+            };
+            
             virtual ~ModelDefinitionEvaluator() {}
             
+            virtual Type type() const = 0;
             virtual bool evaluate(const PropertyList& properties) const = 0;
         };
         
@@ -53,6 +60,18 @@ namespace TrenchBroom {
         public:
             ModelDefinitionPropertyEvaluator(const PropertyKey& propertyKey, const PropertyValue& propertyValue);
             
+            inline Type type() const {
+                return PropertyEvaluator;
+            }
+            
+            inline const PropertyKey& propertyKey() const {
+                return m_propertyKey;
+            }
+            
+            inline const PropertyValue& propertyValue() const {
+                return m_propertyValue;
+            }
+            
             bool evaluate(const PropertyList& properties) const;
         };
         
@@ -63,6 +82,18 @@ namespace TrenchBroom {
         public:
             ModelDefinitionFlagEvaluator(const PropertyKey& propertyKey, int flagValue);
             
+            inline Type type() const {
+                return FlagEvaluator;
+            }
+            
+            inline const PropertyKey& propertyKey() const {
+                return m_propertyKey;
+            }
+            
+            inline int flagValue() const {
+                return m_flagValue;
+            }
+            
             bool evaluate(const PropertyList& properties) const;
         };
         
@@ -74,6 +105,10 @@ namespace TrenchBroom {
         public:
             ModelDefinitionPropertiesEvaluator(const PropertyKey& modelKey, const PropertyKey& skinKey, const PropertyKey& frameKey);
             
+            inline Type type() const {
+                return PropertiesEvaluator;
+            }
+            
             bool evaluate(const PropertyList& properties) const;
         };
         
@@ -104,6 +139,13 @@ namespace TrenchBroom {
                 return m_frameIndex;
             }
             
+            /*
+             * Returns NULL if this model is used regardless of the entity's properties.
+             */
+            inline const ModelDefinitionEvaluator* evaluator() const {
+                return m_evaluator.get();
+            }
+            
             inline bool matches(const PropertyList& properties) const {
                 if (m_evaluator == NULL)
                     return true;
@@ -151,6 +193,14 @@ namespace TrenchBroom {
                 return m_color;
             }
             
+            inline const String& description() const {
+                return m_description;
+            }
+            
+            inline const PropertyDefinition::List& propertyDefinitions() const {
+                return m_propertyDefinitions;
+            }
+            
             const FlagsPropertyDefinition* spawnflags() const {
                 PropertyDefinition::List::const_iterator it, end;
                 for (it = m_propertyDefinitions.begin(), end = m_propertyDefinitions.end(); it != end; ++it) {
@@ -199,6 +249,10 @@ namespace TrenchBroom {
             inline const BBoxf& bounds() const {
                 return m_bounds;
             }
+            
+            inline const ModelDefinition::List& modelDefinitions() const {
+                return m_modelDefinitions;
+            }
 
             const ModelDefinition* model(const PropertyList& properties = EmptyPropertyList) const;
         };
@@ -21,14 +21,17 @@
 
 #include "IO/FileManager.h"
 #include "IO/DefParser.h"
+#include "IO/EntityDefinitionCache.h"
 #include "IO/FgdParser.h"
 #include "Utility/Color.h"
 #include "Utility/Console.h"
+#include "Utility/Hash.h"
 #include "Utility/Map.h"
 #include "Utility/Preferences.h"
 #include "Utility/String.h"
 
 #include <algorithm>
+#include <fstream>
 
 namespace TrenchBroom {
     namespace Model {
@@ -56,6 +59,60 @@ namespace TrenchBroom {
             return result;
         }
 
+        bool EntityDefinitionManager::parseDefinitions(const String& path, const IO::MappedFile& file, const Color& defaultColor, EntityDefinitionMap& definitions) {
+            IO::FileManager fileManager;
+            try {
+                const String extension = fileManager.pathExtension(path);
+                if (Utility::equalsString(extension, "def", false)) {
+                    IO::DefParser parser(file.begin(), file.end(), defaultColor);
+                    
+                    EntityDefinition* definition = NULL;
+                    while ((definition = parser.nextDefinition()) != NULL)
+                        Utility::insertOrReplace(definitions, definition->name(), definition);
+                } else if (Utility::equalsString(extension, "fgd", false)) {
+                    IO::FgdParser parser(file.begin(), file.end(), defaultColor);
+                    
+                    EntityDefinition* definition = NULL;
+                    while ((definition = parser.nextDefinition()) != NULL)
+                        Utility::insertOrReplace(definitions, definition->name(), definition);
+                }
+                return true;
+            } catch (IO::ParserException& e) {
+                Utility::deleteAll(definitions);
+                m_console.error("%s", e.what());
+                return false;
+            }
+        }
+        
+        String EntityDefinitionManager::cachePath(const String& path) {
+            IO::FileManager fileManager;
+            StringStream fileName;
+            fileName << fileManager.pathComponents(path).back() << "-" << std::hex << Utility::hash(path.data(), path.size()) << ".cache";
+            return fileManager.appendPath(fileManager.appendPath(fileManager.cacheDirectory(), "Definitions"), fileName.str());
+        }
+        
+        bool EntityDefinitionManager::writeCache(const IO::EntityDefinitionCache& cache, const String& cachePath, const EntityDefinitionList& definitions) {
+            IO::FileManager fileManager;
+            const String directoryPath = fileManager.deleteLastPathComponent(cachePath);
+            if (!fileManager.exists(directoryPath) && !fileManager.makeDirectory(directoryPath))
+                return false;
+            
+            const String tempPath = cachePath + ".tmp";
+            std::ofstream stream(tempPath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+            if (!stream.is_open())
+                return false;
+            
+            cache.write(stream, definitions);
+            const bool success = stream.good();
+            stream.close();
+            
+            if (!success || !fileManager.moveFile(tempPath, cachePath, true)) {
+                fileManager.deleteFile(tempPath);
+                return false;
+            }
+            return true;
+        }
+        
         void EntityDefinitionManager::load(const String& path) {
             Preferences::PreferenceManager& prefs = Preferences::PreferenceManager::preferences();
             const Color& defaultColor = prefs.getColor(Preferences::EntityBoundsColor);
@@ -63,33 +120,53 @@ namespace TrenchBroom {
             
             IO::FileManager fileManager;
             IO::MappedFile::Ptr file = fileManager.mapFile(path);
-            if (file.get() != NULL) {
-                try {
-                    const String extension = fileManager.pathExtension(path);
-                    if (Utility::equalsString(extension, "def", false)) {
-                        IO::DefParser parser(file->begin(), file->end(), defaultColor);
-                        
-                        EntityDefinition* definition = NULL;
-                        while ((definition = parser.nextDefinition()) != NULL)
-                            Utility::insertOrReplace(newDefinitions, definition->name(), definition);
-                    } else if (Utility::equalsString(extension, "fgd", false)) {
-                        IO::FgdParser parser(file->begin(), file->end(), defaultColor);
-                        
-                        EntityDefinition* definition = NULL;
-                        while ((definition = parser.nextDefinition()) != NULL)
-                            Utility::insertOrReplace(newDefinitions, definition->name(), definition);
-                    }
-                    
+            if (file.get() == NULL) {
+                m_console.error("Unable to open entity definition file %s", path.c_str());
+                return;
+            }
+            
+            if (!prefs.getBool(Preferences::EntityDefinitionCacheEnabled)) {
+                if (parseDefinitions(path, *file, defaultColor, newDefinitions)) {
                     clear();
                     m_entityDefinitions = newDefinitions;
                     m_path = path;
-                } catch (IO::ParserException& e) {
-                    Utility::deleteAll(newDefinitions);
-                    m_console.error(e.what());
                 }
-            } else {
-                m_console.error("Unable to open entity definition file %s", path.c_str());
+                return;
             }
+            
+            const String cachePath = this->cachePath(path);
+            IO::EntityDefinitionCache cache(path, file->begin(), file->end(), fileManager.modificationTime(path), defaultColor);
+            
+            // the cache file is unmapped before it is replaced
+            IO::MappedFile::Ptr cacheFile = fileManager.exists(cachePath) ? fileManager.mapFile(cachePath) : IO::MappedFile::Ptr();
+            EntityDefinitionList cachedDefinitions;
+            const bool cached = cacheFile.get() != NULL && cache.loadDefinitions(*cacheFile, cachedDefinitions);
+            cacheFile.reset();
+            
+            if (cached) {
+                EntityDefinitionList::const_iterator it, end;
+                for (it = cachedDefinitions.begin(), end = cachedDefinitions.end(); it != end; ++it)
+                    Utility::insertOrReplace(newDefinitions, (*it)->name(), *it);
+                
+                clear();
+                m_entityDefinitions = newDefinitions;
+                m_path = path;
+                return;
+            }
+            
+            if (!parseDefinitions(path, *file, defaultColor, newDefinitions))
+                return;
+            
+            clear();
+            m_entityDefinitions = newDefinitions;
+            m_path = path;
+            
+            EntityDefinitionList definitions;
+            EntityDefinitionMap::const_iterator it, end;
+            for (it = m_entityDefinitions.begin(), end = m_entityDefinitions.end(); it != end; ++it)
+                definitions.push_back(it->second);
+            if (!writeCache(cache, cachePath, definitions))
+                m_console.warn("Could not write entity definition cache");
         }
         
         void EntityDefinitionManager::clear() {
@@ -26,6 +26,11 @@
 #include <map>
 
 namespace TrenchBroom {
+    namespace IO {
+        class EntityDefinitionCache;
+        class MappedFile;
+    }
+    
     namespace Utility {
         class Console;
     }
@@ -70,6 +75,10 @@ namespace TrenchBroom {
             Utility::Console& m_console;
             String m_path;
             EntityDefinitionMap m_entityDefinitions;
+            
+            bool parseDefinitions(const String& path, const IO::MappedFile& file, const Color& defaultColor, EntityDefinitionMap& definitions);
+            String cachePath(const String& path);
+            bool writeCache(const IO::EntityDefinitionCache& cache, const String& cachePath, const EntityDefinitionList& definitions);
         public:
             EntityDefinitionManager(Utility::Console& console);
             ~EntityDefinitionManager();
@@ -0,0 +1,208 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TrenchBroom_EntityModelManager_h
+#define TrenchBroom_EntityModelManager_h
+
+#include "IO/IOUtils.h"
+#include "Utility/Console.h"
+#include "Utility/String.h"
+#include "Utility/ThreadPool.h"
+
+#include <cassert>
+#include <map>
+#include <vector>
+
+namespace TrenchBroom {
+    namespace Model {
+        /*
+         * Caches the entity models of one type and loads them on a pool of background threads. The files are looked
+         * up and mapped on the calling thread, while reading and parsing them is left to the pool.
+         *
+         * The cache itself must only be used from the main thread. A model which is requested while it is still being
+         * loaded is not loaded a second time; instead, every request is answered by the same load once it has been
+         * collected.
+         */
+        template <class T>
+        class EntityModelManager {
+        private:
+            static const size_t LoaderThreadCount = 2;
+            
+            class LoadTask : public Utility::ThreadPool::Task {
+            private:
+                String m_name;
+                IO::MappedFile::Ptr m_file;
+                T* m_model;
+            protected:
+                void run() {
+                    try {
+                        m_model = new T(m_name, m_file);
+                    } catch (...) {
+                        m_model = NULL;
+                    }
+                }
+            public:
+                LoadTask(const String& name, IO::MappedFile::Ptr file) :
+                m_name(name),
+                m_file(file),
+                m_model(NULL) {}
+                
+                ~LoadTask() {
+                    delete m_model;
+                    m_model = NULL;
+                }
+                
+                inline const String& name() const {
+                    return m_name;
+                }
+                
+                inline T* releaseModel() {
+                    T* model = m_model;
+                    m_model = NULL;
+                    return model;
+                }
+            };
+            
+            /*
+             * If the model has been loaded, the entry holds it. If it is still being loaded, the entry holds the load
+             * task. If both are NULL, the model could not be found or loaded.
+             */
+            class Entry {
+            public:
+                T* model;
+                LoadTask* task;
+                
+                Entry() :
+                model(NULL),
+                task(NULL) {}
+            };
+            
+            typedef std::map<String, Entry> EntryMap;
+            
+            String m_typeName;
+            Utility::ThreadPool* m_loaderPool;
+            EntryMap m_entries;
+            StringList m_loadingKeys;
+            
+            Entry& entry(const String& name, const StringList& paths, Utility::Console& console) {
+                const String pathList = Utility::join(paths, ",");
+                const String key = pathList + ":" + name;
+                
+                typename EntryMap::iterator it = m_entries.find(key);
+                if (it != m_entries.end())
+                    return it->second;
+                
+                console.info("Loading '%s' (searching %s)", name.c_str(), pathList.c_str());
+                
+                Entry& entry = m_entries[key];
+                IO::MappedFile::Ptr file = IO::findGameFile(name, paths);
+                if (file.get() != NULL) {
+                    entry.task = new LoadTask(name, file);
+                    m_loadingKeys.push_back(key);
+                    m_loaderPool->enqueue(*entry.task);
+                } else {
+                    console.warn("Unable to find %s '%s'", m_typeName.c_str(), name.c_str());
+                }
+                return entry;
+            }
+            
+            void finishLoad(Entry& entry, Utility::Console& console) {
+                assert(entry.task != NULL);
+                
+                entry.model = entry.task->releaseModel();
+                if (entry.model == NULL)
+                    console.warn("Unable to load %s '%s'", m_typeName.c_str(), entry.task->name().c_str());
+                delete entry.task;
+                entry.task = NULL;
+            }
+        public:
+            EntityModelManager(const String& typeName) :
+            m_typeName(typeName),
+            m_loaderPool(new Utility::ThreadPool(LoaderThreadCount)) {}
+            
+            virtual ~EntityModelManager() {
+                // stop the workers first so that no task is running when the tasks are deleted
+                delete m_loaderPool;
+                m_loaderPool = NULL;
+                
+                typename EntryMap::iterator it, end;
+                for (it = m_entries.begin(), end = m_entries.end(); it != end; ++it) {
+                    Entry& entry = it->second;
+                    delete entry.task;
+                    delete entry.model;
+                }
+                m_entries.clear();
+                m_loadingKeys.clear();
+            }
+            
+            /*
+             * Returns the model with the given name if it has been loaded. Otherwise, NULL is returned and the given
+             * flag indicates whether the model is still being loaded, in which case it should be requested again once
+             * collectLoadedModels has reported that some loads have finished.
+             */
+            const T* requestModel(const String& name, const StringList& paths, Utility::Console& console, bool& loading) {
+                const Entry& entry = this->entry(name, paths, console);
+                loading = entry.task != NULL;
+                return entry.model;
+            }
+            
+            /*
+             * Returns the model with the given name, waiting for it to be loaded if necessary.
+             */
+            const T* model(const String& name, const StringList& paths, Utility::Console& console) {
+                Entry& entry = this->entry(name, paths, console);
+                if (entry.task != NULL) {
+                    m_loaderPool->wait(*entry.task);
+                    finishLoad(entry, console);
+                }
+                return entry.model;
+            }
+            
+            /*
+             * Takes over the models whose loads have finished since the last call and returns whether there were any.
+             */
+            bool collectLoadedModels(Utility::Console& console) {
+                bool collected = false;
+                size_t i = 0;
+                while (i < m_loadingKeys.size()) {
+                    typename EntryMap::iterator it = m_entries.find(m_loadingKeys[i]);
+                    assert(it != m_entries.end());
+                    
+                    Entry& entry = it->second;
+                    if (entry.task == NULL || m_loaderPool->finished(*entry.task)) {
+                        if (entry.task != NULL)
+                            finishLoad(entry, console);
+                        m_loadingKeys[i] = m_loadingKeys.back();
+                        m_loadingKeys.pop_back();
+                        collected = true;
+                    } else {
+                        i++;
+                    }
+                }
+                return collected;
+            }
+            
+            inline bool loading() const {
+                return !m_loadingKeys.empty();
+            }
+        };
+    }
+}
+
+#endif
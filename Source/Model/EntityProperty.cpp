@@ -19,10 +19,55 @@
 
 #include "EntityProperty.h"
 
+#include <algorithm>
 #include <cassert>
 
 namespace TrenchBroom {
     namespace Model {
+        const PropertyKeyAtom PropertyKeyTable::NoAtom;
+        const unsigned int PropertyStore::NoIndex;
+
+        PropertyKeyTable::PropertyKeyTable() {
+            const char* wellKnownKeys[WellKnownKeyCount] = {
+                "classname",
+                "origin",
+                "angle",
+                "angles",
+                "mangle",
+                "spawnflags",
+                "target",
+                "killtarget",
+                "targetname"
+            };
+
+            for (unsigned int i = 0; i < WellKnownKeyCount; i++) {
+                const Utility::InternedString key(wellKnownKeys[i]);
+                if (key.index() >= m_wellKnownAtoms.size())
+                    m_wellKnownAtoms.resize(key.index() + 1, NoAtom);
+                m_wellKnownAtoms[key.index()] = static_cast<PropertyKeyAtom>(i);
+            }
+        }
+
+        const PropertyKeyTable& PropertyKeyTable::instance() {
+            static const PropertyKeyTable table;
+            return table;
+        }
+
+        PropertyKeyAtom PropertyKeyTable::atom(const Utility::InternedString& key) {
+            const AtomList& wellKnownAtoms = instance().m_wellKnownAtoms;
+            const unsigned int index = key.index();
+            if (index < wellKnownAtoms.size() && wellKnownAtoms[index] != NoAtom)
+                return wellKnownAtoms[index];
+            return static_cast<PropertyKeyAtom>(WellKnownKeyCount + index);
+        }
+
+        PropertyKeyAtom PropertyKeyTable::findAtom(const PropertyKey& key) {
+            Utility::InternedString internedKey;
+            if (!Utility::InternedString::find(key, internedKey))
+                return NoAtom;
+            return atom(internedKey);
+        }
+
         bool PropertyStore::hasDuplicates() const {
             PropertyKeySet keys;
             PropertyList::const_iterator propIt, propEnd;
@@ -35,52 +80,105 @@ namespace TrenchBroom {
             return false;
         }
 
+        void PropertyStore::indexProperty(unsigned int index) {
+            const PropertyKeyAtom atom = m_properties[index].atom();
+            if (PropertyKeyTable::wellKnown(atom)) {
+                m_slots[atom] = index;
+                return;
+            }
+
+            m_otherKeyCount++;
+            if (m_index.empty() && m_otherKeyCount < MinIndexedKeyCount)
+                return;
+
+            if (2 * m_otherKeyCount > m_index.size()) {
+                rebuildIndex();
+                return;
+            }
+
+            const size_t mask = m_index.size() - 1;
+            size_t bucket = PropertyKeyTable::hashAtom(atom) & mask;
+            while (m_index[bucket] != NoIndex)
+                bucket = (bucket + 1) & mask;
+            m_index[bucket] = index;
+        }
+
+        void PropertyStore::rebuildIndex() {
+            std::fill(m_slots, m_slots + PropertyKeyTable::WellKnownKeyCount, NoIndex);
+            m_otherKeyCount = 0;
+            for (unsigned int i = 0; i < m_properties.size(); i++) {
+                const PropertyKeyAtom atom = m_properties[i].atom();
+                if (PropertyKeyTable::wellKnown(atom))
+                    m_slots[atom] = i;
+                else
+                    m_otherKeyCount++;
+            }
+
+            m_index.clear();
+            if (m_otherKeyCount < MinIndexedKeyCount)
+                return;
+
+            size_t size = 16;
+            while (size < 2 * m_otherKeyCount)
+                size *= 2;
+            m_index.resize(size, NoIndex);
+
+            const size_t mask = size - 1;
+            for (unsigned int i = 0; i < m_properties.size(); i++) {
+                const PropertyKeyAtom atom = m_properties[i].atom();
+                if (!PropertyKeyTable::wellKnown(atom)) {
+                    size_t bucket = PropertyKeyTable::hashAtom(atom) & mask;
+                    while (m_index[bucket] != NoIndex)
+                        bucket = (bucket + 1) & mask;
+                    m_index[bucket] = i;
+                }
+            }
+        }
+
+        PropertyStore::PropertyStore() :
+        m_otherKeyCount(0) {
+            std::fill(m_slots, m_slots + PropertyKeyTable::WellKnownKeyCount, NoIndex);
+        }
+
         bool PropertyStore::setPropertyKey(const PropertyKey& oldKey, const PropertyKey& newKey) {
             if (containsProperty(newKey))
                 return false;
             
-            PropertyList::iterator it, end;
-            for (it = m_properties.begin(), end = m_properties.end(); it != end; ++it) {
-                Property& property = *it;
-                if (property.key() == oldKey) {
-                    property.setKey(newKey);
-                    assert(!hasDuplicates());
-                    return true;
-                }
-            }
-            
-            return false;
+            const unsigned int index = findIndex(oldKey);
+            if (index == NoIndex)
+                return false;
+
+            m_properties[index].setKey(newKey);
+            rebuildIndex();
+            assert(!hasDuplicates());
+            return true;
         }
 
         void PropertyStore::setPropertyValue(const PropertyKey& key, const PropertyValue& value) {
-            PropertyList::iterator it, end;
-            for (it = m_properties.begin(), end = m_properties.end(); it != end; ++it) {
-                Property& property = *it;
-                if (property.key() == key) {
-                    property.setValue(value);
-                    return;
-                }
+            const unsigned int index = findIndex(key);
+            if (index != NoIndex) {
+                m_properties[index].setValue(value);
+                return;
             }
             
             m_properties.push_back(Property(key, value));
+            indexProperty(static_cast<unsigned int>(m_properties.size() - 1));
             assert(!hasDuplicates());
         }
         
         bool PropertyStore::removeProperty(const PropertyKey& key) {
-            PropertyList::iterator it, end;
-            for (it = m_properties.begin(), end = m_properties.end(); it != end; ++it) {
-                Property& property = *it;
-                if (property.key() == key) {
-                    m_properties.erase(it);
-                    return true;
-                }
-            }
-            
-            return false;
+            const unsigned int index = findIndex(key);
+            if (index == NoIndex)
+                return false;
+
+            m_properties.erase(m_properties.begin() + index);
+            rebuildIndex();
+            return true;
         }
 
         void PropertyStore::clear() {
             m_properties.clear();
+            rebuildIndex();
         }
     }
 }
@@ -20,6 +20,7 @@
 #ifndef __TrenchBroom__EntityProperty__
 #define __TrenchBroom__EntityProperty__
 
+#include "Utility/InternedString.h"
 #include "Utility/String.h"
 
 #include <map>
@@ -35,9 +36,60 @@ namespace TrenchBroom {
         typedef std::pair<PropertyKeySet::iterator, bool> PropertyKeySetInsertResult;
         typedef std::vector<PropertyValue> PropertyValueList;
 
+        typedef unsigned int PropertyKeyAtom;
+
+        /*
+         * Derives integer atoms from property keys interned in the process wide string table, so that keys can be
+         * compared and hashed as integers. The keys that the editor looks up all the time always receive the atoms
+         * listed in WellKnownKey, in that order; all other keys are numbered after them by their string index. The
+         * table is immutable once it has been created, so atoms can be derived on any thread.
+         */
+        class PropertyKeyTable {
+        public:
+            typedef enum {
+                ClassnameAtom = 0,
+                OriginAtom,
+                AngleAtom,
+                AnglesAtom,
+                MangleAtom,
+                SpawnFlagsAtom,
+                TargetAtom,
+                KillTargetAtom,
+                TargetnameAtom,
+                WellKnownKeyCount
+            } WellKnownKey;
+
+            static const PropertyKeyAtom NoAtom = 0xFFFFFFFF;
+        private:
+            typedef std::vector<PropertyKeyAtom> AtomList;
+
+            // the atoms of the well known keys, indexed by their string index, and NoAtom for all other strings
+            AtomList m_wellKnownAtoms;
+
+            PropertyKeyTable();
+
+            static const PropertyKeyTable& instance();
+        public:
+            static PropertyKeyAtom atom(const Utility::InternedString& key);
+
+            /*
+             * Returns the atom for the given key or NoAtom if the key was never interned. No property store can
+             * contain a key without an atom.
+             */
+            static PropertyKeyAtom findAtom(const PropertyKey& key);
+
+            static inline bool wellKnown(PropertyKeyAtom atom) {
+                return atom < WellKnownKeyCount;
+            }
+
+            static inline size_t hashAtom(PropertyKeyAtom atom) {
+                return static_cast<size_t>(atom * 2654435761u);
+            }
+        };
+
         class Property {
         private:
-            PropertyKey m_key;
+            Utility::InternedString m_key;
             PropertyValue m_value;
         public:
             Property() {}
@@ -47,11 +99,19 @@ namespace TrenchBroom {
             m_value(value) {}
             
             inline const PropertyKey& key() const {
+                return m_key.str();
+            }
+            
+            inline const Utility::InternedString& internedKey() const {
                 return m_key;
             }
             
+            inline PropertyKeyAtom atom() const {
+                return PropertyKeyTable::atom(m_key);
+            }
+            
             inline void setKey(const PropertyKey& key) {
-                m_key = key;
+                m_key = Utility::InternedString(key);
             }
             
             inline const PropertyValue& value() const {
@@ -69,34 +129,107 @@ namespace TrenchBroom {
         typedef std::map<PropertyKey, Property> PropertyMap;
         static const PropertyMap EmptyPropertyMap;
         
+        /*
+         * Stores the properties of an entity in insertion order. Each property's key is interned, and lookups go
+         * through a slot table for the well known keys and through a small open addressing index for all other keys.
+         * Entities with only a few other keys are searched linearly by atom since that is faster than hashing.
+         */
         class PropertyStore {
         private:
+            typedef std::vector<unsigned int> IndexList;
+
+            static const unsigned int NoIndex = 0xFFFFFFFF;
+            static const size_t MinIndexedKeyCount = 8;
+
             PropertyList m_properties;
-            
+            unsigned int m_slots[PropertyKeyTable::WellKnownKeyCount];
+            IndexList m_index;
+            size_t m_otherKeyCount;
+
             bool hasDuplicates() const;
-        public:
-            inline bool containsProperty(const PropertyKey& key) const {
-                PropertyList::const_iterator it, end;
-                for (it = m_properties.begin(), end = m_properties.end(); it != end; ++it) {
-                    const Property& property = *it;
-                    if (property.key() == key)
-                        return true;
+
+            inline unsigned int findIndex(PropertyKeyAtom atom) const {
+                if (PropertyKeyTable::wellKnown(atom))
+                    return m_slots[atom];
+
+                if (m_index.empty()) {
+                    for (unsigned int i = 0; i < m_properties.size(); i++)
+                        if (m_properties[i].atom() == atom)
+                            return i;
+                    return NoIndex;
                 }
+
+                const size_t mask = m_index.size() - 1;
+                size_t bucket = PropertyKeyTable::hashAtom(atom) & mask;
+                while (m_index[bucket] != NoIndex) {
+                    if (m_properties[m_index[bucket]].atom() == atom)
+                        return m_index[bucket];
+                    bucket = (bucket + 1) & mask;
+                }
+                return NoIndex;
+            }
+
+            // compares the interned keys instead of deriving the atom of every property that is visited
+            inline unsigned int findIndex(const PropertyKey& key) const {
+                Utility::InternedString internedKey;
+                if (!Utility::InternedString::find(key, internedKey))
+                    return NoIndex;
                 
-                return false;
+                const PropertyKeyAtom atom = PropertyKeyTable::atom(internedKey);
+                if (PropertyKeyTable::wellKnown(atom))
+                    return m_slots[atom];
+
+                if (m_index.empty()) {
+                    for (unsigned int i = 0; i < m_properties.size(); i++)
+                        if (m_properties[i].internedKey() == internedKey)
+                            return i;
+                    return NoIndex;
+                }
+
+                const size_t mask = m_index.size() - 1;
+                size_t bucket = PropertyKeyTable::hashAtom(atom) & mask;
+                while (m_index[bucket] != NoIndex) {
+                    if (m_properties[m_index[bucket]].internedKey() == internedKey)
+                        return m_index[bucket];
+                    bucket = (bucket + 1) & mask;
+                }
+                return NoIndex;
+            }
+
+            void indexProperty(unsigned int index);
+            void rebuildIndex();
+        public:
+            PropertyStore();
+
+            inline bool containsProperty(PropertyKeyAtom atom) const {
+                return findIndex(atom) != NoIndex;
+            }
+
+            inline bool containsProperty(const PropertyKey& key) const {
+                return findIndex(key) != NoIndex;
+            }
+
+            inline const Property* property(PropertyKeyAtom atom) const {
+                const unsigned int index = findIndex(atom);
+                if (index == NoIndex)
+                    return NULL;
+                return &m_properties[index];
             }
 
             inline const Property* property(const PropertyKey& key) const {
-                PropertyList::const_iterator it, end;
-                for (it = m_properties.begin(), end = m_properties.end(); it != end; ++it) {
-                    const Property& property = *it;
-                    if (property.key() == key)
-                        return &property;
-                }
-                
-                return NULL;
+                const unsigned int index = findIndex(key);
+                if (index == NoIndex)
+                    return NULL;
+                return &m_properties[index];
             }
-            
+
+            inline const PropertyValue* propertyValue(PropertyKeyAtom atom) const {
+                const Property* prop = property(atom);
+                if (prop == NULL)
+                    return NULL;
+                return &prop->value();
+            }
+
             inline const PropertyValue* propertyValue(const PropertyKey& key) const {
                 const Property* prop = property(key);
                 if (prop == NULL)
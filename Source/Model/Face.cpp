@@ -22,6 +22,7 @@
 #include "Model/Brush.h"
 #include "Model/BrushGeometry.h"
 #include "Model/Texture.h"
+#include "Utility/Atomic.h"
 
 namespace TrenchBroom {
     namespace Model {
@@ -98,8 +99,8 @@ namespace TrenchBroom {
         };
         
         void Face::init() {
-            static unsigned int currentId = 1;
-            m_faceId = currentId++;
+            static volatile unsigned int currentId = 0;
+            m_faceId = Utility::atomicIncrement(currentId);
             for (size_t i = 0; i < 3; i++)
                 m_points[i] = Vec3f::Null;
             m_xOffset = 0.0f;
@@ -332,16 +333,17 @@ namespace TrenchBroom {
         }
         
         void Face::updateContentType() {
-            if (!m_textureName.empty()) {
-                if (m_textureName[0] == '*')
+            const String& textureName = m_textureName.str();
+            if (!textureName.empty()) {
+                if (textureName[0] == '*')
                     m_contentType = CTLiquid;
-                else if (Utility::containsString(m_textureName, "clip", false))
+                else if (Utility::containsString(textureName, "clip", false))
                     m_contentType = CTClip;
-                else if (Utility::containsString(m_textureName, "skip", false))
+                else if (Utility::containsString(textureName, "skip", false))
                     m_contentType = CTSkip;
-                else if (Utility::containsString(m_textureName, "hint", false))
+                else if (Utility::containsString(textureName, "hint", false))
                     m_contentType = CTHint;
-                else if (Utility::containsString(m_textureName, "trigger", false))
+                else if (Utility::containsString(textureName, "trigger", false))
                     m_contentType = CTTrigger;
                 else
                     m_contentType = CTDefault;
@@ -350,16 +352,28 @@ namespace TrenchBroom {
             }
         }
 
-        Face::Face(const BBoxf& worldBounds, bool forceIntegerFacePoints, const Vec3f& point1, const Vec3f& point2, const Vec3f& point3, const String& textureName) : m_worldBounds(worldBounds), m_textureName(textureName) {
-            init();
-            m_worldBounds = worldBounds;
-            m_forceIntegerFacePoints = forceIntegerFacePoints;
+        void Face::initPoints(const Vec3f& point1, const Vec3f& point2, const Vec3f& point3) {
             m_points[0] = point1;
             m_points[1] = point2;
             m_points[2] = point3;
             correctFacePoints();
             m_boundary.setPoints(m_points[0], m_points[1], m_points[2]);
             updatePointsFromBoundary();
+        }
+
+        Face::Face(const BBoxf& worldBounds, bool forceIntegerFacePoints, const Vec3f& point1, const Vec3f& point2, const Vec3f& point3, const String& textureName) : m_worldBounds(worldBounds) {
+            init();
+            m_worldBounds = worldBounds;
+            m_forceIntegerFacePoints = forceIntegerFacePoints;
+            initPoints(point1, point2, point3);
+            setTextureName(textureName);
+        }
+        
+        Face::Face(const BBoxf& worldBounds, bool forceIntegerFacePoints, const Vec3f& point1, const Vec3f& point2, const Vec3f& point3, const Utility::InternedString& textureName) : m_worldBounds(worldBounds) {
+            init();
+            m_worldBounds = worldBounds;
+            m_forceIntegerFacePoints = forceIntegerFacePoints;
+            initPoints(point1, point2, point3);
             setTextureName(textureName);
         }
         
@@ -376,7 +390,7 @@ namespace TrenchBroom {
         m_boundary(face.boundary()),
         m_worldBounds(face.worldBounds()),
         m_forceIntegerFacePoints(face.forceIntegerFacePoints()),
-        m_textureName(face.textureName()),
+        m_textureName(face.internedTextureName()),
         m_texture(face.texture()),
         m_xOffset(face.xOffset()),
         m_yOffset(face.yOffset()),
@@ -392,6 +406,29 @@ namespace TrenchBroom {
             updatePointsFromBoundary();
         }
         
+        Face::Face(const BBoxf& worldBounds, bool forceIntegerFacePoints, unsigned int faceId, const Planef& boundary, const FacePoints& points) :
+        m_side(NULL),
+        m_worldBounds(worldBounds) {
+            init();
+            m_faceId = faceId;
+            m_forceIntegerFacePoints = forceIntegerFacePoints;
+            m_boundary = boundary;
+            for (size_t i = 0; i < 3; i++)
+                m_points[i] = points[i];
+            updatePointsFromBoundary();
+        }
+        
+        Face::Face(const BBoxf& worldBounds, bool forceIntegerFacePoints, const FacePoints& points, const Planef& boundary, const Utility::InternedString& textureName) :
+        m_side(NULL),
+        m_worldBounds(worldBounds) {
+            init();
+            m_forceIntegerFacePoints = forceIntegerFacePoints;
+            m_boundary = boundary;
+            for (size_t i = 0; i < 3; i++)
+                m_points[i] = points[i];
+            setTextureName(textureName);
+        }
+        
 		Face::~Face() {
 			m_texPlanefNormIndex = 0;
 			m_texFaceNormIndex = 0;
@@ -429,6 +466,7 @@ namespace TrenchBroom {
             m_rotation = faceTemplate.rotation();
             m_xScale = faceTemplate.xScale();
             m_yScale = faceTemplate.yScale();
+            m_textureName = faceTemplate.internedTextureName();
             setTexture(faceTemplate.texture());
             m_texAxesValid = false;
             m_vertexCacheValid = false;
@@ -448,17 +486,25 @@ namespace TrenchBroom {
         }
         
         void Face::updatePointsFromVertices() {
+            Vec3f::List positions;
+            positions.reserve(m_side->vertices.size());
+            for (size_t i = 0; i < m_side->vertices.size(); i++)
+                positions.push_back(m_side->vertices[i]->position);
+            updatePointsFromVertices(positions);
+        }
+        
+        void Face::updatePointsFromVertices(const Vec3f::List& vertices) {
             Vec3f v1, v2;
             
-            const size_t vertexCount = m_side->vertices.size();
+            const size_t vertexCount = vertices.size();
             assert(vertexCount >= 3);
 
             float bestDot = 1.0f;
             size_t best = vertexCount;
             for (unsigned int i = 0; i < vertexCount && bestDot > 0; i++) {
-                m_points[2] = m_side->vertices[pred(i, vertexCount)]->position;
-                m_points[0] = m_side->vertices[i]->position;
-                m_points[1] = m_side->vertices[succ(i, vertexCount)]->position;
+                m_points[2] = vertices[pred(i, vertexCount)];
+                m_points[0] = vertices[i];
+                m_points[1] = vertices[succ(i, vertexCount)];
                 
                 v1 = (m_points[2] - m_points[0]).normalized();
                 v2 = (m_points[1] - m_points[0]).normalized();
@@ -469,9 +515,9 @@ namespace TrenchBroom {
                 }
             }
             
-            m_points[2] = m_side->vertices[pred(best, vertexCount)]->position;
-            m_points[0] = m_side->vertices[best]->position;
-            m_points[1] = m_side->vertices[succ(best, vertexCount)]->position;
+            m_points[2] = vertices[pred(best, vertexCount)];
+            m_points[0] = vertices[best];
+            m_points[1] = vertices[succ(best, vertexCount)];
             correctFacePoints();
             
             if (!m_boundary.setPoints(m_points[0], m_points[1], m_points[2])) {
@@ -519,13 +565,11 @@ namespace TrenchBroom {
                 m_texture->decUsageCount();
             
             m_texture = texture;
-            if (m_texture != NULL)
-                m_textureName = texture->name();
-            
-            if (m_texture != NULL)
+            if (m_texture != NULL) {
                 m_texture->incUsageCount();
+                setTextureName(m_texture->internedName());
+            }
             m_vertexCacheValid = false;
-            updateContentType();
         }
         
         void Face::moveTexture(const Vec3f& up, const Vec3f& right, Direction direction, float distance) {
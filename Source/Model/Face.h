@@ -25,6 +25,7 @@
 #include "Renderer/FaceVertex.h"
 #include "Utility/Allocator.h"
 #include "Utility/FindPlanePoints.h"
+#include "Utility/InternedString.h"
 #include "Utility/String.h"
 #include "Utility/VecMath.h"
 
@@ -115,7 +116,7 @@ namespace TrenchBroom {
             BBoxf m_worldBounds;
             bool m_forceIntegerFacePoints;
 
-            String m_textureName;
+            Utility::InternedString m_textureName;
             Texture* m_texture;
             float m_xOffset;
             float m_yOffset;
@@ -147,6 +148,7 @@ namespace TrenchBroom {
             }
 
             void init();
+            void initPoints(const Vec3f& point1, const Vec3f& point2, const Vec3f& point3);
             void texAxesAndIndices(const Vec3f& faceNormal, Vec3f& xAxis, Vec3f& yAxis, unsigned int& planeNormIndex, unsigned int& faceNormIndex) const;
             void validateTexAxes(const Vec3f& faceNormal) const;
             void validateVertexCache() const;
@@ -156,8 +158,19 @@ namespace TrenchBroom {
             void updateContentType();
         public:
             Face(const BBoxf& worldBounds, bool forceIntegerFacePoints, const Vec3f& point1, const Vec3f& point2, const Vec3f& point3, const String& textureName);
+            Face(const BBoxf& worldBounds, bool forceIntegerFacePoints, const Vec3f& point1, const Vec3f& point2, const Vec3f& point3, const Utility::InternedString& textureName);
             Face(const BBoxf& worldBounds, bool forceIntegerFacePoints, const Face& faceTemplate);
             Face(const Face& face);
+            
+            /*
+             * Recreates a face from an undo snapshot. The texture and its attributes must be set separately.
+             */
+            Face(const BBoxf& worldBounds, bool forceIntegerFacePoints, unsigned int faceId, const Planef& boundary, const FacePoints& points);
+            
+            /*
+             * Recreates a face from the map cache. The points and the boundary are used as they are.
+             */
+            Face(const BBoxf& worldBounds, bool forceIntegerFacePoints, const FacePoints& points, const Planef& boundary, const Utility::InternedString& textureName);
 			~Face();
 
             void restore(const Face& faceTemplate);
@@ -186,6 +199,7 @@ namespace TrenchBroom {
             }
 
             void updatePointsFromVertices();
+            void updatePointsFromVertices(const Vec3f::List& vertices);
             void updatePointsFromBoundary();
 
             inline void getPoints(Vec3f& point1, Vec3f& point2, Vec3f& point3) const {
@@ -232,10 +246,20 @@ namespace TrenchBroom {
             }
             
             inline const String& textureName() const {
+                return m_textureName.str();
+            }
+
+            inline const Utility::InternedString& internedTextureName() const {
                 return m_textureName;
             }
 
             inline void setTextureName(const String& textureName) {
+                setTextureName(Utility::InternedString(textureName));
+            }
+
+            inline void setTextureName(const Utility::InternedString& textureName) {
+                if (textureName == m_textureName)
+                    return;
                 m_textureName = textureName;
                 updateContentType();
             }
@@ -310,7 +334,7 @@ namespace TrenchBroom {
                 setXOffset(face.xOffset());
                 setYOffset(face.yOffset());
                 setRotation(face.rotation());
-                setTextureName(face.textureName());
+                setTextureName(face.internedTextureName());
                 setTexture(face.texture());
             }
 
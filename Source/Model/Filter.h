@@ -97,7 +97,7 @@ namespace TrenchBroom {
                     const Model::PropertyList& properties = entity.properties();
                     Model::PropertyList::const_iterator it, end;
                     for (it = properties.begin(), end = properties.end(); it != end; ++it) {
-                        const Model::Property property = *it;
+                        const Model::Property& property = *it;
                         if (Utility::containsString(property.key(), pattern, false) ||
                             Utility::containsString(property.value(), pattern, false))
                             return true;
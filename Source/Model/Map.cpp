@@ -131,7 +131,7 @@ namespace TrenchBroom {
         void Map::addEntity(Entity& entity) {
             if (!entity.worldspawn() || worldspawn() == NULL) {
                 m_entities.push_back(&entity);
-                addEntityTargetname(entity, entity.propertyForKey(Entity::TargetnameKey));
+                addEntityTargetname(entity, entity.propertyForKey(PropertyKeyTable::TargetnameAtom));
                 addEntityTargets(entity);
                 addEntityKillTargets(entity);
                 entity.setMap(this);
@@ -142,7 +142,7 @@ namespace TrenchBroom {
             if (entity.worldspawn())
                 m_worldspawn = NULL;
             entity.setMap(NULL);
-            removeEntityTargetname(entity, entity.propertyForKey(Entity::TargetnameKey));
+            removeEntityTargetname(entity, entity.propertyForKey(PropertyKeyTable::TargetnameAtom));
             removeEntityTargets(entity);
             removeEntityKillTargets(entity);
             Utility::erase(m_entities, &entity);
@@ -20,35 +20,42 @@
 #include "MapDocument.h"
 
 #include "Controller/Autosaver.h"
+#include "Controller/BrushSnapshot.h"
 #include "Controller/Command.h"
 #include "IO/FileManager.h"
 #include "IO/IOException.h"
+#include "IO/MapCache.h"
 #include "IO/MapParser.h"
 #include "IO/MapWriter.h"
+#include "IO/Pak.h"
 #include "IO/Wad.h"
 #include "Model/Brush.h"
+#include "Model/Bvh.h"
+#include "Model/ConvexVolume.h"
 #include "Model/EditStateManager.h"
 #include "Model/Entity.h"
 #include "Model/EntityDefinitionManager.h"
 #include "Model/Face.h"
 #include "Model/Map.h"
-#include "Model/Octree.h"
 #include "Model/Picker.h"
 #include "Model/PointFile.h"
 #include "Model/TextureManager.h"
 #include "Renderer/SharedResources.h"
 #include "Renderer/TextureRendererManager.h"
+#include "Utility/CommandProcessor.h"
 #include "Utility/Console.h"
 #include "Utility/Grid.h"
 #include "Utility/List.h"
 #include "Utility/Preferences.h"
 #include "Utility/String.h"
+#include "Utility/ThreadPool.h"
 #include "Utility/VecMath.h"
 #include "View/EditorView.h"
 #include "View/FaceInspector.h"
 #include "View/Inspector.h"
 #include "View/ProgressIndicatorDialog.h"
 
+#include <algorithm>
 #include <cassert>
 
 #include <wx/msgdlg.h>
@@ -76,7 +83,7 @@ namespace TrenchBroom {
                 console().info("Loading file %s", file.mbc_str().data());
                 
                 View::ProgressIndicatorDialog progressIndicator;
-                loadMap(mappedFile->begin(), mappedFile->end(), progressIndicator);
+                loadMap(path, mappedFile->begin(), mappedFile->end(), progressIndicator);
                 loadTextures();
                 loadEntityDefinitionFile();
 
@@ -98,7 +105,7 @@ namespace TrenchBroom {
             try {
                 wxStopWatch watch;
                 IO::MapWriter mapWriter;
-                mapWriter.writeToFileAtPath(*m_map, file.ToStdString(), true);
+                mapWriter.writeToFileAtPath(*m_map, file.ToStdString(), true, m_threadPool);
                 console().info("Saved map file to %s in %f seconds", file.ToStdString().c_str(), watch.Time() / 1000.0f);
                 return true;
             } catch (IO::IOException& e) {
@@ -111,7 +118,7 @@ namespace TrenchBroom {
             m_sharedResources->textureRendererManager().invalidate();
             m_editStateManager->clear();
             m_map->clear();
-            m_octree->clear();
+            m_bvh->clear();
             m_textureManager->clear();
             m_definitionManager->clear();
             unloadPointFile();
@@ -128,14 +135,30 @@ namespace TrenchBroom {
             m_sharedResources->loadPalette(palettePath);
         }
 
-        void MapDocument::loadMap(char* begin, char* end, Utility::ProgressIndicator& progressIndicator) {
+        void MapDocument::loadMap(const String& path, char* begin, char* end, Utility::ProgressIndicator& progressIndicator) {
             progressIndicator.setText("Loading map file...");
             
             wxStopWatch watch;
-            IO::MapParser parser(begin, end, console());
-            parser.parseMap(*m_map, &progressIndicator);
+            if (!Preferences::PreferenceManager::preferences().getBool(Preferences::MapCacheEnabled)) {
+                IO::MapParser parser(begin, end, console());
+                parser.parseMap(*m_map, &progressIndicator, m_threadPool);
+                console().info("Loaded map file in %f seconds", watch.Time() / 1000.0f);
+                return;
+            }
+            
+            IO::MapCache cache(path, begin, end);
+            if (cache.loadMap(*m_map)) {
+                console().info("Loaded map file from cache in %f seconds", watch.Time() / 1000.0f);
+                return;
+            }
             
+            IO::MapParser parser(begin, end, console());
+            const bool complete = parser.parseMap(*m_map, &progressIndicator, m_threadPool);
             console().info("Loaded map file in %f seconds", watch.Time() / 1000.0f);
+            
+            // a partially loaded map is not cached so that the error is reported again when the map is reopened
+            if (complete && !cache.write(*m_map))
+                console().warn("Could not write map cache");
         }
 
         void MapDocument::setAllTexturesToNull() {
@@ -158,7 +181,7 @@ namespace TrenchBroom {
                 for (size_t j = 0; j < brushes.size(); j++) {
                     const Model::FaceList& faces = brushes[j]->faces();
                     for (size_t k = 0; k < faces.size(); k++) {
-                        const String& textureName = faces[k]->textureName();
+                        const Utility::InternedString& textureName = faces[k]->internedTextureName();
                         Model::Texture* newTexture = m_textureManager->texture(textureName);
                         faces[k]->setTexture(newTexture);
                     }
@@ -169,11 +192,69 @@ namespace TrenchBroom {
                 setMruTexture(NULL);
         }
         
-        void MapDocument::loadTextureWad(const String& path) {
-            const size_t index = m_textureManager->collections().size();
+        class MapDocument::LoadTextureCollectionTask : public Utility::ThreadPool::Task {
+        private:
+            String m_name;
+            String m_path;
+            TextureCollection* m_collection;
+            String m_error;
+        protected:
+            void run() {
+                try {
+                    m_collection = new TextureCollection(m_name, m_path);
+                } catch (IO::IOException& e) {
+                    m_error = e.what();
+                }
+            }
+        public:
+            LoadTextureCollectionTask(const String& name, const String& path) :
+            m_name(name),
+            m_path(path),
+            m_collection(NULL) {}
+            
+            inline const String& path() const {
+                return m_path;
+            }
+            
+            inline TextureCollection* collection() const {
+                return m_collection;
+            }
+            
+            inline const String& error() const {
+                return m_error;
+            }
+        };
+        
+        class MapDocument::VolumeQueryTask : public Utility::ThreadPool::Task {
+        private:
+            const ConvexVolume& m_volume;
+            bool m_containment;
+            const BrushList& m_candidates;
+            size_t m_first;
+            size_t m_count;
+            std::vector<char>& m_matches;
+        protected:
+            void run() {
+                ConvexVolume candidate;
+                for (size_t i = m_first; i < m_first + m_count; i++) {
+                    candidate.set(*m_candidates[i]);
+                    m_matches[i] = m_containment ? m_volume.contains(candidate) : m_volume.intersects(candidate);
+                }
+            }
+        public:
+            VolumeQueryTask(const ConvexVolume& volume, bool containment, const BrushList& candidates, size_t first, size_t count, std::vector<char>& matches) :
+            m_volume(volume),
+            m_containment(containment),
+            m_candidates(candidates),
+            m_first(first),
+            m_count(count),
+            m_matches(matches) {}
+        };
+        
+        bool MapDocument::resolveTextureWadPath(const String& path, String& wadPath) {
             IO::FileManager fileManager;
             
-            String wadPath = path;
+            wadPath = path;
             if (!fileManager.isAbsolutePath(wadPath)) {
                 Preferences::PreferenceManager& prefs = Preferences::PreferenceManager::preferences();
                 
@@ -184,33 +265,27 @@ namespace TrenchBroom {
                 
                 if (!fileManager.resolveRelativePath(path, rootPaths, wadPath)) {
                     console().error("Could not open texture wad %s (tried relative to current map file, TrenchBroom executable, and Quake path)", path.c_str());
-                    return;
+                    return false;
                 }
             }
             
-            if (fileManager.exists(wadPath)) {
-                Model::TextureCollection* collection = NULL;
-                try {
-                    collection = new Model::TextureCollection(path, wadPath);
-                    m_textureManager->addCollection(collection, index);
-                } catch (IO::IOException& e) {
-                    delete collection;
-                    collection = NULL;
-                    console().error("Could not open texture wad %s: %s", wadPath.c_str(), e.what());
-                }
-            } else {
+            if (!fileManager.exists(wadPath)) {
                 console().error("Could not open texture wad %s", wadPath.c_str());
+                return false;
             }
+            return true;
         }
         
         MapDocument::MapDocument() :
         m_autosaver(NULL),
         m_autosaveTimer(NULL),
+        m_brushSnapshotStore(NULL),
         m_console(NULL),
+        m_threadPool(NULL),
         m_sharedResources(NULL),
         m_map(NULL),
         m_editStateManager(NULL),
-        m_octree(NULL),
+        m_bvh(NULL),
         m_picker(NULL),
         m_textureManager(NULL),
         m_definitionManager(NULL),
@@ -227,10 +302,12 @@ namespace TrenchBroom {
             m_autosaveTimer = NULL;
             delete m_autosaver;
             m_autosaver = NULL;
+            delete m_brushSnapshotStore;
+            m_brushSnapshotStore = NULL;
             delete m_picker;
             m_picker = NULL;
-            delete m_octree;
-            m_octree = NULL;
+            delete m_bvh;
+            m_bvh = NULL;
             delete m_editStateManager;
             m_editStateManager = NULL;
             delete m_map;
@@ -241,8 +318,11 @@ namespace TrenchBroom {
             m_textureManager = NULL;
             delete m_grid;
             m_grid = NULL;
+            m_sharedResources->textureRendererManager().setThreadPool(NULL);
             m_sharedResources->Destroy(); // makes sure that the resources are deleted after the last frame
             m_sharedResources = NULL;
+            delete m_threadPool;
+            m_threadPool = NULL;
             delete m_console;
             m_console = NULL;
         }
@@ -298,41 +378,41 @@ namespace TrenchBroom {
                     entity.setDefinition(definition);
             }
             m_map->addEntity(entity);
-            m_octree->addObject(entity);
+            m_bvh->addObject(entity);
 
             const Model::BrushList& brushes = entity.brushes();
             Model::BrushList::const_iterator brushIt, brushEnd;
             for (brushIt = brushes.begin(), brushEnd = brushes.end(); brushIt != brushEnd; ++brushIt) {
                 Model::Brush& brush = **brushIt;
-                m_octree->addObject(brush);
+                m_bvh->addObject(brush);
 
                 const FaceList& faces = brush.faces();
                 FaceList::const_iterator faceIt, faceEnd;
                 for (faceIt = faces.begin(), faceEnd = faces.end(); faceIt != faceEnd; ++faceIt) {
                     Face& face = **faceIt;
-                    face.setTexture(m_textureManager->texture(face.textureName()));
+                    face.setTexture(m_textureManager->texture(face.internedTextureName()));
                 }
             }
         }
 
         void MapDocument::entityWillChange(Entity& entity) {
-            m_octree->removeObject(entity);
+            m_bvh->removeObject(entity);
         }
 
         void MapDocument::entityDidChange(Entity& entity) {
-            m_octree->addObject(entity);
+            m_bvh->addObject(entity);
         }
 
         void MapDocument::entitiesWillChange(const EntityList& entities) {
             MapObjectList objects;
             objects.insert(objects.begin(), entities.begin(), entities.end());
-            m_octree->removeObjects(objects);
+            m_bvh->removeObjects(objects);
         }
 
         void MapDocument::entitiesDidChange(const EntityList& entities) {
             MapObjectList objects;
             objects.insert(objects.begin(), entities.begin(), entities.end());
-            m_octree->addObjects(objects);
+            m_bvh->addObjects(objects);
         }
 
         void MapDocument::removeEntity(Entity& entity) {
@@ -340,39 +420,39 @@ namespace TrenchBroom {
             Model::BrushList::const_iterator brushIt, brushEnd;
             for (brushIt = brushes.begin(), brushEnd = brushes.end(); brushIt != brushEnd; ++brushIt) {
                 Model::Brush& brush = **brushIt;
-                m_octree->removeObject(brush);
+                m_bvh->removeObject(brush);
             }
 
-            m_octree->removeObject(entity);
+            m_bvh->removeObject(entity);
             m_map->removeEntity(entity);
             entity.setDefinition(NULL);
         }
 
         void MapDocument::addBrush(Entity& entity, Brush& brush) {
             if (!entity.worldspawn())
-                m_octree->removeObject(entity);
+                m_bvh->removeObject(entity);
             entity.addBrush(brush);
-            m_octree->addObject(brush);
+            m_bvh->addObject(brush);
             if (!entity.worldspawn())
-                m_octree->addObject(entity);
+                m_bvh->addObject(entity);
 
             const FaceList& faces = brush.faces();
             FaceList::const_iterator faceIt, faceEnd;
             for (faceIt = faces.begin(), faceEnd = faces.end(); faceIt != faceEnd; ++faceIt) {
                 Face& face = **faceIt;
-                face.setTexture(m_textureManager->texture(face.textureName()));
+                face.setTexture(m_textureManager->texture(face.internedTextureName()));
             }
         }
 
         void MapDocument::removeBrush(Brush& brush) {
-            m_octree->removeObject(brush);
+            m_bvh->removeObject(brush);
             Entity* entity = brush.entity();
             if (entity != NULL) {
                 if (!entity->worldspawn())
-                    m_octree->removeObject(*entity);
+                    m_bvh->removeObject(*entity);
                 entity->removeBrush(brush);
                 if (!entity->worldspawn())
-                    m_octree->addObject(*entity);
+                    m_bvh->addObject(*entity);
             }
             
             const FaceList& faces = brush.faces();
@@ -386,15 +466,15 @@ namespace TrenchBroom {
         void MapDocument::brushWillChange(Brush& brush) {
             Entity* entity = brush.entity();
             if (entity != NULL && !entity->worldspawn())
-                m_octree->removeObject(*entity);
-            m_octree->removeObject(brush);
+                m_bvh->removeObject(*entity);
+            m_bvh->removeObject(brush);
         }
 
         void MapDocument::brushDidChange(Brush& brush) {
             Entity* entity = brush.entity();
-            m_octree->addObject(brush);
+            m_bvh->addObject(brush);
             if (entity != NULL && !entity->worldspawn())
-                m_octree->addObject(*entity);
+                m_bvh->addObject(*entity);
         }
 
         void MapDocument::brushesWillChange(const BrushList& brushes) {
@@ -409,7 +489,7 @@ namespace TrenchBroom {
                     objects.insert(entity);
             }
             
-            m_octree->removeObjects(Utility::makeList(objects));
+            m_bvh->removeObjects(Utility::makeList(objects));
         }
 
         void MapDocument::brushesDidChange(const BrushList& brushes) {
@@ -424,7 +504,7 @@ namespace TrenchBroom {
                     objects.insert(entity);
             }
 
-            m_octree->addObjects(Utility::makeList(objects));
+            m_bvh->addObjects(Utility::makeList(objects));
         }
 
         void MapDocument::setForceIntegerCoordinates(bool forceIntegerCoordinates) {
@@ -475,6 +555,72 @@ namespace TrenchBroom {
             return *m_grid;
         }
 
+        Utility::ThreadPool& MapDocument::threadPool() const {
+            return *m_threadPool;
+        }
+        
+        Controller::BrushSnapshotStore& MapDocument::brushSnapshotStore() const {
+            return *m_brushSnapshotStore;
+        }
+        
+        void MapDocument::queryVolume(const Brush& brush, bool containment, EntityList& entities, BrushList& brushes) {
+            static const size_t BatchSize = 256;
+            
+            const ConvexVolume volume(brush);
+            const MapObjectList objects = m_bvh->intersect(volume.bounds());
+            
+            BrushList candidates;
+            candidates.reserve(objects.size());
+            MapObjectList::const_iterator it, end;
+            for (it = objects.begin(), end = objects.end(); it != end; ++it) {
+                MapObject& object = **it;
+                if (object.objectType() == MapObject::BrushObject) {
+                    Brush& candidate = static_cast<Brush&>(object);
+                    if (&candidate != &brush)
+                        candidates.push_back(&candidate);
+                }
+            }
+            
+            // the brushes are tested by the workers while the entities are tested here
+            std::vector<char> matches(candidates.size(), 0);
+            std::vector<VolumeQueryTask*> tasks;
+            Utility::ThreadPool::TaskList taskList;
+            for (size_t first = 0; first < candidates.size(); first += BatchSize) {
+                VolumeQueryTask* task = new VolumeQueryTask(volume, containment, candidates, first, std::min(BatchSize, candidates.size() - first), matches);
+                tasks.push_back(task);
+                taskList.push_back(task);
+            }
+            m_threadPool->enqueue(taskList);
+            
+            ConvexVolume candidate;
+            for (it = objects.begin(), end = objects.end(); it != end; ++it) {
+                MapObject& object = **it;
+                if (object.objectType() == MapObject::EntityObject) {
+                    Entity& entity = static_cast<Entity&>(object);
+                    if (entity.brushes().empty()) {
+                        candidate.set(entity.bounds());
+                        if (containment ? volume.contains(candidate) : volume.touches(candidate))
+                            entities.push_back(&entity);
+                    }
+                }
+            }
+            
+            m_threadPool->wait(taskList);
+            Utility::deleteAll(tasks);
+            
+            for (size_t i = 0; i < candidates.size(); i++)
+                if (matches[i])
+                    brushes.push_back(candidates[i]);
+        }
+        
+        void MapDocument::objectsTouching(const Brush& brush, EntityList& entities, BrushList& brushes) {
+            queryVolume(brush, false, entities, brushes);
+        }
+        
+        void MapDocument::objectsInside(const Brush& brush, EntityList& entities, BrushList& brushes) {
+            queryVolume(brush, true, entities, brushes);
+        }
+
         const StringList& MapDocument::searchPaths() const {
             if (!m_searchPathsValid) {
                 m_searchPaths.clear();
@@ -500,6 +646,7 @@ namespace TrenchBroom {
         
         void MapDocument::invalidateSearchPaths() {
             m_searchPathsValid = false;
+            IO::PakManager::sharedManager->invalidate();
         }
 
         bool MapDocument::pointFileExists() {
@@ -577,7 +724,7 @@ namespace TrenchBroom {
                 entity.setDefinition(NULL);
             }
 
-            m_octree->clear();
+            m_bvh->clear();
             
             m_definitionManager->clear();
             m_definitionManager->load(definitionPath);
@@ -591,7 +738,7 @@ namespace TrenchBroom {
                 }
             }
             
-            m_octree->loadMap();
+            m_bvh->loadMap();
         }
 
         void MapDocument::loadTextures() {
@@ -600,12 +747,32 @@ namespace TrenchBroom {
             
             const String* wads = worldspawn().propertyForKey(Entity::WadKey);
             if (wads != NULL) {
+                // the wad directories are read on the worker threads, but the collections are added in order
+                std::vector<LoadTextureCollectionTask*> tasks;
+                Utility::ThreadPool::TaskList taskList;
+                
                 StringList wadPaths = Utility::split(*wads, ';');
                 for (size_t i = 0; i < wadPaths.size(); i++) {
                     const String wadPath = Utility::trim(wadPaths[i]);
-                    if (!wadPath.empty())
-                        loadTextureWad(wadPath);
+                    String resolvedPath;
+                    if (!wadPath.empty() && resolveTextureWadPath(wadPath, resolvedPath)) {
+                        LoadTextureCollectionTask* task = new LoadTextureCollectionTask(wadPath, resolvedPath);
+                        tasks.push_back(task);
+                        taskList.push_back(task);
+                    }
                 }
+                
+                m_threadPool->enqueue(taskList);
+                m_threadPool->wait(taskList);
+                
+                for (size_t i = 0; i < tasks.size(); i++) {
+                    LoadTextureCollectionTask* task = tasks[i];
+                    if (task->collection() != NULL)
+                        m_textureManager->addCollection(task->collection(), m_textureManager->collections().size());
+                    else
+                        console().error("Could not open texture wad %s: %s", task->path().c_str(), task->error().c_str());
+                }
+                Utility::deleteAll(tasks);
             }
             
             refreshAllTextures();
@@ -621,19 +788,32 @@ namespace TrenchBroom {
             Modify(m_modificationCount != 0);
         }
 
+        wxCommandProcessor* MapDocument::OnCreateCommandProcessor() {
+            const int memoryBudget = Preferences::PreferenceManager::preferences().getInt(Preferences::UndoMemoryBudget);
+            
+            CommandProcessor* commandProcessor = new CommandProcessor();
+            commandProcessor->setMemoryBudget(memoryBudget > 0 ? static_cast<size_t>(memoryBudget) * 1024 * 1024 : 0, m_console);
+            return commandProcessor;
+        }
+        
         bool MapDocument::OnCreate(const wxString& path, long flags) {
             BBoxf worldBounds(Vec3f(-16384, -16384, -16384), Vec3f(16384, 16384, 16384));
 
             m_console = new Utility::Console();
+            
+            const int threadCount = Preferences::PreferenceManager::preferences().getInt(Preferences::WorkerThreadCount);
+            m_threadPool = new Utility::ThreadPool(threadCount > 0 ? static_cast<size_t>(threadCount) : Utility::ThreadPool::defaultThreadCount());
             m_textureManager = new TextureManager();
             m_sharedResources = new Renderer::SharedResources(*m_textureManager, *m_console);
+            m_sharedResources->textureRendererManager().setThreadPool(m_threadPool);
             m_map = new Model::Map(worldBounds, false);
             m_editStateManager = new Model::EditStateManager();
-            m_octree = new Octree(*m_map);
-            m_picker = new Model::Picker(*m_octree);
+            m_bvh = new Bvh(*m_map);
+            m_picker = new Model::Picker(*m_bvh);
             m_definitionManager = new EntityDefinitionManager(*m_console);
             m_modificationCount = 0;
             m_autosaver = new Controller::Autosaver(*this);
+            m_brushSnapshotStore = new Controller::BrushSnapshotStore();
             m_autosaveTimer = new wxTimer(this);
             m_autosaveTimer->Start(1000);
 
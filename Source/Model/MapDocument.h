@@ -30,6 +30,7 @@
 namespace TrenchBroom {
     namespace Controller {
         class Autosaver;
+        class BrushSnapshotStore;
     }
     
     namespace Renderer {
@@ -40,16 +41,18 @@ namespace TrenchBroom {
         class Console;
         class Grid;
         class ProgressIndicator;
+        class ThreadPool;
     }
     
     namespace Model {
         class Brush;
+        class Bvh;
+        class ConvexVolume;
         class EditStateManager;
         class Entity;
         class EntityDefinitionManager;
         class Face;
         class Map;
-        class Octree;
         class Palette;
         class PointFile;
         class Picker;
@@ -59,13 +62,18 @@ namespace TrenchBroom {
         class MapDocument : public wxDocument {
             DECLARE_DYNAMIC_CLASS(MapDocument)
         protected:
+            class LoadTextureCollectionTask;
+            class VolumeQueryTask;
+            
             Controller::Autosaver* m_autosaver;
             wxTimer* m_autosaveTimer;
+            Controller::BrushSnapshotStore* m_brushSnapshotStore;
             Utility::Console* m_console;
+            Utility::ThreadPool* m_threadPool;
             Renderer::SharedResources* m_sharedResources;
             Map* m_map;
             EditStateManager* m_editStateManager;
-            Octree* m_octree;
+            Bvh* m_bvh;
             Picker* m_picker;
             TextureManager* m_textureManager;
             EntityDefinitionManager* m_definitionManager;
@@ -86,11 +94,12 @@ namespace TrenchBroom {
             void clear();
 
             void loadPalette();
-            void loadMap(char* begin, char* end, Utility::ProgressIndicator& progressIndicator);
+            void loadMap(const String& path, char* begin, char* end, Utility::ProgressIndicator& progressIndicator);
 
             void setAllTexturesToNull();
             void refreshAllTextures();
-            void loadTextureWad(const String& path);
+            bool resolveTextureWadPath(const String& path, String& wadPath);
+            void queryVolume(const Brush& brush, bool containment, EntityList& entities, BrushList& brushes);
         public:
             MapDocument();
             virtual ~MapDocument();
@@ -123,6 +132,16 @@ namespace TrenchBroom {
             TextureManager& textureManager() const;
             Picker& picker() const;
             Utility::Grid& grid() const;
+            Utility::ThreadPool& threadPool() const;
+            Controller::BrushSnapshotStore& brushSnapshotStore() const;
+            
+            /*
+             * Collects the point entities and brushes which touch or which are contained in the given brush, excluding
+             * the brush itself. The candidates are culled using the bounding volume hierarchy, and the exact tests
+             * are distributed among the threads of the thread pool.
+             */
+            void objectsTouching(const Brush& brush, EntityList& entities, BrushList& brushes);
+            void objectsInside(const Brush& brush, EntityList& entities, BrushList& brushes);
             
             const StringList& searchPaths() const;
             void invalidateSearchPaths();
@@ -146,6 +165,7 @@ namespace TrenchBroom {
             void decModificationCount();
             
             bool OnCreate(const wxString& path, long flags);
+            wxCommandProcessor* OnCreateCommandProcessor();
 			bool OnNewDocument();
             bool OnOpenDocument(const wxString& path);
             void OnAutosaveTimer(wxTimerEvent& event);
@@ -22,6 +22,7 @@
 
 #include "Model/EditState.h"
 #include "Model/MapObjectTypes.h"
+#include "Utility/Atomic.h"
 #include "Utility/VecMath.h"
 
 #include <vector>
@@ -52,8 +53,8 @@ namespace TrenchBroom {
             m_previouslyLocked(false),
             m_fileFirstLine(0),
             m_fileLineCount(0) {
-                static unsigned int currentId = 1;
-                m_uniqueId = currentId++;
+                static volatile unsigned int currentId = 0;
+                m_uniqueId = Utility::atomicIncrement(currentId);
             }
             
             virtual ~MapObject() {
@@ -144,6 +145,10 @@ namespace TrenchBroom {
                 return m_fileFirstLine;
             }
             
+            inline size_t fileLineCount() const {
+                return m_fileLineCount;
+            }
+            
             inline bool occupiesFileLine(size_t line) const {
                 return line >= m_fileFirstLine && line < m_fileFirstLine + m_fileLineCount;
             }
@@ -18,9 +18,9 @@
  */
 
 #include "Picker.h"
+#include "Model/Bvh.h"
 #include "Model/Face.h"
 #include "Model/MapObject.h"
-#include "Model/Octree.h"
 
 #include <algorithm>
 
@@ -111,12 +111,13 @@ namespace TrenchBroom {
             return hits(HitType::Any, filter);
         }
 
-        Picker::Picker(Octree& octree) : m_octree(octree) {}
+        Picker::Picker(Bvh& bvh) : m_bvh(bvh) {}
 
         PickResult* Picker::pick(const Rayf& ray) {
             PickResult* pickResults = new PickResult();
 
-            MapObjectList objects = m_octree.intersect(ray);
+            MapObjectList objects;
+            m_bvh.intersect(ray, objects);
             for (unsigned int i = 0; i < objects.size(); i++)
                 objects[i]->pick(ray, *pickResults);
 
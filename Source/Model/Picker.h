@@ -29,9 +29,9 @@ namespace TrenchBroom {
     namespace Model {
         class Entity;
         class Brush;
+        class Bvh;
         class Face;
         class Filter;
-        class Octree;
 
         namespace HitType {
             typedef unsigned int Type;
@@ -135,9 +135,9 @@ namespace TrenchBroom {
         
         class Picker {
         private:
-            Octree& m_octree;
+            Bvh& m_bvh;
         public:
-            Picker(Octree& octree);
+            Picker(Bvh& bvh);
             PickResult* pick(const Rayf& ray);
         };
     }
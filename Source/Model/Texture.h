@@ -21,6 +21,8 @@
 #define __TrenchBroom__Texture__
 
 #include <GL/glew.h>
+#include "Utility/Atomic.h"
+#include "Utility/InternedString.h"
 #include "Utility/String.h"
 
 namespace TrenchBroom {
@@ -30,11 +32,13 @@ namespace TrenchBroom {
         class Texture {
         public:
             static const String Empty;
+            static const size_t NoIndex = static_cast<size_t>(-1);
             typedef unsigned int IdType;
         protected:
             TextureCollection& m_collection;
-            String m_name;
+            Utility::InternedString m_name;
             IdType m_uniqueId;
+            size_t m_index;
             unsigned int m_width;
             unsigned int m_height;
             unsigned int m_usageCount;
@@ -43,12 +47,14 @@ namespace TrenchBroom {
             Texture(TextureCollection& collection, const String& name, unsigned int width, unsigned int height) :
             m_collection(collection),
             m_name(name),
+            m_index(NoIndex),
             m_width(width),
             m_height(height),
             m_usageCount(0),
             m_overridden(false) {
-                static IdType uniqueId = 0;
-                m_uniqueId = uniqueId++;
+                // textures are created on the worker threads which load texture collections
+                static volatile IdType currentId = 0;
+                m_uniqueId = Utility::atomicIncrement(currentId);
             }
 
             inline TextureCollection& collection() const {
@@ -56,6 +62,10 @@ namespace TrenchBroom {
             }
             
             inline const String& name() const {
+                return m_name.str();
+            }
+            
+            inline const Utility::InternedString& internedName() const {
                 return m_name;
             }
             
@@ -63,6 +73,18 @@ namespace TrenchBroom {
                 return m_uniqueId;
             }
             
+            /*
+             * Returns the dense index which the texture manager assigned to this texture, or NoIndex if the
+             * texture is not managed.
+             */
+            inline size_t index() const {
+                return m_index;
+            }
+            
+            inline void setIndex(size_t index) {
+                m_index = index;
+            }
+            
             inline unsigned int width() const {
                 return m_width;
             }
@@ -24,10 +24,18 @@
 
 namespace TrenchBroom {
     namespace Model {
-        TextureCollectionLoader::TextureCollectionLoader(const String& path) throw (IO::IOException) :
-        m_wad(path) {}
-
-        unsigned char* TextureCollectionLoader::load(const Texture& texture, const Renderer::Palette& palette, Color& averageColor) throw (IO::IOException) {
+        TextureCollectionLoader::TextureCollectionLoader(const String& path, const Renderer::Palette& palette) throw (IO::IOException) :
+        m_wad(path),
+        m_palette(palette),
+        m_cache(path, palette.checksum()) {}
+
+        unsigned char* TextureCollectionLoader::load(const Texture& texture, Color& averageColor) const throw (IO::IOException) {
+            if (m_cache.valid()) {
+                unsigned char* rgbImage = m_cache.image(texture.name(), texture.width(), texture.height(), averageColor);
+                if (rgbImage != NULL)
+                    return rgbImage;
+            }
+            
             IO::Mip* mip = NULL;
             try {
                 mip = m_wad.loadMip(texture.name(), 1);
@@ -40,11 +48,16 @@ namespace TrenchBroom {
 
             size_t pixelCount = texture.width() * texture.height();
             unsigned char* rgbImage = new unsigned char[pixelCount * 3];
-            palette.indexedToRgb(mip->mip0(), rgbImage, pixelCount, averageColor);
+            m_palette.indexedToRgb(mip->mip0(), rgbImage, pixelCount, averageColor);
             delete mip;
 
             return rgbImage;
         }
+        
+        void TextureCollectionLoader::updateCache(const IO::TextureCache::ImageList& images) {
+            if (!m_cache.valid())
+                m_cache.write(images);
+        }
 
         TextureCollection::TextureCollection(const String& name, const String& path) throw (IO::IOException) :
         m_name(name),
@@ -77,8 +90,8 @@ namespace TrenchBroom {
             Utility::deleteAll(m_textures);
         }
 
-        TextureCollection::LoaderPtr TextureCollection::loader() const {
-            return LoaderPtr(new TextureCollectionLoader(m_path));
+        TextureCollection::LoaderPtr TextureCollection::loader(const Renderer::Palette& palette) const {
+            return LoaderPtr(new TextureCollectionLoader(m_path, palette));
         }
 
         void TextureManager::reloadTextures() {
@@ -87,14 +100,18 @@ namespace TrenchBroom {
             m_texturesCaseInsensitive.clear();
             m_texturesByName.clear();
             m_texturesByUsage.clear();
+            m_texturesByInternedName.clear();
 
             typedef std::pair<TextureMap::iterator, bool> InsertResult;
 
+            // the renderers use the indices to batch faces by texture, so they must be dense
+            size_t index = 0;
             for (size_t i = 0; i < m_collections.size(); i++) {
                 TextureCollection* collection = m_collections[i];
                 const TextureList textures = collection->textures();
                 for (size_t j = 0; j < textures.size(); j++) {
                     Texture* texture = textures[j];
+                    texture->setIndex(index++);
                     m_collectionMap[texture] = collection;
 
                     InsertResult result = m_texturesCaseSensitive.insert(TextureMapEntry(texture->name(), texture));
@@ -140,6 +157,11 @@ namespace TrenchBroom {
             std::advance(removePos, index);
             m_collections.erase(removePos);
 
+            // the indices of the removed textures will be reassigned to the remaining textures
+            const TextureList& textures = collection->textures();
+            for (size_t i = 0; i < textures.size(); i++)
+                textures[i]->setIndex(Texture::NoIndex);
+            
             reloadTextures();
             return collection;
         }
@@ -161,6 +183,7 @@ namespace TrenchBroom {
             m_texturesCaseInsensitive.clear();
             m_texturesByName.clear();
             m_texturesByUsage.clear();
+            m_texturesByInternedName.clear();
             m_collectionMap.clear();
             Utility::deleteAll(m_collections);
         }
@@ -20,10 +20,12 @@
 #ifndef __TrenchBroom__TextureManager__
 #define __TrenchBroom__TextureManager__
 
+#include "IO/TextureCache.h"
 #include "IO/Wad.h"
 #include "Model/Texture.h"
 #include "Model/TextureTypes.h"
 #include "Utility/Color.h"
+#include "Utility/InternedString.h"
 #include "Utility/String.h"
 
 #include <algorithm>
@@ -66,9 +68,25 @@ namespace TrenchBroom {
         class TextureCollectionLoader {
         protected:
             IO::Wad m_wad;
+            const Renderer::Palette& m_palette;
+            IO::TextureCache m_cache;
         public:
-            TextureCollectionLoader(const String& path) throw (IO::IOException);
-            unsigned char* load(const Texture& texture, const Renderer::Palette& palette, Color& averageColor) throw (IO::IOException);
+            TextureCollectionLoader(const String& path, const Renderer::Palette& palette) throw (IO::IOException);
+            
+            /*
+             * Returns the RGB image of the given texture. The image is copied from the texture cache if it is up to
+             * date, otherwise it is decoded from the wad file. May be called from several threads at once.
+             */
+            unsigned char* load(const Texture& texture, Color& averageColor) const throw (IO::IOException);
+            
+            inline bool cached() const {
+                return m_cache.valid();
+            }
+            
+            /*
+             * Rebuilds the texture cache from the given decoded images unless it is already up to date.
+             */
+            void updateCache(const IO::TextureCache::ImageList& images);
         };
         
         class TextureCollection {
@@ -104,12 +122,13 @@ namespace TrenchBroom {
                 m_path = path;
             }
             
-            LoaderPtr loader() const;
+            LoaderPtr loader(const Renderer::Palette& palette) const;
         };
 
         class TextureManager {
         private:
             typedef std::map<Texture*, TextureCollection*> TextureCollectionMap;
+            typedef std::map<Utility::InternedString, Texture*> InternedTextureMap;
             
             TextureCollectionList m_collections;
             TextureCollectionMap m_collectionMap;
@@ -117,6 +136,7 @@ namespace TrenchBroom {
             TextureMap m_texturesCaseInsensitive;
             TextureList m_texturesByName;
             mutable TextureList m_texturesByUsage;
+            InternedTextureMap m_texturesByInternedName;
             void reloadTextures();
         public:
             ~TextureManager();
@@ -147,6 +167,20 @@ namespace TrenchBroom {
                 return it->second;
             }
             
+            /*
+             * Faces share a handle per texture name, so the result of the string lookup is remembered per handle,
+             * including names that have no texture.
+             */
+            inline Texture* texture(const Utility::InternedString& name) {
+                InternedTextureMap::iterator it = m_texturesByInternedName.find(name);
+                if (it != m_texturesByInternedName.end())
+                    return it->second;
+                
+                Texture* result = texture(name.str());
+                m_texturesByInternedName.insert(InternedTextureMap::value_type(name, result));
+                return result;
+            }
+            
             inline String wadProperty() const {
                 StringStream str;
                 for (size_t i = 0; i < m_collections.size(); i++) {
@@ -33,6 +33,27 @@
 
 namespace TrenchBroom {
     namespace Renderer {
+        void AliasModelRenderer::validate() {
+            assert(m_skinIndex < m_alias.skins().size());
+            assert(m_frameIndex < m_alias.frames().size());
+            
+            Model::AliasSkin& skin = *m_alias.skins()[m_skinIndex];
+            m_texture = TextureRendererPtr(new TextureRenderer(skin, 0, m_palette));
+            
+            // the decoded frame vertices are already laid out as the vertex array expects them
+            Model::AliasSingleFrame& frame = m_alias.frame(m_frameIndex);
+            const FaceVertex::List& vertices = frame.vertices();
+            unsigned int vertexCount = static_cast<unsigned int>(vertices.size());
+            
+            m_vertexArray = new VertexArray(m_vbo, GL_TRIANGLES, vertexCount,
+                                            Attribute::position3f(),
+                                            Attribute::normal3f(),
+                                            Attribute::texCoord02f(), 0);
+            
+            SetVboState mapVbo(m_vbo, Vbo::VboMapped);
+            m_vertexArray->addAttributes(vertices);
+        }
+        
         AliasModelRenderer::AliasModelRenderer(const Model::Alias& alias, unsigned int frameIndex, unsigned int skinIndex, Vbo& vbo, const Palette& palette) :
         m_alias(alias),
         m_frameIndex(frameIndex),
@@ -50,32 +71,8 @@ namespace TrenchBroom {
         }
 
         void AliasModelRenderer::render(ShaderProgram& shaderProgram) {
-            if (m_vertexArray == NULL) {
-                assert(m_skinIndex < m_alias.skins().size());
-                assert(m_frameIndex < m_alias.frames().size());
-                
-                Model::AliasSkin& skin = *m_alias.skins()[m_skinIndex];
-                m_texture = TextureRendererPtr(new TextureRenderer(skin, 0, m_palette));
-
-                Model::AliasSingleFrame& frame = m_alias.frame(m_frameIndex);
-                const Model::AliasFrameTriangleList& triangles = frame.triangles();
-                unsigned int vertexCount = static_cast<unsigned int>(3 * triangles.size());
-                
-                m_vertexArray = new VertexArray(m_vbo, GL_TRIANGLES, vertexCount,
-                                                Attribute::position3f(),
-                                                Attribute::texCoord02f());
-
-                SetVboState mapVbo(m_vbo, Vbo::VboMapped);
-                for (unsigned int i = 0; i < triangles.size(); i++) {
-                    Model::AliasFrameTriangle& triangle = *triangles[i];
-                    for (unsigned int j = 0; j < 3; j++) {
-                        Model::AliasFrameVertex& vertex = triangle[j];
-                        m_vertexArray->addAttribute(vertex.position());
-                        m_vertexArray->addAttribute(vertex.texCoords());
-                    }
-                }
-            }
-
+            if (m_vertexArray == NULL)
+                validate();
             assert(m_vertexArray != NULL);
             
             glActiveTexture(GL_TEXTURE0);
@@ -85,6 +82,18 @@ namespace TrenchBroom {
             m_texture->deactivate();
         }
 
+        void AliasModelRenderer::renderInstances(ShaderProgram& shaderProgram, unsigned int instanceCount) {
+            if (m_vertexArray == NULL)
+                validate();
+            assert(m_vertexArray != NULL);
+            
+            glActiveTexture(GL_TEXTURE0);
+            m_texture->activate();
+            shaderProgram.setUniformVariable("Texture", 0);
+            m_vertexArray->renderInstances(instanceCount);
+            m_texture->deactivate();
+        }
+
         const Vec3f& AliasModelRenderer::center() const {
             return m_alias.frame(m_frameIndex).center();
         }
@@ -95,17 +104,14 @@ namespace TrenchBroom {
 
         BBoxf AliasModelRenderer::boundsAfterTransformation(const Mat4f& transformation) const {
             Model::AliasSingleFrame& frame = m_alias.frame(m_frameIndex);
-            const Model::AliasFrameTriangleList& triangles = frame.triangles();
+            const FaceVertex::List& vertices = frame.vertices();
 
             BBoxf bounds;
-            bounds.min = bounds.max = transformation * (*triangles[0])[0].position();
+            bounds.min = bounds.max = transformation * Vec3f(vertices[0].px, vertices[0].py, vertices[0].pz);
             
-            for (unsigned int i = 1; i < triangles.size(); i++) {
-                Model::AliasFrameTriangle& triangle = *triangles[i];
-                for (unsigned int j = 0; j < 3; j++) {
-                    Model::AliasFrameVertex& vertex = triangle[j];
-                    bounds.mergeWith(transformation * vertex.position());
-                }
+            for (unsigned int i = 1; i < vertices.size(); i++) {
+                const FaceVertex& vertex = vertices[i];
+                bounds.mergeWith(transformation * Vec3f(vertex.px, vertex.py, vertex.pz));
             }
             
             return bounds;
@@ -48,11 +48,14 @@ namespace TrenchBroom {
 
             Vbo& m_vbo;
             VertexArray* m_vertexArray;
+            
+            void validate();
         public:
             AliasModelRenderer(const Model::Alias& alias, unsigned int frameIndex, unsigned int skinIndex, Vbo& vbo, const Palette& palette);
             ~AliasModelRenderer();
 
             void render(ShaderProgram& shaderProgram);
+            void renderInstances(ShaderProgram& shaderProgram, unsigned int instanceCount);
 
             const Vec3f& center() const;
             const BBoxf& bounds() const;
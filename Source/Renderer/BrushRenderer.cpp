@@ -0,0 +1,737 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "BrushRenderer.h"
+
+#include "Model/Brush.h"
+#include "Model/BrushGeometry.h"
+#include "Model/Entity.h"
+#include "Model/EntityDefinition.h"
+#include "Model/Face.h"
+#include "Model/Filter.h"
+#include "Model/Map.h"
+#include "Model/MapDocument.h"
+#include "Model/Texture.h"
+#include "Renderer/AttributeArray.h"
+#include "Renderer/Culler.h"
+#include "Renderer/FaceRenderer.h"
+#include "Renderer/FaceVertex.h"
+#include "Renderer/RenderContext.h"
+#include "Renderer/SharedResources.h"
+#include "Renderer/TextureRenderer.h"
+#include "Renderer/TextureRendererManager.h"
+#include "Renderer/Vbo.h"
+#include "Renderer/Shader/ShaderManager.h"
+#include "Renderer/Shader/ShaderProgram.h"
+#include "Utility/Grid.h"
+#include "Utility/List.h"
+#include "Utility/Preferences.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace TrenchBroom {
+    namespace Renderer {
+        // face vertices are written as they are cached by the faces: position, normal and texture coordinates
+        static const size_t FaceVertexSize = sizeof(FaceVertex);
+        static const size_t FaceNormalOffset = 3 * sizeof(GLfloat);
+        static const size_t FaceTexCoordOffset = 6 * sizeof(GLfloat);
+        
+        // edge vertices consist of a position and a color and are padded to 32 bytes
+        static const size_t EdgeVertexSize = 32;
+        static const size_t EdgeColorOffset = 3 * sizeof(GLfloat);
+        static const size_t EdgePadding = EdgeVertexSize - 7 * sizeof(GLfloat);
+        
+        // all blocks are multiples of the vertex sizes, so the initial capacity must be, too
+        static const size_t InitialVboCapacity = 0x10000;
+        
+        const float BrushRenderer::ChunkSize = 1024.0f;
+        
+        class CompareFacesByTexture {
+        public:
+            inline bool operator() (const Model::Face* left, const Model::Face* right) const {
+                return left->texture() < right->texture();
+            }
+        };
+        
+        static inline const Color& edgeColor(const Model::Brush& brush, const Color& defaultColor) {
+            const Model::Entity* entity = brush.entity();
+            const Model::EntityDefinition* definition = entity != NULL ? entity->definition() : NULL;
+            if (entity != NULL && !entity->worldspawn() && definition != NULL && definition->type() == Model::EntityDefinition::BrushEntity)
+                return definition->color();
+            return defaultColor;
+        }
+        
+        static inline size_t writeEdgeVertex(VboBlock& block, const Vec3f& position, const Color& color, size_t offset) {
+            offset = block.writeVec(position, offset);
+            offset = block.writeVec<Vec4f>(color, offset);
+            return offset + EdgePadding;
+        }
+        
+        BrushRenderer::ChunkKey::ChunkKey(const Vec3f& position) :
+        m_x(static_cast<int>(std::floor(position.x() / ChunkSize))),
+        m_y(static_cast<int>(std::floor(position.y() / ChunkSize))),
+        m_z(static_cast<int>(std::floor(position.z() / ChunkSize))) {}
+        
+        bool BrushRenderer::ChunkKey::operator<(const ChunkKey& other) const {
+            if (m_x != other.m_x)
+                return m_x < other.m_x;
+            if (m_y != other.m_y)
+                return m_y < other.m_y;
+            return m_z < other.m_z;
+        }
+        
+        void BrushRenderer::clearSlots() {
+            BrushSlotMap::iterator slotIt, slotEnd;
+            for (slotIt = m_slots.begin(), slotEnd = m_slots.end(); slotIt != slotEnd; ++slotIt)
+                delete slotIt->second;
+            m_slots.clear();
+            
+            for (size_t i = 0; i < GroupCount; i++) {
+                Utility::deleteAll(m_faceBuckets[i]);
+                Utility::deleteAll(m_unindexedFaceBuckets[i]);
+            }
+            
+            ChunkMap::iterator chunkIt, chunkEnd;
+            for (chunkIt = m_chunks.begin(), chunkEnd = m_chunks.end(); chunkIt != chunkEnd; ++chunkIt)
+                delete chunkIt->second;
+            m_chunks.clear();
+            m_visibleChunks.clear();
+            
+            m_faceVbo->freeAllBlocks();
+            m_edgeVbo->freeAllBlocks();
+            m_selectedFaceEdgeBlock = NULL;
+            m_selectedFaceEdgeVertexCount = 0;
+            m_selectedFaceEdgesValid = false;
+        }
+        
+        void BrushRenderer::removeSlot(Model::Brush* brush) {
+            m_invalidBrushes.erase(brush);
+            m_ungroupedBrushes.erase(brush);
+            
+            BrushSlotMap::iterator it = m_slots.find(brush);
+            if (it == m_slots.end())
+                return;
+            
+            BrushSlot* slot = it->second;
+            unassignGroups(*slot);
+            if (slot->faceBlock != NULL)
+                slot->faceBlock->freeBlock();
+            if (slot->edgeBlock != NULL)
+                slot->edgeBlock->freeBlock();
+            delete slot;
+            m_slots.erase(it);
+        }
+        
+        void BrushRenderer::writeFaces(Model::Brush& brush, BrushSlot& slot) {
+            assert(m_faceVbo->state() == Vbo::VboMapped);
+            
+            // faces with the same texture are written next to each other so that their ranges can be merged
+            Model::FaceList faces = brush.faces();
+            std::stable_sort(faces.begin(), faces.end(), CompareFacesByTexture());
+            
+            size_t vertexCount = 0;
+            Model::FaceList::const_iterator faceIt, faceEnd;
+            for (faceIt = faces.begin(), faceEnd = faces.end(); faceIt != faceEnd; ++faceIt) {
+                const Model::Face& face = **faceIt;
+                vertexCount += face.cachedVertices().size();
+            }
+            
+            const size_t capacity = vertexCount * FaceVertexSize;
+            if (slot.faceBlock != NULL && slot.faceBlock->capacity() != capacity) {
+                slot.faceBlock->freeBlock();
+                slot.faceBlock = NULL;
+            }
+            
+            slot.faces.clear();
+            if (capacity == 0)
+                return;
+            
+            if (slot.faceBlock == NULL)
+                slot.faceBlock = m_faceVbo->allocBlock(capacity);
+            
+            size_t offset = 0;
+            GLint vertexOffset = 0;
+            for (faceIt = faces.begin(), faceEnd = faces.end(); faceIt != faceEnd; ++faceIt) {
+                Model::Face* face = *faceIt;
+                const FaceVertex::List& vertices = face->cachedVertices();
+                if (vertices.empty())
+                    continue;
+                
+                const GLsizei count = static_cast<GLsizei>(vertices.size());
+                offset = slot.faceBlock->writeBuffer(reinterpret_cast<const unsigned char*>(&vertices.front()), offset, vertices.size() * FaceVertexSize);
+                slot.faces.push_back(FaceEntry(face, face->texture(), vertexOffset, count));
+                vertexOffset += count;
+            }
+        }
+        
+        void BrushRenderer::writeEdges(Model::Brush& brush, BrushSlot& slot) {
+            assert(m_edgeVbo->state() == Vbo::VboMapped);
+            
+            const Model::EdgeList& edges = brush.edges();
+            const size_t capacity = 2 * edges.size() * EdgeVertexSize;
+            if (slot.edgeBlock != NULL && slot.edgeBlock->capacity() != capacity) {
+                slot.edgeBlock->freeBlock();
+                slot.edgeBlock = NULL;
+            }
+            
+            slot.edgeVertexCount = static_cast<GLsizei>(2 * edges.size());
+            if (capacity == 0)
+                return;
+            
+            if (slot.edgeBlock == NULL)
+                slot.edgeBlock = m_edgeVbo->allocBlock(capacity);
+            
+            Preferences::PreferenceManager& prefs = Preferences::PreferenceManager::preferences();
+            const Color& color = edgeColor(brush, prefs.getColor(Preferences::EdgeColor));
+            
+            size_t offset = 0;
+            Model::EdgeList::const_iterator edgeIt, edgeEnd;
+            for (edgeIt = edges.begin(), edgeEnd = edges.end(); edgeIt != edgeEnd; ++edgeIt) {
+                const Model::Edge& edge = **edgeIt;
+                offset = writeEdgeVertex(*slot.edgeBlock, edge.start->position, color, offset);
+                offset = writeEdgeVertex(*slot.edgeBlock, edge.end->position, color, offset);
+            }
+        }
+        
+        void BrushRenderer::writeSelectedFaceEdges(RenderContext& context) {
+            if (m_selectedFaceEdgeBlock != NULL) {
+                m_selectedFaceEdgeBlock->freeBlock();
+                m_selectedFaceEdgeBlock = NULL;
+            }
+            m_selectedFaceEdgeVertexCount = 0;
+            m_selectedFaceEdgesValid = true;
+            
+            // the edges of faces of selected brushes are already rendered with the brushes
+            Model::FaceList faces;
+            size_t vertexCount = 0;
+            Model::FaceList::const_iterator faceIt, faceEnd;
+            for (faceIt = m_selectedFaces.begin(), faceEnd = m_selectedFaces.end(); faceIt != faceEnd; ++faceIt) {
+                Model::Face* face = *faceIt;
+                const Model::Brush* brush = face->brush();
+                const Model::Entity* entity = brush->entity();
+                if (context.filter().brushVisible(*brush) &&
+                    !brush->selected() && !brush->locked() &&
+                    (entity == NULL || (!entity->selected() && !entity->locked()))) {
+                    faces.push_back(face);
+                    vertexCount += 2 * face->edges().size();
+                }
+            }
+            
+            if (vertexCount == 0)
+                return;
+            
+            SetVboState mapVbo(*m_edgeVbo, Vbo::VboMapped);
+            m_selectedFaceEdgeBlock = m_edgeVbo->allocBlock(vertexCount * EdgeVertexSize);
+            m_selectedFaceEdgeVertexCount = static_cast<GLsizei>(vertexCount);
+            
+            // the color is set by the shader when selected edges are rendered
+            const Color color;
+            size_t offset = 0;
+            for (faceIt = faces.begin(), faceEnd = faces.end(); faceIt != faceEnd; ++faceIt) {
+                const Model::Face& face = **faceIt;
+                const Model::EdgeList& edges = face.edges();
+                Model::EdgeList::const_iterator edgeIt, edgeEnd;
+                for (edgeIt = edges.begin(), edgeEnd = edges.end(); edgeIt != edgeEnd; ++edgeIt) {
+                    const Model::Edge& edge = **edgeIt;
+                    offset = writeEdgeVertex(*m_selectedFaceEdgeBlock, edge.start->position, color, offset);
+                    offset = writeEdgeVertex(*m_selectedFaceEdgeBlock, edge.end->position, color, offset);
+                }
+            }
+        }
+        
+        BrushRenderer::FaceBucket* BrushRenderer::createFaceBucket(Model::Texture* texture) {
+            TextureRendererManager& textureRendererManager = m_document.sharedResources().textureRendererManager();
+            TextureRenderer* textureRenderer = texture != NULL ? &textureRendererManager.renderer(texture) : NULL;
+            const bool transparent = texture != NULL && FaceRenderer::alphaBlend(texture->name());
+            return new FaceBucket(texture, textureRenderer, transparent);
+        }
+        
+        BrushRenderer::FaceBucket& BrushRenderer::faceBucket(Group group, Model::Texture* texture) {
+            assert(group < GroupCount);
+            
+            const size_t index = texture == NULL ? 0 : (texture->index() != Model::Texture::NoIndex ? texture->index() + 1 : Model::Texture::NoIndex);
+            if (index != Model::Texture::NoIndex) {
+                FaceBucketList& buckets = m_faceBuckets[group];
+                if (index >= buckets.size())
+                    buckets.resize(index + 1, NULL);
+                
+                FaceBucket*& bucket = buckets[index];
+                if (bucket == NULL)
+                    bucket = createFaceBucket(texture);
+                if (bucket->key == texture)
+                    return *bucket;
+            }
+            
+            FaceBucketList& unindexedBuckets = m_unindexedFaceBuckets[group];
+            FaceBucketList::const_iterator it, end;
+            for (it = unindexedBuckets.begin(), end = unindexedBuckets.end(); it != end; ++it)
+                if ((*it)->key == texture)
+                    return **it;
+            
+            FaceBucket* bucket = createFaceBucket(texture);
+            unindexedBuckets.push_back(bucket);
+            return *bucket;
+        }
+        
+        BrushRenderer::Chunk& BrushRenderer::chunk(const BBoxf& bounds) {
+            const ChunkKey key((bounds.min + bounds.max) / 2.0f);
+            ChunkMap::iterator it = m_chunks.lower_bound(key);
+            if (it == m_chunks.end() || key < it->first)
+                it = m_chunks.insert(it, ChunkMap::value_type(key, new Chunk()));
+            
+            Chunk& chunk = *it->second;
+            if (chunk.brushCount == 0)
+                chunk.bounds = bounds;
+            else
+                chunk.bounds.mergeWith(bounds);
+            chunk.brushCount++;
+            return chunk;
+        }
+        
+        void BrushRenderer::assignGroups(RenderContext& context, Model::Brush& brush, BrushSlot& slot) {
+            assert(slot.chunk == NULL);
+            assert(slot.faceSpans.empty());
+            assert(slot.edgeGroup == Hidden);
+            
+            if (!context.filter().brushVisible(brush))
+                return;
+            
+            // the bounds of a chunk only grow until all groups are reassigned, so they always contain its brushes
+            slot.chunk = &chunk(brush.bounds());
+            
+            const Model::Entity* entity = brush.entity();
+            Group brushGroup = Unselected;
+            if (brush.selected() || (entity != NULL && entity->selected()))
+                brushGroup = Selected;
+            else if (brush.locked() || (entity != NULL && entity->locked()))
+                brushGroup = Locked;
+            
+            if (slot.faceBlock != NULL) {
+                const GLint baseIndex = static_cast<GLint>(slot.faceBlock->address() / FaceVertexSize);
+                
+                FaceEntryList::const_iterator entryIt, entryEnd;
+                for (entryIt = slot.faces.begin(), entryEnd = slot.faces.end(); entryIt != entryEnd; ++entryIt) {
+                    const FaceEntry& entry = *entryIt;
+                    const Group group = entry.face->selected() ? Selected : brushGroup;
+                    const GLint index = baseIndex + entry.offset;
+                    
+                    if (!slot.faceSpans.empty()) {
+                        FaceSpan& span = slot.faceSpans.back();
+                        if (span.texture == entry.texture && span.group == group && span.index + span.count == index) {
+                            span.count += entry.count;
+                            continue;
+                        }
+                    }
+                    slot.faceSpans.push_back(FaceSpan(entry.texture, group, index, entry.count));
+                }
+                
+                // the spans must not be moved anymore once their handles are registered
+                FaceSpanList::iterator spanIt, spanEnd;
+                for (spanIt = slot.faceSpans.begin(), spanEnd = slot.faceSpans.end(); spanIt != spanEnd; ++spanIt) {
+                    FaceSpan& span = *spanIt;
+                    span.bucket = &faceBucket(span.group, span.texture);
+                    slot.chunk->faceRanges[span.bucket].add(span.index, span.count, span.handle);
+                }
+            }
+            
+            if (slot.edgeBlock != NULL) {
+                const GLint index = static_cast<GLint>(slot.edgeBlock->address() / EdgeVertexSize);
+                slot.chunk->edgeRanges[brushGroup].add(index, slot.edgeVertexCount, slot.edgeHandle);
+                slot.edgeGroup = brushGroup;
+            }
+        }
+        
+        void BrushRenderer::unassignGroups(BrushSlot& slot) {
+            if (slot.chunk == NULL)
+                return;
+            
+            Chunk& chunk = *slot.chunk;
+            FaceSpanList::const_iterator spanIt, spanEnd;
+            for (spanIt = slot.faceSpans.begin(), spanEnd = slot.faceSpans.end(); spanIt != spanEnd; ++spanIt) {
+                const FaceSpan& span = *spanIt;
+                assert(span.bucket != NULL);
+                assert(chunk.faceRanges.count(span.bucket) > 0);
+                chunk.faceRanges[span.bucket].remove(span.handle);
+            }
+            slot.faceSpans.clear();
+            
+            if (slot.edgeGroup != Hidden) {
+                chunk.edgeRanges[slot.edgeGroup].remove(slot.edgeHandle);
+                slot.edgeGroup = Hidden;
+            }
+            
+            assert(chunk.brushCount > 0);
+            chunk.brushCount--;
+            slot.chunk = NULL;
+        }
+        
+        void BrushRenderer::reassignAllGroups(RenderContext& context) {
+            ChunkMap::iterator chunkIt, chunkEnd;
+            for (chunkIt = m_chunks.begin(), chunkEnd = m_chunks.end(); chunkIt != chunkEnd; ++chunkIt)
+                delete chunkIt->second;
+            m_chunks.clear();
+            m_visibleChunks.clear();
+            
+            BrushSlotMap::iterator slotIt, slotEnd;
+            for (slotIt = m_slots.begin(), slotEnd = m_slots.end(); slotIt != slotEnd; ++slotIt) {
+                BrushSlot& slot = *slotIt->second;
+                slot.chunk = NULL;
+                slot.faceSpans.clear();
+                slot.edgeGroup = Hidden;
+                assignGroups(context, *slotIt->first, slot);
+            }
+        }
+        
+        void BrushRenderer::renderFaceBuckets(ShaderProgram& shader, const FaceBucketList& buckets, bool transparent, bool applyTexture, const Color& faceColor) {
+            FaceBucketList::const_iterator it, end;
+            for (it = buckets.begin(), end = buckets.end(); it != end; ++it) {
+                if (*it == NULL)
+                    continue;
+                
+                FaceBucket& bucket = **it;
+                if (bucket.transparent != transparent || bucket.visibleRanges.empty())
+                    continue;
+                
+                if (bucket.texture != NULL) {
+                    bucket.texture->activate();
+                    shader.setUniformVariable("ApplyTexture", applyTexture);
+                    shader.setUniformVariable("FaceTexture", 0);
+                    shader.setUniformVariable("Color", bucket.texture->averageColor());
+                } else {
+                    shader.setUniformVariable("ApplyTexture", false);
+                    shader.setUniformVariable("Color", faceColor);
+                }
+                
+                std::vector<VertexRangeList*>::const_iterator rangeIt, rangeEnd;
+                for (rangeIt = bucket.visibleRanges.begin(), rangeEnd = bucket.visibleRanges.end(); rangeIt != rangeEnd; ++rangeIt)
+                    (*rangeIt)->render(GL_TRIANGLES);
+                
+                if (bucket.texture != NULL)
+                    bucket.texture->deactivate();
+            }
+        }
+        
+        void BrushRenderer::renderFaceBuckets(ShaderProgram& shader, Group group, bool transparent, bool applyTexture, const Color& faceColor) {
+            renderFaceBuckets(shader, m_faceBuckets[group], transparent, applyTexture, faceColor);
+            renderFaceBuckets(shader, m_unindexedFaceBuckets[group], transparent, applyTexture, faceColor);
+        }
+        
+        void BrushRenderer::renderEdgeRanges(Group group, bool includeSelectedFaceEdges) {
+            ChunkList::const_iterator it, end;
+            for (it = m_visibleChunks.begin(), end = m_visibleChunks.end(); it != end; ++it)
+                (*it)->edgeRanges[group].render(GL_LINES);
+            if (includeSelectedFaceEdges && m_selectedFaceEdgeBlock != NULL) {
+                const GLint index = static_cast<GLint>(m_selectedFaceEdgeBlock->address() / EdgeVertexSize);
+                glDrawArrays(GL_LINES, index, m_selectedFaceEdgeVertexCount);
+            }
+        }
+        
+        BrushRenderer::BrushRenderer(Model::MapDocument& document) :
+        m_document(document),
+        m_faceVbo(NULL),
+        m_edgeVbo(NULL),
+        m_allBrushesInvalid(true),
+        m_allBrushesUngrouped(false),
+        m_selectedFaceEdgeBlock(NULL),
+        m_selectedFaceEdgeVertexCount(0),
+        m_selectedFaceEdgesValid(false) {
+            m_faceVbo = new Vbo(GL_ARRAY_BUFFER, InitialVboCapacity);
+            m_edgeVbo = new Vbo(GL_ARRAY_BUFFER, InitialVboCapacity);
+        }
+        
+        BrushRenderer::~BrushRenderer() {
+            clearSlots();
+            delete m_edgeVbo;
+            m_edgeVbo = NULL;
+            delete m_faceVbo;
+            m_faceVbo = NULL;
+        }
+        
+        void BrushRenderer::addBrushes(const Model::BrushList& brushes) {
+            m_invalidBrushes.insert(brushes.begin(), brushes.end());
+        }
+        
+        void BrushRenderer::removeBrushes(const Model::BrushList& brushes) {
+            if (brushes.empty())
+                return;
+            
+            Model::BrushList::const_iterator brushIt, brushEnd;
+            for (brushIt = brushes.begin(), brushEnd = brushes.end(); brushIt != brushEnd; ++brushIt)
+                removeSlot(*brushIt);
+            
+            const Model::BrushSet removedBrushes(brushes.begin(), brushes.end());
+            Model::FaceList::iterator faceIt = m_selectedFaces.begin();
+            while (faceIt != m_selectedFaces.end()) {
+                if (removedBrushes.count((*faceIt)->brush()) > 0)
+                    faceIt = m_selectedFaces.erase(faceIt);
+                else
+                    ++faceIt;
+            }
+            m_selectedFaceEdgesValid = false;
+        }
+        
+        void BrushRenderer::invalidateBrushes(const Model::BrushList& brushes) {
+            m_invalidBrushes.insert(brushes.begin(), brushes.end());
+            m_selectedFaceEdgesValid = false;
+        }
+        
+        void BrushRenderer::invalidateAllBrushes() {
+            m_allBrushesInvalid = true;
+        }
+        
+        void BrushRenderer::regroupBrushes(const Model::BrushList& brushes) {
+            m_ungroupedBrushes.insert(brushes.begin(), brushes.end());
+        }
+        
+        void BrushRenderer::regroupAllBrushes() {
+            m_allBrushesUngrouped = true;
+            m_selectedFaceEdgesValid = false;
+        }
+        
+        void BrushRenderer::setSelectedFaces(const Model::FaceList& faces) {
+            m_selectedFaces = faces;
+            m_selectedFaceEdgesValid = false;
+        }
+        
+        void BrushRenderer::invalidateSelectedFaces() {
+            m_selectedFaceEdgesValid = false;
+        }
+        
+        void BrushRenderer::clear() {
+            clearSlots();
+            m_invalidBrushes.clear();
+            m_ungroupedBrushes.clear();
+            m_selectedFaces.clear();
+            m_allBrushesInvalid = true;
+            m_allBrushesUngrouped = false;
+        }
+        
+        void BrushRenderer::validate(RenderContext& context) {
+            if (m_allBrushesInvalid) {
+                clearSlots();
+                m_invalidBrushes.clear();
+                m_ungroupedBrushes.clear();
+                
+                const Model::EntityList& entities = m_document.map().entities();
+                Model::EntityList::const_iterator entityIt, entityEnd;
+                for (entityIt = entities.begin(), entityEnd = entities.end(); entityIt != entityEnd; ++entityIt) {
+                    const Model::BrushList& brushes = (*entityIt)->brushes();
+                    m_invalidBrushes.insert(brushes.begin(), brushes.end());
+                }
+                m_allBrushesInvalid = false;
+                m_allBrushesUngrouped = true;
+            }
+            
+            if (!m_invalidBrushes.empty()) {
+                const size_t facePackCount = m_faceVbo->packCount();
+                const size_t edgePackCount = m_edgeVbo->packCount();
+                
+                size_t faceCapacity = 0;
+                size_t edgeCapacity = 0;
+                Model::BrushSet::const_iterator brushIt, brushEnd;
+                for (brushIt = m_invalidBrushes.begin(), brushEnd = m_invalidBrushes.end(); brushIt != brushEnd; ++brushIt) {
+                    Model::Brush& brush = **brushIt;
+                    const Model::FaceList& faces = brush.faces();
+                    Model::FaceList::const_iterator faceIt, faceEnd;
+                    for (faceIt = faces.begin(), faceEnd = faces.end(); faceIt != faceEnd; ++faceIt)
+                        faceCapacity += (*faceIt)->cachedVertices().size() * FaceVertexSize;
+                    edgeCapacity += 2 * brush.edges().size() * EdgeVertexSize;
+                    
+                    BrushSlotMap::iterator slotIt = m_slots.find(&brush);
+                    if (slotIt == m_slots.end())
+                        m_slots[&brush] = new BrushSlot();
+                    else
+                        unassignGroups(*slotIt->second);
+                }
+                
+                {
+                    SetVboState mapVbo(*m_faceVbo, Vbo::VboMapped);
+                    m_faceVbo->ensureFreeCapacity(faceCapacity);
+                    for (brushIt = m_invalidBrushes.begin(), brushEnd = m_invalidBrushes.end(); brushIt != brushEnd; ++brushIt)
+                        writeFaces(**brushIt, *m_slots[*brushIt]);
+                }
+                
+                {
+                    SetVboState mapVbo(*m_edgeVbo, Vbo::VboMapped);
+                    m_edgeVbo->ensureFreeCapacity(edgeCapacity);
+                    for (brushIt = m_invalidBrushes.begin(), brushEnd = m_invalidBrushes.end(); brushIt != brushEnd; ++brushIt)
+                        writeEdges(**brushIt, *m_slots[*brushIt]);
+                }
+                
+                // if any blocks were moved, the ranges of all brushes are stale
+                if (m_faceVbo->packCount() != facePackCount || m_edgeVbo->packCount() != edgePackCount) {
+                    m_allBrushesUngrouped = true;
+                    m_selectedFaceEdgesValid = false;
+                } else if (!m_allBrushesUngrouped) {
+                    for (brushIt = m_invalidBrushes.begin(), brushEnd = m_invalidBrushes.end(); brushIt != brushEnd; ++brushIt)
+                        assignGroups(context, **brushIt, *m_slots[*brushIt]);
+                }
+            }
+            
+            if (m_allBrushesUngrouped) {
+                reassignAllGroups(context);
+            } else {
+                Model::BrushSet::const_iterator brushIt, brushEnd;
+                for (brushIt = m_ungroupedBrushes.begin(), brushEnd = m_ungroupedBrushes.end(); brushIt != brushEnd; ++brushIt) {
+                    Model::Brush* brush = *brushIt;
+                    if (m_invalidBrushes.count(brush) > 0)
+                        continue;
+                    
+                    BrushSlotMap::iterator slotIt = m_slots.find(brush);
+                    if (slotIt != m_slots.end()) {
+                        unassignGroups(*slotIt->second);
+                        assignGroups(context, *brush, *slotIt->second);
+                    }
+                }
+            }
+            
+            m_invalidBrushes.clear();
+            m_ungroupedBrushes.clear();
+            m_allBrushesUngrouped = false;
+            
+            if (!m_selectedFaceEdgesValid)
+                writeSelectedFaceEdges(context);
+        }
+        
+        void BrushRenderer::cull(Culler& culler) {
+            for (size_t i = 0; i < GroupCount; i++) {
+                FaceBucketList::const_iterator bucketIt, bucketEnd;
+                for (bucketIt = m_faceBuckets[i].begin(), bucketEnd = m_faceBuckets[i].end(); bucketIt != bucketEnd; ++bucketIt)
+                    if (*bucketIt != NULL)
+                        (*bucketIt)->visibleRanges.clear();
+                for (bucketIt = m_unindexedFaceBuckets[i].begin(), bucketEnd = m_unindexedFaceBuckets[i].end(); bucketIt != bucketEnd; ++bucketIt)
+                    (*bucketIt)->visibleRanges.clear();
+            }
+            m_visibleChunks.clear();
+            
+            ChunkMap::const_iterator chunkIt, chunkEnd;
+            for (chunkIt = m_chunks.begin(), chunkEnd = m_chunks.end(); chunkIt != chunkEnd; ++chunkIt) {
+                Chunk* chunk = chunkIt->second;
+                if (chunk->brushCount == 0 || culler.cullChunk(chunk->bounds))
+                    continue;
+                
+                m_visibleChunks.push_back(chunk);
+                std::map<FaceBucket*, VertexRangeList>::iterator rangeIt, rangeEnd;
+                for (rangeIt = chunk->faceRanges.begin(), rangeEnd = chunk->faceRanges.end(); rangeIt != rangeEnd; ++rangeIt)
+                    if (!rangeIt->second.empty())
+                        rangeIt->first->visibleRanges.push_back(&rangeIt->second);
+            }
+        }
+        
+        void BrushRenderer::renderFaces(RenderContext& context, Group group, bool grayScale, const Color* tintColor) {
+            assert(group < GroupCount);
+            if (m_faceBuckets[group].empty() && m_unindexedFaceBuckets[group].empty())
+                return;
+            
+            Preferences::PreferenceManager& prefs = Preferences::PreferenceManager::preferences();
+            Utility::Grid& grid = context.grid();
+            
+            ShaderManager& shaderManager = context.shaderManager();
+            ShaderProgram& faceProgram = shaderManager.shaderProgram(Shaders::FaceShader);
+            
+            if (faceProgram.activate()) {
+                SetVboState activateVbo(*m_faceVbo, Vbo::VboActive);
+                
+                Attribute position = Attribute::position3f();
+                Attribute normal = Attribute::normal3f();
+                Attribute texCoord = Attribute::texCoord02f();
+                position.setGLState(0, FaceVertexSize, 0);
+                normal.setGLState(1, FaceVertexSize, FaceNormalOffset);
+                texCoord.setGLState(2, FaceVertexSize, FaceTexCoordOffset);
+                
+                glActiveTexture(GL_TEXTURE0);
+                
+                const bool applyTexture = context.viewOptions().faceRenderMode() == View::ViewOptions::Textured;
+                const Color& faceColor = prefs.getColor(Preferences::FaceColor);
+                faceProgram.setUniformVariable("Brightness", prefs.getFloat(Preferences::RendererBrightness));
+                faceProgram.setUniformVariable("Alpha", 1.0f);
+                faceProgram.setUniformVariable("RenderGrid", grid.visible());
+                faceProgram.setUniformVariable("GridSize", static_cast<float>(grid.actualSize()));
+                faceProgram.setUniformVariable("GridAlpha", prefs.getFloat(Preferences::GridAlpha));
+                faceProgram.setUniformVariable("GridCheckerboard", prefs.getBool(Preferences::GridCheckerboard));
+                faceProgram.setUniformVariable("ApplyTexture", applyTexture);
+                faceProgram.setUniformVariable("ApplyTinting", tintColor != NULL);
+                if (tintColor != NULL)
+                    faceProgram.setUniformVariable("TintColor", *tintColor);
+                faceProgram.setUniformVariable("GrayScale", grayScale);
+                faceProgram.setUniformVariable("CameraPosition", context.camera().position());
+                faceProgram.setUniformVariable("ShadeFaces", context.viewOptions().shadeFaces());
+                faceProgram.setUniformVariable("UseFog", context.viewOptions().useFog());
+                
+                renderFaceBuckets(faceProgram, group, false, applyTexture, faceColor);
+                glDepthMask(GL_FALSE);
+                faceProgram.setUniformVariable("Alpha", prefs.getFloat(Preferences::TransparentFaceAlpha));
+                renderFaceBuckets(faceProgram, group, true, applyTexture, faceColor);
+                glDepthMask(GL_TRUE);
+                
+                texCoord.clearGLState(2);
+                normal.clearGLState(1);
+                position.clearGLState(0);
+                faceProgram.deactivate();
+            }
+        }
+        
+        void BrushRenderer::renderEdges(RenderContext& context, Group group) {
+            assert(group < GroupCount);
+            if (m_visibleChunks.empty())
+                return;
+            
+            ShaderManager& shaderManager = context.shaderManager();
+            ShaderProgram& coloredEdgeProgram = shaderManager.shaderProgram(Shaders::ColoredEdgeShader);
+            if (coloredEdgeProgram.activate()) {
+                SetVboState activateVbo(*m_edgeVbo, Vbo::VboActive);
+                
+                Attribute position = Attribute::position3f();
+                Attribute color = Attribute::color4f();
+                position.setGLState(0, EdgeVertexSize, 0);
+                color.setGLState(1, EdgeVertexSize, EdgeColorOffset);
+                
+                renderEdgeRanges(group, false);
+                
+                color.clearGLState(1);
+                position.clearGLState(0);
+                coloredEdgeProgram.deactivate();
+            }
+        }
+        
+        void BrushRenderer::renderEdges(RenderContext& context, Group group, const Color& color) {
+            assert(group < GroupCount);
+            const bool includeSelectedFaceEdges = group == Selected && m_selectedFaceEdgeBlock != NULL;
+            if (m_visibleChunks.empty() && !includeSelectedFaceEdges)
+                return;
+            
+            ShaderManager& shaderManager = context.shaderManager();
+            ShaderProgram& edgeProgram = shaderManager.shaderProgram(Shaders::EdgeShader);
+            if (edgeProgram.activate()) {
+                SetVboState activateVbo(*m_edgeVbo, Vbo::VboActive);
+                
+                Attribute position = Attribute::position3f();
+                position.setGLState(0, EdgeVertexSize, 0);
+                
+                edgeProgram.setUniformVariable("Color", color);
+                renderEdgeRanges(group, includeSelectedFaceEdges);
+                
+                position.clearGLState(0);
+                edgeProgram.deactivate();
+            }
+        }
+    }
+}
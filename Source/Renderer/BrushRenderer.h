@@ -0,0 +1,246 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TrenchBroom__BrushRenderer__
+#define __TrenchBroom__BrushRenderer__
+
+#include <GL/glew.h>
+#include "Model/BrushTypes.h"
+#include "Model/FaceTypes.h"
+#include "Model/TextureTypes.h"
+#include "Renderer/VertexRangeList.h"
+#include "Utility/Color.h"
+#include "Utility/VecMath.h"
+
+#include <map>
+#include <vector>
+
+using namespace TrenchBroom::VecMath;
+
+namespace TrenchBroom {
+    namespace Model {
+        class MapDocument;
+    }
+    
+    namespace Renderer {
+        class Culler;
+        class RenderContext;
+        class ShaderProgram;
+        class TextureRenderer;
+        class Vbo;
+        class VboBlock;
+        
+        /*
+         * Renders the faces and edges of all brushes of a map. The face triangles and the edges of every brush are
+         * kept in VBO blocks of their own, and every render group keeps the vertex ranges of the brushes which belong
+         * to it. A change of the edit state of a brush only moves its ranges from one group to another, and a change
+         * of its geometry or its textures only rewrites its own blocks.
+         *
+         * The ranges are further split into chunks, which are the cells of a regular grid. Every brush belongs to the
+         * chunk which contains the center of its bounds, and every chunk keeps its own ranges per render group and
+         * texture. Chunks which are not visible to the camera are culled before any ranges are rendered.
+         */
+        class BrushRenderer {
+        public:
+            typedef enum {
+                Unselected = 0,
+                Selected = 1,
+                Locked = 2,
+                Hidden = 3
+            } Group;
+            
+            static const size_t GroupCount = 3;
+            static const float ChunkSize;
+        private:
+            class FaceEntry {
+            public:
+                Model::Face* face;
+                Model::Texture* texture;
+                GLint offset;
+                GLsizei count;
+                
+                FaceEntry(Model::Face* i_face, Model::Texture* i_texture, GLint i_offset, GLsizei i_count) :
+                face(i_face),
+                texture(i_texture),
+                offset(i_offset),
+                count(i_count) {}
+            };
+            
+            typedef std::vector<FaceEntry> FaceEntryList;
+            
+            class FaceBucket {
+            public:
+                Model::Texture* key;
+                TextureRenderer* texture;
+                bool transparent;
+                
+                // the ranges of this bucket in the chunks which passed the culling test in the current frame
+                std::vector<VertexRangeList*> visibleRanges;
+                
+                FaceBucket(Model::Texture* i_key, TextureRenderer* i_texture, bool i_transparent) :
+                key(i_key),
+                texture(i_texture),
+                transparent(i_transparent) {}
+            };
+            
+            /*
+             * The buckets of a group are indexed by the dense index of their texture, shifted by one so that faces
+             * without a texture go into the first bucket. Textures without an index, or whose index is already taken
+             * by another texture, get a bucket in a short list which is searched linearly.
+             */
+            typedef std::vector<FaceBucket*> FaceBucketList;
+            
+            class FaceSpan {
+            public:
+                Model::Texture* texture;
+                FaceBucket* bucket;
+                Group group;
+                GLint index;
+                GLsizei count;
+                size_t handle;
+                
+                FaceSpan(Model::Texture* i_texture, Group i_group, GLint i_index, GLsizei i_count) :
+                texture(i_texture),
+                bucket(NULL),
+                group(i_group),
+                index(i_index),
+                count(i_count),
+                handle(0) {}
+            };
+            
+            typedef std::vector<FaceSpan> FaceSpanList;
+            
+            class ChunkKey {
+            private:
+                int m_x, m_y, m_z;
+            public:
+                ChunkKey(const Vec3f& position);
+                bool operator<(const ChunkKey& other) const;
+            };
+            
+            class Chunk {
+            public:
+                BBoxf bounds;
+                size_t brushCount;
+                std::map<FaceBucket*, VertexRangeList> faceRanges;
+                VertexRangeList edgeRanges[GroupCount];
+                
+                Chunk() :
+                brushCount(0) {}
+            };
+            
+            typedef std::map<ChunkKey, Chunk*> ChunkMap;
+            typedef std::vector<Chunk*> ChunkList;
+            
+            class BrushSlot {
+            public:
+                VboBlock* faceBlock;
+                VboBlock* edgeBlock;
+                FaceEntryList faces;
+                GLsizei edgeVertexCount;
+                
+                // the ranges which are currently registered with the render groups of a chunk
+                Chunk* chunk;
+                FaceSpanList faceSpans;
+                Group edgeGroup;
+                size_t edgeHandle;
+                
+                BrushSlot() :
+                faceBlock(NULL),
+                edgeBlock(NULL),
+                edgeVertexCount(0),
+                chunk(NULL),
+                edgeGroup(Hidden),
+                edgeHandle(0) {}
+            };
+            
+            typedef std::map<Model::Brush*, BrushSlot*> BrushSlotMap;
+            
+            Model::MapDocument& m_document;
+            Vbo* m_faceVbo;
+            Vbo* m_edgeVbo;
+            
+            BrushSlotMap m_slots;
+            FaceBucketList m_faceBuckets[GroupCount];
+            FaceBucketList m_unindexedFaceBuckets[GroupCount];
+            ChunkMap m_chunks;
+            ChunkList m_visibleChunks;
+            
+            Model::BrushSet m_invalidBrushes;
+            Model::BrushSet m_ungroupedBrushes;
+            bool m_allBrushesInvalid;
+            bool m_allBrushesUngrouped;
+            
+            // the edges of selected faces of brushes which are not selected themselves
+            Model::FaceList m_selectedFaces;
+            VboBlock* m_selectedFaceEdgeBlock;
+            GLsizei m_selectedFaceEdgeVertexCount;
+            bool m_selectedFaceEdgesValid;
+            
+            void clearSlots();
+            void removeSlot(Model::Brush* brush);
+            
+            void writeFaces(Model::Brush& brush, BrushSlot& slot);
+            void writeEdges(Model::Brush& brush, BrushSlot& slot);
+            void writeSelectedFaceEdges(RenderContext& context);
+            
+            FaceBucket* createFaceBucket(Model::Texture* texture);
+            FaceBucket& faceBucket(Group group, Model::Texture* texture);
+            Chunk& chunk(const BBoxf& bounds);
+            void assignGroups(RenderContext& context, Model::Brush& brush, BrushSlot& slot);
+            void unassignGroups(BrushSlot& slot);
+            void reassignAllGroups(RenderContext& context);
+            
+            void renderFaceBuckets(ShaderProgram& shader, const FaceBucketList& buckets, bool transparent, bool applyTexture, const Color& faceColor);
+            void renderFaceBuckets(ShaderProgram& shader, Group group, bool transparent, bool applyTexture, const Color& faceColor);
+            void renderEdgeRanges(Group group, bool includeSelectedFaceEdges);
+            
+            // prevent copying
+            BrushRenderer(const BrushRenderer& other);
+            void operator= (const BrushRenderer& other);
+        public:
+            BrushRenderer(Model::MapDocument& document);
+            ~BrushRenderer();
+            
+            void addBrushes(const Model::BrushList& brushes);
+            void removeBrushes(const Model::BrushList& brushes);
+            void invalidateBrushes(const Model::BrushList& brushes);
+            void invalidateAllBrushes();
+            void regroupBrushes(const Model::BrushList& brushes);
+            void regroupAllBrushes();
+            void setSelectedFaces(const Model::FaceList& faces);
+            void invalidateSelectedFaces();
+            void clear();
+            
+            void validate(RenderContext& context);
+            
+            /*
+             * Determines the chunks which are visible in the current frame. Must be called after validating the
+             * renderer and before rendering any faces or edges.
+             */
+            void cull(Culler& culler);
+            
+            void renderFaces(RenderContext& context, Group group, bool grayScale, const Color* tintColor);
+            void renderEdges(RenderContext& context, Group group);
+            void renderEdges(RenderContext& context, Group group, const Color& color);
+        };
+    }
+}
+
+#endif /* defined(__TrenchBroom__BrushRenderer__) */
@@ -34,7 +34,7 @@ namespace TrenchBroom {
         void BspModelRenderer::buildVertexArrays() {
             typedef TexturedPolygonSorter<const Model::BspTexture, Model::BspFace*> FaceSorter;
             typedef FaceSorter::PolygonCollection FaceCollection;
-            typedef FaceSorter::PolygonCollectionMap FaceCollectionMap;
+            typedef FaceSorter::PolygonCollectionList FaceCollectionList;
             
             Model::BspModel& model = *m_bsp.models()[0];
             FaceSorter faceSorter;
@@ -54,24 +54,24 @@ namespace TrenchBroom {
                 faceSorter.addPolygon(&texture, face, face->vertices().size());
             }
             
-            const FaceCollectionMap& faceCollectionMap = faceSorter.collections();
-            FaceCollectionMap::const_iterator it, end;
+            const FaceCollectionList& faceCollections = faceSorter.collections();
+            FaceCollectionList::const_iterator it, end;
             Vec2f texCoords;
             
             m_vbo.map();
-            for (it = faceCollectionMap.begin(), end = faceCollectionMap.end(); it != end; ++it) {
+            for (it = faceCollections.begin(), end = faceCollections.end(); it != end; ++it) {
                 const Model::BspTexture* texture = it->first;
                 Renderer::TextureRenderer* textureRenderer = m_textures[texture];
                 const FaceCollection& faceCollection = it->second;
-                const Model::BspFaceList& collectedFaces = faceCollection.polygons();
-                unsigned int vertexCount = static_cast<unsigned int>(3 * faceCollection.vertexCount() - 6 * collectedFaces.size());
+                const size_t faceCount = faceCollection.polygonCount();
+                unsigned int vertexCount = static_cast<unsigned int>(3 * faceCollection.vertexCount() - 6 * faceCount);
                 
                 VertexArray* vertexArray = new VertexArray(m_vbo, GL_TRIANGLES, vertexCount,
                                                            Attribute::position3f(),
                                                            Attribute::texCoord02f());
                 
-                for (unsigned int i = 0; i < collectedFaces.size(); i++) {
-                    Model::BspFace* face = collectedFaces[i];
+                for (unsigned int i = 0; i < faceCount; i++) {
+                    Model::BspFace* face = faceCollection.polygon(i);
                     const Vec3f::List& vertices = face->vertices();
                     for (unsigned int j = 1; j < vertices.size() - 1; j++) {
                         face->textureCoordinates(vertices[0], texCoords);
@@ -119,6 +119,20 @@ namespace TrenchBroom {
             }
         }
         
+        void BspModelRenderer::renderInstances(ShaderProgram& shaderProgram, unsigned int instanceCount) {
+            if (m_vertexArrays.empty())
+                buildVertexArrays();
+            
+            glActiveTexture(GL_TEXTURE0);
+            for (unsigned int i = 0; i < m_vertexArrays.size(); i++) {
+                TextureVertexArray& textureVertexArray = m_vertexArrays[i];
+                textureVertexArray.texture->activate();
+                shaderProgram.setUniformVariable("Texture", 0);
+                textureVertexArray.vertexArray->renderInstances(instanceCount);
+                textureVertexArray.texture->deactivate();
+            }
+        }
+        
         const Vec3f& BspModelRenderer::center() const {
             return m_bsp.models()[0]->center();
         }
@@ -0,0 +1,95 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Culler.h"
+
+namespace TrenchBroom {
+    namespace Renderer {
+        bool Culler::count(Stats& stats, bool culled) {
+            if (culled)
+                stats.culled++;
+            else
+                stats.drawn++;
+            return culled;
+        }
+        
+        Culler::Culler() :
+        m_maxDistance2(0.0f),
+        m_enabled(false) {}
+        
+        void Culler::update(const Mat4f& projectionMatrix, const Mat4f& viewMatrix, const Vec3f& position, float maxDistance) {
+            // a point p is within the frustum if -w <= x, y, z <= w for its clip coordinates (x, y, z, w) = M * p, so
+            // every plane is the sum or the difference of the last row of M and one of the other rows
+            const Mat4f matrix = projectionMatrix * viewMatrix;
+            for (size_t i = 0; i < 6; i++) {
+                const size_t row = i / 2;
+                const float sign = i % 2 == 0 ? 1.0f : -1.0f;
+                
+                Vec3f normal;
+                for (size_t j = 0; j < 3; j++)
+                    normal[j] = -(matrix[j][3] + sign * matrix[j][row]);
+                float distance = matrix[3][3] + sign * matrix[3][row];
+                
+                const float length = normal.length();
+                m_planes[i] = Planef(normal / length, distance / length);
+            }
+            
+            m_position = position;
+            m_maxDistance2 = maxDistance * maxDistance;
+            m_enabled = true;
+            m_chunkStats = Stats();
+            m_entityStats = Stats();
+        }
+        
+        void Culler::disable() {
+            m_enabled = false;
+            m_chunkStats = Stats();
+            m_entityStats = Stats();
+        }
+        
+        bool Culler::culled(const BBoxf& bounds) const {
+            if (!m_enabled)
+                return false;
+            
+            for (size_t i = 0; i < 6; i++) {
+                // the corner of the box which is farthest inside of the plane
+                const Planef& plane = m_planes[i];
+                const Vec3f corner(plane.normal.x() > 0.0f ? bounds.min.x() : bounds.max.x(),
+                                   plane.normal.y() > 0.0f ? bounds.min.y() : bounds.max.y(),
+                                   plane.normal.z() > 0.0f ? bounds.min.z() : bounds.max.z());
+                if (plane.pointDistance(corner) > 0.0f)
+                    return true;
+            }
+            
+            if (m_maxDistance2 > 0.0f) {
+                float distance2 = 0.0f;
+                for (size_t i = 0; i < 3; i++) {
+                    if (m_position[i] < bounds.min[i])
+                        distance2 += (bounds.min[i] - m_position[i]) * (bounds.min[i] - m_position[i]);
+                    else if (m_position[i] > bounds.max[i])
+                        distance2 += (m_position[i] - bounds.max[i]) * (m_position[i] - bounds.max[i]);
+                }
+                if (distance2 > m_maxDistance2)
+                    return true;
+            }
+            
+            return false;
+        }
+    }
+}
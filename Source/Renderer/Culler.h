@@ -0,0 +1,97 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TrenchBroom__Culler__
+#define __TrenchBroom__Culler__
+
+#include "Utility/VecMath.h"
+
+#include <cmath>
+
+using namespace TrenchBroom::VecMath;
+
+namespace TrenchBroom {
+    namespace Renderer {
+        /*
+         * Decides which parts of the scene are visible to the camera before any GL calls are issued. A box is culled if
+         * it lies entirely outside of the view frustum or if it is farther away from the camera than the maximum
+         * distance. The culler counts the drawn and the culled boxes until it is updated for the next frame.
+         *
+         * The culler only depends on the camera matrices, so it can be used (and tested) without a GL context.
+         */
+        class Culler {
+        public:
+            class Stats {
+            public:
+                size_t drawn;
+                size_t culled;
+                
+                Stats() :
+                drawn(0),
+                culled(0) {}
+            };
+        private:
+            // the normals point out of the frustum: left, right, bottom, top, near, far
+            Planef m_planes[6];
+            Vec3f m_position;
+            float m_maxDistance2;
+            bool m_enabled;
+            Stats m_chunkStats;
+            Stats m_entityStats;
+            
+            static bool count(Stats& stats, bool culled);
+        public:
+            Culler();
+            
+            /*
+             * Sets up the culler for a new frame and resets the statistics. A maximum distance of 0 disables distance
+             * culling.
+             */
+            void update(const Mat4f& projectionMatrix, const Mat4f& viewMatrix, const Vec3f& position, float maxDistance);
+            void disable();
+            
+            bool culled(const BBoxf& bounds) const;
+            
+            /*
+             * Returns 0 if the culler is disabled or does not cull by distance.
+             */
+            inline float maxDistance() const {
+                return m_enabled ? std::sqrt(m_maxDistance2) : 0.0f;
+            }
+            
+            inline bool cullChunk(const BBoxf& bounds) {
+                return count(m_chunkStats, culled(bounds));
+            }
+            
+            inline bool cullEntity(const BBoxf& bounds) {
+                return count(m_entityStats, culled(bounds));
+            }
+            
+            inline const Stats& chunkStats() const {
+                return m_chunkStats;
+            }
+            
+            inline const Stats& entityStats() const {
+                return m_entityStats;
+            }
+        };
+    }
+}
+
+#endif /* defined(__TrenchBroom__Culler__) */
@@ -39,6 +39,12 @@ namespace TrenchBroom {
             virtual void render(ShaderProgram& shaderProgram, Transformation& transformation, const Model::Entity& entity);
             virtual void render(ShaderProgram& shaderProgram, Transformation& transformation, const Vec3f& position, const Quatf& rotation);
             virtual void render(ShaderProgram& shaderProgram) = 0;
+            
+            /*
+             * Renders the given number of instances of the model in one draw call. The instance transformations must be
+             * supplied by the shader program. Requires ARB_draw_instanced.
+             */
+            virtual void renderInstances(ShaderProgram& shaderProgram, unsigned int instanceCount) = 0;
             virtual const Vec3f& center() const = 0;
             virtual const BBoxf& bounds() const = 0;
             virtual BBoxf boundsAfterTransformation(const Mat4f& transformation) const = 0;
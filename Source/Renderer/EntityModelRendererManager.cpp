@@ -21,6 +21,7 @@
 
 #include <GL/glew.h>
 #include "Model/Alias.h"
+#include "Model/AliasManager.h"
 #include "Model/Bsp.h"
 #include "Model/Entity.h"
 #include "Model/EntityDefinition.h"
@@ -46,6 +47,15 @@ namespace TrenchBroom {
             return Utility::toLower(key.str());
         }
 
+        bool EntityModelRendererManager::takeRendererBudget() {
+            if (m_rendererBudget == 0) {
+                m_deferred = true;
+                return false;
+            }
+            m_rendererBudget--;
+            return true;
+        }
+        
         EntityModelRenderer* EntityModelRendererManager::modelRenderer(const Model::ModelDefinition& modelDefinition, const StringList& searchPaths) {
             assert(m_palette != NULL);
             IO::FileManager fileManager;
@@ -66,22 +76,27 @@ namespace TrenchBroom {
 
             String modelName = Utility::toLower(modelDefinition.name().substr(1));
             String ext = Utility::toLower(fileManager.pathExtension(modelName));
+            bool loading = false;
             if (ext == "mdl") {
                 unsigned int skinIndex = modelDefinition.skinIndex();
                 unsigned int frameIndex = modelDefinition.frameIndex();
 
                 Model::AliasManager& aliasManager = *Model::AliasManager::sharedManager;
-                const Model::Alias* alias = aliasManager.alias(modelName, searchPaths, m_console);
+                const Model::Alias* alias = aliasManager.requestAlias(modelName, searchPaths, m_console, loading);
 
                 if (alias != NULL && skinIndex < alias->skins().size() && frameIndex < alias->frames().size()) {
+                    if (!takeRendererBudget())
+                        return NULL;
                     Renderer::EntityModelRenderer* renderer = new AliasModelRenderer(*alias, frameIndex, skinIndex, *m_vbo, *m_palette);
                     m_modelRenderers[key] = renderer;
                     return renderer;
                 }
             } else if (ext == "bsp") {
                 Model::BspManager& bspManager = *Model::BspManager::sharedManager;
-                const Model::Bsp* bsp = bspManager.bsp(modelName, searchPaths, m_console);
+                const Model::Bsp* bsp = bspManager.requestBsp(modelName, searchPaths, m_console, loading);
                 if (bsp != NULL) {
+                    if (!takeRendererBudget())
+                        return NULL;
                     Renderer::EntityModelRenderer* renderer = new BspModelRenderer(*bsp, *m_vbo, *m_palette);
                     m_modelRenderers[key] = renderer;
                     return renderer;
@@ -90,6 +105,8 @@ namespace TrenchBroom {
                 m_console.warn("Unknown model type '%s'", ext.c_str());
             }
 
+            if (loading)
+                return NULL;
             m_mismatches.insert(key);
             return NULL;
         }
@@ -97,7 +114,10 @@ namespace TrenchBroom {
         EntityModelRendererManager::EntityModelRendererManager(Utility::Console& console) :
         m_palette(NULL),
         m_console(console),
-        m_valid(true) {
+        m_valid(true),
+        m_rendererBudget(RendererBudget),
+        m_deferred(false),
+        m_generation(0) {
             m_vbo = new Renderer::Vbo(GL_ARRAY_BUFFER, 0xFFFF);
         }
 
@@ -134,6 +154,20 @@ namespace TrenchBroom {
             m_mismatches.clear();
         }
 
+        void EntityModelRendererManager::update() {
+            const bool aliasesLoaded = Model::AliasManager::sharedManager->collectLoadedModels(m_console);
+            const bool bspsLoaded = Model::BspManager::sharedManager->collectLoadedModels(m_console);
+            if (aliasesLoaded || bspsLoaded || m_deferred) {
+                m_generation++;
+                m_deferred = false;
+            }
+            m_rendererBudget = RendererBudget;
+        }
+        
+        bool EntityModelRendererManager::pending() const {
+            return m_deferred || Model::AliasManager::sharedManager->loading() || Model::BspManager::sharedManager->loading();
+        }
+
         void EntityModelRendererManager::setPalette(const Palette& palette) {
             if (&palette == m_palette)
                 return;
@@ -42,8 +42,23 @@ namespace TrenchBroom {
         class Palette;
         class Vbo;
         
+        /*
+         * Creates the renderers for entity models. The models are loaded in the background, and no renderer is returned
+         * for a model until it has been loaded. To spread the uploading of the models' vertex data over several frames,
+         * only a limited number of renderers is created between two calls to update.
+         *
+         * Whenever a request that was previously answered with NULL might succeed, the generation is incremented so that
+         * the callers know that they should request their renderers again.
+         */
         class EntityModelRendererManager {
+        public:
+            /*
+             * The interval in milliseconds in which views should call update while there are pending requests.
+             */
+            static const int UpdateInterval = 50;
         private:
+            static const size_t RendererBudget = 16;
+            
             typedef std::map<String, EntityModelRenderer*> EntityModelRendererCache;
             typedef std::set<String> MismatchCache;
             
@@ -54,7 +69,11 @@ namespace TrenchBroom {
             EntityModelRendererCache m_modelRenderers;
             MismatchCache m_mismatches;
             bool m_valid;
+            size_t m_rendererBudget;
+            bool m_deferred;
+            unsigned int m_generation;
 
+            bool takeRendererBudget();
             const String modelRendererKey(const Model::ModelDefinition& modelDefinition, const StringList& searchPaths);
             EntityModelRenderer* modelRenderer(const Model::ModelDefinition& modelDefinition, const StringList& searchPaths);
 
@@ -70,6 +89,17 @@ namespace TrenchBroom {
             void clear();
             void clearMismatches();
             
+            /*
+             * Collects the models that have finished loading and renews the renderer budget. Must be called before
+             * rendering a frame.
+             */
+            void update();
+            bool pending() const;
+            
+            inline unsigned int generation() const {
+                return m_generation;
+            }
+            
             void setPalette(const Palette& palette);
             
             void activate();
@@ -20,18 +20,34 @@
 #include "EntityRenderer.h"
 
 #include "Model/MapDocument.h"
+#include "Renderer/Culler.h"
 #include "Renderer/EntityModelRenderer.h"
 #include "Renderer/EntityModelRendererManager.h"
+#include "Renderer/InstancedVertexArray.h"
+#include "Renderer/PointHandleRenderer.h"
 #include "Renderer/SharedResources.h"
 #include "Renderer/Shader/ShaderManager.h"
 #include "Renderer/Shader/ShaderProgram.h"
 #include "Renderer/Text/FontManager.h"
 #include "Utility/Preferences.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 
 namespace TrenchBroom {
     namespace Renderer {
+        EntityRenderer::ModelInstanceAttributes::ModelInstanceAttributes() :
+        positions(new InstanceAttributesVec4f("instancePosition", Vec4f::List())),
+        rotations(new InstanceAttributesVec4f("instanceRotation", Vec4f::List())) {}
+        
+        EntityRenderer::ModelInstanceAttributes::~ModelInstanceAttributes() {
+            delete positions;
+            positions = NULL;
+            delete rotations;
+            rotations = NULL;
+        }
+        
         EntityRenderer::EntityClassnameAnchor::EntityClassnameAnchor(Model::Entity& entity, Renderer::EntityModelRenderer* renderer) :
         m_entity(&entity),
         m_renderer(renderer) {}
@@ -129,23 +145,53 @@ namespace TrenchBroom {
         }
 
         void EntityRenderer::validateModels(RenderContext& context) {
-            m_modelRenderers.clear();
+            m_modelInstances.clear();
 
-            EntityModelRendererManager& modelRendererManager = m_document.sharedResources().modelRendererManager();
             Model::EntitySet::iterator entityIt, entityEnd;
             for (entityIt = m_entities.begin(), entityEnd = m_entities.end(); entityIt != entityEnd; ++entityIt) {
                 Model::Entity* entity = *entityIt;
-                const String* classname = entity->classname();
-                if (classname != NULL) {
-                    EntityModelRenderer* renderer = modelRendererManager.modelRenderer(*entity, m_document.searchPaths());
-                    if (renderer != NULL)
-                        m_modelRenderers[entity] = CachedEntityModelRenderer(renderer, *classname);
-                }
+                if (entity->classname() != NULL)
+                    addModel(*entity);
             }
 
             m_modelRendererCacheValid = true;
         }
 
+        void EntityRenderer::validateModelTransformations() {
+            // only the instances whose transformations actually changed are marked for uploading
+            EntityModelInstances::GroupMap& groups = m_modelInstances.groups();
+            EntityModelInstances::GroupMap::iterator it, end;
+            for (it = groups.begin(), end = groups.end(); it != end; ++it) {
+                EntityModelInstances::Group& group = it->second;
+                for (size_t i = 0; i < group.instanceCount(); i++) {
+                    Model::Entity* entity = group.instance(i);
+                    group.setTransformation(i, entity->origin(), entity->rotation());
+                }
+            }
+            
+            m_modelTransformationsValid = true;
+        }
+        
+        EntityModelRenderer* EntityRenderer::addModel(Model::Entity& entity) {
+            EntityModelRendererManager& modelRendererManager = m_document.sharedResources().modelRendererManager();
+            EntityModelRenderer* renderer = modelRendererManager.modelRenderer(entity, m_document.searchPaths());
+            if (renderer != NULL)
+                m_modelInstances.addInstance(renderer, &entity, entity.origin(), entity.rotation());
+            return renderer;
+        }
+        
+        void EntityRenderer::deleteUnusedModelInstanceAttributes() {
+            ModelInstanceAttributesMap::iterator it = m_modelInstanceAttributes.begin();
+            while (it != m_modelInstanceAttributes.end()) {
+                if (m_modelInstances.group(it->first) == NULL) {
+                    delete it->second;
+                    m_modelInstanceAttributes.erase(it++);
+                } else {
+                    ++it;
+                }
+            }
+        }
+
         void EntityRenderer::renderBounds(RenderContext& context) {
             if (m_boundsVertexArray == NULL)
                 return;
@@ -199,15 +245,72 @@ namespace TrenchBroom {
 
         }
 
-        void EntityRenderer::renderModels(RenderContext& context) {
-            if (m_modelRenderers.empty())
+        void EntityRenderer::renderModels(ShaderProgram& program, RenderContext& context, Culler* culler) {
+            EntityModelInstances::GroupMap& groups = m_modelInstances.groups();
+            EntityModelInstances::GroupMap::iterator it, end;
+            for (it = groups.begin(), end = groups.end(); it != end; ++it) {
+                EntityModelRenderer* renderer = it->first;
+                const EntityModelInstances::Group& group = it->second;
+                for (size_t i = 0; i < group.instanceCount(); i++) {
+                    Model::Entity* entity = group.instance(i);
+                    if (context.filter().entityVisible(*entity) && (culler == NULL || !culler->cullEntity(entity->bounds())))
+                        renderer->render(program, context.transformation(), *entity);
+                }
+            }
+        }
+        
+        void EntityRenderer::renderModelInstances(ShaderProgram& program, RenderContext& context, Culler* culler) {
+            if (!m_modelTransformationsValid)
+                validateModelTransformations();
+            
+            EntityModelInstances::GroupMap& groups = m_modelInstances.groups();
+            EntityModelInstances::GroupMap::iterator it, end;
+            for (it = groups.begin(), end = groups.end(); it != end; ++it) {
+                EntityModelRenderer* renderer = it->first;
+                EntityModelInstances::Group& group = it->second;
+                
+                /*
+                 * Culled instances are hidden like filtered ones. Only the instances whose visibility changed since
+                 * the last frame are uploaded again.
+                 */
+                for (size_t i = 0; i < group.instanceCount(); i++) {
+                    const Model::Entity& entity = *group.instance(i);
+                    group.setVisible(i, context.filter().entityVisible(entity) && (culler == NULL || !culler->cullEntity(entity.bounds())));
+                }
+                
+                ModelInstanceAttributes*& attributes = m_modelInstanceAttributes[renderer];
+                if (attributes == NULL) {
+                    attributes = new ModelInstanceAttributes();
+                    attributes->positions->updateValues(group.positions(), 0, group.instanceCount());
+                    attributes->rotations->updateValues(group.rotations(), 0, group.instanceCount());
+                    group.validate();
+                } else if (group.dirty()) {
+                    attributes->positions->updateValues(group.positions(), group.dirtyBegin(), group.dirtyEnd());
+                    attributes->rotations->updateValues(group.rotations(), group.dirtyBegin(), group.dirtyEnd());
+                    group.validate();
+                }
+                
+                attributes->positions->activate(program, 1);
+                attributes->rotations->activate(program, 2);
+                renderer->renderInstances(program, static_cast<unsigned int>(group.instanceCount()));
+                attributes->rotations->deactivate(2);
+                attributes->positions->deactivate(1);
+            }
+            glActiveTexture(GL_TEXTURE0);
+            
+            deleteUnusedModelInstanceAttributes();
+        }
+        
+        void EntityRenderer::renderModels(RenderContext& context, Culler* culler) {
+            if (m_modelInstances.empty())
                 return;
 
             Preferences::PreferenceManager& prefs = Preferences::PreferenceManager::preferences();
             EntityModelRendererManager& modelRendererManager = m_document.sharedResources().modelRendererManager();
 
+            const bool instancing = PointHandleRenderer::instancingSupported();
             ShaderManager& shaderManager = m_document.sharedResources().shaderManager();
-            ShaderProgram& entityModelProgram = shaderManager.shaderProgram(Shaders::EntityModelShader);
+            ShaderProgram& entityModelProgram = shaderManager.shaderProgram(instancing ? Shaders::InstancedEntityModelShader : Shaders::EntityModelShader);
 
             if (entityModelProgram.activate()) {
                 modelRendererManager.activate();
@@ -216,14 +319,10 @@ namespace TrenchBroom {
                 entityModelProgram.setUniformVariable("TintColor", m_tintColor);
                 entityModelProgram.setUniformVariable("GrayScale", m_grayscale);
 
-                EntityModelRenderers::iterator it, end;
-                for (it = m_modelRenderers.begin(), end = m_modelRenderers.end(); it != end; ++it) {
-                    Model::Entity* entity = it->first;
-                    if (context.filter().entityVisible(*entity)) {
-                        EntityModelRenderer* renderer = it->second.renderer;
-                        renderer->render(entityModelProgram, context.transformation(), *entity);
-                    }
-                }
+                if (instancing)
+                    renderModelInstances(entityModelProgram, context, culler);
+                else
+                    renderModels(entityModelProgram, context, culler);
 
                 modelRendererManager.deactivate();
                 entityModelProgram.deactivate();
@@ -236,6 +335,7 @@ namespace TrenchBroom {
         m_boundsVertexArray(NULL),
         m_boundsValid(true),
         m_modelRendererCacheValid(true),
+        m_modelTransformationsValid(true),
         m_classnameRenderer(NULL),
         m_classnameColor(1.0f, 1.0f, 1.0f, 1.0f),
         m_classnameBackgroundColor(0.0f, 0.0f, 0.0f, 0.6f),
@@ -260,6 +360,10 @@ namespace TrenchBroom {
         EntityRenderer::~EntityRenderer() {
             delete m_boundsVertexArray;
             m_boundsVertexArray = NULL;
+            ModelInstanceAttributesMap::iterator it, end;
+            for (it = m_modelInstanceAttributes.begin(), end = m_modelInstanceAttributes.end(); it != end; ++it)
+                delete it->second;
+            m_modelInstanceAttributes.clear();
             delete m_classnameRenderer;
             m_classnameRenderer = NULL;
         }
@@ -272,16 +376,11 @@ namespace TrenchBroom {
             if (!m_entities.insert(&entity).second)
                 return;
 
-            EntityModelRendererManager& modelRendererManager = m_document.sharedResources().modelRendererManager();
-
             const String* classname = entity.classname();
             if (classname == NULL)
                 classname = &Model::Entity::NoClassnameValue;
             if (classname != NULL) {
-                EntityModelRenderer* renderer = modelRendererManager.modelRenderer(entity, m_document.searchPaths());
-                if (renderer != NULL)
-                    m_modelRenderers[&entity] = CachedEntityModelRenderer(renderer, *classname);
-
+                EntityModelRenderer* renderer = addModel(entity);
                 m_classnameRenderer->addString(&entity, *classname, Text::TextAnchor::Ptr(new EntityClassnameAnchor(entity, renderer)));
             }
 
@@ -294,18 +393,13 @@ namespace TrenchBroom {
             if (entities.empty())
                 return;
 
-            EntityModelRendererManager& modelRendererManager = m_document.sharedResources().modelRendererManager();
-
             for (unsigned int i = 0; i < entities.size(); i++) {
                 Model::Entity* entity = entities[i];
                 const String* classname = entity->classname();
                 if (classname == NULL)
                     classname = &Model::Entity::NoClassnameValue;
                 if (classname != NULL) {
-                    EntityModelRenderer* renderer = modelRendererManager.modelRenderer(*entity, m_document.searchPaths());
-                    if (renderer != NULL)
-                        m_modelRenderers[entity] = CachedEntityModelRenderer(renderer, *classname);
-
+                    EntityModelRenderer* renderer = addModel(*entity);
                     m_classnameRenderer->addString(entity, *classname, Text::TextAnchor::Ptr(new EntityClassnameAnchor(*entity, renderer)));
                 }
             }
@@ -316,6 +410,7 @@ namespace TrenchBroom {
 
         void EntityRenderer::invalidateBounds() {
             m_boundsValid = false;
+            m_modelTransformationsValid = false;
         }
 
         void EntityRenderer::invalidateModels() {
@@ -325,13 +420,14 @@ namespace TrenchBroom {
         void EntityRenderer::clear() {
             m_entities.clear();
             m_boundsValid = false;
-            m_modelRenderers.clear();
+            m_modelInstances.clear();
             m_modelRendererCacheValid = true;
+            m_modelTransformationsValid = true;
             m_classnameRenderer->clear();
         }
 
         void EntityRenderer::removeEntity(Model::Entity& entity) {
-            m_modelRenderers.erase(&entity);
+            m_modelInstances.removeInstance(&entity);
             m_classnameRenderer->removeString(&entity);
             m_entities.erase(&entity);
             m_boundsValid = false;
@@ -343,21 +439,21 @@ namespace TrenchBroom {
 
             for (unsigned int i = 0; i < entities.size(); i++) {
                 Model::Entity* entity = entities[i];
-                m_modelRenderers.erase(entity);
+                m_modelInstances.removeInstance(entity);
                 m_classnameRenderer->removeString(entity);
                 m_entities.erase(entity);
             }
             m_boundsValid = false;
         }
 
-        void EntityRenderer::render(RenderContext& context) {
+        void EntityRenderer::render(RenderContext& context, Culler* culler) {
             if (!m_boundsValid)
                 validateBounds(context);
             if (!m_modelRendererCacheValid)
                 validateModels(context);
 
             if (context.viewOptions().showEntityModels())
-                renderModels(context);
+                renderModels(context, culler);
             if (context.viewOptions().showEntityBounds())
                 renderBounds(context);
             if (context.viewOptions().showEntityClassnames())
@@ -21,6 +21,7 @@
 #define __TrenchBroom__EntityRenderer__
 
 #include "Model/EntityTypes.h"
+#include "Renderer/ModelInstanceGroups.h"
 #include "Renderer/RenderContext.h"
 #include "Renderer/Shader/Shader.h"
 #include "Renderer/Text/TextRenderer.h"
@@ -38,22 +39,29 @@ namespace TrenchBroom {
     }
     
     namespace Renderer {
+        class Culler;
         class EntityModelRenderer;
+        class InstanceAttributesVec4f;
+        class ShaderProgram;
         class Vbo;
         class VertexArray;
         
         class EntityRenderer {
         private:
-            class CachedEntityModelRenderer {
+            /*
+             * The instance textures which hold the transformations of the entities which share a model renderer.
+             */
+            class ModelInstanceAttributes {
             public:
-                EntityModelRenderer* renderer;
-                String classname;
+                InstanceAttributesVec4f* positions;
+                InstanceAttributesVec4f* rotations;
                 
-                CachedEntityModelRenderer() : renderer(NULL), classname("") {}
-                
-                CachedEntityModelRenderer(EntityModelRenderer* i_renderer, const String& i_classname) :
-                renderer(i_renderer),
-                classname(i_classname) {}
+                ModelInstanceAttributes();
+                ~ModelInstanceAttributes();
+            private:
+                // prevent copying
+                ModelInstanceAttributes(const ModelInstanceAttributes& other);
+                void operator= (const ModelInstanceAttributes& other);
             };
             
             class EntityClassnameAnchor : public Text::TextAnchor {
@@ -68,7 +76,8 @@ namespace TrenchBroom {
             };
             
             typedef Model::Entity* EntityKey;
-            typedef std::map<EntityKey, CachedEntityModelRenderer> EntityModelRenderers;
+            typedef ModelInstanceGroups<EntityModelRenderer*, EntityKey> EntityModelInstances;
+            typedef std::map<EntityModelRenderer*, ModelInstanceAttributes*> ModelInstanceAttributesMap;
             typedef Text::TextRenderer<EntityKey> EntityClassnameRenderer;
             
             class EntityClassnameFilter : public EntityClassnameRenderer::TextRendererFilter {
@@ -82,8 +91,10 @@ namespace TrenchBroom {
             Model::EntitySet m_entities;
             VertexArray* m_boundsVertexArray;
             bool m_boundsValid;
-            EntityModelRenderers m_modelRenderers;
+            EntityModelInstances m_modelInstances;
             bool m_modelRendererCacheValid;
+            bool m_modelTransformationsValid;
+            ModelInstanceAttributesMap m_modelInstanceAttributes;
             EntityClassnameRenderer* m_classnameRenderer;
             
             Color m_classnameColor;
@@ -103,10 +114,15 @@ namespace TrenchBroom {
             void writeBounds(RenderContext& context, const Model::EntityList& entities);
             void validateBounds(RenderContext& context);
             void validateModels(RenderContext& context);
+            void validateModelTransformations();
+            EntityModelRenderer* addModel(Model::Entity& entity);
+            void deleteUnusedModelInstanceAttributes();
             
             void renderBounds(RenderContext& context);
             void renderClassnames(RenderContext& context);
-            void renderModels(RenderContext& context);
+            void renderModels(ShaderProgram& program, RenderContext& context, Culler* culler);
+            void renderModelInstances(ShaderProgram& program, RenderContext& context, Culler* culler);
+            void renderModels(RenderContext& context, Culler* culler);
             void renderFigures(RenderContext& context);
 
             // prevent copying
@@ -172,7 +188,12 @@ namespace TrenchBroom {
             void invalidateModels();
             void clear();
             
-            void render(RenderContext& context);
+            /*
+             * Renders the entities. If a culler is given, the models of entities which are not visible to the camera
+             * are skipped. If instancing is supported, all entities which share a model are drawn with one instanced
+             * draw call, and only the culler's maximum distance is applied.
+             */
+            void render(RenderContext& context, Culler* culler = NULL);
         };
     }
 }
@@ -37,25 +37,25 @@ namespace TrenchBroom {
         String FaceRenderer::AlphaBlendedTextures[] = {"clip", "hint", /*"skip",*/ "hintskip", "trigger"};
 
         void FaceRenderer::writeFaceData(Vbo& vbo, TextureRendererManager& textureRendererManager, const Sorter& faceSorter) {
-            const FaceCollectionMap& faceCollectionMap = faceSorter.collections();
-            if (faceCollectionMap.empty())
+            const FaceCollectionList& faceCollections = faceSorter.collections();
+            if (faceCollections.empty())
                 return;
             
-            FaceCollectionMap::const_iterator it, end;
-            for (it = faceCollectionMap.begin(), end = faceCollectionMap.end(); it != end; ++it) {
+            FaceCollectionList::const_iterator it, end;
+            for (it = faceCollections.begin(), end = faceCollections.end(); it != end; ++it) {
                 Model::Texture* texture = it->first;
                 TextureRenderer* textureRenderer = texture != NULL ? &textureRendererManager.renderer(texture) : NULL;
                 const FaceCollection& faceCollection = it->second;
-                const Model::FaceList& faces = faceCollection.polygons();
-                const size_t vertexCount = 3 * faceCollection.vertexCount() - 6 * faces.size();
+                const size_t faceCount = faceCollection.polygonCount();
+                const size_t vertexCount = 3 * faceCollection.vertexCount() - 6 * faceCount;
                 VertexArray* vertexArray = new VertexArray(vbo, GL_TRIANGLES, vertexCount,
                                                            Attribute::position3f(),
                                                            Attribute::normal3f(),
                                                            Attribute::texCoord02f(),
                                                            0);
                 
-                for (size_t i = 0; i < faces.size(); i++) {
-                    Model::Face* face = faces[i];
+                for (size_t i = 0; i < faceCount; i++) {
+                    Model::Face* face = faceCollection.polygon(i);
                     vertexArray->addAttributes(face->cachedVertices());
                 }
                 
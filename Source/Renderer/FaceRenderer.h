@@ -40,7 +40,7 @@ namespace TrenchBroom {
             typedef TexturedPolygonSorter<Model::Texture, Model::Face*> Sorter;
         protected:
             typedef Sorter::PolygonCollection FaceCollection;
-            typedef Sorter::PolygonCollectionMap FaceCollectionMap;
+            typedef Sorter::PolygonCollectionList FaceCollectionList;
 
             Color m_faceColor;
             TextureVertexArrayList m_vertexArrays;
@@ -48,6 +48,12 @@ namespace TrenchBroom {
             
             static String AlphaBlendedTextures[];
             
+            void writeFaceData(Vbo& vbo, TextureRendererManager& textureRendererManager, const Sorter& faceSorter);
+            void render(RenderContext& context, bool grayScale, const Color* tintColor);
+            void renderOpaqueFaces(ShaderProgram& shader, const bool applyTexture);
+            void renderTransparentFaces(ShaderProgram& shader, const bool applyTexture);
+            void renderFaces(const TextureVertexArrayList& vertexArrays, ShaderProgram& shader, const bool applyTexture);
+        public:
             inline static bool alphaBlend(const String& textureName) {
                 if (textureName.empty())
                     return false;
@@ -59,12 +65,6 @@ namespace TrenchBroom {
                 return false;
             }
             
-            void writeFaceData(Vbo& vbo, TextureRendererManager& textureRendererManager, const Sorter& faceSorter);
-            void render(RenderContext& context, bool grayScale, const Color* tintColor);
-            void renderOpaqueFaces(ShaderProgram& shader, const bool applyTexture);
-            void renderTransparentFaces(ShaderProgram& shader, const bool applyTexture);
-            void renderFaces(const TextureVertexArrayList& vertexArrays, ShaderProgram& shader, const bool applyTexture);
-        public:
             FaceRenderer(Vbo& vbo, TextureRendererManager& textureRendererManager, const Sorter& faceSorter, const Color& faceColor);
             
             void render(RenderContext& context, bool grayScale);
@@ -24,6 +24,7 @@
 #include "Utility/List.h"
 #include "Utility/String.h"
 
+#include <algorithm>
 #include <cassert>
 #include <vector>
 
@@ -41,20 +42,30 @@ namespace TrenchBroom {
             GLint m_textureSize;
         protected:
             virtual GLint createTexture(GLuint textureId) = 0;
+            virtual void updateTexture(GLint textureSize) {}
+            
+            inline bool hasTexture() const {
+                return m_textureId > 0;
+            }
+            
+            inline void deleteTexture() {
+                if (m_textureId > 0) {
+                    glDeleteTextures(1, &m_textureId);
+                    m_textureId = 0;
+                }
+            }
         public:
             InstanceAttributes(const String& name) :
             m_name(name),
-            m_textureId(0) {
+            m_textureId(0),
+            m_textureSize(0) {
                 StringStream stream;
                 stream << m_name << "Size";
                 m_textureSizeName = stream.str();
             }
             
             virtual ~InstanceAttributes() {
-                if (m_textureId > 0) {
-                    glDeleteTextures(1, &m_textureId);
-                    m_textureId = 0;
-                }
+                deleteTexture();
             }
 
             inline const String& name() const {
@@ -77,25 +88,45 @@ namespace TrenchBroom {
                     m_textureSize = createTexture(m_textureId);
                 } else {
                     glBindTexture(GL_TEXTURE_2D, m_textureId);
+                    updateTexture(m_textureSize);
                 }
             }
             
             inline void cleanup() {
                 glBindTexture(GL_TEXTURE_2D, 0);
             }
+            
+            /*
+             * Binds the texture to the given texture unit and passes it and its size to the given program.
+             */
+            inline void activate(ShaderProgram& program, unsigned int textureNum) {
+                glActiveTexture(GL_TEXTURE0 + textureNum);
+                setup();
+                program.setUniformVariable(m_name, static_cast<int>(textureNum));
+                program.setUniformVariable(m_textureSizeName, m_textureSize);
+            }
+            
+            inline void deactivate(unsigned int textureNum) {
+                glActiveTexture(GL_TEXTURE0 + textureNum);
+                cleanup();
+            }
         };
         
         class InstanceAttributesVec4f : public InstanceAttributes {
         private:
             Vec4f::List m_vertices;
+            size_t m_offset;
         protected:
             GLint createTexture(GLuint textureId) {
+                assert(m_offset == 0);
+                
                 size_t size = 1;
                 while (size * size < m_vertices.size())
                     size *= 2;
 
                 unsigned char* buffer = new unsigned char[size * size * 4 * sizeof(float)];
-                memcpy(buffer, reinterpret_cast<const unsigned char*>(&m_vertices.front()), m_vertices.size() * 4 * 4);
+                if (!m_vertices.empty())
+                    memcpy(buffer, reinterpret_cast<const unsigned char*>(&m_vertices.front()), m_vertices.size() * 4 * 4);
                 
                 // requires GL_ARB_texture_float, see http://www.opengl.org/wiki/Floating_point_and_mipmapping_and_filtering
                 GLint textureSize = static_cast<GLint>(size);
@@ -110,10 +141,54 @@ namespace TrenchBroom {
                 
                 return textureSize;
             }
+            
+            void updateTexture(GLint textureSize) {
+                if (m_vertices.empty())
+                    return;
+                
+                // the texels are laid out row by row, so the range is uploaded in one piece per row it touches
+                const size_t size = static_cast<size_t>(textureSize);
+                const size_t end = m_offset + m_vertices.size();
+                size_t index = m_offset;
+                while (index < end) {
+                    const size_t x = index % size;
+                    const size_t y = index / size;
+                    const size_t count = std::min(size - x, end - index);
+                    glTexSubImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(x), static_cast<GLint>(y), static_cast<GLsizei>(count), 1, GL_RGBA, GL_FLOAT, reinterpret_cast<const GLvoid*>(&m_vertices[index - m_offset]));
+                    index += count;
+                }
+                
+                m_vertices.clear();
+                m_offset = 0;
+            }
         public:
             InstanceAttributesVec4f(const String& name, const Vec4f::List& vertices) :
             InstanceAttributes(name),
-            m_vertices(vertices) {}
+            m_vertices(vertices),
+            m_offset(0) {}
+            
+            /*
+             * Replaces the values in the range [begin, end) of the given values, which contain all values of the
+             * instances. Only that range is uploaded on the next setup unless the values no longer fit into the
+             * texture, in which case the texture is recreated from all values.
+             */
+            inline void updateValues(const Vec4f::List& values, size_t begin, size_t end) {
+                assert(begin <= end && end <= values.size());
+                const size_t size = static_cast<size_t>(textureSize());
+                if (!hasTexture() || values.size() > size * size) {
+                    deleteTexture();
+                    m_vertices = values;
+                    m_offset = 0;
+                } else if (!m_vertices.empty()) {
+                    // there is a pending update already, so upload everything that is in use
+                    m_vertices = values;
+                    m_offset = 0;
+                } else if (begin < end) {
+                    m_vertices.assign(values.begin() + static_cast<Vec4f::List::difference_type>(begin),
+                                      values.begin() + static_cast<Vec4f::List::difference_type>(end));
+                    m_offset = begin;
+                }
+            }
         };
         
         // requires ARB_draw_instanced and ARB_texture_float
@@ -164,20 +239,15 @@ namespace TrenchBroom {
                 InstanceAttributesList::const_iterator it, end;
                 for (it = m_instanceAttributes.begin(), end = m_instanceAttributes.end(); it != end; ++it) {
                     InstanceAttributes& attributes = **it;
-                    glActiveTexture(GL_TEXTURE0 + textureNum);
-                    attributes.setup();
-                    program.setUniformVariable(attributes.name(), static_cast<int>(textureNum));
-                    program.setUniformVariable(attributes.textureSizeName(), attributes.textureSize());
-                    textureNum++;
+                    attributes.activate(program, textureNum++);
                 }
                 
                 glDrawArraysInstancedARB(m_primType, 0, static_cast<GLsizei>(m_vertexCount), static_cast<GLsizei>(m_instanceCount));
                 
-                textureNum = GL_TEXTURE0;
+                textureNum = 0;
                 for (it = m_instanceAttributes.begin(), end = m_instanceAttributes.end(); it != end; ++it) {
                     InstanceAttributes& attributes = **it;
-                    glActiveTexture(textureNum++);
-                    attributes.cleanup();
+                    attributes.deactivate(textureNum++);
                 }
                 
                 cleanup();
@@ -34,11 +34,12 @@
 #include "Model/Filter.h"
 #include "Model/Map.h"
 #include "Model/MapDocument.h"
-#include "Renderer/EdgeRenderer.h"
+#include "Renderer/BrushRenderer.h"
+#include "Renderer/Camera.h"
+#include "Renderer/EntityModelRendererManager.h"
 #include "Renderer/EntityRenderer.h"
 #include "Renderer/EntityRotationDecorator.h"
 #include "Renderer/EntityLinkDecorator.h"
-#include "Renderer/FaceRenderer.h"
 #include "Renderer/PointHandleRenderer.h"
 #include "Renderer/PointTraceRenderer.h"
 #include "Renderer/RenderContext.h"
@@ -62,151 +63,10 @@ namespace TrenchBroom {
         static const int NormalSize = 3 * sizeof(GLfloat);
         static const int ColorSize = 4;
         static const int TexCoordSize = 2 * sizeof(GLfloat);
-        static const int FaceVertexSize = VertexSize + NormalSize + TexCoordSize;
-        static const int EdgeVertexSize = VertexSize;
         static const int EntityBoundsVertexSize = ColorSize + VertexSize;
 
-        void MapRenderer::rebuildGeometryData(RenderContext& context) {
-            if (!m_geometryDataValid) {
-                delete m_faceRenderer;
-                m_faceRenderer = NULL;
-                delete m_edgeRenderer;
-                m_edgeRenderer = NULL;
-            }
-            if (!m_selectedGeometryDataValid) {
-                delete m_selectedFaceRenderer;
-                m_selectedFaceRenderer = NULL;
-                delete m_selectedEdgeRenderer;
-                m_selectedEdgeRenderer = NULL;
-            }
-            if (!m_lockedGeometryDataValid) {
-                delete m_lockedFaceRenderer;
-                m_lockedFaceRenderer = NULL;
-                delete m_lockedEdgeRenderer;
-                m_lockedEdgeRenderer = NULL;
-            }
-            
-            FaceSorter unselectedFaceSorter;
-            FaceSorter selectedFaceSorter;
-            FaceSorter lockedFaceSorter;
-            
-            Model::BrushList unselectedWorldBrushes;
-            Model::BrushList unselectedEntityBrushes;
-            Model::BrushList selectedBrushes;
-            Model::BrushList lockedBrushes;
-            Model::FaceList partiallySelectedBrushFaces;
-            
-            // collect all visible faces and brushes
-            const Model::EntityList& entities = m_document.map().entities();
-            for (size_t i = 0; i < entities.size(); i++) {
-                Model::Entity* entity = entities[i];
-                const Model::BrushList& brushes = entity->brushes();
-                for (size_t j = 0; j < brushes.size(); j++) {
-                    Model::Brush* brush = brushes[j];
-                    if (context.filter().brushVisible(*brush)) {
-                        if (entity->selected() || brush->selected()) {
-                            selectedBrushes.push_back(brush);
-                        } else if (entity->locked() || brush->locked()) {
-                            lockedBrushes.push_back(brush);
-                        } else {
-                            if (entity->worldspawn())
-                                unselectedWorldBrushes.push_back(brush);
-                            else
-                                unselectedEntityBrushes.push_back(brush);
-                            if (brush->partiallySelected()) {
-                                const Model::FaceList& faces = brush->faces();
-                                for (size_t k = 0; k < faces.size(); k++) {
-                                    Model::Face* face = faces[k];
-                                    if (face->selected()) {
-                                        partiallySelectedBrushFaces.push_back(face);
-                                    }
-                                }
-                            }
-                        }
-                        
-                        const Model::FaceList& faces = brush->faces();
-                        for (size_t k = 0; k < faces.size(); k++) {
-                            Model::Face* face = faces[k];
-                            Model::Texture* texture = face->texture();
-                            if (entity->selected() || brush->selected() || face->selected())
-                                selectedFaceSorter.addPolygon(texture, face, face->vertices().size());
-                            else if (entity->locked() || brush->locked())
-                                lockedFaceSorter.addPolygon(texture, face, face->vertices().size());
-                            else
-                                unselectedFaceSorter.addPolygon(texture, face, face->vertices().size());
-                        }
-                    }
-                }
-            }
-            
-            // merge the collected brushes
-            Model::BrushList unselectedBrushes(unselectedWorldBrushes);
-            unselectedBrushes.insert(unselectedBrushes.end(), unselectedEntityBrushes.begin(), unselectedEntityBrushes.end());
-
-            // write face triangles
-            m_faceVbo->activate();
-            m_faceVbo->map();
-            
-            // make sure that the VBO is sufficiently large
-            size_t totalFaceVertexCount = unselectedFaceSorter.vertexCount() + selectedFaceSorter.vertexCount() + lockedFaceSorter.vertexCount();
-            size_t totalPolygonCount = unselectedFaceSorter.polygonCount() + selectedFaceSorter.polygonCount() + lockedFaceSorter.polygonCount();
-            size_t totalTriangleVertexCount = 3 * totalFaceVertexCount - 6 * totalPolygonCount;
-            m_faceVbo->ensureFreeCapacity(static_cast<unsigned int>(totalTriangleVertexCount) * FaceVertexSize);
-            
-            Preferences::PreferenceManager& prefs = Preferences::PreferenceManager::preferences();
-            TextureRendererManager& textureRendererManager = m_document.sharedResources().textureRendererManager();
-            const Color& faceColor = prefs.getColor(Preferences::FaceColor);
-
-            if (!m_geometryDataValid && !unselectedFaceSorter.empty()) {
-                assert(m_faceRenderer == NULL);
-                m_faceRenderer = new FaceRenderer(*m_faceVbo, textureRendererManager, unselectedFaceSorter, faceColor);
-            }
-            
-            if (!m_selectedGeometryDataValid && !selectedFaceSorter.empty()) {
-                assert(m_selectedFaceRenderer == NULL);
-                m_selectedFaceRenderer = new FaceRenderer(*m_faceVbo, textureRendererManager, selectedFaceSorter, faceColor);
-            }
-            
-            if (!m_lockedGeometryDataValid && !lockedFaceSorter.empty()) {
-                assert(m_lockedFaceRenderer == NULL);
-                m_lockedFaceRenderer = new FaceRenderer(*m_faceVbo, textureRendererManager, lockedFaceSorter, faceColor);
-            }
-            
-            m_faceVbo->unmap();
-            m_faceVbo->deactivate();
-            
-            // write edges
-            m_edgeVbo->activate();
-            m_edgeVbo->map();
-            
-            const Color& edgeColor = prefs.getColor(Preferences::EdgeColor);
-
-            if (!m_geometryDataValid && !unselectedBrushes.empty()) {
-                assert(m_edgeRenderer == NULL);
-                m_edgeRenderer = new EdgeRenderer(*m_edgeVbo, unselectedBrushes, Model::EmptyFaceList, edgeColor);
-            }
-            
-            if (!m_selectedGeometryDataValid && (!selectedBrushes.empty() || !partiallySelectedBrushFaces.empty())) {
-                assert(m_selectedEdgeRenderer == NULL);
-                m_selectedEdgeRenderer = new EdgeRenderer(*m_edgeVbo, selectedBrushes, partiallySelectedBrushFaces);
-            }
-            
-            if (!m_lockedGeometryDataValid && !lockedBrushes.empty()) {
-                assert(m_lockedEdgeRenderer == NULL);
-                m_lockedEdgeRenderer = new EdgeRenderer(*m_edgeVbo, lockedBrushes, Model::EmptyFaceList);
-            }
-            
-            m_edgeVbo->unmap();
-            m_edgeVbo->deactivate();
-            
-            m_geometryDataValid = true;
-            m_selectedGeometryDataValid = true;
-            m_lockedGeometryDataValid = true;
-        }
-        
         void MapRenderer::validate(RenderContext& context) {
-            if (!m_geometryDataValid || !m_selectedGeometryDataValid || !m_lockedGeometryDataValid)
-                rebuildGeometryData(context);
+            m_brushRenderer->validate(context);
         }
         
         void MapRenderer::invalidateDecorators() {
@@ -220,45 +80,34 @@ namespace TrenchBroom {
         void MapRenderer::renderFaces(RenderContext& context) {
             Preferences::PreferenceManager& prefs = Preferences::PreferenceManager::preferences();
             
-            m_faceVbo->activate();
-            if (m_faceRenderer != NULL)
-                m_faceRenderer->render(context, false);
-            if (context.viewOptions().renderSelection() && m_selectedFaceRenderer != NULL) {
+            m_brushRenderer->renderFaces(context, BrushRenderer::Unselected, false, NULL);
+            if (context.viewOptions().renderSelection()) {
                 const Color& color = m_overrideSelectionColors ? m_selectedFaceColor : prefs.getColor(Preferences::SelectedFaceColor);
-                m_selectedFaceRenderer->render(context, false, color);
+                m_brushRenderer->renderFaces(context, BrushRenderer::Selected, false, &color);
             }
-            if (m_lockedFaceRenderer != NULL)
-                m_lockedFaceRenderer->render(context, true, prefs.getColor(Preferences::LockedFaceColor));
-            m_faceVbo->deactivate();
+            const Color& lockedColor = prefs.getColor(Preferences::LockedFaceColor);
+            m_brushRenderer->renderFaces(context, BrushRenderer::Locked, true, &lockedColor);
         }
         
         void MapRenderer::renderEdges(RenderContext& context) {
             Preferences::PreferenceManager& prefs = Preferences::PreferenceManager::preferences();
             
-            m_edgeVbo->activate();
             if (context.viewOptions().renderEdges()) {
-                if (m_edgeRenderer != NULL) {
-                    glSetEdgeOffset(0.02f);
-                    m_edgeRenderer->render(context);
-                }
-                if (m_lockedEdgeRenderer != NULL) {
-                    glSetEdgeOffset(0.02f);
-                    m_lockedEdgeRenderer->render(context, prefs.getColor(Preferences::LockedEdgeColor));
-                }
+                glSetEdgeOffset(0.02f);
+                m_brushRenderer->renderEdges(context, BrushRenderer::Unselected);
+                m_brushRenderer->renderEdges(context, BrushRenderer::Locked, prefs.getColor(Preferences::LockedEdgeColor));
             }
-            if (context.viewOptions().renderSelection() && m_selectedEdgeRenderer != NULL) {
+            if (context.viewOptions().renderSelection()) {
                 const Color& edgeColor = m_overrideSelectionColors ? m_selectedEdgeColor : prefs.getColor(Preferences::SelectedEdgeColor);
                 const Color& occludedEdgeColor = m_overrideSelectionColors ? m_occludedSelectedEdgeColor : prefs.getColor(Preferences::OccludedSelectedEdgeColor);
                 
-                
                 glDisable(GL_DEPTH_TEST);
                 glSetEdgeOffset(0.02f);
-                m_selectedEdgeRenderer->render(context, occludedEdgeColor);
+                m_brushRenderer->renderEdges(context, BrushRenderer::Selected, occludedEdgeColor);
                 glEnable(GL_DEPTH_TEST);
                 glSetEdgeOffset(0.025f);
-                m_selectedEdgeRenderer->render(context, edgeColor);
+                m_brushRenderer->renderEdges(context, BrushRenderer::Selected, edgeColor);
             }
-            m_edgeVbo->deactivate();
             glResetEdgeOffset();
         }
         
@@ -278,18 +127,40 @@ namespace TrenchBroom {
             m_lockedEntityRenderer->addEntities(changeSet.entitiesTo(Model::EditState::Locked));
             m_lockedEntityRenderer->removeEntities(changeSet.entitiesFrom(Model::EditState::Locked));
             
+            // only the brushes whose edit state changed are moved to other render groups
+            Model::BrushList changedBrushes;
+            for (unsigned int state = 0; state < Model::EditState::Count; state++) {
+                const Model::EditState::Type type = static_cast<Model::EditState::Type>(state);
+                const Model::BrushList& brushes = changeSet.brushesFrom(type);
+                changedBrushes.insert(changedBrushes.end(), brushes.begin(), brushes.end());
+                
+                const Model::EntityList& entities = changeSet.entitiesFrom(type);
+                for (unsigned int i = 0; i < entities.size(); i++) {
+                    const Model::BrushList& entityBrushes = entities[i]->brushes();
+                    changedBrushes.insert(changedBrushes.end(), entityBrushes.begin(), entityBrushes.end());
+                }
+            }
+            
+            if (changeSet.faceSelectionChanged()) {
+                for (unsigned int i = 0; i < 2; i++) {
+                    const Model::FaceList& faces = changeSet.faces(i == 0);
+                    for (unsigned int j = 0; j < faces.size(); j++)
+                        changedBrushes.push_back(faces[j]->brush());
+                }
+                m_brushRenderer->setSelectedFaces(m_document.editStateManager().selectedFaces());
+            }
+            
+            m_brushRenderer->regroupBrushes(changedBrushes);
+            
             if (changeSet.brushStateChangedFrom(Model::EditState::Default) ||
                 changeSet.brushStateChangedTo(Model::EditState::Default) ||
                 changeSet.faceSelectionChanged()) {
-                m_geometryDataValid = false;
                 invalidateDecorators();
             }
             
             if (changeSet.brushStateChangedFrom(Model::EditState::Selected) ||
                 changeSet.brushStateChangedTo(Model::EditState::Selected) ||
                 changeSet.faceSelectionChanged()) {
-                m_selectedGeometryDataValid = false;
-                
                 const Model::BrushList& selectedBrushes = changeSet.brushesTo(Model::EditState::Selected);
                 for (unsigned int i = 0; i < selectedBrushes.size(); i++) {
                     Model::Brush* brush = selectedBrushes[i];
@@ -337,11 +208,6 @@ namespace TrenchBroom {
                 
                 invalidateDecorators();
             }
-            
-            if (changeSet.brushStateChangedFrom(Model::EditState::Locked) ||
-                changeSet.brushStateChangedTo(Model::EditState::Locked)) {
-                m_lockedGeometryDataValid = false;
-            }
         }
         
         void MapRenderer::invalidateEntities() {
@@ -357,13 +223,29 @@ namespace TrenchBroom {
         }
         
         void MapRenderer::invalidateBrushes() {
-            m_geometryDataValid = false;
-            m_selectedGeometryDataValid = false;
-            m_lockedGeometryDataValid = false;
+            m_brushRenderer->invalidateAllBrushes();
+        }
+        
+        void MapRenderer::invalidateBrushes(const Model::BrushList& brushes) {
+            m_brushRenderer->invalidateBrushes(brushes);
         }
         
         void MapRenderer::invalidateSelectedBrushes() {
-            m_selectedGeometryDataValid = false;
+            Model::EditStateManager& editStateManager = m_document.editStateManager();
+            Model::BrushList brushes = editStateManager.selectedBrushes();
+            
+            const Model::EntityList& entities = editStateManager.selectedEntities();
+            for (unsigned int i = 0; i < entities.size(); i++) {
+                const Model::BrushList& entityBrushes = entities[i]->brushes();
+                brushes.insert(brushes.end(), entityBrushes.begin(), entityBrushes.end());
+            }
+            
+            const Model::FaceList& faces = editStateManager.selectedFaces();
+            for (unsigned int i = 0; i < faces.size(); i++)
+                brushes.push_back(faces[i]->brush());
+            
+            m_brushRenderer->invalidateBrushes(brushes);
+            m_brushRenderer->invalidateSelectedFaces();
         }
         
         void MapRenderer::invalidateAll() {
@@ -382,19 +264,7 @@ namespace TrenchBroom {
         }
         
         void MapRenderer::clear() {
-            delete m_faceRenderer;
-            m_faceRenderer = NULL;
-            delete m_selectedFaceRenderer;
-            m_selectedFaceRenderer = NULL;
-            delete m_lockedFaceRenderer;
-            m_lockedFaceRenderer = NULL;
-            
-            delete m_edgeRenderer;
-            m_edgeRenderer = NULL;
-            delete m_selectedEdgeRenderer;
-            m_selectedEdgeRenderer = NULL;
-            delete m_lockedEdgeRenderer;
-            m_lockedEdgeRenderer = NULL;
+            m_brushRenderer->clear();
             
             m_entityRenderer->clear();
             m_selectedEntityRenderer->clear();
@@ -406,14 +276,7 @@ namespace TrenchBroom {
         
         MapRenderer::MapRenderer(Model::MapDocument& document) :
         m_document(document),
-        m_faceVbo(NULL),
-        m_faceRenderer(NULL),
-        m_selectedFaceRenderer(NULL),
-        m_lockedFaceRenderer(NULL),
-        m_edgeVbo(NULL),
-        m_edgeRenderer(NULL),
-        m_selectedEdgeRenderer(NULL),
-        m_lockedEdgeRenderer(NULL),
+        m_brushRenderer(NULL),
         m_entityVbo(NULL),
         m_entityRenderer(NULL),
         m_selectedEntityRenderer(NULL),
@@ -422,13 +285,10 @@ namespace TrenchBroom {
         m_pointTraceRenderer(NULL),
         m_overrideSelectionColors(false),
         m_rendering(false),
-        m_geometryDataValid(false),
-        m_selectedGeometryDataValid(false),
-        m_lockedGeometryDataValid(false) {
+        m_entityModelGeneration(0) {
             Preferences::PreferenceManager& prefs = Preferences::PreferenceManager::preferences();
 
-            m_faceVbo = new Vbo(GL_ARRAY_BUFFER, 0xFFFF);
-            m_edgeVbo = new Vbo(GL_ARRAY_BUFFER, 0xFFFF);
+            m_brushRenderer = new BrushRenderer(m_document);
             m_entityVbo = new Vbo(GL_ARRAY_BUFFER, 0xFFFF);
             m_utilityVbo = new Vbo(GL_ARRAY_BUFFER, 0xFFFF);
             
@@ -468,22 +328,8 @@ namespace TrenchBroom {
             m_entityRenderer = NULL;
             delete m_entityVbo;
             m_entityVbo = NULL;
-            delete m_lockedEdgeRenderer;
-            m_lockedEdgeRenderer = NULL;
-            delete m_selectedEdgeRenderer;
-            m_selectedEdgeRenderer = NULL;
-            delete m_edgeRenderer;
-            m_edgeRenderer = NULL;
-            delete m_edgeVbo;
-            m_edgeVbo = NULL;
-            delete m_lockedFaceRenderer;
-            m_lockedFaceRenderer = NULL;
-            delete m_selectedFaceRenderer;
-            m_selectedFaceRenderer = NULL;
-            delete m_faceRenderer;
-            m_faceRenderer = NULL;
-            delete m_faceVbo;
-            m_faceVbo = NULL;
+            delete m_brushRenderer;
+            m_brushRenderer = NULL;
             delete m_utilityVbo;
             m_utilityVbo = NULL;
         }
@@ -507,13 +353,19 @@ namespace TrenchBroom {
                 }
                 case Controller::Command::ViewFilterChange: {
                     invalidateEntities();
-                    invalidateBrushes();
+                    m_brushRenderer->regroupAllBrushes();
                     break;
                 }
                 case Controller::Command::PreferenceChange: {
                     const Controller::PreferenceChangeEvent& preferenceChangeEvent = static_cast<const Controller::PreferenceChangeEvent&>(command);
                     if (preferenceChangeEvent.isPreferenceChanged(Preferences::QuakePath))
                         invalidateEntityModelRendererCache();
+                    if (preferenceChangeEvent.isPreferenceChanged(Preferences::EdgeColor))
+                        invalidateBrushes();
+                    break;
+                }
+                case Controller::Command::SetEntityDefinitionFile: {
+                    invalidateBrushes();
                     break;
                 }
                 case Controller::Command::SetFaceAttributes:
@@ -527,20 +379,37 @@ namespace TrenchBroom {
                 case Controller::Command::RemoveEntityProperty: {
                     const Controller::EntityPropertyCommand& entityPropertyCommand = static_cast<const Controller::EntityPropertyCommand&>(command);
                     if (entityPropertyCommand.isEntityAffected(m_document.worldspawn()) &&
-                        entityPropertyCommand.isPropertyAffected(Model::Entity::WadKey))
-                            invalidateBrushes();
+                        entityPropertyCommand.isPropertyAffected(Model::Entity::WadKey)) {
+                        invalidateBrushes();
+                    } else {
+                        // the classname determines the edge color and the visibility of the brushes
+                        const Model::EntityList& entities = entityPropertyCommand.entities();
+                        for (unsigned int i = 0; i < entities.size(); i++)
+                            invalidateBrushes(entities[i]->brushes());
+                    }
                     invalidateEntities();
                     invalidateSelectedEntityModelRendererCache();
                     break;
                 }
                 case Controller::Command::AddObjects: {
                     const Controller::AddObjectsCommand& addObjectsCommand = static_cast<const Controller::AddObjectsCommand&>(command);
+                    if (addObjectsCommand.hasAddedBrushes()) {
+                        Model::BrushList brushes = addObjectsCommand.addedBrushes();
+                        const Model::EntityList& entities = addObjectsCommand.addedEntities();
+                        for (unsigned int i = 0; i < entities.size(); i++) {
+                            const Model::BrushList& entityBrushes = entities[i]->brushes();
+                            brushes.insert(brushes.end(), entityBrushes.begin(), entityBrushes.end());
+                        }
+                        
+                        if (addObjectsCommand.state() == Controller::Command::Doing)
+                            m_brushRenderer->addBrushes(brushes);
+                        else
+                            m_brushRenderer->removeBrushes(brushes);
+                    }
                     if (addObjectsCommand.state() == Controller::Command::Doing)
                         m_entityRenderer->addEntities(addObjectsCommand.addedEntities());
                     else
                         m_entityRenderer->removeEntities(addObjectsCommand.addedEntities());
-                    if (addObjectsCommand.hasAddedBrushes())
-                        invalidateBrushes();
                     break;
                 }
                 case Controller::Command::RebuildBrushGeometry:
@@ -558,8 +427,18 @@ namespace TrenchBroom {
                         m_entityRenderer->removeEntities(removeObjectsCommand.removedEntities());
                     else
                         m_entityRenderer->addEntities(removeObjectsCommand.removedEntities());
-                    if (!removeObjectsCommand.removedBrushes().empty())
-                        invalidateBrushes();
+                    
+                    Model::BrushList brushes = removeObjectsCommand.brushes();
+                    const Model::EntityList& entities = removeObjectsCommand.entities();
+                    for (unsigned int i = 0; i < entities.size(); i++) {
+                        const Model::BrushList& entityBrushes = entities[i]->brushes();
+                        brushes.insert(brushes.end(), entityBrushes.begin(), entityBrushes.end());
+                    }
+                    
+                    if (removeObjectsCommand.state() == Controller::Command::Doing)
+                        m_brushRenderer->removeBrushes(brushes);
+                    else
+                        m_brushRenderer->addBrushes(brushes);
                     break;
                 }
                 case Controller::Command::ReparentBrushes: {
@@ -589,8 +468,21 @@ namespace TrenchBroom {
                 return;
             m_rendering = true;
             
+            // pick up the entity models which have been loaded in the meantime
+            EntityModelRendererManager& modelRendererManager = m_document.sharedResources().modelRendererManager();
+            modelRendererManager.update();
+            if (modelRendererManager.generation() != m_entityModelGeneration) {
+                invalidateEntityModelRendererCache();
+                m_entityModelGeneration = modelRendererManager.generation();
+            }
+            
             validate(context);
             
+            Preferences::PreferenceManager& prefs = Preferences::PreferenceManager::preferences();
+            const Camera& camera = context.camera();
+            m_culler.update(camera.projectionMatrix(), camera.viewMatrix(), camera.position(), prefs.getFloat(Preferences::RendererCullDistance));
+            m_brushRenderer->cull(m_culler);
+            
             glEnable(GL_BLEND);
             glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
             glFrontFace(GL_CW);
@@ -607,10 +499,10 @@ namespace TrenchBroom {
                 renderEdges(context);
             
             if (context.viewOptions().showEntities()) {
-                m_entityRenderer->render(context);
+                m_entityRenderer->render(context, &m_culler);
                 if (context.viewOptions().renderSelection())
-                    m_selectedEntityRenderer->render(context);
-                m_lockedEntityRenderer->render(context);
+                    m_selectedEntityRenderer->render(context, &m_culler);
+                m_lockedEntityRenderer->render(context, &m_culler);
                 renderDecorators(context);
             }
             
@@ -25,6 +25,7 @@
 #include "Model/EntityTypes.h"
 #include "Model/Face.h"
 #include "Model/TextureTypes.h"
+#include "Renderer/Culler.h"
 #include "Renderer/EntityDecorator.h"
 #include "Renderer/Figure.h"
 #include "Renderer/RenderUtils.h"
@@ -48,9 +49,8 @@ namespace TrenchBroom {
     }
     
     namespace Renderer {
-        class EdgeRenderer;
+        class BrushRenderer;
         class EntityRenderer;
-        class FaceRenderer;
         class Figure;
         class PointTraceRenderer;
         class RenderContext;
@@ -64,23 +64,12 @@ namespace TrenchBroom {
         }
         
         class MapRenderer {
-        private:
-            typedef TexturedPolygonSorter<Model::Texture, Model::Face*> FaceSorter;
-            typedef FaceSorter::PolygonCollection FaceCollection;
-            typedef FaceSorter::PolygonCollectionMap FaceCollectionMap;
         private:
             Model::MapDocument& m_document;
             
             // level geometry rendering
-            Vbo* m_faceVbo;
-            FaceRenderer* m_faceRenderer;
-            FaceRenderer* m_selectedFaceRenderer;
-            FaceRenderer* m_lockedFaceRenderer;
-            
-            Vbo* m_edgeVbo;
-            EdgeRenderer* m_edgeRenderer;
-            EdgeRenderer* m_selectedEdgeRenderer;
-            EdgeRenderer* m_lockedEdgeRenderer;
+            Culler m_culler;
+            BrushRenderer* m_brushRenderer;
             
             Vbo* m_entityVbo;
             EntityRenderer* m_entityRenderer;
@@ -98,11 +87,7 @@ namespace TrenchBroom {
             
             // state
             bool m_rendering;
-            bool m_geometryDataValid;
-            bool m_selectedGeometryDataValid;
-            bool m_lockedGeometryDataValid;
-            
-            void rebuildGeometryData(RenderContext& context);
+            unsigned int m_entityModelGeneration;
             
             void validate(RenderContext& context);
             
@@ -114,6 +99,7 @@ namespace TrenchBroom {
             void invalidateEntities();
             void invalidateSelectedEntities();
             void invalidateBrushes();
+            void invalidateBrushes(const Model::BrushList& brushes);
             void invalidateSelectedBrushes();
             void invalidateAll();
             void invalidateEntityModelRendererCache();
@@ -141,6 +127,13 @@ namespace TrenchBroom {
             void removePointTrace();
             
             void render(RenderContext& context);
+            
+            /*
+             * Counts the chunks and entity models which were drawn and culled in the last frame.
+             */
+            inline const Culler& culler() const {
+                return m_culler;
+            }
         };
     }
 }
@@ -0,0 +1,282 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TrenchBroom_ModelInstanceGroups_h
+#define TrenchBroom_ModelInstanceGroups_h
+
+#include "Utility/VecMath.h"
+
+#include <algorithm>
+#include <cassert>
+#include <map>
+#include <vector>
+
+using namespace TrenchBroom::VecMath;
+
+namespace TrenchBroom {
+    namespace Renderer {
+        /*
+         * Groups the instances of models by their models so that every group can be drawn with a single instanced draw
+         * call. Every group keeps the transformations of its instances in two arrays which can be uploaded as they are:
+         * the positions, whose fourth component is 1 for visible and 0 for hidden instances, and the rotations, which
+         * are stored as quaternions with the scalar part in the fourth component.
+         *
+         * Each group tracks the range of instances whose values changed since it was last validated, so that only that
+         * range must be uploaded again. Removing an instance moves the last instance of its group into the vacated
+         * slot, which keeps the arrays dense.
+         *
+         * The models and instances are only used as keys, so the groups can be used (and tested) without a GL context.
+         */
+        template <typename ModelType, typename InstanceType>
+        class ModelInstanceGroups {
+        public:
+            typedef std::vector<InstanceType> InstanceList;
+            
+            class Group {
+            private:
+                InstanceList m_instances;
+                Vec4f::List m_positions;
+                Vec4f::List m_rotations;
+                size_t m_dirtyBegin;
+                size_t m_dirtyEnd;
+                
+                inline void touch(size_t index) {
+                    m_dirtyBegin = std::min(m_dirtyBegin, index);
+                    m_dirtyEnd = std::max(m_dirtyEnd, index + 1);
+                }
+                
+                inline size_t add(InstanceType instance, const Vec3f& position, const Quatf& rotation) {
+                    const size_t index = m_instances.size();
+                    m_instances.push_back(instance);
+                    m_positions.push_back(Vec4f(position.x(), position.y(), position.z(), 1.0f));
+                    m_rotations.push_back(Vec4f(rotation.v.x(), rotation.v.y(), rotation.v.z(), rotation.s));
+                    touch(index);
+                    return index;
+                }
+                
+                /*
+                 * Removes the instance at the given index and returns the instance which was moved into its slot, or
+                 * the removed instance if it was the last one.
+                 */
+                inline InstanceType remove(size_t index) {
+                    assert(index < m_instances.size());
+                    const size_t last = m_instances.size() - 1;
+                    if (index < last) {
+                        m_instances[index] = m_instances[last];
+                        m_positions[index] = m_positions[last];
+                        m_rotations[index] = m_rotations[last];
+                        touch(index);
+                    }
+                    
+                    const InstanceType moved = m_instances[index];
+                    m_instances.pop_back();
+                    m_positions.pop_back();
+                    m_rotations.pop_back();
+                    m_dirtyEnd = std::min(m_dirtyEnd, m_instances.size());
+                    if (m_dirtyBegin >= m_dirtyEnd)
+                        validate();
+                    return moved;
+                }
+                
+                friend class ModelInstanceGroups<ModelType, InstanceType>;
+            public:
+                Group() :
+                m_dirtyBegin(0),
+                m_dirtyEnd(0) {}
+                
+                inline size_t instanceCount() const {
+                    return m_instances.size();
+                }
+                
+                inline InstanceType instance(size_t index) const {
+                    assert(index < m_instances.size());
+                    return m_instances[index];
+                }
+                
+                inline const Vec4f::List& positions() const {
+                    return m_positions;
+                }
+                
+                inline const Vec4f::List& rotations() const {
+                    return m_rotations;
+                }
+                
+                inline bool visible(size_t index) const {
+                    assert(index < m_positions.size());
+                    return m_positions[index].w() != 0.0f;
+                }
+                
+                /*
+                 * Returns whether the value changed.
+                 */
+                inline bool setVisible(size_t index, bool visible) {
+                    assert(index < m_positions.size());
+                    const float w = visible ? 1.0f : 0.0f;
+                    if (m_positions[index].w() == w)
+                        return false;
+                    m_positions[index][3] = w;
+                    touch(index);
+                    return true;
+                }
+                
+                /*
+                 * Returns whether the transformation changed.
+                 */
+                inline bool setTransformation(size_t index, const Vec3f& position, const Quatf& rotation) {
+                    assert(index < m_positions.size());
+                    const Vec4f newPosition(position.x(), position.y(), position.z(), m_positions[index].w());
+                    const Vec4f newRotation(rotation.v.x(), rotation.v.y(), rotation.v.z(), rotation.s);
+                    if (m_positions[index] == newPosition && m_rotations[index] == newRotation)
+                        return false;
+                    m_positions[index] = newPosition;
+                    m_rotations[index] = newRotation;
+                    touch(index);
+                    return true;
+                }
+                
+                inline bool dirty() const {
+                    return m_dirtyBegin < m_dirtyEnd;
+                }
+                
+                /*
+                 * The range of instances whose values changed, the end is exclusive.
+                 */
+                inline size_t dirtyBegin() const {
+                    return m_dirtyBegin;
+                }
+                
+                inline size_t dirtyEnd() const {
+                    return m_dirtyEnd;
+                }
+                
+                inline void validate() {
+                    m_dirtyBegin = m_instances.size();
+                    m_dirtyEnd = 0;
+                }
+            };
+            
+            typedef std::map<ModelType, Group> GroupMap;
+        private:
+            class Location {
+            public:
+                ModelType model;
+                size_t index;
+                
+                Location(ModelType i_model, size_t i_index) :
+                model(i_model),
+                index(i_index) {}
+            };
+            
+            typedef std::map<InstanceType, Location> LocationMap;
+            
+            GroupMap m_groups;
+            LocationMap m_locations;
+        public:
+            inline GroupMap& groups() {
+                return m_groups;
+            }
+            
+            inline const GroupMap& groups() const {
+                return m_groups;
+            }
+            
+            inline Group* group(ModelType model) {
+                typename GroupMap::iterator it = m_groups.find(model);
+                if (it == m_groups.end())
+                    return NULL;
+                return &it->second;
+            }
+            
+            inline bool empty() const {
+                return m_locations.empty();
+            }
+            
+            inline size_t instanceCount() const {
+                return m_locations.size();
+            }
+            
+            inline bool contains(InstanceType instance) const {
+                return m_locations.find(instance) != m_locations.end();
+            }
+            
+            /*
+             * Adds the given instance to the group of the given model. If the instance already belongs to a group, it
+             * is removed from that group first.
+             */
+            inline void addInstance(ModelType model, InstanceType instance, const Vec3f& position, const Quatf& rotation) {
+                typename LocationMap::iterator it = m_locations.find(instance);
+                if (it != m_locations.end()) {
+                    if (it->second.model == model) {
+                        m_groups[model].setTransformation(it->second.index, position, rotation);
+                        return;
+                    }
+                    removeInstance(instance);
+                }
+                
+                const size_t index = m_groups[model].add(instance, position, rotation);
+                m_locations.insert(std::make_pair(instance, Location(model, index)));
+            }
+            
+            /*
+             * Returns false if the given instance does not belong to any group. Groups are removed when their last
+             * instance is removed.
+             */
+            inline bool removeInstance(InstanceType instance) {
+                typename LocationMap::iterator it = m_locations.find(instance);
+                if (it == m_locations.end())
+                    return false;
+                
+                const ModelType model = it->second.model;
+                const size_t index = it->second.index;
+                m_locations.erase(it);
+                
+                typename GroupMap::iterator groupIt = m_groups.find(model);
+                assert(groupIt != m_groups.end());
+                Group& group = groupIt->second;
+                const InstanceType moved = group.remove(index);
+                if (moved != instance) {
+                    typename LocationMap::iterator movedIt = m_locations.find(moved);
+                    assert(movedIt != m_locations.end());
+                    movedIt->second.index = index;
+                }
+                
+                if (group.instanceCount() == 0)
+                    m_groups.erase(groupIt);
+                return true;
+            }
+            
+            /*
+             * Returns whether the transformation of the given instance changed.
+             */
+            inline bool setTransformation(InstanceType instance, const Vec3f& position, const Quatf& rotation) {
+                typename LocationMap::iterator it = m_locations.find(instance);
+                if (it == m_locations.end())
+                    return false;
+                return m_groups[it->second.model].setTransformation(it->second.index, position, rotation);
+            }
+            
+            inline void clear() {
+                m_groups.clear();
+                m_locations.clear();
+            }
+        };
+    }
+}
+
+#endif
@@ -25,6 +25,15 @@
 
 namespace TrenchBroom {
     namespace Renderer {
+        void Palette::buildTable() {
+            for (size_t i = 0; i < 256; i++) {
+                unsigned char rgb[4] = {0, 0, 0, 0};
+                for (size_t j = 0; j < 3 && i * 3 + j < m_size; j++)
+                    rgb[j] = m_data[i * 3 + j];
+                memcpy(&m_table[i], rgb, 4);
+            }
+        }
+        
         Palette::Palette(const String& path) {
             std::ifstream stream(path.c_str(), std::ios::binary | std::ios::in);
             assert(stream.is_open());
@@ -36,6 +45,8 @@ namespace TrenchBroom {
 
             stream.read(reinterpret_cast<char*>(m_data), static_cast<std::streamsize>(m_size));
             stream.close();
+            
+            buildTable();
         }
 
         Palette::Palette(const Palette& other) :
@@ -43,15 +54,71 @@ namespace TrenchBroom {
         m_size(other.m_size) {
             m_data = new unsigned char[m_size];
             memcpy(m_data, other.m_data, m_size);
+            memcpy(m_table, other.m_table, sizeof(m_table));
         }
 
         void Palette::operator= (Palette other) {
             std::swap(m_data, other.m_data);
             std::swap(m_size, other.m_size);
+            std::swap_ranges(m_table, m_table + 256, other.m_table);
         }
 
         Palette::~Palette() {
             delete[] m_data;
         }
+        
+        void Palette::indexedToRgb(const unsigned char* indexedImage, unsigned char* rgbImage, size_t pixelCount, Color& averageColor) const {
+            /*
+             * Every pixel is written as a four byte word whose last byte is overwritten by the next pixel, so only
+             * the last pixel needs to be written bytewise. The average color is computed from a histogram of the
+             * color indices instead of summing up every channel of every pixel.
+             */
+            size_t histogram[256];
+            std::fill(histogram, histogram + 256, 0);
+            
+            if (pixelCount > 0) {
+                const size_t last = pixelCount - 1;
+                size_t i = 0;
+                for (; i + 4 <= last; i += 4) {
+                    const unsigned char i0 = indexedImage[i + 0];
+                    const unsigned char i1 = indexedImage[i + 1];
+                    const unsigned char i2 = indexedImage[i + 2];
+                    const unsigned char i3 = indexedImage[i + 3];
+                    memcpy(rgbImage + (i + 0) * 3, &m_table[i0], 4);
+                    memcpy(rgbImage + (i + 1) * 3, &m_table[i1], 4);
+                    memcpy(rgbImage + (i + 2) * 3, &m_table[i2], 4);
+                    memcpy(rgbImage + (i + 3) * 3, &m_table[i3], 4);
+                    histogram[i0]++;
+                    histogram[i1]++;
+                    histogram[i2]++;
+                    histogram[i3]++;
+                }
+                for (; i < last; i++) {
+                    const unsigned char index = indexedImage[i];
+                    memcpy(rgbImage + i * 3, &m_table[index], 4);
+                    histogram[index]++;
+                }
+                
+                const unsigned char index = indexedImage[last];
+                memcpy(rgbImage + last * 3, &m_table[index], 3);
+                histogram[index]++;
+            }
+            
+            // the sums are integers and therefore exactly the same as if every pixel were added up separately
+            double avg[3];
+            avg[0] = avg[1] = avg[2] = 0;
+            for (size_t j = 0; j < 256; j++) {
+                if (histogram[j] > 0) {
+                    unsigned char rgb[4];
+                    memcpy(rgb, &m_table[j], 4);
+                    for (size_t k = 0; k < 3; k++)
+                        avg[k] += static_cast<double>(histogram[j]) * static_cast<double>(rgb[k]);
+                }
+            }
+            
+            for (size_t j = 0; j < 3; j++)
+                averageColor[j] = static_cast<float>(avg[j] / pixelCount / 0xFF);
+            averageColor[3] = 1.0f;
+        }
     }
 }
@@ -21,16 +21,27 @@
 #define __TrenchBroom__Palette__
 
 #include "Utility/Color.h"
+#include "Utility/Hash.h"
 #include "Utility/String.h"
 
 #include <cassert>
 
+#ifdef _MSC_VER
+#include <cstdint>
+#elif defined __GNUC__
+#include <stdint.h>
+#endif
+
 namespace TrenchBroom {
     namespace Renderer {
         class Palette {
         private:
             unsigned char* m_data;
             size_t m_size;
+            // the RGB triples of all 256 colors, padded to four bytes so that a pixel is converted with one store
+            uint32_t m_table[256];
+            
+            void buildTable();
         public:
             Palette(const String& path);
             Palette(const Palette& other);
@@ -38,23 +49,18 @@ namespace TrenchBroom {
             
             void operator= (Palette other);
             
-            inline void indexedToRgb(const unsigned char* indexedImage, unsigned char* rgbImage, size_t pixelCount, Color& averageColor) const {
-                double avg[3];
-                avg[0] = avg[1] = avg[2] = 0;
-                for (unsigned int i = 0; i < pixelCount; i++) {
-                    unsigned int index = indexedImage[i];
-                    assert(index < m_size);
-                    for (unsigned int j = 0; j < 3; j++) {
-                        unsigned char c = m_data[index * 3 + j];
-                        rgbImage[i * 3 + j] = c;
-                        avg[j] += static_cast<double>(c);
-                    }
-                }
-
-                for (unsigned int i = 0; i < 3; i++)
-                    averageColor[i] = static_cast<float>(avg[i] / pixelCount / 0xFF);
-                averageColor[3] = 1.0f;
+            /*
+             * Images which were converted with a palette with a different checksum must not be reused.
+             */
+            inline uint32_t checksum() const {
+                return Utility::hash(m_data, m_size);
             }
+            
+            /*
+             * Converts the given indexed image to RGB and computes the average color of the image. This is called
+             * from worker threads when texture collections are loaded.
+             */
+            void indexedToRgb(const unsigned char* indexedImage, unsigned char* rgbImage, size_t pixelCount, Color& averageColor) const;
         };
     }
 }
@@ -61,6 +61,7 @@ namespace TrenchBroom {
             extern const ShaderConfig ColoredEdgeShader;
             extern const ShaderConfig EdgeShader;
             extern const ShaderConfig EntityModelShader;
+            extern const ShaderConfig InstancedEntityModelShader;
             extern const ShaderConfig FaceShader;
             extern const ShaderConfig TextShader;
             extern const ShaderConfig TextBackgroundShader;
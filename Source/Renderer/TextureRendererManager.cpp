@@ -22,29 +22,107 @@
 #include "Model/Texture.h"
 #include "Model/TextureManager.h"
 #include "Renderer/TextureRenderer.h"
+#include "Utility/List.h"
 #include "Utility/Map.h"
+#include "Utility/ThreadPool.h"
 
+#include <algorithm>
 #include <cassert>
 #include <exception>
 
 namespace TrenchBroom {
     namespace Renderer {
-        TextureRendererCollection::TextureRendererCollection(Model::TextureCollection& textureCollection, const Palette& palette) {
+        class TextureRendererCollection::DecodeTask : public Utility::ThreadPool::Task {
+        public:
+            class Result {
+            public:
+                unsigned char* image;
+                Color averageColor;
+                
+                Result() :
+                image(NULL) {}
+            };
+            
+            typedef std::vector<Result> ResultList;
+        private:
+            const Model::TextureCollectionLoader& m_loader;
+            const Model::TextureList& m_textures;
+            size_t m_first;
+            ResultList m_results;
+        protected:
+            void run() {
+                decode();
+            }
+        public:
+            DecodeTask(const Model::TextureCollectionLoader& loader, const Model::TextureList& textures, size_t first, size_t last) :
+            m_loader(loader),
+            m_textures(textures),
+            m_first(first),
+            m_results(last - first) {}
+            
+            void decode() {
+                for (size_t i = 0; i < m_results.size(); i++) {
+                    Result& result = m_results[i];
+                    try {
+                        result.image = m_loader.load(*m_textures[m_first + i], result.averageColor);
+                    } catch (IO::IOException&) {
+                        result.image = NULL;
+                    }
+                }
+            }
+            
+            inline size_t first() const {
+                return m_first;
+            }
+            
+            inline const ResultList& results() const {
+                return m_results;
+            }
+        };
+        
+        TextureRendererCollection::TextureRendererCollection(Model::TextureCollection& textureCollection, const Palette& palette, Utility::ThreadPool* threadPool) {
             typedef std::pair<TextureRendererMap::iterator, bool> InsertResult;
 
-            Color averageColor;
-            Model::TextureCollection::LoaderPtr loader = textureCollection.loader();
-
+            Model::TextureCollection::LoaderPtr loader = textureCollection.loader(palette);
             const Model::TextureList& textures = textureCollection.textures();
-            for (unsigned int i = 0; i < textures.size(); i++) {
-                Model::Texture& texture = *textures[i];
-                unsigned char* textureImage = loader->load(texture, palette, averageColor);
-                if (textureImage != NULL) {
-                    TextureRenderer* textureRenderer = new TextureRenderer(textureImage, averageColor, texture.width(), texture.height());
-                    InsertResult result = m_textures.insert(TextureRendererEntry(&texture, textureRenderer));
-                    assert(result.second);
+            
+            std::vector<DecodeTask*> tasks;
+            Utility::ThreadPool::TaskList taskList;
+            for (size_t first = 0; first < textures.size(); first += DecodeBatchSize) {
+                DecodeTask* task = new DecodeTask(*loader, textures, first, std::min(first + DecodeBatchSize, textures.size()));
+                tasks.push_back(task);
+                taskList.push_back(task);
+            }
+            
+            if (threadPool != NULL) {
+                threadPool->enqueue(taskList);
+                threadPool->wait(taskList);
+            } else {
+                for (size_t i = 0; i < tasks.size(); i++)
+                    tasks[i]->decode();
+            }
+            
+            IO::TextureCache::ImageList images;
+            for (size_t i = 0; i < tasks.size(); i++) {
+                const DecodeTask& task = *tasks[i];
+                const DecodeTask::ResultList& results = task.results();
+                for (size_t j = 0; j < results.size(); j++) {
+                    const DecodeTask::Result& result = results[j];
+                    if (result.image != NULL) {
+                        Model::Texture& texture = *textures[task.first() + j];
+                        TextureRenderer* textureRenderer = new TextureRenderer(result.image, result.averageColor, texture.width(), texture.height());
+                        InsertResult insertResult = m_textures.insert(TextureRendererEntry(&texture, textureRenderer));
+                        assert(insertResult.second);
+                        
+                        if (!loader->cached())
+                            images.push_back(IO::TextureCache::Image(texture.name(), texture.width(), texture.height(), result.image, result.averageColor));
+                    }
                 }
             }
+            
+            // the images are only uploaded and released once the renderers are activated, so they are still valid here
+            loader->updateCache(images);
+            Utility::deleteAll(tasks);
         }
         
         TextureRenderer* TextureRendererCollection::renderer(Model::Texture& texture) const {
@@ -69,6 +147,7 @@ namespace TrenchBroom {
         m_textureManager(textureManager),
         m_dummyTexture(new TextureRenderer()),
         m_palette(NULL),
+        m_threadPool(NULL),
         m_valid(true) {}
         
         TextureRendererManager::~TextureRendererManager() {
@@ -92,7 +171,7 @@ namespace TrenchBroom {
             TextureRendererCollection* rendererCollection = NULL;
             TextureRendererCollectionMap::iterator it = m_textureCollections.find(&collection);
             if (it == m_textureCollections.end()) {
-                rendererCollection = new TextureRendererCollection(collection, *m_palette);
+                rendererCollection = new TextureRendererCollection(collection, *m_palette, m_threadPool);
                 m_textureCollections[&collection] = rendererCollection;
             } else {
                 rendererCollection = it->second;
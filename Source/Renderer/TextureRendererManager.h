@@ -31,18 +31,31 @@ namespace TrenchBroom {
         class TextureManager;
     }
     
+    namespace Utility {
+        class ThreadPool;
+    }
+    
     namespace Renderer {
         class Palette;
         class TextureRenderer;
         
         class TextureRendererCollection {
         protected:
+            class DecodeTask;
+            
             typedef std::map<Model::Texture*, TextureRenderer*> TextureRendererMap;
             typedef std::pair<Model::Texture*, TextureRenderer*> TextureRendererEntry;
             
+            // the number of textures which a worker thread decodes at once
+            static const size_t DecodeBatchSize = 16;
+            
             TextureRendererMap m_textures;
         public:
-            TextureRendererCollection(Model::TextureCollection& textureCollection, const Palette& palette);
+            /*
+             * Decodes all textures of the given collection. If a thread pool is given, the textures are read and
+             * converted to RGB on its worker threads. The images are uploaded when the renderers are activated.
+             */
+            TextureRendererCollection(Model::TextureCollection& textureCollection, const Palette& palette, Utility::ThreadPool* threadPool);
             ~TextureRendererCollection();
             
             TextureRenderer* renderer(Model::Texture& texture) const;
@@ -56,6 +69,7 @@ namespace TrenchBroom {
             Model::TextureManager& m_textureManager;
             TextureRenderer* m_dummyTexture;
             Palette* m_palette;
+            Utility::ThreadPool* m_threadPool;
             TextureRendererCollectionMap m_textureCollections;
             bool m_valid;
 
@@ -71,6 +85,10 @@ namespace TrenchBroom {
                 m_valid = false;
             }
             
+            inline void setThreadPool(Utility::ThreadPool* threadPool) {
+                m_threadPool = threadPool;
+            }
+            
             TextureRenderer& renderer(Model::Texture* texture);
             
             inline void invalidate() {
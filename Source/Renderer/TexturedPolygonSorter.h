@@ -20,80 +20,221 @@
 #ifndef TrenchBroom_TexturedPolygonSorter_h
 #define TrenchBroom_TexturedPolygonSorter_h
 
-#include <iostream>
-#include <map>
+#include <cassert>
+#include <cstddef>
+#include <utility>
 #include <vector>
 
 namespace TrenchBroom {
     namespace Renderer {
+        /*
+         * Batches polygons by their textures. The textures must provide dense indices through a method index(), and
+         * textures which have no index must return static_cast<size_t>(-1). Adding a polygon only records it and
+         * counts it for its texture. When the collections are requested for the first time, the polygons are
+         * scattered into one contiguous array in which the polygons of every texture occupy a consecutive range, so
+         * there are neither tree lookups nor per texture reallocations. The collections are ordered by texture index.
+         */
         template <typename TextureType, typename PolygonType>
         class TexturedPolygonSorter {
-        private:
-            class CompareTexturesById {
-            public:
-                inline bool operator() (const TextureType* left, const TextureType* right) const {
-                    return left < right;
-                }
-            };
         public:
             typedef std::vector<PolygonType> PolygonList;
+            
             class PolygonCollection {
             private:
-                PolygonList m_polygons;
+                const PolygonList* m_polygons;
+                size_t m_first;
+                size_t m_polygonCount;
                 size_t m_vertexCount;
             public:
-                PolygonCollection() :
-                m_vertexCount(0) {}
-
-                inline const PolygonList& polygons() const {
-                    return m_polygons;
+                PolygonCollection(const PolygonList& polygons, size_t first, size_t polygonCount, size_t vertexCount) :
+                m_polygons(&polygons),
+                m_first(first),
+                m_polygonCount(polygonCount),
+                m_vertexCount(vertexCount) {}
+                
+                inline size_t polygonCount() const {
+                    return m_polygonCount;
                 }
-
+                
+                inline PolygonType polygon(size_t index) const {
+                    assert(index < m_polygonCount);
+                    return (*m_polygons)[m_first + index];
+                }
+                
                 inline size_t vertexCount() const {
                     return m_vertexCount;
                 }
-
-                inline void addPolygon(PolygonType polygon, size_t vertexCount) {
-                    m_polygons.push_back(polygon);
-                    m_vertexCount += vertexCount;
-                }
             };
-
-            typedef std::map<TextureType*, PolygonCollection, CompareTexturesById> PolygonCollectionMap;
+            
             typedef std::pair<TextureType*, PolygonCollection> PolygonCollectionEntry;
+            typedef std::vector<PolygonCollectionEntry> PolygonCollectionList;
         private:
+            static const size_t NoIndex = static_cast<size_t>(-1);
+            
+            // the highest bit of the slot marks unindexed textures, which keeps the entries small
+            static const size_t UnindexedSlot = ~(static_cast<size_t>(-1) >> 1);
+            
+            class Entry {
+            public:
+                PolygonType polygon;
+                size_t slot;
+                
+                Entry(PolygonType i_polygon, size_t i_slot) :
+                polygon(i_polygon),
+                slot(i_slot) {}
+            };
+            
+            typedef std::vector<Entry> EntryList;
+            typedef std::vector<TextureType*> TextureList;
+            typedef std::vector<size_t> CountList;
+            
+            class SlotList {
+            public:
+                TextureList textures;
+                CountList polygonCounts;
+                CountList vertexCounts;
+                
+                inline size_t size() const {
+                    return textures.size();
+                }
+                
+                inline void resize(size_t size) {
+                    textures.resize(size, NULL);
+                    polygonCounts.resize(size, 0);
+                    vertexCounts.resize(size, 0);
+                }
+                
+                inline void count(size_t slot, size_t vertexCount) {
+                    polygonCounts[slot]++;
+                    vertexCounts[slot] += vertexCount;
+                }
+            };
+            
+            // slot 0 holds the polygons without a texture, slot i + 1 the polygons of the texture with index i
+            SlotList m_indexedSlots;
+            // textures without an index or with an index which is taken by another texture are looked up linearly
+            SlotList m_unindexedSlots;
+            
+            // consecutive polygons often share their texture
+            TextureType* m_lastTexture;
+            size_t m_lastSlot;
+            
+            EntryList m_entries;
             size_t m_vertexCount;
-            size_t m_polygonCount;
-            PolygonCollectionMap m_polygonCollections;
-            typename PolygonCollectionMap::iterator m_lastPolygonCollection;
+            
+            mutable PolygonList m_polygons;
+            mutable PolygonCollectionList m_polygonCollections;
+            mutable bool m_sorted;
+            
+            inline bool indexedSlot(TextureType* texture, size_t& slot) {
+                if (texture == NULL) {
+                    slot = 0;
+                    return true;
+                }
+                
+                const size_t index = texture->index();
+                if (index == NoIndex)
+                    return false;
+                
+                slot = index + 1;
+                if (slot >= m_indexedSlots.size())
+                    m_indexedSlots.resize(slot + 1);
+                
+                if (m_indexedSlots.textures[slot] == NULL)
+                    m_indexedSlots.textures[slot] = texture;
+                return m_indexedSlots.textures[slot] == texture;
+            }
+            
+            inline size_t unindexedSlot(TextureType* texture) {
+                for (size_t i = 0; i < m_unindexedSlots.size(); i++)
+                    if (m_unindexedSlots.textures[i] == texture)
+                        return i;
+                m_unindexedSlots.resize(m_unindexedSlots.size() + 1);
+                m_unindexedSlots.textures.back() = texture;
+                return m_unindexedSlots.size() - 1;
+            }
+            
+            inline void addCollections(const SlotList& slots, CountList& positions, size_t& position) const {
+                positions.resize(slots.size());
+                for (size_t i = 0; i < slots.size(); i++) {
+                    positions[i] = position;
+                    const size_t polygonCount = slots.polygonCounts[i];
+                    if (polygonCount > 0) {
+                        const PolygonCollection collection(m_polygons, position, polygonCount, slots.vertexCounts[i]);
+                        m_polygonCollections.push_back(PolygonCollectionEntry(slots.textures[i], collection));
+                        position += polygonCount;
+                    }
+                }
+            }
+            
+            void sort() const {
+                // the prefix sums of the polygon counts are the positions of the slots in the polygon array
+                CountList indexedPositions;
+                CountList unindexedPositions;
+                size_t position = 0;
+                addCollections(m_indexedSlots, indexedPositions, position);
+                addCollections(m_unindexedSlots, unindexedPositions, position);
+                
+                m_polygons.resize(m_entries.size());
+                typename EntryList::const_iterator it, end;
+                for (it = m_entries.begin(), end = m_entries.end(); it != end; ++it) {
+                    const Entry& entry = *it;
+                    if ((entry.slot & UnindexedSlot) == 0)
+                        m_polygons[indexedPositions[entry.slot]++] = entry.polygon;
+                    else
+                        m_polygons[unindexedPositions[entry.slot & ~UnindexedSlot]++] = entry.polygon;
+                }
+                
+                m_sorted = true;
+            }
+            
+            // prevent copying, the collections refer to the polygon array
+            TexturedPolygonSorter(const TexturedPolygonSorter& other);
+            void operator= (const TexturedPolygonSorter& other);
         public:
             TexturedPolygonSorter() :
+            m_lastTexture(NULL),
+            m_lastSlot(0),
             m_vertexCount(0),
-            m_polygonCount(0),
-            m_lastPolygonCollection(m_polygonCollections.end()) {}
-
+            m_sorted(false) {
+                m_indexedSlots.resize(1);
+            }
+            
             inline void addPolygon(TextureType* texture, PolygonType polygon, size_t vertexCount) {
-                if (m_lastPolygonCollection == m_polygonCollections.end() || m_lastPolygonCollection->first != texture)
-                    m_lastPolygonCollection = m_polygonCollections.insert(PolygonCollectionEntry(texture, PolygonCollection())).first;
-
-                m_lastPolygonCollection->second.addPolygon(polygon, vertexCount);
+                assert(!m_sorted);
+                
+                if (texture != m_lastTexture) {
+                    size_t slot;
+                    if (indexedSlot(texture, slot))
+                        m_lastSlot = slot;
+                    else
+                        m_lastSlot = unindexedSlot(texture) | UnindexedSlot;
+                    m_lastTexture = texture;
+                }
+                
+                if ((m_lastSlot & UnindexedSlot) == 0)
+                    m_indexedSlots.count(m_lastSlot, vertexCount);
+                else
+                    m_unindexedSlots.count(m_lastSlot & ~UnindexedSlot, vertexCount);
+                m_entries.push_back(Entry(polygon, m_lastSlot));
                 m_vertexCount += vertexCount;
-                m_polygonCount++;
             }
-
+            
             inline size_t vertexCount() const {
                 return m_vertexCount;
             }
-
+            
             inline size_t polygonCount() const {
-                return m_polygonCount;
+                return m_entries.size();
             }
-
+            
             inline bool empty() const {
-                return m_polygonCollections.empty();
+                return m_entries.empty();
             }
-
-            inline const PolygonCollectionMap& collections() const {
+            
+            inline const PolygonCollectionList& collections() const {
+                if (!m_sorted)
+                    sort();
                 return m_polygonCollections;
             }
         };
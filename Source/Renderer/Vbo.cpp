@@ -165,6 +165,7 @@ namespace TrenchBroom {
                 for (it = memBlocks.begin(), end = memBlocks.end(); it != end; ++it) {
                     const MemBlock& memBlock = *it;
                     memcpy(m_buffer + memBlock.start, temp + offset, memBlock.length);
+                    offset += memBlock.length;
                 }
                 
                 delete [] temp;
@@ -236,7 +237,7 @@ namespace TrenchBroom {
             return last;
         }
         
-        Vbo::Vbo(GLenum type, size_t capacity) : m_type(type), m_totalCapacity(capacity), m_freeCapacity(capacity), m_buffer(NULL), m_vboId(0), m_state(VboInactive) {
+        Vbo::Vbo(GLenum type, size_t capacity) : m_type(type), m_totalCapacity(capacity), m_freeCapacity(capacity), m_buffer(NULL), m_vboId(0), m_state(VboInactive), m_packCount(0) {
             m_first = new VboBlock(*this, 0, m_totalCapacity);
             m_last = m_first;
             m_freeBlocks.push_back(m_first);
@@ -447,6 +448,7 @@ namespace TrenchBroom {
 #endif
 
             if (m_totalCapacity == m_freeCapacity || (m_last->free() && m_last->capacity() == m_freeCapacity)) return;
+            m_packCount++;
             
             // find first free block
             VboBlock* block = m_first;
@@ -70,6 +70,7 @@ namespace TrenchBroom {
             unsigned char* m_buffer;
             GLuint m_vboId;
             VboState m_state;
+            size_t m_packCount;
             size_t findFreeBlockInRange(size_t address, size_t capacity, size_t start, size_t length);
             size_t findFreeBlock(size_t address, size_t capacity);
             void insertFreeBlock(VboBlock& block);
@@ -98,6 +99,14 @@ namespace TrenchBroom {
                 return m_state;
             }
             
+            /*
+             * Returns the number of times the blocks of this VBO have been moved by pack. Users which keep the
+             * addresses of their blocks must refresh them whenever this value changes.
+             */
+            inline size_t packCount() const {
+                return m_packCount;
+            }
+            
             void ensureFreeCapacity(size_t capacity);
             VboBlock* allocBlock(size_t capacity);
             VboBlock* freeBlock(VboBlock& block);
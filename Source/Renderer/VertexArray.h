@@ -62,6 +62,13 @@ namespace TrenchBroom {
                 glDrawArrays(m_primType, 0, static_cast<GLsizei>(m_vertexCount));
                 cleanup();
             }
+            
+            // requires ARB_draw_instanced
+            inline void renderInstances(unsigned int instanceCount) {
+                setup();
+                glDrawArraysInstancedARB(m_primType, 0, static_cast<GLsizei>(m_vertexCount), static_cast<GLsizei>(instanceCount));
+                cleanup();
+            }
         };
     }
 }
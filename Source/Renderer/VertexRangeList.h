@@ -0,0 +1,90 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TrenchBroom_VertexRangeList_h
+#define TrenchBroom_VertexRangeList_h
+
+#include <GL/glew.h>
+
+#include <cassert>
+#include <vector>
+
+namespace TrenchBroom {
+    namespace Renderer {
+        /*
+         * A list of vertex ranges which are rendered with a single call to glMultiDrawArrays. Every range is
+         * identified by its index in the list, which the owner of the range passes in as a handle. Removing a range
+         * moves the last range into its place and updates the handle of the moved range, so both adding and removing
+         * a range take constant time.
+         */
+        class VertexRangeList {
+        private:
+            typedef std::vector<GLint> IndexArray;
+            typedef std::vector<GLsizei> CountArray;
+            typedef std::vector<size_t*> HandleArray;
+            
+            IndexArray m_indices;
+            CountArray m_counts;
+            HandleArray m_handles;
+        public:
+            inline void add(GLint index, GLsizei count, size_t& handle) {
+                handle = m_indices.size();
+                m_indices.push_back(index);
+                m_counts.push_back(count);
+                m_handles.push_back(&handle);
+            }
+            
+            inline void remove(size_t handle) {
+                assert(handle < m_indices.size());
+                
+                const size_t last = m_indices.size() - 1;
+                if (handle < last) {
+                    m_indices[handle] = m_indices[last];
+                    m_counts[handle] = m_counts[last];
+                    m_handles[handle] = m_handles[last];
+                    *m_handles[handle] = handle;
+                }
+                m_indices.pop_back();
+                m_counts.pop_back();
+                m_handles.pop_back();
+            }
+            
+            inline void clear() {
+                m_indices.clear();
+                m_counts.clear();
+                m_handles.clear();
+            }
+            
+            inline bool empty() const {
+                return m_indices.empty();
+            }
+            
+            inline void render(GLenum primType) {
+                if (m_indices.empty())
+                    return;
+                
+                GLint* indexArray = &m_indices[0];
+                GLsizei* countArray = &m_counts[0];
+                glMultiDrawArrays(primType, indexArray, countArray, static_cast<GLsizei>(m_indices.size()));
+            }
+        };
+    }
+}
+
+#endif
@@ -20,184 +20,28 @@
 #ifndef TrenchBroom_Allocator_h
 #define TrenchBroom_Allocator_h
 
-#include <cassert>
-#include <iostream>
-#include <limits>
-#include <stack>
-#include <vector>
+#include "Utility/Arena.h"
 
 // Undefine this to prevent false positives when looking for memory leaks.
 #define _ENABLE_ALLOCATOR 1
 
 namespace TrenchBroom {
     namespace Utility {
-        template <class T, size_t PoolSize = 64, size_t BlocksPerChunk = 256>
+        /*
+         * Classes which derive from this class are allocated from the size class arena. The size is passed to
+         * operator delete so that objects which are too large for the arena can be told apart without looking at
+         * their memory.
+         */
+        template <class T>
         class Allocator {
-        private:
-            class Chunk {
-            private:
-                unsigned char m_firstFreeBlock;
-                unsigned char m_numFreeBlocks;
-                unsigned char m_blocks[BlocksPerChunk * sizeof(T)];
-            public:
-                Chunk() :
-                m_firstFreeBlock(0),
-                m_numFreeBlocks(BlocksPerChunk - 1) {
-                    for (size_t i = 0; i < BlocksPerChunk - 1; i++)
-                        m_blocks[i * sizeof(T)] = static_cast<unsigned char>(i + 1);
-                }
-
-                inline bool contains(const T* t) const {
-                    const unsigned char* block = reinterpret_cast<const unsigned char*>(t);
-                    if (block < m_blocks)
-                        return false;
-                    size_t offset = static_cast<size_t>(block - m_blocks);
-                    return offset < (BlocksPerChunk - 1) * sizeof(T);
-                }
-
-                inline T* allocate() {
-                    if (m_numFreeBlocks == 0)
-                        return NULL;
-
-                    unsigned char* block = m_blocks + m_firstFreeBlock * sizeof(T);
-                    m_firstFreeBlock = *block;
-                    m_numFreeBlocks--;
-                    return reinterpret_cast<T*>(block);
-                };
-
-                inline void deallocate(T* t) {
-                    assert(m_numFreeBlocks < BlocksPerChunk - 1);
-                    assert(contains(t));
-
-                    unsigned char* block = reinterpret_cast<unsigned char*>(t);
-                    assert(block >= m_blocks);
-                    size_t offset = static_cast<size_t>(block - m_blocks);
-                    assert(offset % sizeof(T) == 0);
-
-                    size_t index = offset / sizeof(T);
-                    assert(index < BlocksPerChunk);
-
-                    *block = m_firstFreeBlock;
-                    m_firstFreeBlock = static_cast<unsigned char>(index);
-                    m_numFreeBlocks++;
-                }
-
-                inline bool empty() const {
-                    return m_numFreeBlocks == BlocksPerChunk - 1;
-                }
-
-                inline bool full() const {
-                    return m_numFreeBlocks == 0;
-                }
-            };
-
-            typedef std::vector<Chunk*> ChunkList;
-            typedef std::stack<T*> Pool;
-
-            static inline Pool& pool() {
-                static Pool p;
-                return p;
-            }
-
-            static inline ChunkList& fullChunks() {
-                static ChunkList chunks;
-                return chunks;
-            }
-
-            static inline ChunkList& mixedChunks() {
-                static ChunkList chunks;
-                return chunks;
-            }
-
-            static inline ChunkList emptyChunks() {
-                static ChunkList chunks;
-                return chunks;
-            }
         public:
 #ifdef _ENABLE_ALLOCATOR
             inline void* operator new(size_t size) {
-                assert(size == sizeof(T));
-
-                if (!pool().empty()) {
-                    T* t = pool().top();
-                    pool().pop();
-                    return t;
-                }
-
-                Chunk* chunk = NULL;
-                if (mixedChunks().empty()) {
-                    if (!emptyChunks().empty()) {
-                        chunk = emptyChunks().back();
-                        emptyChunks().pop_back();
-                    } else {
-                        chunk = new Chunk();
-                    }
-                } else {
-                    chunk = mixedChunks().back();
-                    mixedChunks().pop_back();
-                }
-
-                assert(!chunk->full());
-                T* block = chunk->allocate();
-
-                if (chunk->full())
-                    fullChunks().push_back(chunk);
-                else
-                    mixedChunks().push_back(chunk);
-                return block;
+                return Arena::allocate(size);
             }
 
-            inline void operator delete(void* block) {
-                T* t = reinterpret_cast<T*>(block);
-
-                size_t poolSize = PoolSize;
-                if (poolSize > 0 && pool().size() < poolSize) {
-                    pool().push(t);
-                    return;
-                }
-
-                typename ChunkList::reverse_iterator fullIt, fullEnd, mixedIt, mixedEnd;
-                fullIt = fullChunks().rbegin();
-                fullEnd = fullChunks().rend();
-                mixedIt = mixedChunks().rbegin();
-                mixedEnd = mixedChunks().rend();
-
-                Chunk* chunk = NULL;
-                while (fullIt < fullEnd || mixedIt < mixedEnd) {
-                    if (fullIt < fullEnd) {
-                        Chunk* fullChunk = *fullIt;
-                        if (fullChunk->contains(t)) {
-                            chunk = fullChunk;
-                            break;
-                        }
-                        ++fullIt;
-                    }
-                    if (mixedIt < mixedEnd) {
-                        Chunk* mixedChunk = *mixedIt;
-                        if (mixedChunk->contains(t)) {
-                            chunk = mixedChunk;
-                            break;
-                        }
-                        ++mixedIt;
-                    }
-                }
-
-                assert(chunk != NULL);
-
-                if (chunk->full()) {
-                    fullChunks().erase((fullIt + 1).base());
-                    mixedChunks().push_back(chunk);
-                }
-
-                chunk->deallocate(t);
-
-                if (chunk->empty()) {
-                    mixedChunks().erase((mixedIt + 1).base());
-                    if (emptyChunks().size() < 2)
-                        emptyChunks().push_back(chunk);
-                    else
-                        delete chunk;
-                }
+            inline void operator delete(void* block, size_t size) {
+                Arena::deallocate(block, size);
             }
 #endif
         };
@@ -0,0 +1,371 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Arena.h"
+
+#include "Utility/Atomic.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <new>
+
+#if defined _MSC_VER
+#include <malloc.h>
+#else
+#include <pthread.h>
+#endif
+
+namespace TrenchBroom {
+    namespace Utility {
+        static const size_t BatchSize = 32;
+        static const size_t MaxCachedBlocks = 2 * BatchSize;
+        
+        class ArenaBlock {
+        public:
+            ArenaBlock* next;
+        };
+        
+        /*
+         * The header at the start of every chunk. Blocks are taken from the free list first and then from the unused
+         * space at the end of the chunk.
+         */
+        class ArenaChunk {
+        public:
+            ArenaChunk* previous;
+            ArenaChunk* next;
+            ArenaBlock* freeBlocks;
+            char* unused;
+            char* end;
+            size_t sizeClass;
+            size_t usedBlocks;
+            bool available;
+        };
+        
+        static const size_t ChunkHeaderSize = ((sizeof(ArenaChunk) + Arena::Granularity - 1) / Arena::Granularity) * Arena::Granularity;
+        
+        class ArenaSizeClass {
+        public:
+            SpinLock lock;
+            ArenaChunk* available;
+            ArenaChunk* spare;
+            size_t chunkCount;
+            size_t usedBlocks;
+            
+            ArenaSizeClass() :
+            available(NULL),
+            spare(NULL),
+            chunkCount(0),
+            usedBlocks(0) {}
+        };
+        
+        class ArenaThreadCache {
+        public:
+            ArenaBlock* blocks[Arena::SizeClassCount];
+            size_t counts[Arena::SizeClassCount];
+            ArenaThreadCache* previous;
+            ArenaThreadCache* next;
+        };
+        
+        static ArenaSizeClass sizeClasses[Arena::SizeClassCount];
+        static SpinLock threadCacheLock;
+        static ArenaThreadCache* threadCaches = NULL;
+        
+        static inline size_t sizeClassIndex(size_t size) {
+            assert(size <= Arena::MaxBlockSize);
+            return size == 0 ? 0 : (size - 1) / Arena::Granularity;
+        }
+        
+        static inline size_t blockSize(size_t sizeClass) {
+            return (sizeClass + 1) * Arena::Granularity;
+        }
+        
+        static inline ArenaChunk* chunkOf(void* block) {
+            const size_t address = reinterpret_cast<size_t>(block);
+            return reinterpret_cast<ArenaChunk*>(address & ~(Arena::ChunkSize - 1));
+        }
+        
+        static ArenaChunk* createChunk(size_t sizeClass) {
+            void* memory = NULL;
+#if defined _MSC_VER
+            memory = _aligned_malloc(Arena::ChunkSize, Arena::ChunkSize);
+#else
+            if (posix_memalign(&memory, Arena::ChunkSize, Arena::ChunkSize) != 0)
+                memory = NULL;
+#endif
+            if (memory == NULL)
+                throw std::bad_alloc();
+            
+            ArenaChunk* chunk = static_cast<ArenaChunk*>(memory);
+            chunk->previous = NULL;
+            chunk->next = NULL;
+            chunk->freeBlocks = NULL;
+            chunk->unused = static_cast<char*>(memory) + ChunkHeaderSize;
+            chunk->end = chunk->unused + ((Arena::ChunkSize - ChunkHeaderSize) / blockSize(sizeClass)) * blockSize(sizeClass);
+            chunk->sizeClass = sizeClass;
+            chunk->usedBlocks = 0;
+            chunk->available = false;
+            return chunk;
+        }
+        
+        static void destroyChunk(ArenaChunk* chunk) {
+#if defined _MSC_VER
+            _aligned_free(chunk);
+#else
+            free(chunk);
+#endif
+        }
+        
+        static inline void linkChunk(ArenaSizeClass& sizeClass, ArenaChunk* chunk) {
+            assert(!chunk->available);
+            chunk->previous = NULL;
+            chunk->next = sizeClass.available;
+            if (sizeClass.available != NULL)
+                sizeClass.available->previous = chunk;
+            sizeClass.available = chunk;
+            chunk->available = true;
+        }
+        
+        static inline void unlinkChunk(ArenaSizeClass& sizeClass, ArenaChunk* chunk) {
+            assert(chunk->available);
+            if (chunk->previous != NULL)
+                chunk->previous->next = chunk->next;
+            else
+                sizeClass.available = chunk->next;
+            if (chunk->next != NULL)
+                chunk->next->previous = chunk->previous;
+            chunk->previous = NULL;
+            chunk->next = NULL;
+            chunk->available = false;
+        }
+        
+        /*
+         * Moves a batch of blocks from the chunks of the given size class to the given cache.
+         */
+        static void refillCache(ArenaThreadCache& cache, size_t index) {
+            ArenaSizeClass& sizeClass = sizeClasses[index];
+            const size_t size = blockSize(index);
+            SpinLocker locker(sizeClass.lock);
+            
+            for (size_t i = 0; i < BatchSize; i++) {
+                ArenaChunk* chunk = sizeClass.available;
+                if (chunk == NULL) {
+                    if (sizeClass.spare != NULL) {
+                        chunk = sizeClass.spare;
+                        sizeClass.spare = NULL;
+                    } else {
+                        chunk = createChunk(index);
+                        sizeClass.chunkCount++;
+                    }
+                    linkChunk(sizeClass, chunk);
+                }
+                
+                ArenaBlock* block = chunk->freeBlocks;
+                if (block != NULL) {
+                    chunk->freeBlocks = block->next;
+                } else {
+                    assert(chunk->unused < chunk->end);
+                    block = reinterpret_cast<ArenaBlock*>(chunk->unused);
+                    chunk->unused += size;
+                }
+                
+                chunk->usedBlocks++;
+                if (chunk->freeBlocks == NULL && chunk->unused == chunk->end)
+                    unlinkChunk(sizeClass, chunk);
+                
+                block->next = cache.blocks[index];
+                cache.blocks[index] = block;
+                cache.counts[index]++;
+            }
+            sizeClass.usedBlocks += BatchSize;
+        }
+        
+        /*
+         * Returns the given number of blocks from the given cache to their chunks. Chunks which become empty are
+         * released, except for one spare chunk per size class.
+         */
+        static void flushCache(ArenaThreadCache& cache, size_t index, size_t count) {
+            ArenaSizeClass& sizeClass = sizeClasses[index];
+            SpinLocker locker(sizeClass.lock);
+            
+            for (size_t i = 0; i < count; i++) {
+                ArenaBlock* block = cache.blocks[index];
+                assert(block != NULL);
+                cache.blocks[index] = block->next;
+                cache.counts[index]--;
+                
+                ArenaChunk* chunk = chunkOf(block);
+                assert(chunk->sizeClass == index);
+                assert(chunk->usedBlocks > 0);
+                block->next = chunk->freeBlocks;
+                chunk->freeBlocks = block;
+                chunk->usedBlocks--;
+                
+                if (chunk->usedBlocks == 0) {
+                    if (chunk->available)
+                        unlinkChunk(sizeClass, chunk);
+                    if (sizeClass.spare == NULL) {
+                        sizeClass.spare = chunk;
+                    } else {
+                        destroyChunk(chunk);
+                        sizeClass.chunkCount--;
+                    }
+                } else if (!chunk->available) {
+                    linkChunk(sizeClass, chunk);
+                }
+            }
+            sizeClass.usedBlocks -= count;
+        }
+        
+        static void releaseCache(ArenaThreadCache* cache) {
+            for (size_t i = 0; i < Arena::SizeClassCount; i++)
+                if (cache->counts[i] > 0)
+                    flushCache(*cache, i, cache->counts[i]);
+            
+            SpinLocker locker(threadCacheLock);
+            if (cache->previous != NULL)
+                cache->previous->next = cache->next;
+            else
+                threadCaches = cache->next;
+            if (cache->next != NULL)
+                cache->next->previous = cache->previous;
+            delete cache;
+        }
+        
+#if defined _MSC_VER
+        static __declspec(thread) ArenaThreadCache* currentCache = NULL;
+        
+        static inline ArenaThreadCache* getCurrentCache() {
+            return currentCache;
+        }
+        
+        static inline void setCurrentCache(ArenaThreadCache* cache) {
+            currentCache = cache;
+        }
+#else
+        static pthread_key_t currentCacheKey;
+        static pthread_once_t currentCacheKeyOnce = PTHREAD_ONCE_INIT;
+        
+        // called by pthreads when a thread exits without releasing its cache
+        static void destroyCurrentCache(void* cache) {
+            releaseCache(static_cast<ArenaThreadCache*>(cache));
+        }
+        
+        static void createCurrentCacheKey() {
+            pthread_key_create(&currentCacheKey, destroyCurrentCache);
+        }
+        
+        static inline ArenaThreadCache* getCurrentCache() {
+            pthread_once(&currentCacheKeyOnce, createCurrentCacheKey);
+            return static_cast<ArenaThreadCache*>(pthread_getspecific(currentCacheKey));
+        }
+        
+        static inline void setCurrentCache(ArenaThreadCache* cache) {
+            pthread_setspecific(currentCacheKey, cache);
+        }
+#endif
+        
+        static inline ArenaThreadCache& threadCache() {
+            ArenaThreadCache* cache = getCurrentCache();
+            if (cache == NULL) {
+                cache = new ArenaThreadCache();
+                for (size_t i = 0; i < Arena::SizeClassCount; i++) {
+                    cache->blocks[i] = NULL;
+                    cache->counts[i] = 0;
+                }
+                
+                SpinLocker locker(threadCacheLock);
+                cache->previous = NULL;
+                cache->next = threadCaches;
+                if (threadCaches != NULL)
+                    threadCaches->previous = cache;
+                threadCaches = cache;
+                setCurrentCache(cache);
+            }
+            return *cache;
+        }
+        
+        void* Arena::allocate(size_t size) {
+            if (size > MaxBlockSize)
+                return ::operator new(size);
+            
+            const size_t index = sizeClassIndex(size);
+            ArenaThreadCache& cache = threadCache();
+            if (cache.blocks[index] == NULL)
+                refillCache(cache, index);
+            
+            ArenaBlock* block = cache.blocks[index];
+            cache.blocks[index] = block->next;
+            cache.counts[index]--;
+            return block;
+        }
+        
+        void Arena::deallocate(void* block, size_t size) {
+            if (block == NULL)
+                return;
+            if (size > MaxBlockSize) {
+                ::operator delete(block);
+                return;
+            }
+            
+            const size_t index = chunkOf(block)->sizeClass;
+            assert(index == sizeClassIndex(size));
+            
+            ArenaThreadCache& cache = threadCache();
+            ArenaBlock* freeBlock = static_cast<ArenaBlock*>(block);
+            freeBlock->next = cache.blocks[index];
+            cache.blocks[index] = freeBlock;
+            cache.counts[index]++;
+            
+            if (cache.counts[index] > MaxCachedBlocks)
+                flushCache(cache, index, BatchSize);
+        }
+        
+        void Arena::releaseThreadCache() {
+            ArenaThreadCache* cache = getCurrentCache();
+            if (cache != NULL) {
+                setCurrentCache(NULL);
+                releaseCache(cache);
+            }
+        }
+        
+        Arena::Stats Arena::stats() {
+            Stats stats;
+            size_t cached[SizeClassCount];
+            
+            {
+                SpinLocker locker(threadCacheLock);
+                for (size_t i = 0; i < SizeClassCount; i++) {
+                    cached[i] = 0;
+                    for (ArenaThreadCache* cache = threadCaches; cache != NULL; cache = cache->next)
+                        cached[i] += cache->counts[i];
+                }
+            }
+            
+            for (size_t i = 0; i < SizeClassCount; i++) {
+                ArenaSizeClass& sizeClass = sizeClasses[i];
+                SpinLocker locker(sizeClass.lock);
+                const size_t live = sizeClass.usedBlocks > cached[i] ? sizeClass.usedBlocks - cached[i] : 0;
+                stats.liveObjects += live;
+                stats.liveBytes += live * blockSize(i);
+                stats.reservedBytes += sizeClass.chunkCount * ChunkSize;
+            }
+            return stats;
+        }
+    }
+}
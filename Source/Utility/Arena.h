@@ -0,0 +1,77 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TrenchBroom_Arena_h
+#define TrenchBroom_Arena_h
+
+#include <cstddef>
+
+namespace TrenchBroom {
+    namespace Utility {
+        /*
+         * A pool allocator for small objects. Requests are rounded up to one of several size classes, and each size
+         * class carves its blocks out of chunks of ChunkSize bytes. The chunks are aligned to their size, so the
+         * chunk header which owns a block is found by masking the block's address, which makes deallocation O(1).
+         *
+         * Every thread keeps a small cache of free blocks per size class and only takes the size class' lock when it
+         * needs to exchange a batch of blocks with the chunks, so that several threads can allocate and release
+         * objects concurrently, e.g. when loading a map. Threads which use the arena should call releaseThreadCache
+         * before they exit so that their cached blocks are returned to the chunks.
+         *
+         * Requests which are larger than MaxBlockSize are forwarded to the global operator new.
+         */
+        class Arena {
+        public:
+            static const size_t Granularity = 16;
+            static const size_t MaxBlockSize = 512;
+            static const size_t SizeClassCount = MaxBlockSize / Granularity;
+            static const size_t ChunkSize = 64 * 1024;
+            
+            class Stats {
+            public:
+                size_t liveObjects;
+                size_t liveBytes;
+                size_t reservedBytes;
+                
+                Stats() :
+                liveObjects(0),
+                liveBytes(0),
+                reservedBytes(0) {}
+            };
+        private:
+            Arena();
+        public:
+            static void* allocate(size_t size);
+            static void deallocate(void* block, size_t size);
+            
+            /*
+             * Returns the blocks cached by the calling thread to their chunks.
+             */
+            static void releaseThreadCache();
+            
+            /*
+             * Returns the number and size of the blocks which are currently in use and the size of all chunks. The
+             * values are exact unless other threads allocate or release blocks while the statistics are gathered.
+             */
+            static Stats stats();
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,103 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TrenchBroom_Atomic_h
+#define TrenchBroom_Atomic_h
+
+#if defined _MSC_VER
+#include <intrin.h>
+#pragma intrinsic(_InterlockedExchange, _InterlockedIncrement)
+extern "C" __declspec(dllimport) int __stdcall SwitchToThread();
+#else
+#include <sched.h>
+#endif
+
+namespace TrenchBroom {
+    namespace Utility {
+        /*
+         * These helpers only depend on compiler intrinsics so that they can be used in headers which are shared with
+         * the test target, which does not link against wxWidgets.
+         */
+        inline unsigned int atomicIncrement(volatile unsigned int& value) {
+#if defined _MSC_VER
+            return static_cast<unsigned int>(_InterlockedIncrement(reinterpret_cast<volatile long*>(&value)));
+#else
+            return __sync_add_and_fetch(&value, 1u);
+#endif
+        }
+
+        class SpinLock {
+        private:
+            volatile long m_locked;
+
+            SpinLock(const SpinLock& other);
+            SpinLock& operator=(const SpinLock& other);
+
+            inline static void yield() {
+#if defined _MSC_VER
+                SwitchToThread();
+#else
+                sched_yield();
+#endif
+            }
+        public:
+            SpinLock() : m_locked(0) {}
+
+            /*
+             * Spins for a short while and then gives up the time slice so that a preempted owner can finish.
+             */
+            inline void lock() {
+#if defined _MSC_VER
+                while (_InterlockedExchange(&m_locked, 1) != 0) {
+#else
+                while (__sync_lock_test_and_set(&m_locked, 1) != 0) {
+#endif
+                    unsigned int spins = 0;
+                    while (m_locked != 0)
+                        if (++spins % 64 == 0)
+                            yield();
+                }
+            }
+
+            inline void unlock() {
+#if defined _MSC_VER
+                _InterlockedExchange(&m_locked, 0);
+#else
+                __sync_lock_release(&m_locked);
+#endif
+            }
+        };
+
+        class SpinLocker {
+        private:
+            SpinLock& m_lock;
+        public:
+            SpinLocker(SpinLock& lock) :
+            m_lock(lock) {
+                m_lock.lock();
+            }
+
+            ~SpinLocker() {
+                m_lock.unlock();
+            }
+        };
+    }
+}
+
+#endif
@@ -19,11 +19,13 @@
 
 #include "CommandProcessor.h"
 
+#include "Utility/Console.h"
+
 #include <algorithm>
 #include <cassert>
 
 CompoundCommand::CompoundCommand(const wxString& name) :
-wxCommand(true, name) {}
+MeasuredCommand(true, name) {}
 
 CompoundCommand::~CompoundCommand() {
     clear();
@@ -70,9 +72,70 @@ bool CompoundCommand::Undo() {
     return true;
 }
 
+size_t CompoundCommand::memoryUsage(SharedBlockSet& countedBlocks) const {
+    size_t memoryUsage = 0;
+    CommandList::const_iterator it, end;
+    for (it = m_commands.begin(), end = m_commands.end(); it != end; ++it) {
+        const MeasuredCommand* command = static_cast<const MeasuredCommand*>(*it);
+        memoryUsage += command->memoryUsage(countedBlocks);
+    }
+    return memoryUsage;
+}
+
+void CommandProcessor::enforceMemoryBudget() {
+    if (m_memoryBudget == 0 || m_commands.GetCount() < 2)
+        return;
+    
+    /*
+     * Walk from the most recent command to the oldest one so that a block which is shared by several commands is
+     * charged to the most recent of them. It is only released once all of them are discarded, and those are older.
+     * The most recent command is always kept, even if it exceeds the budget on its own.
+     */
+    SharedBlockSet countedBlocks;
+    wxList::compatibility_iterator node = m_commands.GetLast();
+    size_t memoryUsage = static_cast<MeasuredCommand*>(node->GetData())->memoryUsage(countedBlocks);
+    for (node = node->GetPrevious(); node; node = node->GetPrevious()) {
+        const size_t commandUsage = static_cast<MeasuredCommand*>(node->GetData())->memoryUsage(countedBlocks);
+        if (memoryUsage + commandUsage > m_memoryBudget)
+            break;
+        memoryUsage += commandUsage;
+    }
+    
+    if (!node)
+        return;
+    
+    // discard the command which exceeded the budget and all older ones
+    unsigned int discardCount = 0;
+    bool last = false;
+    while (!last) {
+        wxList::compatibility_iterator first = m_commands.GetFirst();
+        last = first == node;
+        MeasuredCommand* command = static_cast<MeasuredCommand*>(first->GetData());
+        if (command == m_block)
+            m_block = NULL;
+        delete command;
+        m_commands.Erase(first);
+#if wxCHECK_VERSION(2, 9, 0)
+        if (m_lastSavedCommand && m_lastSavedCommand == first)
+            m_lastSavedCommand = wxList::compatibility_iterator();
+#endif
+        discardCount++;
+    }
+    
+    if (m_console != NULL)
+        m_console->info("Discarded %u undo steps to stay within the undo memory budget (%.1f of %.1f MB in use)", discardCount, memoryUsage / 1048576.0, m_memoryBudget / 1048576.0);
+}
+
 CommandProcessor::CommandProcessor(int maxCommandLevel) :
 wxCommandProcessor(maxCommandLevel),
-m_block(NULL) {}
+m_block(NULL),
+m_memoryBudget(0),
+m_console(NULL) {}
+
+void CommandProcessor::setMemoryBudget(size_t memoryBudget, TrenchBroom::Utility::Console* console) {
+    m_memoryBudget = memoryBudget;
+    m_console = console;
+}
 
 void CommandProcessor::BeginGroup(wxCommandProcessor* wxCommandProc, const wxString& name) {
     CommandProcessor* commandProc = static_cast<CommandProcessor*>(wxCommandProc);
@@ -132,7 +195,7 @@ void CommandProcessor::EndGroup() {
         delete group;
     } else {
         if (m_groupStack.empty())
-            wxCommandProcessor::Store(group);
+            Store(group);
         else
             m_groupStack.top()->addCommand(group);
     }
@@ -154,6 +217,11 @@ void CommandProcessor::DiscardGroup() {
     delete group;
 }
 
+void CommandProcessor::Store(wxCommand* command) {
+    wxCommandProcessor::Store(command);
+    enforceMemoryBudget();
+}
+
 bool CommandProcessor::Submit(wxCommand* command, bool storeIt) {
     if (m_groupStack.empty())
         return wxCommandProcessor::Submit(command, storeIt);
@@ -22,12 +22,40 @@
 
 #include <wx/cmdproc.h>
 
+#include <set>
 #include <stack>
 #include <vector>
 
+namespace TrenchBroom {
+    namespace Utility {
+        class Console;
+    }
+}
+
+/*
+ * The addresses of the blocks of undo information which are shared by several commands and which have already been
+ * counted.
+ */
+typedef std::set<const void*> SharedBlockSet;
+
+/*
+ * The base class of all commands which are stored by the command processor. Commands report how much memory their
+ * undo information occupies so that the oldest commands can be discarded once the undo history exceeds its budget.
+ * A block which is shared with other commands is only counted if it is not in the given set yet, and is then added.
+ */
+class MeasuredCommand : public wxCommand {
+public:
+    MeasuredCommand(bool canUndo, const wxString& name) :
+    wxCommand(canUndo, name) {}
+    
+    virtual size_t memoryUsage(SharedBlockSet& countedBlocks) const {
+        return 0;
+    }
+};
+
 typedef std::vector<wxCommand*> CommandList;
 
-class CompoundCommand : public wxCommand {
+class CompoundCommand : public MeasuredCommand {
 protected:
     CommandList m_commands;
 public:
@@ -41,6 +69,8 @@ public:
     
     bool Do();
     bool Undo();
+    
+    size_t memoryUsage(SharedBlockSet& countedBlocks) const;
 };
 
 class CommandProcessor : public wxCommandProcessor {
@@ -49,8 +79,18 @@ protected:
 
     GroupStack m_groupStack;
     wxCommand* m_block;
+    size_t m_memoryBudget;
+    TrenchBroom::Utility::Console* m_console;
+    
+    void enforceMemoryBudget();
 public:
     CommandProcessor(int maxCommandLevel = -1);
+    
+    /*
+     * Sets the number of bytes which the undo history may occupy, or 0 if it is unlimited. Discarded commands are
+     * reported to the given console, which may be NULL.
+     */
+    void setMemoryBudget(size_t memoryBudget, TrenchBroom::Utility::Console* console);
 
     static void BeginGroup(wxCommandProcessor* wxCommandProc, const wxString& name);
     static void EndGroup(wxCommandProcessor* wxCommandProc);
@@ -68,6 +108,7 @@ public:
     void RollbackGroup();
     void DiscardGroup();
     bool Submit(wxCommand* command, bool storeIt = true);
+    void Store(wxCommand* command);
 };
 
 #endif /* defined(__TrenchBroom__CommandProcessor__) */
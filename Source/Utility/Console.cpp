@@ -25,6 +25,7 @@
 #include "NSLog.h"
 #endif
 
+#include <cassert>
 #include <cstdarg>
 #include <fstream>
 #include <wx/datetime.h>
@@ -150,5 +151,15 @@ namespace TrenchBroom {
             va_end(arguments);
             error(message);
         }
+
+        void BufferedConsole::log(const LogMessage& message) {
+            m_buffer.push_back(message);
+        }
+
+        void BufferedConsole::replay(Console& console, size_t first, size_t last) const {
+            assert(first <= last && last <= m_buffer.size());
+            for (size_t i = first; i < last; i++)
+                console.log(m_buffer[i]);
+        }
     }
 }
@@ -83,10 +83,11 @@ namespace TrenchBroom {
             void logToFile(const LogMessage& message);
         public:
             Console() : m_textCtrl(NULL) {}
+            virtual ~Console() {}
             
             void setTextCtrl(wxTextCtrl* textCtrl);
             
-            void log(const LogMessage& message);
+            virtual void log(const LogMessage& message);
             
             void debug(const String& message);
             void debug(const char* format, ...);
@@ -97,6 +98,21 @@ namespace TrenchBroom {
             void error(const String& message);
             void error(const char* format, ...);
         };
+
+        /*
+         * Collects all messages instead of displaying them so that worker threads can log without touching the UI.
+         * The collected messages are replayed on the main thread later.
+         */
+        class BufferedConsole : public Console {
+        public:
+            void log(const LogMessage& message);
+
+            inline size_t messageCount() const {
+                return m_buffer.size();
+            }
+
+            void replay(Console& console, size_t first, size_t last) const;
+        };
     }
 }
 
@@ -19,8 +19,6 @@
 
 #include "DocManager.h"
 
-#include "Utility/CommandProcessor.h"
-
 IMPLEMENT_DYNAMIC_CLASS(DocManager, wxDocManager)
 wxDocument* DocManager::CreateDocument(const wxString& pathOrig, long flags) {
     wxDocument* document = GetCurrentDocument();
@@ -29,8 +27,9 @@ wxDocument* DocManager::CreateDocument(const wxString& pathOrig, long flags) {
         if (document == NULL)
             return NULL;
         
+        // the document creates its command processor again now that it is fully initialized
         wxCommandProcessor* oldProcessor = document->GetCommandProcessor();
-        CommandProcessor* newProcessor = new CommandProcessor();
+        wxCommandProcessor* newProcessor = document->OnCreateCommandProcessor();
         newProcessor->SetEditMenu(oldProcessor->GetEditMenu());
         newProcessor->SetRedoAccelerator(oldProcessor->GetRedoAccelerator());
         newProcessor->SetUndoAccelerator(oldProcessor->GetUndoAccelerator());
@@ -0,0 +1,120 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TrenchBroom_FormatFloat_h
+#define TrenchBroom_FormatFloat_h
+
+#include "Utility/String.h"
+
+#include <cstdio>
+#include <cstring>
+
+#ifdef _MSC_VER
+#include <cstdint>
+#elif defined __GNUC__
+#include <stdint.h>
+#endif
+
+namespace TrenchBroom {
+    namespace Utility {
+        /*
+         * Appends the given value to the buffer exactly as printf would format it with "%.<precision>g".
+         *
+         * A float is an integer times a power of two. If that power is between 2^-16 and 2^39, the exact decimal
+         * digits fit into 64 bits and the value is formatted directly, which covers grid aligned coordinates and the
+         * usual texture offsets and scales. Values that need rounding or exponential notation, as well as denormals,
+         * infinities and NaNs, are passed to sprintf.
+         */
+        inline void appendFloat(String& buffer, float value, int precision) {
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            const bool negative = (bits >> 31) != 0;
+            const int exponent = static_cast<int>((bits >> 23) & 0xFF);
+            uint64_t mantissa = bits & 0x7FFFFF;
+            
+            if (exponent == 0 && mantissa == 0) {
+                buffer += negative ? "-0" : "0";
+                return;
+            }
+            
+            if (exponent != 0 && exponent != 0xFF) {
+                // value = mantissa * 2^shift
+                mantissa |= 0x800000;
+                int shift = exponent - 150;
+                while (shift < 0 && (mantissa & 1) == 0) {
+                    mantissa >>= 1;
+                    shift++;
+                }
+                
+                if (shift >= -16 && shift <= 39) {
+                    // value = digits * 10^-fractionDigits
+                    uint64_t digits = mantissa;
+                    int fractionDigits = 0;
+                    if (shift > 0) {
+                        digits <<= shift;
+                    } else {
+                        fractionDigits = -shift;
+                        for (int i = 0; i < fractionDigits; i++)
+                            digits *= 5;
+                    }
+                    
+                    char str[24];
+                    int length = 0;
+                    while (digits > 0) {
+                        str[length++] = static_cast<char>('0' + digits % 10);
+                        digits /= 10;
+                    }
+                    
+                    // str holds the digits in reverse order, find the last significant one
+                    int last = 0;
+                    while (str[last] == '0')
+                        last++;
+                    
+                    const int decimalExponent = length - 1 - fractionDigits;
+                    const int significantDigits = length - last;
+                    if (decimalExponent >= -4 && decimalExponent < precision && significantDigits <= precision) {
+                        if (negative)
+                            buffer += '-';
+                        if (decimalExponent >= 0) {
+                            for (int i = length - 1; i >= fractionDigits; i--)
+                                buffer += str[i];
+                            if (last < fractionDigits) {
+                                buffer += '.';
+                                for (int i = fractionDigits - 1; i >= last; i--)
+                                    buffer += str[i];
+                            }
+                        } else {
+                            buffer += "0.";
+                            buffer.append(static_cast<size_t>(fractionDigits - length), '0');
+                            for (int i = length - 1; i >= last; i--)
+                                buffer += str[i];
+                        }
+                        return;
+                    }
+                }
+            }
+            
+            char str[128];
+            std::sprintf(str, "%.*g", precision, static_cast<double>(value));
+            buffer += str;
+        }
+    }
+}
+
+#endif
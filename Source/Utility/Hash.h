@@ -0,0 +1,51 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TrenchBroom_Hash_h
+#define TrenchBroom_Hash_h
+
+#include <cstddef>
+
+#ifdef _MSC_VER
+#include <cstdint>
+#elif defined __GNUC__
+#include <stdint.h>
+#endif
+
+namespace TrenchBroom {
+    namespace Utility {
+        static const uint32_t HashSeed = 2166136261u;
+        
+        /*
+         * Computes the 32 bit FNV-1a hash of the given bytes. Pass the result of a previous call as the seed to hash
+         * several blocks of data as if they were one.
+         */
+        inline uint32_t hash(const void* data, size_t size, uint32_t seed = HashSeed) {
+            const unsigned char* bytes = static_cast<const unsigned char*>(data);
+            uint32_t result = seed;
+            for (size_t i = 0; i < size; i++) {
+                result ^= bytes[i];
+                result *= 16777619u;
+            }
+            return result;
+        }
+    }
+}
+
+#endif
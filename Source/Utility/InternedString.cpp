@@ -0,0 +1,146 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "InternedString.h"
+
+#include "Utility/Atomic.h"
+#include "Utility/Hash.h"
+
+#include <deque>
+
+namespace TrenchBroom {
+    namespace Utility {
+        class StringTable {
+        private:
+            typedef InternedString::Entry Entry;
+            
+            class Bucket {
+            public:
+                const Entry* entry;
+                uint32_t hash;
+                
+                Bucket() :
+                entry(NULL),
+                hash(0) {}
+            };
+            
+            typedef std::vector<Bucket> BucketList;
+            
+            SpinLock m_lock;
+            std::deque<Entry> m_entries;
+            BucketList m_buckets;
+            size_t m_bytes;
+            
+            size_t findBucket(const String& str, uint32_t hash) const {
+                const size_t mask = m_buckets.size() - 1;
+                size_t index = hash & mask;
+                while (m_buckets[index].entry != NULL) {
+                    const Bucket& bucket = m_buckets[index];
+                    if (bucket.hash == hash && bucket.entry->string == str)
+                        break;
+                    index = (index + 1) & mask;
+                }
+                return index;
+            }
+            
+            void grow() {
+                BucketList buckets(2 * m_buckets.size());
+                const size_t mask = buckets.size() - 1;
+                BucketList::const_iterator it, end;
+                for (it = m_buckets.begin(), end = m_buckets.end(); it != end; ++it) {
+                    const Bucket& bucket = *it;
+                    if (bucket.entry != NULL) {
+                        size_t index = bucket.hash & mask;
+                        while (buckets[index].entry != NULL)
+                            index = (index + 1) & mask;
+                        buckets[index] = bucket;
+                    }
+                }
+                m_buckets.swap(buckets);
+            }
+        public:
+            StringTable() :
+            m_buckets(1024),
+            m_bytes(0) {}
+            
+            static StringTable& instance() {
+                static StringTable table;
+                return table;
+            }
+            
+            const Entry* intern(const String& str) {
+                const uint32_t hash = Utility::hash(str.data(), str.size());
+                
+                SpinLocker locker(m_lock);
+                size_t index = findBucket(str, hash);
+                if (m_buckets[index].entry != NULL)
+                    return m_buckets[index].entry;
+                
+                if (2 * (m_entries.size() + 1) > m_buckets.size()) {
+                    grow();
+                    index = findBucket(str, hash);
+                }
+                
+                m_entries.push_back(Entry(str, static_cast<unsigned int>(m_entries.size())));
+                m_bytes += str.size();
+                
+                Bucket& bucket = m_buckets[index];
+                bucket.entry = &m_entries.back();
+                bucket.hash = hash;
+                return bucket.entry;
+            }
+            
+            const Entry* find(const String& str) {
+                const uint32_t hash = Utility::hash(str.data(), str.size());
+                
+                SpinLocker locker(m_lock);
+                return m_buckets[findBucket(str, hash)].entry;
+            }
+            
+            void statistics(size_t& count, size_t& bytes) {
+                SpinLocker locker(m_lock);
+                count = m_entries.size();
+                bytes = m_bytes;
+            }
+        };
+        
+        static const InternedString::Entry* emptyString() {
+            static const InternedString::Entry* empty = StringTable::instance().intern("");
+            return empty;
+        }
+        
+        InternedString::InternedString() :
+        m_entry(emptyString()) {}
+        
+        InternedString::InternedString(const String& str) :
+        m_entry(StringTable::instance().intern(str)) {}
+        
+        bool InternedString::find(const String& str, InternedString& result) {
+            const Entry* entry = StringTable::instance().find(str);
+            if (entry == NULL)
+                return false;
+            result.m_entry = entry;
+            return true;
+        }
+        
+        void InternedString::statistics(size_t& count, size_t& bytes) {
+            StringTable::instance().statistics(count, bytes);
+        }
+    }
+}
@@ -0,0 +1,94 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TrenchBroom__InternedString__
+#define __TrenchBroom__InternedString__
+
+#include "Utility/String.h"
+
+#include <vector>
+
+namespace TrenchBroom {
+    namespace Utility {
+        /*
+         * A handle to a string in the process wide string table. Equal strings share one copy and one handle, so
+         * comparing handles is a pointer comparison. Interned strings are never released, so only strings that come
+         * from a small vocabulary (texture names, property keys) should be interned.
+         *
+         * Interning is thread safe. Handles are ordered by address, which is stable but not alphabetical. Every string
+         * also has a dense index in the order in which the strings were interned, which can be used to derive small
+         * integer IDs from a handle.
+         */
+        class InternedString {
+        public:
+            class Entry {
+            public:
+                String string;
+                unsigned int index;
+                
+                Entry(const String& i_string, unsigned int i_index) :
+                string(i_string),
+                index(i_index) {}
+            };
+        private:
+            const Entry* m_entry;
+        public:
+            InternedString();
+            explicit InternedString(const String& str);
+            
+            /*
+             * Sets the given handle to the given string if it has been interned before. Does not intern the string.
+             */
+            static bool find(const String& str, InternedString& result);
+            
+            inline const String& str() const {
+                return m_entry->string;
+            }
+            
+            inline unsigned int index() const {
+                return m_entry->index;
+            }
+            
+            inline bool empty() const {
+                return m_entry->string.empty();
+            }
+            
+            inline bool operator==(const InternedString& other) const {
+                return m_entry == other.m_entry;
+            }
+            
+            inline bool operator!=(const InternedString& other) const {
+                return m_entry != other.m_entry;
+            }
+            
+            inline bool operator<(const InternedString& other) const {
+                return m_entry < other.m_entry;
+            }
+            
+            /*
+             * Returns the number of strings in the table and the number of bytes used by their characters.
+             */
+            static void statistics(size_t& count, size_t& bytes);
+        };
+        
+        typedef std::vector<InternedString> InternedStringList;
+    }
+}
+
+#endif /* defined(__TrenchBroom__InternedString__) */
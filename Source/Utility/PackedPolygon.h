@@ -0,0 +1,179 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TrenchBroom_PackedPolygon_h
+#define TrenchBroom_PackedPolygon_h
+
+#include "Utility/Math.h"
+
+#include <cassert>
+#include <vector>
+
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#define TRENCHBROOM_PACKED_POLYGON_SSE
+#include <emmintrin.h>
+#endif
+
+namespace TrenchBroom {
+    namespace VecMath {
+        /*
+         * A planar polygon whose vertices are stored in two contiguous arrays of X and Y coordinates, relative to the
+         * point being tested. The arrays start with a copy of the last vertex and are padded with copies of it at the
+         * end, so that edge i is always (i, i + 1) and any four consecutive edges can be loaded at once.
+         *
+         * The crossing number test gives exactly the same results as the vertex by vertex loop it replaces: the point
+         * is inside if it coincides with a vertex or if an odd number of edges cross the positive X axis.
+         */
+        class PackedPolygon {
+        private:
+            static const size_t MaxFixedVertices = 60;
+            static const size_t Padding = 4;
+            
+            float m_fixedX[MaxFixedVertices + Padding];
+            float m_fixedY[MaxFixedVertices + Padding];
+            std::vector<float> m_dynamicX;
+            std::vector<float> m_dynamicY;
+            float* m_x;
+            float* m_y;
+            size_t m_count;
+            
+            PackedPolygon(const PackedPolygon& other);
+            PackedPolygon& operator=(const PackedPolygon& other);
+            
+            inline bool containsOriginScalar() const {
+                const float epsilon = Math<float>::AlmostZero;
+                
+                unsigned int crossings = 0;
+                for (size_t i = 0; i < m_count; i++) {
+                    const float x0 = m_x[i];
+                    const float y0 = m_y[i];
+                    const float x1 = m_x[i + 1];
+                    const float y1 = m_y[i + 1];
+                    
+                    if (Math<float>::zero(x1, epsilon) && Math<float>::zero(y1, epsilon))
+                        return true;
+                    
+                    /*
+                     * A polygon edge intersects with the positive X axis if the Y coordinates of its vertices have
+                     * different signs (0 counts as negative) and either both X coordinates are positive or the X
+                     * coordinates have different signs and the edge crosses the X axis at a non-negative X coordinate.
+                     */
+                    if ((y0 > 0.0f) != (y1 > 0.0f)) {
+                        if (x0 > 0.0f && x1 > 0.0f) {
+                            crossings++;
+                        } else if ((x0 > 0.0f) != (x1 > 0.0f)) {
+                            const float x = -y0 * (x1 - x0) / (y1 - y0) + x0;
+                            if (x >= 0.0f)
+                                crossings++;
+                        }
+                    }
+                }
+                return crossings % 2 == 1;
+            }
+            
+#ifdef TRENCHBROOM_PACKED_POLYGON_SSE
+            inline bool containsOriginSse() const {
+                const __m128 epsilon = _mm_set1_ps(Math<float>::AlmostZero);
+                const __m128 signBit = _mm_set1_ps(-0.0f);
+                const __m128 zero = _mm_setzero_ps();
+                
+                __m128 coincident = zero;
+                unsigned int crossings = 0;
+                for (size_t i = 0; i < m_count; i += 4) {
+                    const __m128 x0 = _mm_loadu_ps(m_x + i);
+                    const __m128 y0 = _mm_loadu_ps(m_y + i);
+                    const __m128 x1 = _mm_loadu_ps(m_x + i + 1);
+                    const __m128 y1 = _mm_loadu_ps(m_y + i + 1);
+                    
+                    coincident = _mm_or_ps(coincident, _mm_and_ps(_mm_cmple_ps(_mm_andnot_ps(signBit, x1), epsilon),
+                                                                  _mm_cmple_ps(_mm_andnot_ps(signBit, y1), epsilon)));
+                    
+                    const __m128 x0Pos = _mm_cmpgt_ps(x0, zero);
+                    const __m128 x1Pos = _mm_cmpgt_ps(x1, zero);
+                    const __m128 straddlesX = _mm_xor_ps(_mm_cmpgt_ps(y0, zero), _mm_cmpgt_ps(y1, zero));
+                    
+                    // same operations in the same order as in the scalar version so that the results are identical
+                    const __m128 x = _mm_add_ps(_mm_div_ps(_mm_mul_ps(_mm_xor_ps(y0, signBit), _mm_sub_ps(x1, x0)),
+                                                           _mm_sub_ps(y1, y0)), x0);
+                    const __m128 crossesAtPositiveX = _mm_and_ps(_mm_xor_ps(x0Pos, x1Pos), _mm_cmpge_ps(x, zero));
+                    const __m128 crosses = _mm_and_ps(straddlesX, _mm_or_ps(_mm_and_ps(x0Pos, x1Pos), crossesAtPositiveX));
+                    
+                    const int mask = _mm_movemask_ps(crosses);
+                    crossings += static_cast<unsigned int>((mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1));
+                }
+                
+                return _mm_movemask_ps(coincident) != 0 || crossings % 2 == 1;
+            }
+#endif
+        public:
+            PackedPolygon() :
+            m_x(m_fixedX),
+            m_y(m_fixedY),
+            m_count(0) {}
+            
+            /*
+             * Prepares the arrays for the given number of vertices, which must then be set using setVertex.
+             */
+            inline void reset(size_t count) {
+                assert(count > 0);
+                m_count = count;
+                if (count <= MaxFixedVertices) {
+                    m_x = m_fixedX;
+                    m_y = m_fixedY;
+                } else {
+                    m_dynamicX.resize(count + Padding);
+                    m_dynamicY.resize(count + Padding);
+                    m_x = &m_dynamicX[0];
+                    m_y = &m_dynamicY[0];
+                }
+            }
+            
+            inline void setVertex(size_t index, float x, float y) {
+                assert(index < m_count);
+                m_x[index + 1] = x;
+                m_y[index + 1] = y;
+                if (index == m_count - 1) {
+                    m_x[0] = x;
+                    m_y[0] = y;
+                    for (size_t i = m_count + 1; i < m_count + Padding; i++) {
+                        m_x[i] = x;
+                        m_y[i] = y;
+                    }
+                }
+            }
+            
+            inline size_t count() const {
+                return m_count;
+            }
+            
+            /*
+             * Returns true if the origin is inside this polygon, on its boundary or very close to one of its vertices.
+             */
+            inline bool containsOrigin(bool useSse = true) const {
+#ifdef TRENCHBROOM_PACKED_POLYGON_SSE
+                if (useSse)
+                    return containsOriginSse();
+#endif
+                return containsOriginScalar();
+            }
+        };
+    }
+}
+
+#endif
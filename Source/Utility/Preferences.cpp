@@ -38,6 +38,7 @@ namespace TrenchBroom {
         const Preference<float> CameraFieldOfVision = Preference<float>(                        "Renderer/Camera field of vision",                              90.0f);
         const Preference<float> CameraNearPlane = Preference<float>(                            "Renderer/Camera near plane",                                   1.0f);
         const Preference<float> CameraFarPlane = Preference<float>(                             "Renderer/Camera far plane",                                    8192.0f);
+        const Preference<float> RendererCullDistance = Preference<float>(                       "Renderer/Cull distance",                                       0.0f); // 0 means no limit other than the far plane
 
         const Preference<float> InfoOverlayFadeDistance = Preference<float>(                    "Renderer/Info overlay fade distance",                          400.0f);
         const Preference<float> SelectedInfoOverlayFadeDistance = Preference<float>(            "Renderer/Selected info overlay fade distance",                 400.0f);
@@ -155,6 +156,10 @@ namespace TrenchBroom {
         const Preference<String> RendererFontName = Preference<String>(                         "Renderer/Font name",                                           "Arial");
 #endif
 
+        const Preference<int>   WorkerThreadCount = Preference<int>(                            "General/Worker threads",                                       0); // 0 means one thread per CPU
+        const Preference<int>   UndoMemoryBudget = Preference<int>(                             "General/Undo memory budget",                                   256); // in megabytes, 0 means unlimited
+        const Preference<bool>  MapCacheEnabled = Preference<bool>(                             "General/Cache loaded maps",                                    true);
+        const Preference<bool>  EntityDefinitionCacheEnabled = Preference<bool>(                "General/Cache entity definitions",                             true);
         const Preference<int>   RendererInstancingMode = Preference<int>(                       "Renderer/Instancing mode",                                     0);
         const int               RendererInstancingModeAutodetect    = 0;
         const int               RendererInstancingModeForceOn       = 1;
@@ -306,6 +311,7 @@ namespace TrenchBroom {
             editMenu->addActionItem(KeyboardShortcut(View::CommandIds::Menu::EditSelectAll, WXK_CONTROL, 'A', KeyboardShortcut::SCAny, "Select All"));
             editMenu->addActionItem(KeyboardShortcut(View::CommandIds::Menu::EditSelectSiblings, WXK_CONTROL, WXK_ALT, 'A', KeyboardShortcut::SCAny, "Select Siblings"));
             editMenu->addActionItem(KeyboardShortcut(View::CommandIds::Menu::EditSelectTouching, WXK_CONTROL, 'T', KeyboardShortcut::SCAny, "Select Touching"));
+            editMenu->addActionItem(KeyboardShortcut(View::CommandIds::Menu::EditSelectInside, WXK_CONTROL, WXK_ALT, 'T', KeyboardShortcut::SCAny, "Select Inside"));
             editMenu->addActionItem(KeyboardShortcut(View::CommandIds::Menu::EditSelectByFilePosition, KeyboardShortcut::SCAny, "Select by Line Number"));
             editMenu->addActionItem(KeyboardShortcut(View::CommandIds::Menu::EditSelectNone, WXK_CONTROL, WXK_SHIFT, 'A', KeyboardShortcut::SCAny, "Select None"));
             editMenu->addSeparator();
@@ -255,6 +255,7 @@ namespace TrenchBroom {
         extern const Preference<float>  CameraFieldOfVision;
         extern const Preference<float>  CameraNearPlane;
         extern const Preference<float>  CameraFarPlane;
+        extern const Preference<float>  RendererCullDistance;
 
         extern const Preference<float>  InfoOverlayFadeDistance;
         extern const Preference<float>  SelectedInfoOverlayFadeDistance;
@@ -359,6 +360,10 @@ namespace TrenchBroom {
         extern const Preference<float>  TextureBrowserIconSize;
 
         extern const Preference<String> QuakePath;
+        extern const Preference<int>    WorkerThreadCount;
+        extern const Preference<int>    UndoMemoryBudget;
+        extern const Preference<bool>   MapCacheEnabled;
+        extern const Preference<bool>   EntityDefinitionCacheEnabled;
         extern const Preference<String> RendererFontName;
         extern const Preference<int>    RendererInstancingMode;
         extern const int                RendererInstancingModeAutodetect;
@@ -44,13 +44,14 @@ namespace TrenchBroom {
         
         struct CaseInsensitiveCharCompare {
         private:
-            const std::locale& m_locale;
+            // looking up the facet for every character is much more expensive than the comparison itself
+            const std::ctype<char>& m_ctype;
         public:
             CaseInsensitiveCharCompare(const std::locale& loc = std::locale::classic()) :
-            m_locale(loc) {}
+            m_ctype(std::use_facet<std::ctype<char> >(loc)) {}
             
             int operator()(char lhs, char rhs) const {
-                return std::tolower(lhs, m_locale) - std::tolower(rhs, m_locale);
+                return m_ctype.tolower(lhs) - m_ctype.tolower(rhs);
             }
         };
         
@@ -0,0 +1,148 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ThreadPool.h"
+
+#include "Utility/Arena.h"
+
+#include <cassert>
+
+namespace TrenchBroom {
+    namespace Utility {
+        wxThread::ExitCode ThreadPool::Worker::Entry() {
+            Task* task = NULL;
+            while ((task = m_pool.nextTask()) != NULL) {
+                try {
+                    task->run();
+                } catch (...) {
+                    assert(false);
+                }
+                m_pool.finishTask(task);
+            }
+            Arena::releaseThreadCache();
+            return (wxThread::ExitCode)0;
+        }
+
+        ThreadPool::Worker::Worker(ThreadPool& pool) :
+        wxThread(wxTHREAD_JOINABLE),
+        m_pool(pool) {}
+
+        ThreadPool::Task* ThreadPool::nextTask() {
+            wxMutexLocker lock(m_mutex);
+            while (m_queue.empty() && !m_terminate)
+                m_taskQueued.Wait();
+            if (m_terminate)
+                return NULL;
+
+            Task* task = m_queue.front();
+            m_queue.pop_front();
+            return task;
+        }
+
+        void ThreadPool::finishTask(Task* task) {
+            wxMutexLocker lock(m_mutex);
+            task->m_finished = true;
+            m_taskFinished.Broadcast();
+        }
+
+        void ThreadPool::cancelQueuedTasks() {
+            TaskQueue::const_iterator it, end;
+            for (it = m_queue.begin(), end = m_queue.end(); it != end; ++it) {
+                Task* task = *it;
+                task->m_cancelled = true;
+                task->m_finished = true;
+            }
+            m_queue.clear();
+            m_taskFinished.Broadcast();
+        }
+
+        size_t ThreadPool::defaultThreadCount() {
+            int count = wxThread::GetCPUCount();
+            return count > 0 ? static_cast<size_t>(count) : 1;
+        }
+
+        ThreadPool::ThreadPool(size_t threadCount) :
+        m_taskQueued(m_mutex),
+        m_taskFinished(m_mutex),
+        m_terminate(false) {
+            for (size_t i = 0; i < threadCount; i++) {
+                Worker* worker = new Worker(*this);
+                if (worker->Create() != wxTHREAD_NO_ERROR || worker->Run() != wxTHREAD_NO_ERROR) {
+                    delete worker;
+                    break;
+                }
+                m_workers.push_back(worker);
+            }
+        }
+
+        ThreadPool::~ThreadPool() {
+            {
+                wxMutexLocker lock(m_mutex);
+                m_terminate = true;
+                cancelQueuedTasks();
+                m_taskQueued.Broadcast();
+            }
+
+            WorkerList::const_iterator it, end;
+            for (it = m_workers.begin(), end = m_workers.end(); it != end; ++it) {
+                Worker* worker = *it;
+                worker->Wait();
+                delete worker;
+            }
+            m_workers.clear();
+        }
+
+        void ThreadPool::enqueue(Task& task) {
+            task.m_finished = false;
+            task.m_cancelled = false;
+            if (m_workers.empty()) {
+                task.run();
+                task.m_finished = true;
+                return;
+            }
+
+            wxMutexLocker lock(m_mutex);
+            m_queue.push_back(&task);
+            m_taskQueued.Signal();
+        }
+
+        void ThreadPool::enqueue(const TaskList& tasks) {
+            TaskList::const_iterator it, end;
+            for (it = tasks.begin(), end = tasks.end(); it != end; ++it)
+                enqueue(**it);
+        }
+
+        void ThreadPool::wait(Task& task) {
+            wxMutexLocker lock(m_mutex);
+            while (!task.m_finished)
+                m_taskFinished.Wait();
+        }
+
+        void ThreadPool::wait(const TaskList& tasks) {
+            TaskList::const_iterator it, end;
+            for (it = tasks.begin(), end = tasks.end(); it != end; ++it)
+                wait(**it);
+        }
+
+        bool ThreadPool::finished(Task& task) {
+            wxMutexLocker lock(m_mutex);
+            return task.m_finished;
+        }
+    }
+}
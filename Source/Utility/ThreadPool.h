@@ -0,0 +1,112 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TrenchBroom__ThreadPool__
+#define __TrenchBroom__ThreadPool__
+
+#include <deque>
+#include <vector>
+
+#include <wx/thread.h>
+
+namespace TrenchBroom {
+    namespace Utility {
+        class ThreadPool {
+        public:
+            class Task {
+            private:
+                bool m_finished;
+                bool m_cancelled;
+                friend class ThreadPool;
+            protected:
+                /*
+                 * Called on one of the pool's worker threads. Implementations must not let any exceptions escape.
+                 */
+                virtual void run() = 0;
+            public:
+                Task() : m_finished(false), m_cancelled(false) {}
+                virtual ~Task() {}
+                
+                /*
+                 * Indicates whether the task was still queued when the pool was destroyed. Such a task counts as
+                 * finished, but it has never been run.
+                 */
+                inline bool cancelled() const {
+                    return m_cancelled;
+                }
+            };
+
+            typedef std::vector<Task*> TaskList;
+        private:
+            class Worker : public wxThread {
+            private:
+                ThreadPool& m_pool;
+            protected:
+                ExitCode Entry();
+            public:
+                Worker(ThreadPool& pool);
+            };
+
+            typedef std::vector<Worker*> WorkerList;
+            typedef std::deque<Task*> TaskQueue;
+
+            wxMutex m_mutex;
+            wxCondition m_taskQueued;
+            wxCondition m_taskFinished;
+            TaskQueue m_queue;
+            WorkerList m_workers;
+            bool m_terminate;
+
+            Task* nextTask();
+            void finishTask(Task* task);
+            void cancelQueuedTasks();
+        public:
+            static size_t defaultThreadCount();
+
+            ThreadPool(size_t threadCount);
+            
+            /*
+             * Waits for the running tasks to finish. Tasks which are still queued are not run, but they are marked as
+             * finished and cancelled and their waiters are woken up.
+             */
+            ~ThreadPool();
+
+            inline size_t threadCount() const {
+                return m_workers.size();
+            }
+
+            /*
+             * Queues the given task for execution. The caller retains ownership of the task and must not delete it
+             * before it has waited for it. If the pool has no worker threads, the task is executed immediately.
+             */
+            void enqueue(Task& task);
+            void enqueue(const TaskList& tasks);
+
+            void wait(Task& task);
+            void wait(const TaskList& tasks);
+
+            /*
+             * Returns whether the given task has finished without waiting for it.
+             */
+            bool finished(Task& task);
+        };
+    }
+}
+
+#endif /* defined(__TrenchBroom__ThreadPool__) */
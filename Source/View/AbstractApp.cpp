@@ -27,7 +27,7 @@
 
 #include "IO/FileManager.h"
 #include "IO/Pak.h"
-#include "Model/Alias.h"
+#include "Model/AliasManager.h"
 #include "Model/Bsp.h"
 #include "Model/MapDocument.h"
 #include "Utility/DocManager.h"
@@ -0,0 +1,155 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Clipboard.h"
+
+#include "IO/MapParser.h"
+#include "IO/MapSnapshot.h"
+#include "IO/MapWriter.h"
+#include "Utility/Console.h"
+
+#include <wx/clipbrd.h>
+#include <wx/dataobj.h>
+#include <wx/utils.h>
+
+#include <cstring>
+
+namespace TrenchBroom {
+    namespace View {
+        const wxDataFormat& Clipboard::tokenFormat() {
+            static const wxDataFormat format(wxT("application/x-trenchbroom-clipboard-token"));
+            return format;
+        }
+        
+        IO::MapSnapshot*& Clipboard::snapshot() {
+            static IO::MapSnapshot* snapshot = NULL;
+            return snapshot;
+        }
+        
+        unsigned int& Clipboard::serial() {
+            static unsigned int serial = 0;
+            return serial;
+        }
+        
+        bool Clipboard::setData(IO::MapSnapshot* newSnapshot, const String& text) {
+            delete snapshot();
+            snapshot() = NULL;
+            
+            if (!wxTheClipboard->Open()) {
+                delete newSnapshot;
+                return false;
+            }
+            
+            Token token;
+            token.processId = wxGetProcessId();
+            token.serial = ++serial();
+            
+            wxCustomDataObject* tokenData = new wxCustomDataObject(tokenFormat());
+            tokenData->SetData(sizeof(Token), &token);
+            
+            wxDataObjectComposite* data = new wxDataObjectComposite();
+            data->Add(new wxTextDataObject(text), true);
+            data->Add(tokenData);
+            
+            const bool success = wxTheClipboard->SetData(data);
+            wxTheClipboard->Close();
+            
+            if (success)
+                snapshot() = newSnapshot;
+            else
+                delete newSnapshot;
+            return success;
+        }
+        
+        bool Clipboard::snapshotOnClipboard() {
+            if (snapshot() == NULL || !wxTheClipboard->IsSupported(tokenFormat()))
+                return false;
+            
+            wxCustomDataObject tokenData(tokenFormat());
+            if (!wxTheClipboard->GetData(tokenData) || tokenData.GetSize() != sizeof(Token))
+                return false;
+            
+            Token token;
+            std::memcpy(&token, tokenData.GetData(), sizeof(Token));
+            return token.processId == wxGetProcessId() && token.serial == serial();
+        }
+        
+        bool Clipboard::copyFaces(const Model::FaceList& faces) {
+            StringStream text;
+            IO::MapWriter mapWriter;
+            mapWriter.writeFacesToStream(faces, text);
+            return setData(new IO::MapSnapshot(faces), text.str());
+        }
+        
+        bool Clipboard::copyObjects(const Model::EntityList& pointEntities, const Model::BrushList& brushes) {
+            StringStream text;
+            IO::MapWriter mapWriter;
+            mapWriter.writeObjectsToStream(pointEntities, brushes, text);
+            return setData(new IO::MapSnapshot(pointEntities, brushes), text.str());
+        }
+        
+        bool Clipboard::canPaste() {
+            bool canPaste = false;
+            if (wxTheClipboard->Open()) {
+                canPaste = wxTheClipboard->IsSupported(wxDF_TEXT);
+                wxTheClipboard->Close();
+            }
+            return canPaste;
+        }
+        
+        bool Clipboard::paste(const BBoxf& worldBounds, bool forceIntegerFacePoints, Utility::Console& console, Model::EntityList& entities, Model::BrushList& brushes, Model::FaceList& faces) {
+            if (!wxTheClipboard->Open())
+                return false;
+            
+            bool success = false;
+            if (snapshotOnClipboard()) {
+                const IO::MapSnapshot& clipboardSnapshot = *snapshot();
+                if (clipboardSnapshot.entities().empty())
+                    clipboardSnapshot.createFaces(worldBounds, forceIntegerFacePoints, faces);
+                else
+                    clipboardSnapshot.createEntities(worldBounds, forceIntegerFacePoints, entities);
+                success = !faces.empty() || !entities.empty();
+            } else if (wxTheClipboard->IsSupported(wxDF_TEXT)) {
+                wxTextDataObject textData;
+                String text;
+                
+                if (wxTheClipboard->GetData(textData))
+                    text = textData.GetText();
+                
+                IO::MapParser mapParser(text, console);
+                switch (mapParser.detectContentType()) {
+                    case IO::MapParser::CTEntities:
+                        success = mapParser.parseEntities(worldBounds, forceIntegerFacePoints, entities);
+                        break;
+                    case IO::MapParser::CTBrushes:
+                        success = mapParser.parseBrushes(worldBounds, forceIntegerFacePoints, brushes);
+                        break;
+                    case IO::MapParser::CTFaces:
+                        success = mapParser.parseFaces(worldBounds, forceIntegerFacePoints, faces);
+                        break;
+                    default:
+                        break;
+                }
+            }
+            
+            wxTheClipboard->Close();
+            return success;
+        }
+    }
+}
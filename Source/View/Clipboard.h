@@ -0,0 +1,75 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TrenchBroom__Clipboard__
+#define __TrenchBroom__Clipboard__
+
+#include "Model/BrushTypes.h"
+#include "Model/EntityTypes.h"
+#include "Model/FaceTypes.h"
+#include "Utility/String.h"
+#include "Utility/VecMath.h"
+
+using namespace TrenchBroom::VecMath;
+
+class wxDataFormat;
+
+namespace TrenchBroom {
+    namespace IO {
+        class MapSnapshot;
+    }
+    
+    namespace Utility {
+        class Console;
+    }
+    
+    namespace View {
+        /*
+         * Copies faces and objects to the system clipboard as map text so that other applications can use them. A
+         * snapshot of the copied objects is kept in memory as well, and a small token on the clipboard identifies it.
+         * Pasting in the same process creates the objects from the snapshot instead of parsing the text again.
+         */
+        class Clipboard {
+        private:
+            class Token {
+            public:
+                unsigned long processId;
+                unsigned int serial;
+            };
+            
+            static const wxDataFormat& tokenFormat();
+            static IO::MapSnapshot*& snapshot();
+            static unsigned int& serial();
+            static bool setData(IO::MapSnapshot* snapshot, const String& text);
+            static bool snapshotOnClipboard();
+        public:
+            static bool copyFaces(const Model::FaceList& faces);
+            static bool copyObjects(const Model::EntityList& pointEntities, const Model::BrushList& brushes);
+            static bool canPaste();
+            
+            /*
+             * Creates the entities, brushes or faces which are on the clipboard. Returns false if the clipboard could
+             * not be opened or does not contain anything that can be pasted.
+             */
+            static bool paste(const BBoxf& worldBounds, bool forceIntegerFacePoints, Utility::Console& console, Model::EntityList& entities, Model::BrushList& brushes, Model::FaceList& faces);
+        };
+    }
+}
+
+#endif /* defined(__TrenchBroom__Clipboard__) */
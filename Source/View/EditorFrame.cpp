@@ -27,6 +27,7 @@
 #include "Model/EditStateManager.h"
 #include "Model/Entity.h"
 #include "Model/MapDocument.h"
+#include "Renderer/MapRenderer.h"
 #include "Utility/Console.h"
 #include "Utility/List.h"
 #include "View/CommandIds.h"
@@ -251,6 +252,12 @@ namespace TrenchBroom {
                 return;
             m_navBar->updateBreadcrump();
         }
+        
+        void EditorFrame::updateCullingStats() {
+            if (!m_documentViewHolder.valid())
+                return;
+            m_navBar->updateCullingStats(m_documentViewHolder.view().renderer().culler());
+        }
 
         void EditorFrame::disableProcessing() {
             wxMenuBar* oldMenuBar = GetMenuBar();
@@ -93,6 +93,7 @@ namespace TrenchBroom {
             void update(const Controller::Command& command);
             void updateMenuBar();
             void updateNavBar();
+            void updateCullingStats();
             void disableProcessing();
 
             void OnActivate(wxActivateEvent& event);
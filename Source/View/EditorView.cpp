@@ -37,8 +37,6 @@
 #include "Controller/SnapVerticesCommand.h"
 #include "Controller/TransformObjectsCommand.h"
 #include "IO/ByteBuffer.h"
-#include "IO/MapParser.h"
-#include "IO/MapWriter.h"
 #include "Model/Brush.h"
 #include "Model/Entity.h"
 #include "Model/EntityDefinition.h"
@@ -62,6 +60,7 @@
 #include "Utility/Preferences.h"
 #include "View/AbstractApp.h"
 #include "View/CameraAnimation.h"
+#include "View/Clipboard.h"
 #include "View/CommandIds.h"
 #include "View/EditorFrame.h"
 #include "View/EntityInspector.h"
@@ -72,8 +71,6 @@
 #include "View/MapPropertiesDialog.h"
 #include "View/ViewOptions.h"
 
-#include <wx/clipbrd.h>
-#include <wx/dataobj.h>
 #include <wx/tokenzr.h>
 
 namespace TrenchBroom {
@@ -104,6 +101,7 @@ namespace TrenchBroom {
         EVT_MENU(CommandIds::Menu::EditSelectAll, EditorView::OnEditSelectAll)
         EVT_MENU(CommandIds::Menu::EditSelectSiblings, EditorView::OnEditSelectSiblings)
         EVT_MENU(CommandIds::Menu::EditSelectTouching, EditorView::OnEditSelectTouching)
+        EVT_MENU(CommandIds::Menu::EditSelectInside, EditorView::OnEditSelectInside)
         EVT_MENU(CommandIds::Menu::EditSelectByFilePosition, EditorView::OnEditSelectByFilePosition)
         EVT_MENU(CommandIds::Menu::EditSelectNone, EditorView::OnEditSelectNone)
 
@@ -835,19 +833,10 @@ namespace TrenchBroom {
                        editStateManager.selectionMode() == Model::EditStateManager::SMBrushes ||
                        editStateManager.selectionMode() == Model::EditStateManager::SMEntitiesAndBrushes);
 
-                if (wxTheClipboard->Open()) {
-                    StringStream clipboardData;
-                    IO::MapWriter mapWriter;
-                    if (editStateManager.selectionMode() == Model::EditStateManager::SMFaces) {
-                        mapWriter.writeFacesToStream(editStateManager.selectedFaces(), clipboardData);
-                        wxTheClipboard->SetData(new wxTextDataObject(clipboardData.str()));
-                    } else {
-                        mapWriter.writeObjectsToStream(editStateManager.selectedEntities(), editStateManager.selectedBrushes(), clipboardData);
-                        wxTheClipboard->SetData(new wxTextDataObject(clipboardData.str()));
-                    }
-
-                    wxTheClipboard->Close();
-                }
+                if (editStateManager.selectionMode() == Model::EditStateManager::SMFaces)
+                    Clipboard::copyFaces(editStateManager.selectedFaces());
+                else
+                    Clipboard::copyObjects(editStateManager.selectedEntities(), editStateManager.selectedBrushes());
             }
         }
 
@@ -855,74 +844,60 @@ namespace TrenchBroom {
             if (wxTextCtrl* textCtrl = wxDynamicCast(GetFrame()->FindFocus(), wxTextCtrl)) {
                 textCtrl->Paste();
             } else {
-                if (wxTheClipboard->Open()) {
-                    if (wxTheClipboard->IsSupported(wxDF_TEXT)) {
-                        Model::EntityList entities;
-                        Model::BrushList brushes;
-                        Model::FaceList faces;
-
-                        wxTextDataObject textData;
-                        String text;
-
-                        if (wxTheClipboard->GetData(textData))
-                            text = textData.GetText();
-
-                        IO::MapParser mapParser(text, console());
-                        if (mapParser.parseFaces(mapDocument().map().worldBounds(), mapDocument().map().forceIntegerFacePoints(), faces)) {
-                            assert(!faces.empty());
-
-                            Model::Face& face = *faces.back();
-                            Model::TextureManager& textureManager = mapDocument().textureManager();
-                            Model::Texture* texture = textureManager.texture(face.textureName());
-                            face.setTexture(texture);
-
-                            const Model::FaceList& selectedFaces = mapDocument().editStateManager().selectedFaces();
-                            if (!selectedFaces.empty()) {
-                                Controller::SetFaceAttributesCommand* command = new Controller::SetFaceAttributesCommand(mapDocument(), selectedFaces, wxT("Paste Faces"));
-                                command->setTemplate(face);
-                                submit(command);
-
-                                if (faces.size() == 1)
-                                    mapDocument().console().info("Pasted 1 face from clipboard", faces.size());
-                                else
-                                    mapDocument().console().info("Pasted last of %d faces from clipboard", faces.size());
-                            } else {
-                                mapDocument().console().warn("Could not paste faces because no faces are selected");
-                            }
-                        } else if (mapParser.parseEntities(mapDocument().map().worldBounds(), mapDocument().map().forceIntegerFacePoints(), entities) ||
-                                   mapParser.parseBrushes(mapDocument().map().worldBounds(), mapDocument().map().forceIntegerFacePoints(), brushes)) {
-                            assert(entities.empty() != brushes.empty());
-
-                            const BBoxf objectsBounds = Model::MapObject::bounds(entities, brushes);
-                            const Vec3f objectsPosition = mapDocument().grid().referencePoint(objectsBounds);
-
-                            Vec3f delta;
-
-                            wxMouseState mouseState = wxGetMouseState();
-                            EditorFrame* frame = static_cast<EditorFrame*>(GetFrame());
-                            const wxPoint clientCoords = frame->mapCanvas().ScreenToClient(mouseState.GetPosition());
-                            if (frame->mapCanvas().HitTest(clientCoords) == wxHT_WINDOW_INSIDE) {
-                                Controller::InputState& inputState = inputController().inputState();
-                                Model::PickResult& pickResult = inputState.pickResult();
-                                Model::FaceHit* hit = static_cast<Model::FaceHit*>(pickResult.first(Model::HitType::FaceHit, true, filter()));
-                                if (hit != NULL) {
-                                    const Vec3f snappedHitPoint = mapDocument().grid().snap(hit->hitPoint());
-                                    delta = mapDocument().grid().moveDeltaForBounds(hit->face(), objectsBounds, mapDocument().map().worldBounds(), inputState.pickRay(), snappedHitPoint);
-                                } else {
-                                    const Vec3f targetPosition = mapDocument().grid().snap(camera().defaultPoint(inputState.pickRay().direction));
-                                    delta = targetPosition - objectsPosition;
-                                }
-                            } else {
-                                const Vec3f targetPosition = mapDocument().grid().snap(camera().defaultPoint());
-                                delta = targetPosition - objectsPosition;
-                            }
-
-                            pasteObjects(entities, brushes, delta);
+                Model::EntityList entities;
+                Model::BrushList brushes;
+                Model::FaceList faces;
+
+                if (!Clipboard::paste(mapDocument().map().worldBounds(), mapDocument().map().forceIntegerFacePoints(), console(), entities, brushes, faces)) {
+                    mapDocument().console().warn("Unable to parse clipboard contents");
+                } else if (!faces.empty()) {
+                    Model::Face& face = *faces.back();
+                    Model::TextureManager& textureManager = mapDocument().textureManager();
+                    Model::Texture* texture = textureManager.texture(face.textureName());
+                    face.setTexture(texture);
+
+                    const Model::FaceList& selectedFaces = mapDocument().editStateManager().selectedFaces();
+                    if (!selectedFaces.empty()) {
+                        Controller::SetFaceAttributesCommand* command = new Controller::SetFaceAttributesCommand(mapDocument(), selectedFaces, wxT("Paste Faces"));
+                        command->setTemplate(face);
+                        submit(command);
+
+                        if (faces.size() == 1)
+                            mapDocument().console().info("Pasted 1 face from clipboard", faces.size());
+                        else
+                            mapDocument().console().info("Pasted last of %d faces from clipboard", faces.size());
+                    } else {
+                        mapDocument().console().warn("Could not paste faces because no faces are selected");
+                    }
+                    Utility::deleteAll(faces);
+                } else {
+                    assert(entities.empty() != brushes.empty());
+
+                    const BBoxf objectsBounds = Model::MapObject::bounds(entities, brushes);
+                    const Vec3f objectsPosition = mapDocument().grid().referencePoint(objectsBounds);
+
+                    Vec3f delta;
+
+                    wxMouseState mouseState = wxGetMouseState();
+                    EditorFrame* frame = static_cast<EditorFrame*>(GetFrame());
+                    const wxPoint clientCoords = frame->mapCanvas().ScreenToClient(mouseState.GetPosition());
+                    if (frame->mapCanvas().HitTest(clientCoords) == wxHT_WINDOW_INSIDE) {
+                        Controller::InputState& inputState = inputController().inputState();
+                        Model::PickResult& pickResult = inputState.pickResult();
+                        Model::FaceHit* hit = static_cast<Model::FaceHit*>(pickResult.first(Model::HitType::FaceHit, true, filter()));
+                        if (hit != NULL) {
+                            const Vec3f snappedHitPoint = mapDocument().grid().snap(hit->hitPoint());
+                            delta = mapDocument().grid().moveDeltaForBounds(hit->face(), objectsBounds, mapDocument().map().worldBounds(), inputState.pickRay(), snappedHitPoint);
                         } else {
-                            mapDocument().console().warn("Unable to parse clipboard contents");
+                            const Vec3f targetPosition = mapDocument().grid().snap(camera().defaultPoint(inputState.pickRay().direction));
+                            delta = targetPosition - objectsPosition;
                         }
+                    } else {
+                        const Vec3f targetPosition = mapDocument().grid().snap(camera().defaultPoint());
+                        delta = targetPosition - objectsPosition;
                     }
-                    wxTheClipboard->Close();
+
+                    pasteObjects(entities, brushes, delta);
                 }
             }
         }
@@ -931,28 +906,16 @@ namespace TrenchBroom {
             if (wxTextCtrl* textCtrl = wxDynamicCast(GetFrame()->FindFocus(), wxTextCtrl)) {
                 textCtrl->Paste();
             } else {
-                if (wxTheClipboard->Open()) {
-                    if (wxTheClipboard->IsSupported(wxDF_TEXT)) {
-                        Model::EntityList entities;
-                        Model::BrushList brushes;
-
-                        wxTextDataObject textData;
-                        String text;
-
-                        if (wxTheClipboard->GetData(textData))
-                            text = textData.GetText();
+                Model::EntityList entities;
+                Model::BrushList brushes;
+                Model::FaceList faces;
 
-                        IO::MapParser mapParser(text, console());
-                        if (mapParser.parseEntities(mapDocument().map().worldBounds(), mapDocument().map().forceIntegerFacePoints(), entities) ||
-                            mapParser.parseBrushes(mapDocument().map().worldBounds(), mapDocument().map().forceIntegerFacePoints(), brushes)) {
-                            assert(entities.empty() != brushes.empty());
-
-                            pasteObjects(entities, brushes, Vec3f::Null);
-                        } else {
-                            mapDocument().console().warn("Unable to parse clipboard contents");
-                        }
-                    }
-                    wxTheClipboard->Close();
+                if (!Clipboard::paste(mapDocument().map().worldBounds(), mapDocument().map().forceIntegerFacePoints(), console(), entities, brushes, faces) || !faces.empty()) {
+                    Utility::deleteAll(faces);
+                    mapDocument().console().warn("Unable to parse clipboard contents");
+                } else {
+                    assert(entities.empty() != brushes.empty());
+                    pasteObjects(entities, brushes, Vec3f::Null);
                 }
             }
         }
@@ -1018,30 +981,33 @@ namespace TrenchBroom {
             }
         }
 
-        void EditorView::OnEditSelectTouching(wxCommandEvent& event) {
+        void EditorView::selectByVolume(bool containment, const wxString& name) {
             Model::EditStateManager& editStateManager = mapDocument().editStateManager();
             assert(editStateManager.selectionMode() == Model::EditStateManager::SMBrushes &&
                    editStateManager.selectedBrushes().size() == 1);
 
             Model::Brush* selectionBrush = editStateManager.selectedBrushes().front();
+            Model::EntityList candidateEntities;
+            Model::BrushList candidateBrushes;
+            if (containment)
+                mapDocument().objectsInside(*selectionBrush, candidateEntities, candidateBrushes);
+            else
+                mapDocument().objectsTouching(*selectionBrush, candidateEntities, candidateBrushes);
+            
             Model::EntityList selectEntities;
-            Model::BrushList selectBrushes;
-
-            const Model::EntityList& allEntities = mapDocument().map().entities();
             Model::EntityList::const_iterator entityIt, entityEnd;
-            for (entityIt = allEntities.begin(), entityEnd = allEntities.end(); entityIt != entityEnd; ++entityIt) {
-                Model::Entity& entity = **entityIt;
-                const Model::BrushList& entityBrushes = entity.brushes();
-                if (!entityBrushes.empty()) {
-                    Model::BrushList::const_iterator brushIt, brushEnd;
-                    for (brushIt = entityBrushes.begin(), brushEnd = entityBrushes.end(); brushIt != brushEnd; ++brushIt) {
-                        Model::Brush* brush = *brushIt;
-                        if (brush != selectionBrush && selectionBrush->intersectsBrush(*brush) && m_filter->brushSelectable(*brush))
-                            selectBrushes.push_back(brush);
-                    }
-                } else if (selectionBrush->intersectsEntity(entity) && m_filter->entitySelectable(entity)) {
-                    selectEntities.push_back(&entity);
-                }
+            for (entityIt = candidateEntities.begin(), entityEnd = candidateEntities.end(); entityIt != entityEnd; ++entityIt) {
+                Model::Entity* entity = *entityIt;
+                if (m_filter->entitySelectable(*entity))
+                    selectEntities.push_back(entity);
+            }
+            
+            Model::BrushList selectBrushes;
+            Model::BrushList::const_iterator brushIt, brushEnd;
+            for (brushIt = candidateBrushes.begin(), brushEnd = candidateBrushes.end(); brushIt != brushEnd; ++brushIt) {
+                Model::Brush* brush = *brushIt;
+                if (m_filter->brushSelectable(*brush))
+                    selectBrushes.push_back(brush);
             }
 
             Controller::ChangeEditStateCommand* select;
@@ -1053,12 +1019,20 @@ namespace TrenchBroom {
 
             Controller::RemoveObjectsCommand* remove = Controller::RemoveObjectsCommand::removeBrush(mapDocument(), *selectionBrush);
 
-            CommandProcessor::BeginGroup(mapDocument().GetCommandProcessor(), wxT("Select Touching"));
+            CommandProcessor::BeginGroup(mapDocument().GetCommandProcessor(), name);
             submit(select);
             submit(remove);
             CommandProcessor::EndGroup(mapDocument().GetCommandProcessor());
         }
 
+        void EditorView::OnEditSelectTouching(wxCommandEvent& event) {
+            selectByVolume(false, wxT("Select Touching"));
+        }
+
+        void EditorView::OnEditSelectInside(wxCommandEvent& event) {
+            selectByVolume(true, wxT("Select Inside"));
+        }
+
         void EditorView::OnEditSelectByFilePosition(wxCommandEvent& event) {
             wxString string = wxGetTextFromUser(wxT("Enter a comma- or space separated list of line numbers."), wxT("Select by Line Numbers"), wxT(""), GetFrame());
             if (string.empty())
@@ -1757,6 +1731,7 @@ namespace TrenchBroom {
                     event.Enable(editStateManager.selectionMode() == Model::EditStateManager::SMBrushes);
                     break;
                 case CommandIds::Menu::EditSelectTouching:
+                case CommandIds::Menu::EditSelectInside:
                     event.Enable(editStateManager.selectionMode() == Model::EditStateManager::SMBrushes &&
                                  editStateManager.selectedBrushes().size() == 1);
                     break;
@@ -1782,24 +1757,14 @@ namespace TrenchBroom {
                     if (textCtrl != NULL) {
                         event.Enable(textCtrl->CanPaste());
                     } else {
-                        bool canPaste = false;
-                        if (wxTheClipboard->Open()) {
-                            canPaste = wxTheClipboard->IsSupported(wxDF_TEXT);
-                            wxTheClipboard->Close();
-                        }
-                        event.Enable(canPaste);
+                        event.Enable(Clipboard::canPaste());
                     }
                     break;
                 case CommandIds::Menu::EditPasteAtOriginalPosition:
                     if (textCtrl != NULL) {
                         event.Enable(false);
                     } else {
-                        bool canPaste = false;
-                        if (wxTheClipboard->Open()) {
-                            canPaste = wxTheClipboard->IsSupported(wxDF_TEXT);
-                            wxTheClipboard->Close();
-                        }
-                        event.Enable(canPaste);
+                        event.Enable(Clipboard::canPaste());
                     }
                     break;
                 case CommandIds::Menu::EditHideSelected:
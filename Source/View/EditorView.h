@@ -88,6 +88,7 @@ namespace TrenchBroom {
             void flipObjects(bool horizontally);
             void moveVertices(Direction direction, bool snapToGrid);
             void removeObjects(const wxString& actionName);
+            void selectByVolume(bool containment, const wxString& name);
             
             Vec3f centerCameraOnObjectsPosition(const Model::EntityList& entities, const Model::BrushList& brushes);
         public:
@@ -140,6 +141,7 @@ namespace TrenchBroom {
             void OnEditSelectAll(wxCommandEvent& event);
             void OnEditSelectSiblings(wxCommandEvent& event);
             void OnEditSelectTouching(wxCommandEvent& event);
+            void OnEditSelectInside(wxCommandEvent& event);
             void OnEditSelectByFilePosition(wxCommandEvent& event);
             void OnEditSelectNone(wxCommandEvent& event);
             
@@ -125,6 +125,9 @@ namespace TrenchBroom {
             Renderer::Text::FontDescriptor font(fontName, static_cast<unsigned int>(fontSize));
             IO::FileManager fileManager;
 
+            Renderer::EntityModelRendererManager& modelRendererManager = m_documentViewHolder.document().sharedResources().modelRendererManager();
+            m_modelGeneration = modelRendererManager.generation();
+
             if (m_group) {
                 Model::EntityDefinitionManager::EntityDefinitionGroups groups = definitionManager.groups(Model::EntityDefinition::PointEntity, m_sortOrder);
                 Model::EntityDefinitionManager::EntityDefinitionGroups::const_iterator groupIt, groupEnd;
@@ -325,6 +328,9 @@ namespace TrenchBroom {
                     font->deactivate();
                 }
             }
+
+            if (modelRendererManager.pending() && !m_modelLoadTimer->IsRunning())
+                m_modelLoadTimer->Start(Renderer::EntityModelRendererManager::UpdateInterval, wxTIMER_ONE_SHOT);
         }
 
         bool EntityBrowserCanvas::dndEnabled() {
@@ -400,18 +406,33 @@ namespace TrenchBroom {
         m_documentViewHolder(documentViewHolder),
         m_offscreenRenderer(m_documentViewHolder.document().sharedResources().multisample(), m_documentViewHolder.document().sharedResources().samples()),
         m_vbo(NULL),
+        m_modelLoadTimer(new wxTimer(this)),
+        m_modelGeneration(0),
         m_group(false),
         m_hideUnused(false),
         m_sortOrder(Model::EntityDefinitionManager::Name) {
             const Quatf hRotation = Quatf(Math<float>::radians(-30.0f), Vec3f::PosZ);
             const Quatf vRotation = Quatf(Math<float>::radians(20.0f), Vec3f::PosY);
             m_rotation = vRotation * hRotation;
+
+            Bind(wxEVT_TIMER, &EntityBrowserCanvas::OnModelLoadTimer, this);
         }
 
         EntityBrowserCanvas::~EntityBrowserCanvas() {
             clear();
             delete m_vbo;
             m_vbo = NULL;
+            wxDELETE(m_modelLoadTimer);
+        }
+
+        void EntityBrowserCanvas::OnModelLoadTimer(wxTimerEvent& event) {
+            // the cells keep the bounds of the entity definitions until their models are available
+            Renderer::EntityModelRendererManager& modelRendererManager = m_documentViewHolder.document().sharedResources().modelRendererManager();
+            modelRendererManager.update();
+            if (modelRendererManager.generation() != m_modelGeneration)
+                reload();
+            else if (modelRendererManager.pending())
+                m_modelLoadTimer->Start(Renderer::EntityModelRendererManager::UpdateInterval, wxTIMER_ONE_SHOT);
         }
     }
 }
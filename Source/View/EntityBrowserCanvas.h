@@ -27,6 +27,8 @@
 #include "Utility/VecMath.h"
 #include "View/CellLayoutGLCanvas.h"
 
+#include <wx/timer.h>
+
 using namespace TrenchBroom::VecMath;
 
 namespace TrenchBroom {
@@ -65,6 +67,8 @@ namespace TrenchBroom {
             Renderer::OffscreenRenderer m_offscreenRenderer;
             Renderer::Vbo* m_vbo;
             Quatf m_rotation;
+            wxTimer* m_modelLoadTimer;
+            unsigned int m_modelGeneration;
 
             bool m_group;
             bool m_hideUnused;
@@ -86,6 +90,8 @@ namespace TrenchBroom {
             EntityBrowserCanvas(wxWindow* parent, wxWindowID windowId, wxScrollBar* scrollBar, DocumentViewHolder& documentViewHolder);
             ~EntityBrowserCanvas();
 
+            void OnModelLoadTimer(wxTimerEvent& event);
+
             inline void setSortOrder(Model::EntityDefinitionManager::SortOrder sortOrder) {
                 if (sortOrder == m_sortOrder)
                     return;
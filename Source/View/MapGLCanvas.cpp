@@ -24,6 +24,7 @@
 #include "Model/MapDocument.h"
 #include "Renderer/ApplyMatrix.h"
 #include "Renderer/Camera.h"
+#include "Renderer/EntityModelRendererManager.h"
 #include "Renderer/MapRenderer.h"
 #include "Renderer/OverlayRenderer.h"
 #include "Renderer/RenderContext.h"
@@ -64,6 +65,7 @@ namespace TrenchBroom {
         EVT_MOTION(MapGLCanvas::OnMouseMove)
         EVT_MOUSEWHEEL(MapGLCanvas::OnMouseWheel)
         EVT_MOUSE_CAPTURE_LOST(MapGLCanvas::OnMouseCaptureLost)
+        EVT_TIMER(wxID_ANY, MapGLCanvas::OnModelLoadTimer)
         END_EVENT_TABLE()
 
         wxDragResult MapGLCanvasDropTarget::OnEnter(wxCoord x, wxCoord y, wxDragResult def) {
@@ -140,6 +142,7 @@ namespace TrenchBroom {
         m_vbo(NULL),
         m_inputController(new Controller::InputController(documentViewHolder)),
         m_overlayRenderer(NULL),
+        m_modelLoadTimer(new wxTimer(this)),
         m_hasFocus(false),
         m_ignoreNextClick(false) {
             SetDropTarget(new MapGLCanvasDropTarget(this, *m_inputController));
@@ -155,6 +158,7 @@ namespace TrenchBroom {
             m_overlayRenderer = NULL;
             delete m_vbo;
             m_vbo = NULL;
+            wxDELETE(m_modelLoadTimer);
             wxDELETE(m_glContext);
         }
 
@@ -288,6 +292,14 @@ namespace TrenchBroom {
                 }
 
 				SwapBuffers();
+                
+                EditorFrame* frame = static_cast<EditorFrame*>(view.GetFrame());
+                frame->updateCullingStats();
+
+                // repaint once the entity models which are still being loaded are available
+                Renderer::EntityModelRendererManager& modelRendererManager = m_documentViewHolder.document().sharedResources().modelRendererManager();
+                if (modelRendererManager.pending() && !m_modelLoadTimer->IsRunning())
+                    m_modelLoadTimer->Start(Renderer::EntityModelRendererManager::UpdateInterval, wxTIMER_ONE_SHOT);
 			} else {
 				view.console().error("Unable to set current OpenGL context");
 			}
@@ -434,5 +446,9 @@ namespace TrenchBroom {
         void MapGLCanvas::OnMouseCaptureLost(wxMouseCaptureLostEvent& event) {
             m_inputController->endDrag();
         }
+
+        void MapGLCanvas::OnModelLoadTimer(wxTimerEvent& event) {
+            Refresh();
+        }
     }
 }
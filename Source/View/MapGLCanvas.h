@@ -77,6 +77,7 @@ namespace TrenchBroom {
             Renderer::Vbo* m_vbo;
             Controller::InputController* m_inputController;
             Renderer::OverlayRenderer* m_overlayRenderer;
+            wxTimer* m_modelLoadTimer;
             
             bool m_hasFocus;
             bool m_ignoreNextClick;
@@ -115,6 +116,7 @@ namespace TrenchBroom {
             void OnMouseMove(wxMouseEvent& event);
             void OnMouseWheel(wxMouseEvent& event);
             void OnMouseCaptureLost(wxMouseCaptureLostEvent& event);
+            void OnModelLoadTimer(wxTimerEvent& event);
 
             DECLARE_EVENT_TABLE()
         };
@@ -28,6 +28,7 @@
 #include "Model/Entity.h"
 #include "Model/EntityDefinition.h"
 #include "Model/MapDocument.h"
+#include "Renderer/Culler.h"
 #include "Utility/List.h"
 #include "View/DocumentViewHolder.h"
 #include "View/EditorView.h"
@@ -56,8 +57,10 @@ namespace TrenchBroom {
         wxPanel(parent),
         m_documentViewHolder(documentViewHolder),
         m_navPanel(new wxPanel(this, wxID_ANY)),
+        m_cullingStats(new wxStaticText(this, wxID_ANY, wxT(""))),
         m_searchBox(new wxSearchCtrl(this, wxID_ANY)) {
 #ifdef __APPLE__
+            m_cullingStats->SetFont(*wxSMALL_FONT);
             m_searchBox->SetFont(*wxSMALL_FONT);
             SetBackgroundStyle(wxBG_STYLE_PAINT);
             Bind(wxEVT_PAINT, &NavBar::OnPaint, this);
@@ -67,6 +70,8 @@ namespace TrenchBroom {
             wxSizer* innerSizer = new wxBoxSizer(wxHORIZONTAL);
             innerSizer->AddSpacer(4);
             innerSizer->Add(m_navPanel, 1, wxEXPAND | wxALIGN_CENTRE_VERTICAL);
+            innerSizer->Add(m_cullingStats, 0, wxALIGN_CENTRE_VERTICAL);
+            innerSizer->AddSpacer(8);
             innerSizer->Add(m_searchBox, 0, wxEXPAND | wxALIGN_RIGHT);
 #ifdef __APPLE__
             innerSizer->AddSpacer(4);
@@ -216,5 +221,20 @@ namespace TrenchBroom {
             m_navPanel->SetSizer(sizer);
             Layout();
         }
+        
+        void NavBar::updateCullingStats(const Renderer::Culler& culler) {
+            const Renderer::Culler::Stats& chunkStats = culler.chunkStats();
+            const Renderer::Culler::Stats& entityStats = culler.entityStats();
+            
+            wxString statsString;
+            statsString << chunkStats.drawn << "/" << chunkStats.drawn + chunkStats.culled << " chunks, ";
+            statsString << entityStats.drawn << "/" << entityStats.drawn + entityStats.culled << " models drawn";
+            
+            // called after every frame, so avoid the layout unless the numbers changed
+            if (statsString == m_cullingStats->GetLabel())
+                return;
+            m_cullingStats->SetLabel(statsString);
+            Layout();
+        }
     }
 }
@@ -26,6 +26,10 @@ class wxSearchCtrl;
 class wxStaticText;
 
 namespace TrenchBroom {
+    namespace Renderer {
+        class Culler;
+    }
+    
     namespace View {
         class DocumentViewHolder;
         
@@ -34,6 +38,7 @@ namespace TrenchBroom {
             DocumentViewHolder& m_documentViewHolder;
 
             wxPanel* m_navPanel;
+            wxStaticText* m_cullingStats;
             wxSearchCtrl* m_searchBox;
 
             wxStaticText* makeBreadcrump(const wxString& text, bool link);
@@ -44,6 +49,12 @@ namespace TrenchBroom {
             void OnSearchPatternChanged(wxCommandEvent& event);
             
             void updateBreadcrump();
+            
+            /*
+             * Shows how many brush chunks and entity models were drawn in the last frame, out of all that were
+             * considered for culling.
+             */
+            void updateCullingStats(const Renderer::Culler& culler);
         };
     }
 }
@@ -0,0 +1,57 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TrenchBroom_Benchmark_h
+#define TrenchBroom_Benchmark_h
+
+#include "TestSuite.h"
+
+#include <ctime>
+#include <iostream>
+#include <string>
+
+namespace TrenchBroom {
+    /*
+     * Benchmarks are registered like test cases, but they are only run if the test executable is invoked with
+     * --benchmark.
+     */
+    template <class SubClass>
+    class Benchmark : public TestSuite<SubClass> {
+    private:
+        std::clock_t m_start;
+    protected:
+        inline void startTimer() {
+            m_start = std::clock();
+        }
+        
+        inline double elapsedSeconds() const {
+            return static_cast<double>(std::clock() - m_start) / CLOCKS_PER_SEC;
+        }
+        
+        inline void report(const std::string& name, double amount, const std::string& unit) const {
+            const double seconds = elapsedSeconds();
+            std::cout << name << ": " << amount / seconds << " " << unit << "/s (" << seconds << "s)" << std::endl;
+        }
+    public:
+        Benchmark() :
+        m_start(0) {}
+    };
+}
+
+#endif
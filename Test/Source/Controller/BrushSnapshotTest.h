@@ -0,0 +1,185 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TrenchBroom_BrushSnapshotTest_h
+#define TrenchBroom_BrushSnapshotTest_h
+
+#include "TestSuite.h"
+#include "Controller/BrushSnapshot.h"
+#include "Model/Brush.h"
+#include "Model/Face.h"
+#include "Utility/List.h"
+#include "Utility/VecMath.h"
+
+#include <cassert>
+
+using namespace TrenchBroom::VecMath;
+
+namespace TrenchBroom {
+    namespace Controller {
+        class BrushSnapshotTest : public TestSuite<BrushSnapshotTest> {
+        private:
+            BBoxf m_worldBounds;
+            
+            Model::BrushList makeBrushes(size_t count) {
+                Model::BrushList brushes;
+                for (size_t i = 0; i < count; i++) {
+                    const Vec3f min(64.0f * i, 0.0f, 0.0f);
+                    brushes.push_back(new Model::Brush(m_worldBounds, false, BBoxf(min, min + Vec3f(32.0f, 32.0f, 32.0f)), NULL));
+                }
+                return brushes;
+            }
+            
+            const BrushSnapshot& findSnapshot(const BrushSnapshotList& snapshots, const Model::Brush& brush) {
+                for (size_t i = 0; i < snapshots.size(); i++)
+                    if (snapshots[i].uniqueId() == brush.uniqueId())
+                        return snapshots[i];
+                assert(false);
+                return snapshots.front();
+            }
+        protected:
+            void registerTestCases() {
+                registerTestCase(&BrushSnapshotTest::testShareUnchangedBrushes);
+                registerTestCase(&BrushSnapshotTest::testShareAttributesOfMovedBrush);
+                registerTestCase(&BrushSnapshotTest::testShareWithRedoneCommand);
+                registerTestCase(&BrushSnapshotTest::testDoNotShareReleasedBlocks);
+                registerTestCase(&BrushSnapshotTest::testRestore);
+            }
+        public:
+            BrushSnapshotTest() :
+            m_worldBounds(Vec3f(-4096.0f, -4096.0f, -4096.0f), Vec3f(4096.0f, 4096.0f, 4096.0f)) {}
+            
+            void testShareUnchangedBrushes() {
+                Model::BrushList brushes = makeBrushes(3);
+                BrushSnapshotStore store;
+                
+                BrushSnapshotList first;
+                makeBrushSnapshots(brushes, store, BrushSnapshotList(), first);
+                assert(first.size() == 3);
+                assert(first[0].geometry() == first[2].geometry());
+                assert(first[0].attributes() == first[2].attributes());
+                assert(first[0].geometry()->entries.size() == 18);
+                
+                // a later command which captures one of the brushes again shares its data
+                Model::BrushList oneBrush;
+                oneBrush.push_back(brushes[1]);
+                BrushSnapshotList second;
+                makeBrushSnapshots(oneBrush, store, BrushSnapshotList(), second);
+                assert(second.size() == 1);
+                assert(second[0].geometry() == first[0].geometry());
+                assert(second[0].geometryFirst() == findSnapshot(first, *brushes[1]).geometryFirst());
+                assert(second[0].attributes() == first[0].attributes());
+                
+                Utility::deleteAll(brushes);
+            }
+            
+            void testShareAttributesOfMovedBrush() {
+                Model::BrushList brushes = makeBrushes(3);
+                BrushSnapshotStore store;
+                
+                BrushSnapshotList first;
+                makeBrushSnapshots(brushes, store, BrushSnapshotList(), first);
+                
+                brushes[0]->transform(translationMatrix(Vec3f(16.0f, 0.0f, 0.0f)), Mat4f::Identity, false, false);
+                
+                BrushSnapshotList second;
+                makeBrushSnapshots(brushes, store, BrushSnapshotList(), second);
+                
+                const BrushSnapshot& moved = findSnapshot(second, *brushes[0]);
+                assert(moved.geometry() != first[0].geometry());
+                assert(moved.geometry()->entries.size() == 6);
+                assert(moved.attributes() == first[0].attributes());
+                
+                const BrushSnapshot& unchanged = findSnapshot(second, *brushes[2]);
+                assert(unchanged.geometry() == first[0].geometry());
+                assert(unchanged.attributes() == first[0].attributes());
+                
+                Utility::deleteAll(brushes);
+            }
+            
+            void testShareWithRedoneCommand() {
+                Model::BrushList brushes = makeBrushes(2);
+                BrushSnapshotStore store;
+                
+                BrushSnapshotList snapshots;
+                makeBrushSnapshots(brushes, store, BrushSnapshotList(), snapshots);
+                const FaceGeometryBlock::Ptr geometry = snapshots[0].geometry();
+                
+                // another command captures the brushes after they were changed, and is then undone
+                brushes[0]->transform(translationMatrix(Vec3f(16.0f, 0.0f, 0.0f)), Mat4f::Identity, false, false);
+                brushes[1]->transform(translationMatrix(Vec3f(16.0f, 0.0f, 0.0f)), Mat4f::Identity, false, false);
+                BrushSnapshotList other;
+                makeBrushSnapshots(brushes, store, BrushSnapshotList(), other);
+                brushes[0]->transform(translationMatrix(Vec3f(-16.0f, 0.0f, 0.0f)), Mat4f::Identity, false, false);
+                brushes[1]->transform(translationMatrix(Vec3f(-16.0f, 0.0f, 0.0f)), Mat4f::Identity, false, false);
+                
+                // redoing the first command shares its own snapshots even though the store refers to the other ones
+                makeBrushSnapshots(brushes, store, snapshots, snapshots);
+                assert(snapshots[0].geometry() == geometry);
+                assert(snapshots[1].geometry() == geometry);
+                
+                Utility::deleteAll(brushes);
+            }
+            
+            void testDoNotShareReleasedBlocks() {
+                Model::BrushList brushes = makeBrushes(2);
+                BrushSnapshotStore store;
+                
+                BrushSnapshotList first;
+                makeBrushSnapshots(brushes, store, BrushSnapshotList(), first);
+                FaceGeometryBlock::WeakPtr geometry = first[0].geometry();
+                first.clear();
+                assert(geometry.expired());
+                
+                BrushSnapshotList second;
+                makeBrushSnapshots(brushes, store, BrushSnapshotList(), second);
+                assert(second[0].geometry().get() != NULL);
+                assert(second[0].geometry() == second[1].geometry());
+                
+                Utility::deleteAll(brushes);
+            }
+            
+            void testRestore() {
+                Model::BrushList brushes = makeBrushes(1);
+                Model::Brush& brush = *brushes[0];
+                BrushSnapshotStore store;
+                
+                const BBoxf bounds = brush.bounds();
+                brush.faces()[0]->setXOffset(8.0f);
+                
+                BrushSnapshotList snapshots;
+                makeBrushSnapshots(brushes, store, BrushSnapshotList(), snapshots);
+                
+                brush.transform(translationMatrix(Vec3f(16.0f, 0.0f, 0.0f)), Mat4f::Identity, false, false);
+                brush.faces()[0]->setXOffset(0.0f);
+                assert(brush.bounds().min != bounds.min);
+                
+                snapshots[0].restore(brush);
+                assert(brush.bounds().min == bounds.min);
+                assert(brush.bounds().max == bounds.max);
+                assert(brush.faces().size() == 6);
+                assert(brush.faces()[0]->xOffset() == 8.0f);
+                
+                Utility::deleteAll(brushes);
+            }
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,131 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TrenchBroom_VertexHandleGridBenchmark_h
+#define TrenchBroom_VertexHandleGridBenchmark_h
+
+#include "Benchmark.h"
+#include "Controller/VertexHandleGrid.h"
+#include "Utility/VecMath.h"
+
+#include <cassert>
+#include <sstream>
+#include <vector>
+
+using namespace TrenchBroom::VecMath;
+
+namespace TrenchBroom {
+    namespace Controller {
+        class VertexHandleGridBenchmark : public Benchmark<VertexHandleGridBenchmark> {
+        private:
+            typedef std::vector<Rayf> RayList;
+            
+            float m_handleRadius;
+            float m_scalingFactor;
+            float m_maxDistance;
+            RayList m_rays;
+            unsigned int m_seed;
+            
+            inline float random(float min, float max) {
+                m_seed = m_seed * 1103515245 + 12345;
+                return min + (max - min) * static_cast<float>((m_seed >> 16) & 0x7FFF) / 32767.0f;
+            }
+            
+            // the corners of random boxes, like the vertex handles of a selection of brushes
+            Vec3f::List handles(size_t count) {
+                Vec3f::List result;
+                while (result.size() < count) {
+                    const Vec3f min = Vec3f(random(-2048.0f, 2048.0f), random(-2048.0f, 2048.0f), random(-512.0f, 512.0f)).rounded();
+                    const Vec3f size = Vec3f(random(8.0f, 256.0f), random(8.0f, 256.0f), random(8.0f, 128.0f)).rounded();
+                    for (size_t i = 0; i < 8 && result.size() < count; i++)
+                        result.push_back(Vec3f(min.x() + ((i & 1) != 0 ? size.x() : 0.0f),
+                                               min.y() + ((i & 2) != 0 ? size.y() : 0.0f),
+                                               min.z() + ((i & 4) != 0 ? size.z() : 0.0f)));
+                }
+                return result;
+            }
+            
+            inline size_t pickHandles(const Rayf& ray, const Vec3f::List& positions) const {
+                size_t hits = 0;
+                Vec3f::List::const_iterator it, end;
+                for (it = positions.begin(), end = positions.end(); it != end; ++it)
+                    if (!Math<float>::isnan(ray.intersectWithSphere(*it, 2.0f * m_handleRadius, m_scalingFactor, m_maxDistance)))
+                        hits++;
+                return hits;
+            }
+        protected:
+            void registerTestCases() {
+                registerTestCase(&VertexHandleGridBenchmark::benchmarkPick);
+            }
+            
+            void setup() {
+                // the default preferences
+                m_handleRadius = 3.0f;
+                m_scalingFactor = 1.0f / 300.0f;
+                m_maxDistance = 1000.0f;
+                
+                m_seed = 1;
+                m_rays.clear();
+                for (size_t i = 0; i < 1000; i++) {
+                    const Vec3f origin(random(-2048.0f, 2048.0f), random(-2048.0f, 2048.0f), random(-512.0f, 512.0f));
+                    const Vec3f direction(random(-1.0f, 1.0f), random(-1.0f, 1.0f), random(-0.5f, 0.5f));
+                    m_rays.push_back(Rayf(origin, direction.normalized()));
+                }
+            }
+        public:
+            void benchmarkPick() {
+                const size_t counts[] = {1000, 10000, 100000};
+                for (size_t i = 0; i < 3; i++) {
+                    const Vec3f::List positions = handles(counts[i]);
+                    
+                    VertexHandleGrid grid;
+                    Vec3f::List::const_iterator posIt, posEnd;
+                    for (posIt = positions.begin(), posEnd = positions.end(); posIt != posEnd; ++posIt)
+                        grid.add(*posIt);
+                    
+                    RayList::const_iterator it, end;
+                    size_t allHits = 0;
+                    std::stringstream allName;
+                    allName << "Pick " << counts[i] << " handles by testing all of them";
+                    startTimer();
+                    for (it = m_rays.begin(), end = m_rays.end(); it != end; ++it)
+                        allHits += pickHandles(*it, positions);
+                    report(allName.str(), static_cast<double>(m_rays.size()), "rays");
+                    
+                    size_t gridHits = 0;
+                    std::stringstream gridName;
+                    gridName << "Pick " << counts[i] << " handles with a grid";
+                    startTimer();
+                    for (it = m_rays.begin(), end = m_rays.end(); it != end; ++it) {
+                        Vec3f::List candidates;
+                        if (grid.findCandidates(*it, m_maxDistance, 2.0f * m_handleRadius * m_scalingFactor * m_maxDistance, candidates))
+                            gridHits += pickHandles(*it, candidates);
+                        else
+                            gridHits += pickHandles(*it, positions);
+                    }
+                    report(gridName.str(), static_cast<double>(m_rays.size()), "rays");
+                    
+                    assert(gridHits == allHits);
+                }
+            }
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,240 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TrenchBroom_EntityDefinitionCacheTest_h
+#define TrenchBroom_EntityDefinitionCacheTest_h
+
+#include "TestSuite.h"
+#include "IO/EntityDefinitionCache.h"
+#include "IO/FgdParser.h"
+#include "Model/EntityDefinition.h"
+#include "Model/PropertyDefinition.h"
+#include "Utility/Color.h"
+#include "Utility/List.h"
+
+#include <cassert>
+#include <sstream>
+
+namespace TrenchBroom {
+    namespace IO {
+        class EntityDefinitionCacheTest : public TestSuite<EntityDefinitionCacheTest> {
+        private:
+            static const time_t ModificationTime = 1234567890;
+
+            String m_fgd;
+            String m_cacheContents;
+
+            Model::EntityDefinitionList parseDefinitions() {
+                m_fgd =
+                "@BaseClass = Targetname [ targetname(target_source) : \"Name\" ]\n"
+                "@PointClass base(Targetname) color(255 128 0) size(-16 -16 -24, 16 16 32)\n"
+                "    model(\"progs/player.mdl\" 1 2, \"progs/gib.mdl\" 0 1 spawnflags = 2, \"progs/eyes.mdl\" style = \"1\")\n"
+                "    = info_player : \"Player start\"\n"
+                "[\n"
+                "    angle(integer) : \"Angle\" : 90\n"
+                "    speed(float) : \"Speed\" : \"2.5\"\n"
+                "    style(choices) : \"Style\" : 1 =\n"
+                "    [\n"
+                "        0 : \"Normal\"\n"
+                "        1 : \"Eyes\"\n"
+                "    ]\n"
+                "    spawnflags(flags) =\n"
+                "    [\n"
+                "        1 : \"Suspended\" : 0\n"
+                "        2 : \"Gibbed\" : 1\n"
+                "    ]\n"
+                "]\n"
+                "@SolidClass color(0 128 255) = func_door : \"Door\" [ message(string) : \"Message\" : \"Locked\" ]\n";
+
+                FgdParser parser(&m_fgd[0], &m_fgd[0] + m_fgd.size(), Color(0.5f, 0.5f, 0.5f, 1.0f));
+                Model::EntityDefinitionList definitions;
+                Model::EntityDefinition* definition = NULL;
+                while ((definition = parser.nextDefinition()) != NULL)
+                    definitions.push_back(definition);
+                return definitions;
+            }
+
+            EntityDefinitionCache createCache() {
+                return EntityDefinitionCache("defs/test.fgd", m_fgd.data(), m_fgd.data() + m_fgd.size(), ModificationTime, Color(0.5f, 0.5f, 0.5f, 1.0f));
+            }
+
+            MappedFile writeCache(const EntityDefinitionCache& cache, const Model::EntityDefinitionList& definitions) {
+                std::stringstream stream;
+                cache.write(stream, definitions);
+                m_cacheContents = stream.str();
+                return MappedFile(&m_cacheContents[0], &m_cacheContents[0] + m_cacheContents.size());
+            }
+
+            void assertEqualProperties(const Model::PropertyDefinition& expected, const Model::PropertyDefinition& actual) {
+                assert(actual.type() == expected.type());
+                assert(actual.name() == expected.name());
+                assert(actual.description() == expected.description());
+                assert(actual.defaultPropertyValue() == expected.defaultPropertyValue());
+
+                if (expected.type() == Model::PropertyDefinition::ChoiceProperty) {
+                    const Model::ChoicePropertyOption::List& expectedOptions = static_cast<const Model::ChoicePropertyDefinition&>(expected).options();
+                    const Model::ChoicePropertyOption::List& actualOptions = static_cast<const Model::ChoicePropertyDefinition&>(actual).options();
+                    assert(actualOptions.size() == expectedOptions.size());
+                    for (size_t i = 0; i < expectedOptions.size(); i++) {
+                        assert(actualOptions[i].value() == expectedOptions[i].value());
+                        assert(actualOptions[i].description() == expectedOptions[i].description());
+                    }
+                } else if (expected.type() == Model::PropertyDefinition::FlagsProperty) {
+                    const Model::FlagsPropertyOption::List& expectedOptions = static_cast<const Model::FlagsPropertyDefinition&>(expected).options();
+                    const Model::FlagsPropertyOption::List& actualOptions = static_cast<const Model::FlagsPropertyDefinition&>(actual).options();
+                    assert(actualOptions.size() == expectedOptions.size());
+                    for (size_t i = 0; i < expectedOptions.size(); i++) {
+                        assert(actualOptions[i].value() == expectedOptions[i].value());
+                        assert(actualOptions[i].description() == expectedOptions[i].description());
+                        assert(actualOptions[i].isDefault() == expectedOptions[i].isDefault());
+                    }
+                }
+            }
+
+            void assertEqualModels(const Model::ModelDefinition& expected, const Model::ModelDefinition& actual) {
+                assert(actual.name() == expected.name());
+                assert(actual.skinIndex() == expected.skinIndex());
+                assert(actual.frameIndex() == expected.frameIndex());
+
+                const Model::ModelDefinitionEvaluator* expectedEvaluator = expected.evaluator();
+                const Model::ModelDefinitionEvaluator* actualEvaluator = actual.evaluator();
+                assert((actualEvaluator == NULL) == (expectedEvaluator == NULL));
+                if (expectedEvaluator == NULL)
+                    return;
+
+                assert(actualEvaluator->type() == expectedEvaluator->type());
+                if (expectedEvaluator->type() == Model::ModelDefinitionEvaluator::PropertyEvaluator) {
+                    const Model::ModelDefinitionPropertyEvaluator& expectedProperty = static_cast<const Model::ModelDefinitionPropertyEvaluator&>(*expectedEvaluator);
+                    const Model::ModelDefinitionPropertyEvaluator& actualProperty = static_cast<const Model::ModelDefinitionPropertyEvaluator&>(*actualEvaluator);
+                    assert(actualProperty.propertyKey() == expectedProperty.propertyKey());
+                    assert(actualProperty.propertyValue() == expectedProperty.propertyValue());
+                } else if (expectedEvaluator->type() == Model::ModelDefinitionEvaluator::FlagEvaluator) {
+                    const Model::ModelDefinitionFlagEvaluator& expectedFlag = static_cast<const Model::ModelDefinitionFlagEvaluator&>(*expectedEvaluator);
+                    const Model::ModelDefinitionFlagEvaluator& actualFlag = static_cast<const Model::ModelDefinitionFlagEvaluator&>(*actualEvaluator);
+                    assert(actualFlag.propertyKey() == expectedFlag.propertyKey());
+                    assert(actualFlag.flagValue() == expectedFlag.flagValue());
+                }
+            }
+
+            void assertEqualDefinitions(const Model::EntityDefinition& expected, const Model::EntityDefinition& actual) {
+                assert(actual.type() == expected.type());
+                assert(actual.name() == expected.name());
+                assert(actual.color() == expected.color());
+                assert(actual.description() == expected.description());
+
+                const Model::PropertyDefinition::List& expectedProperties = expected.propertyDefinitions();
+                const Model::PropertyDefinition::List& actualProperties = actual.propertyDefinitions();
+                assert(actualProperties.size() == expectedProperties.size());
+                for (size_t i = 0; i < expectedProperties.size(); i++)
+                    assertEqualProperties(*expectedProperties[i], *actualProperties[i]);
+
+                if (expected.type() != Model::EntityDefinition::PointEntity)
+                    return;
+
+                const Model::PointEntityDefinition& expectedPoint = static_cast<const Model::PointEntityDefinition&>(expected);
+                const Model::PointEntityDefinition& actualPoint = static_cast<const Model::PointEntityDefinition&>(actual);
+                assert(actualPoint.bounds() == expectedPoint.bounds());
+
+                const Model::ModelDefinition::List& expectedModels = expectedPoint.modelDefinitions();
+                const Model::ModelDefinition::List& actualModels = actualPoint.modelDefinitions();
+                assert(actualModels.size() == expectedModels.size());
+                for (size_t i = 0; i < expectedModels.size(); i++)
+                    assertEqualModels(*expectedModels[i], *actualModels[i]);
+            }
+        protected:
+            void registerTestCases() {
+                registerTestCase(&EntityDefinitionCacheTest::testRoundTrip);
+                registerTestCase(&EntityDefinitionCacheTest::testTruncatedFile);
+            }
+        public:
+            void testRoundTrip() {
+                Model::EntityDefinitionList definitions = parseDefinitions();
+                assert(definitions.size() == 2);
+
+                const EntityDefinitionCache cache = createCache();
+                const MappedFile file = writeCache(cache, definitions);
+
+                Model::EntityDefinitionList cachedDefinitions;
+                assert(cache.loadDefinitions(file, cachedDefinitions));
+                assert(cachedDefinitions.size() == definitions.size());
+                for (size_t i = 0; i < definitions.size(); i++)
+                    assertEqualDefinitions(*definitions[i], *cachedDefinitions[i]);
+
+                // make sure that the comparison covers every kind of definition
+                const Model::PointEntityDefinition& player = *static_cast<Model::PointEntityDefinition*>(cachedDefinitions[0]);
+                assert(player.name() == "info_player");
+                assert(player.propertyDefinitions().size() == 5);
+                assert(player.modelDefinitions().size() == 3);
+                assert(player.modelDefinitions()[0]->evaluator() == NULL);
+                assert(player.modelDefinitions()[1]->evaluator()->type() == Model::ModelDefinitionEvaluator::FlagEvaluator);
+                assert(player.modelDefinitions()[2]->evaluator()->type() == Model::ModelDefinitionEvaluator::PropertyEvaluator);
+
+                const Model::FloatPropertyDefinition* speed = static_cast<const Model::FloatPropertyDefinition*>(player.propertyDefinition("speed"));
+                assert(speed != NULL && speed->type() == Model::PropertyDefinition::FloatProperty);
+                assert(speed->defaultValue() == 2.5f);
+
+                const Model::ChoicePropertyDefinition* style = static_cast<const Model::ChoicePropertyDefinition*>(player.propertyDefinition("style"));
+                assert(style != NULL && style->type() == Model::PropertyDefinition::ChoiceProperty);
+                assert(style->defaultValue() == 1);
+                assert(style->options().size() == 2);
+
+                const Model::FlagsPropertyDefinition* spawnflags = static_cast<const Model::FlagsPropertyDefinition*>(player.propertyDefinition("spawnflags"));
+                assert(spawnflags != NULL && spawnflags->type() == Model::PropertyDefinition::FlagsProperty);
+                assert(spawnflags->options().size() == 2);
+                assert(spawnflags->defaultPropertyValue() == "2");
+
+                assert(cachedDefinitions[1]->type() == Model::EntityDefinition::BrushEntity);
+
+                // a cache written for another version of the definition file is rejected
+                const EntityDefinitionCache modifiedCache("defs/test.fgd", m_fgd.data(), m_fgd.data() + m_fgd.size(), ModificationTime + 1, Color(0.5f, 0.5f, 0.5f, 1.0f));
+                Model::EntityDefinitionList modifiedDefinitions;
+                assert(!modifiedCache.loadDefinitions(file, modifiedDefinitions));
+                assert(modifiedDefinitions.empty());
+
+                Utility::deleteAll(definitions);
+                Utility::deleteAll(cachedDefinitions);
+            }
+
+            void testTruncatedFile() {
+                Model::EntityDefinitionList definitions = parseDefinitions();
+                const EntityDefinitionCache cache = createCache();
+                const MappedFile file = writeCache(cache, definitions);
+
+                // the list already contains a definition, which must be left alone
+                Model::EntityDefinitionList cachedDefinitions;
+                cachedDefinitions.push_back(definitions.back());
+
+                for (size_t length = 0; length < file.size(); length++) {
+                    const MappedFile truncatedFile(file.begin(), file.begin() + length);
+                    assert(!cache.loadDefinitions(truncatedFile, cachedDefinitions));
+                    assert(cachedDefinitions.size() == 1);
+                    assert(cachedDefinitions[0] == definitions.back());
+                }
+
+                assert(cache.loadDefinitions(file, cachedDefinitions));
+                assert(cachedDefinitions.size() == 1 + definitions.size());
+
+                Utility::deleteAll(cachedDefinitions, 1);
+                Utility::deleteAll(definitions);
+            }
+        };
+    }
+}
+
+#endif
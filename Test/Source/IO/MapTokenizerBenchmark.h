@@ -0,0 +1,110 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TrenchBroom_MapTokenizerBenchmark_h
+#define TrenchBroom_MapTokenizerBenchmark_h
+
+#include "Benchmark.h"
+#include "IO/MapTokenEmitter.h"
+#include "Utility/String.h"
+
+#include <cassert>
+
+namespace TrenchBroom {
+    namespace IO {
+        class MapTokenizerBenchmark : public Benchmark<MapTokenizerBenchmark> {
+        private:
+            typedef StreamTokenizer<MapTokenEmitter> Tokenizer;
+            
+            String m_map;
+            unsigned int m_seed;
+            
+            inline int random(int min, int max) {
+                m_seed = m_seed * 1103515245 + 12345;
+                return min + static_cast<int>((m_seed >> 16) % static_cast<unsigned int>(max - min + 1));
+            }
+            
+            void writeFace(StringStream& str, int x, int y, int z, int dx, int dy, int dz) {
+                str << "( " << x << " " << y << " " << z << " ) ";
+                str << "( " << x + dx << " " << y << " " << z + dz << " ) ";
+                str << "( " << x << " " << y + dy << " " << z << " ) ";
+                str << "texture" << random(0, 63) << " " << random(-64, 64) << " " << random(-64, 64) << " ";
+                str << random(0, 3) * 22.5f << " " << random(1, 4) * 0.25f << " " << random(1, 4) * 0.25f << "\n";
+            }
+            
+            void writeBrush(StringStream& str) {
+                const int x = random(-512, 512) * 8;
+                const int y = random(-512, 512) * 8;
+                const int z = random(-64, 64) * 8;
+                const int w = random(1, 32) * 8;
+                str << "{\n";
+                writeFace(str, x, y, z, 0, 1, 1);
+                writeFace(str, x + w, y, z, 0, 1, -1);
+                writeFace(str, x, y, z, 1, 0, 1);
+                writeFace(str, x, y + w, z, -1, 0, 1);
+                writeFace(str, x, y, z, 1, 1, 0);
+                writeFace(str, x, y, z + w, 1, -1, 0);
+                str << "}\n";
+            }
+        protected:
+            void registerTestCases() {
+                registerTestCase(&MapTokenizerBenchmark::benchmarkTokenizeMap);
+            }
+            
+            void setup() {
+                m_seed = 1;
+                
+                StringStream str;
+                str << "// Game: Quake\n{\n\"classname\" \"worldspawn\"\n\"wad\" \"gfx/base.wad\"\n";
+                for (size_t i = 0; i < 50000; i++)
+                    writeBrush(str);
+                str << "}\n";
+                m_map = str.str();
+            }
+            
+            void teardown() {
+                m_map.clear();
+            }
+        public:
+            void benchmarkTokenizeMap() {
+                const size_t passes = 5;
+                size_t tokens = 0;
+                float sum = 0.0f;
+                
+                startTimer();
+                for (size_t i = 0; i < passes; i++) {
+                    Tokenizer tokenizer(m_map.c_str(), m_map.c_str() + m_map.size());
+                    Token token;
+                    while ((token = tokenizer.nextToken()).type() != TokenType::Eof) {
+                        if (token.type() == TokenType::Decimal || token.type() == TokenType::Integer)
+                            sum += token.toFloat();
+                        tokens++;
+                    }
+                }
+                
+                const double megaBytes = static_cast<double>(passes * m_map.size()) / (1024.0 * 1024.0);
+                report("Tokenize map", megaBytes, "MB");
+                assert(tokens > 0);
+                assert(sum == sum);
+            }
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,129 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TrenchBroom_StreamTokenizerTest_h
+#define TrenchBroom_StreamTokenizerTest_h
+
+#include "TestSuite.h"
+#include "IO/MapTokenEmitter.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+namespace TrenchBroom {
+    namespace IO {
+        class StreamTokenizerTest : public TestSuite<StreamTokenizerTest> {
+        private:
+            typedef StreamTokenizer<MapTokenEmitter> Tokenizer;
+
+            inline Token token(const char* str) {
+                return Token(TokenType::Decimal, str, str + std::strlen(str), 0, 1, 1);
+            }
+
+            inline bool sameAsAtof(const char* str) {
+                const float expected = static_cast<float>(std::atof(str));
+                const float actual = token(str).toFloat();
+                return std::memcmp(&expected, &actual, sizeof(float)) == 0;
+            }
+        protected:
+            void registerTestCases() {
+                registerTestCase(&StreamTokenizerTest::testToFloat);
+                registerTestCase(&StreamTokenizerTest::testToFloatOutOfRange);
+                registerTestCase(&StreamTokenizerTest::testToInteger);
+                registerTestCase(&StreamTokenizerTest::testTokenizeBrush);
+                registerTestCase(&StreamTokenizerTest::testPushToken);
+                registerTestCase(&StreamTokenizerTest::testCommentAtEof);
+            }
+        public:
+            void testToFloat() {
+                const char* numbers[] = {
+                    "0", "-0", "1", "-1", "0.5", "-0.5", ".25", "5.", "16", "-4096", "128.0", "0.1", "0.3333333",
+                    "3.14159265358979", "-1234.5678", "1e5", "1e-05", "2.5e+3", "-7.125e-2", "65536.125",
+                    "0.000000001", "123456789012345678901234567890", "0.1000000000000000000000001",
+                    "16777217", "9007199254740993", "1e22", "1e23", "4.9406564584124654e-300", "-"
+                };
+                
+                for (size_t i = 0; i < sizeof(numbers) / sizeof(const char*); i++)
+                    assert(sameAsAtof(numbers[i]));
+            }
+            
+            void testToFloatOutOfRange() {
+                assert(sameAsAtof("1e400"));
+                assert(sameAsAtof("-1e400"));
+                assert(sameAsAtof("1e-400"));
+            }
+            
+            void testToInteger() {
+                assert(token("0").toInteger() == 0);
+                assert(token("17").toInteger() == 17);
+                assert(token("-256").toInteger() == -256);
+                assert(token("12.75").toInteger() == 12);
+                assert(token("-").toInteger() == 0);
+            }
+            
+            void testTokenizeBrush() {
+                const char* str = "{\n( 0 -16 1.5 ) ( 1 2 3 ) ( 4 5 6 ) {fence 0 0 0 1 1 // comment\n}";
+                const unsigned int types[] = {
+                    TokenType::OBrace,
+                    TokenType::OParenthesis, TokenType::Integer, TokenType::Integer, TokenType::Decimal, TokenType::CParenthesis,
+                    TokenType::OParenthesis, TokenType::Integer, TokenType::Integer, TokenType::Integer, TokenType::CParenthesis,
+                    TokenType::OParenthesis, TokenType::Integer, TokenType::Integer, TokenType::Integer, TokenType::CParenthesis,
+                    TokenType::OBrace, TokenType::String, TokenType::Integer, TokenType::Integer, TokenType::Integer,
+                    TokenType::Integer, TokenType::Integer, TokenType::CBrace, TokenType::Eof
+                };
+                
+                Tokenizer tokenizer(str, str + std::strlen(str));
+                for (size_t i = 0; i < sizeof(types) / sizeof(unsigned int); i++)
+                    assert(tokenizer.nextToken().type() == types[i]);
+                
+                tokenizer.reset();
+                assert(tokenizer.nextToken().type() == TokenType::OBrace);
+                Token token = tokenizer.nextToken();
+                assert(token.type() == TokenType::OParenthesis);
+                assert(token.line() == 2);
+                assert(token.column() == 1);
+                assert(token.position() == 2);
+            }
+            
+            void testPushToken() {
+                const char* str = "a b c\n";
+                Tokenizer tokenizer(str, str + std::strlen(str));
+                Token a = tokenizer.nextToken();
+                Token b = tokenizer.nextToken();
+                tokenizer.pushToken(b);
+                tokenizer.pushToken(a);
+                assert(tokenizer.peekToken().data() == "a");
+                assert(tokenizer.nextToken().data() == "a");
+                assert(tokenizer.nextToken().data() == "b");
+                assert(tokenizer.nextToken().data() == "c");
+                assert(tokenizer.nextToken().type() == TokenType::Eof);
+            }
+            
+            void testCommentAtEof() {
+                const char* str = "} // no newline";
+                Tokenizer tokenizer(str, str + std::strlen(str));
+                assert(tokenizer.nextToken().type() == TokenType::CBrace);
+                assert(tokenizer.nextToken().type() == TokenType::Eof);
+            }
+        };
+    }
+}
+
+#endif
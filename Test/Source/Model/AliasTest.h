@@ -0,0 +1,221 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TrenchBroom_AliasTest_h
+#define TrenchBroom_AliasTest_h
+
+#include "TestSuite.h"
+#include "IO/AbstractFileManager.h"
+#include "Model/Alias.h"
+#include "Renderer/FaceVertex.h"
+#include "Utility/VecMath.h"
+
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+using namespace TrenchBroom::VecMath;
+
+namespace TrenchBroom {
+    namespace Model {
+        class AliasTest : public TestSuite<AliasTest> {
+        private:
+            typedef std::vector<char> Buffer;
+
+            static const int SkinWidth = 8;
+            static const int SkinHeight = 4;
+
+            Buffer m_buffer;
+
+            void writeInt(int value) {
+                const char* bytes = reinterpret_cast<const char*>(&value);
+                m_buffer.insert(m_buffer.end(), bytes, bytes + sizeof(int));
+            }
+
+            void writeFloat(float value) {
+                const char* bytes = reinterpret_cast<const char*>(&value);
+                m_buffer.insert(m_buffer.end(), bytes, bytes + sizeof(float));
+            }
+
+            void writeName(const char* name) {
+                char bytes[AliasLayout::SimpleFrameLength];
+                std::memset(bytes, 0, AliasLayout::SimpleFrameLength);
+                std::strncpy(bytes, name, AliasLayout::SimpleFrameLength - 1);
+                m_buffer.insert(m_buffer.end(), bytes, bytes + AliasLayout::SimpleFrameLength);
+            }
+
+            // the packed vertices of a frame are offset from those of the base frame by the given amount
+            void writeFrame(const char* name, unsigned char offset) {
+                static const unsigned char BaseVertices[] = {
+                     0, 0, 0, 0,
+                    16, 0, 0, 1,
+                    16, 8, 0, 2,
+                     0, 8, 4, 3
+                };
+
+                m_buffer.insert(m_buffer.end(), 2 * AliasLayout::FrameVertexSize, 0); // bounding box
+                writeName(name);
+                for (size_t i = 0; i < sizeof(BaseVertices); i++)
+                    m_buffer.push_back(static_cast<char>(i % 4 == 3 ? BaseVertices[i] : BaseVertices[i] + offset));
+            }
+
+            /*
+             * Creates a model with one skin, four vertices and two triangles, the second of which faces backwards and
+             * has two vertices on the seam. The first frame is a single frame, the second one is a group of two frames.
+             */
+            IO::MappedFile::Ptr createModel() {
+                m_buffer.clear();
+
+                const char ident[] = {'I', 'D', 'P', 'O'};
+                m_buffer.insert(m_buffer.end(), ident, ident + 4);
+                writeInt(6); // version
+
+                writeFloat(0.5f); writeFloat(1.0f); writeFloat(2.0f); // scale
+                writeFloat(-8.0f); writeFloat(0.0f); writeFloat(16.0f); // origin
+                writeFloat(32.0f); // radius
+                writeFloat(0.0f); writeFloat(0.0f); writeFloat(0.0f); // eye position
+                assert(m_buffer.size() == AliasLayout::HeaderNumSkins);
+
+                writeInt(1); // skins
+                writeInt(SkinWidth);
+                writeInt(SkinHeight);
+                writeInt(4); // vertices
+                writeInt(2); // triangles
+                writeInt(2); // frames
+                writeInt(0); // sync type
+                writeInt(0); // flags
+                writeFloat(1.0f); // size
+                assert(m_buffer.size() == AliasLayout::Skins);
+
+                writeInt(0); // single skin
+                for (int i = 0; i < SkinWidth * SkinHeight; i++)
+                    m_buffer.push_back(static_cast<char>(i));
+
+                // skin vertices: on seam, s, t
+                writeInt(1); writeInt(0); writeInt(0);
+                writeInt(0); writeInt(4); writeInt(0);
+                writeInt(0); writeInt(4); writeInt(2);
+                writeInt(1); writeInt(0); writeInt(2);
+
+                // triangles: front facing, vertex indices
+                writeInt(1); writeInt(0); writeInt(1); writeInt(2);
+                writeInt(0); writeInt(0); writeInt(2); writeInt(3);
+
+                writeInt(0); // single frame
+                writeFrame("base", 0);
+
+                writeInt(1); // frame group
+                writeInt(2);
+                m_buffer.insert(m_buffer.end(), 2 * AliasLayout::FrameVertexSize, 0); // bounding box
+                writeFloat(0.1f);
+                writeFloat(0.3f);
+                writeFrame("run1", 2);
+                writeFrame("run2", 4);
+
+                return IO::MappedFile::Ptr(new IO::MappedFile(&m_buffer.front(), &m_buffer.front() + m_buffer.size()));
+            }
+
+            void assertVertex(const Renderer::FaceVertex& vertex, const Vec3f& position, const Vec3f& normal, const Vec2f& texCoords) {
+                assert(Vec3f(vertex.px, vertex.py, vertex.pz).equals(position));
+                assert(Vec3f(vertex.nx, vertex.ny, vertex.nz).equals(normal));
+                assert(Vec2f(vertex.ts, vertex.tt).equals(texCoords));
+            }
+        protected:
+            void registerTestCases() {
+                registerTestCase(&AliasTest::testSkins);
+                registerTestCase(&AliasTest::testDecodeFrame);
+                registerTestCase(&AliasTest::testFrameGroup);
+            }
+        public:
+            void testSkins() {
+                Alias alias("test.mdl", createModel());
+
+                assert(alias.skins().size() == 1);
+                const AliasSkin& skin = *alias.skins()[0];
+                assert(skin.width() == SkinWidth);
+                assert(skin.height() == SkinHeight);
+                assert(skin.pictures().size() == 1);
+                assert(skin.pictures()[0] == reinterpret_cast<const unsigned char*>(&m_buffer[AliasLayout::Skins + 4]));
+            }
+
+            void testDecodeFrame() {
+                Alias alias("test.mdl", createModel());
+
+                // only the first frame is decoded when the model is loaded
+                assert(alias.frames().size() == 2);
+                assert(alias.frames()[0]->firstFrame()->decoded());
+                assert(!alias.frames()[1]->firstFrame()->decoded());
+
+                const AliasSingleFrame& frame = alias.firstFrame();
+                assert(frame.name() == "base");
+
+                const Vec3f normals[] = {
+                    Vec3f(-0.525731f,  0.000000f,  0.850651f),
+                    Vec3f(-0.442863f,  0.238856f,  0.864188f),
+                    Vec3f(-0.295242f,  0.000000f,  0.955423f),
+                    Vec3f(-0.309017f,  0.500000f,  0.809017f)
+                };
+
+                // the vertices on the seam of the back facing triangle use the right half of the skin
+                const Renderer::FaceVertex::List& vertices = frame.vertices();
+                assert(vertices.size() == 6);
+                assertVertex(vertices[0], Vec3f(-8.0f, 0.0f, 16.0f), normals[0], Vec2f(0.0f, 0.0f));
+                assertVertex(vertices[1], Vec3f( 0.0f, 0.0f, 16.0f), normals[1], Vec2f(0.5f, 0.0f));
+                assertVertex(vertices[2], Vec3f( 0.0f, 8.0f, 16.0f), normals[2], Vec2f(0.5f, 0.5f));
+                assertVertex(vertices[3], Vec3f(-8.0f, 0.0f, 16.0f), normals[0], Vec2f(0.5f, 0.0f));
+                assertVertex(vertices[4], Vec3f( 0.0f, 8.0f, 16.0f), normals[2], Vec2f(0.5f, 0.5f));
+                assertVertex(vertices[5], Vec3f(-8.0f, 8.0f, 24.0f), normals[3], Vec2f(0.5f, 0.5f));
+
+                assert(frame.bounds().min == Vec3f(-8.0f, 0.0f, 16.0f));
+                assert(frame.bounds().max == Vec3f( 0.0f, 8.0f, 24.0f));
+                assert(frame.center() == Vec3f(-4.0f, 4.0f, 18.0f));
+            }
+
+            void testFrameGroup() {
+                Alias alias("test.mdl", createModel());
+
+                const AliasFrameGroup& group = *static_cast<AliasFrameGroup*>(alias.frames()[1]);
+                assert(group.times().size() == 2);
+                assert(group.times()[0] == 0.1f);
+                assert(group.times()[1] == 0.3f);
+                assert(group.frames().size() == 2);
+                assert(group.frames()[0]->name() == "run1");
+                assert(group.frames()[1]->name() == "run2");
+
+                // the second frame of the group starts right after the packed vertices of the first one
+                assert(group.frames()[1]->packedVertices() == group.frames()[0]->packedVertices() + 4 * AliasLayout::FrameVertexSize + AliasLayout::SimpleFrameName + AliasLayout::SimpleFrameLength);
+
+                const AliasSingleFrame& frame = alias.frame(1);
+                assert(&frame == group.frames()[0]);
+                assert(frame.decoded());
+
+                const Renderer::FaceVertex::List& vertices = frame.vertices();
+                assert(vertices.size() == 6);
+                assertVertex(vertices[0], Vec3f(-7.0f, 2.0f, 20.0f), Vec3f(-0.525731f,  0.000000f,  0.850651f), Vec2f(0.0f, 0.0f));
+                assertVertex(vertices[5], Vec3f(-7.0f, 10.0f, 28.0f), Vec3f(-0.309017f,  0.500000f,  0.809017f), Vec2f(0.5f, 0.5f));
+
+                assert(frame.bounds().min == Vec3f(-7.0f, 2.0f, 20.0f));
+                assert(frame.bounds().max == Vec3f( 1.0f, 10.0f, 28.0f));
+                assert(!group.frames()[1]->decoded());
+            }
+        };
+    }
+}
+
+#endif
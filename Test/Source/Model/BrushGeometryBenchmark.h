@@ -0,0 +1,420 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TrenchBroom_BrushGeometryBenchmark_h
+#define TrenchBroom_BrushGeometryBenchmark_h
+
+#include "Benchmark.h"
+#include "IO/MapTokenEmitter.h"
+#include "Model/BrushGeometry.h"
+#include "Model/CompactBrushGeometry.h"
+#include "Model/Face.h"
+#include "Utility/List.h"
+#include "Utility/VecMath.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <locale>
+#include <sstream>
+#include <vector>
+
+using namespace TrenchBroom::VecMath;
+
+namespace TrenchBroom {
+    namespace Model {
+        /*
+         * Compares BrushGeometry with CompactBrushGeometry: building the geometry of 10000 brushes from their
+         * faces like Brush::rebuildGeometry does, clipping the brushes with additional faces, moving a vertex of
+         * each brush and the memory held by the geometry. Loading a map parses the same brushes from map text and
+         * builds each representation from the parsed faces.
+         */
+        class BrushGeometryBenchmark : public Benchmark<BrushGeometryBenchmark> {
+        private:
+            typedef std::vector<FaceList> FaceListList;
+            typedef std::vector<BrushGeometry*> GeometryList;
+            typedef std::vector<CompactBrushGeometry*> CompactGeometryList;
+            typedef IO::StreamTokenizer<IO::MapTokenEmitter> Tokenizer;
+
+            static const size_t BrushCount = 10000;
+
+            BBoxf m_worldBounds;
+            std::vector<BBoxf> m_bounds;
+            FaceListList m_clipFaces;
+            String m_mapText;
+            unsigned int m_seed;
+
+            inline float random(float min, float max) {
+                m_seed = m_seed * 1103515245 + 12345;
+                return min + (max - min) * static_cast<float>((m_seed >> 16) & 0x7FFF) / 32767.0f;
+            }
+
+            // cuts off the given corner of the given bounds
+            Face* clipFace(const BBoxf& bounds, const Vec3f& corner) {
+                const Vec3f size = bounds.size();
+                Vec3f p[3];
+                for (size_t i = 0; i < 3; i++) {
+                    p[i] = corner;
+                    const float offset = (random(0.3f, 0.7f) * size[i]);
+                    p[i][i] += corner[i] == bounds.min[i] ? offset : -offset;
+                }
+                p[0].round();
+                p[1].round();
+                p[2].round();
+
+                Face* face = new Face(m_worldBounds, false, p[0], p[1], p[2], "");
+                if (face->boundary().pointDistance(corner) < 0.0f) {
+                    delete face;
+                    face = new Face(m_worldBounds, false, p[0], p[2], p[1], "");
+                }
+                return face;
+            }
+
+            FaceList boxFaces(const BBoxf& bounds) {
+                const Vec3f& min = bounds.min;
+                const Vec3f& max = bounds.max;
+
+                FaceList faces;
+                faces.push_back(new Face(m_worldBounds, false, min, Vec3f(min.x(), min.y(), max.z()), Vec3f(max.x(), min.y(), min.z()), ""));
+                faces.push_back(new Face(m_worldBounds, false, min, Vec3f(min.x(), max.y(), min.z()), Vec3f(min.x(), min.y(), max.z()), ""));
+                faces.push_back(new Face(m_worldBounds, false, min, Vec3f(max.x(), min.y(), min.z()), Vec3f(min.x(), max.y(), min.z()), ""));
+                faces.push_back(new Face(m_worldBounds, false, max, Vec3f(min.x(), max.y(), max.z()), Vec3f(max.x(), max.y(), min.z()), ""));
+                faces.push_back(new Face(m_worldBounds, false, max, Vec3f(max.x(), max.y(), min.z()), Vec3f(max.x(), min.y(), max.z()), ""));
+                faces.push_back(new Face(m_worldBounds, false, max, Vec3f(max.x(), min.y(), max.z()), Vec3f(min.x(), max.y(), max.z()), ""));
+
+                std::sort(faces.begin(), faces.end(), Face::WeightOrder(Planef::WeightOrder(true)));
+                std::sort(faces.begin(), faces.end(), Face::WeightOrder(Planef::WeightOrder(false)));
+                return faces;
+            }
+
+            FaceListList createFaces() {
+                FaceListList faces;
+                faces.reserve(BrushCount);
+                for (size_t i = 0; i < BrushCount; i++)
+                    faces.push_back(boxFaces(m_bounds[i]));
+                return faces;
+            }
+
+            FaceListList copyClipFaces() {
+                FaceListList faces;
+                faces.reserve(BrushCount);
+                for (size_t i = 0; i < BrushCount; i++) {
+                    FaceList copies;
+                    for (size_t j = 0; j < m_clipFaces[i].size(); j++)
+                        copies.push_back(new Face(*m_clipFaces[i][j]));
+                    faces.push_back(copies);
+                }
+                return faces;
+            }
+
+            void deleteFaces(FaceListList& faces) {
+                for (size_t i = 0; i < faces.size(); i++)
+                    Utility::deleteAll(faces[i]);
+                faces.clear();
+            }
+
+            void writeFace(const Face& face, std::stringstream& stream) {
+                for (size_t i = 0; i < 3; i++) {
+                    const Vec3f& point = face.point(i);
+                    stream << "( " << point.x() << " " << point.y() << " " << point.z() << " ) ";
+                }
+                stream << "base 0 0 0 1 1\n";
+            }
+
+            // a worldspawn entity containing every brush with its clip faces, as written by MapWriter
+            String createMapText() {
+                std::stringstream stream;
+                stream.imbue(std::locale::classic());
+                stream << "{\n\"classname\" \"worldspawn\"\n";
+                for (size_t i = 0; i < BrushCount; i++) {
+                    stream << "{\n";
+                    FaceList faces = boxFaces(m_bounds[i]);
+                    for (size_t j = 0; j < faces.size(); j++)
+                        writeFace(*faces[j], stream);
+                    for (size_t j = 0; j < m_clipFaces[i].size(); j++)
+                        writeFace(*m_clipFaces[i][j], stream);
+                    Utility::deleteAll(faces);
+                    stream << "}\n";
+                }
+                stream << "}\n";
+                return stream.str();
+            }
+
+            Vec3f parseVector(Tokenizer& tokenizer) {
+                Vec3f vec;
+                for (size_t i = 0; i < 3; i++)
+                    vec[i] = tokenizer.nextToken().toFloat();
+                return vec;
+            }
+
+            Face* parseFace(Tokenizer& tokenizer) {
+                // same steps as MapParser::parseFace for the standard format, the opening parenthesis is consumed
+                const Vec3f p1 = parseVector(tokenizer).corrected();
+                tokenizer.nextToken();
+                tokenizer.nextToken();
+                const Vec3f p2 = parseVector(tokenizer).corrected();
+                tokenizer.nextToken();
+                tokenizer.nextToken();
+                const Vec3f p3 = parseVector(tokenizer).corrected();
+                tokenizer.nextToken();
+
+                const IO::Token textureName = tokenizer.nextToken();
+                assert(textureName.type() == IO::TokenType::String);
+
+                Face* face = new Face(m_worldBounds, false, p1, p2, p3, textureName.data());
+                face->setXOffset(tokenizer.nextToken().toFloat());
+                face->setYOffset(tokenizer.nextToken().toFloat());
+                face->setRotation(tokenizer.nextToken().toFloat());
+                face->setXScale(tokenizer.nextToken().toFloat());
+                face->setYScale(tokenizer.nextToken().toFloat());
+                return face;
+            }
+
+            /*
+             * Parses the map text and builds the geometry of every brush from its faces. MapParser cannot be used
+             * here because it reports to the console, so the brushes are parsed with the same tokenizer instead.
+             */
+            template <class Geometry>
+            size_t loadMap(std::vector<Geometry*>& geometries, FaceListList& faces) {
+                Tokenizer tokenizer(m_mapText.c_str(), m_mapText.c_str() + m_mapText.size());
+                IO::Token token = tokenizer.nextToken();
+                assert(token.type() == IO::TokenType::OBrace);
+
+                // skip the entity properties
+                while ((token = tokenizer.nextToken()).type() == IO::TokenType::String)
+                    tokenizer.nextToken();
+
+                size_t faceCount = 0;
+                while (token.type() == IO::TokenType::OBrace) {
+                    FaceList brushFaces;
+                    while ((token = tokenizer.nextToken()).type() == IO::TokenType::OParenthesis)
+                        brushFaces.push_back(parseFace(tokenizer));
+                    assert(token.type() == IO::TokenType::CBrace);
+
+                    FaceSet droppedFaces;
+                    Geometry* geometry = new Geometry(m_worldBounds);
+                    geometry->addFaces(brushFaces, droppedFaces);
+                    geometries.push_back(geometry);
+                    faces.push_back(brushFaces);
+                    faceCount += brushFaces.size();
+
+                    token = tokenizer.nextToken();
+                }
+                assert(token.type() == IO::TokenType::CBrace);
+                return faceCount;
+            }
+
+            void updateFaces(FaceList& faces, const FaceSet& newFaces, const FaceSet& droppedFaces) {
+                FaceSet::const_iterator it, end;
+                for (it = droppedFaces.begin(), end = droppedFaces.end(); it != end; ++it) {
+                    Face* face = *it;
+                    faces.erase(std::remove(faces.begin(), faces.end(), face), faces.end());
+                    delete face;
+                }
+                faces.insert(faces.end(), newFaces.begin(), newFaces.end());
+            }
+
+            size_t memoryUsage(const BrushGeometry& geometry) {
+                size_t result = sizeof(BrushGeometry);
+                result += geometry.vertices.capacity() * sizeof(Vertex*) + geometry.vertices.size() * sizeof(Vertex);
+                result += geometry.edges.capacity() * sizeof(Edge*) + geometry.edges.size() * sizeof(Edge);
+                result += geometry.sides.capacity() * sizeof(Side*) + geometry.sides.size() * sizeof(Side);
+                for (size_t i = 0; i < geometry.sides.size(); i++) {
+                    const Side& side = *geometry.sides[i];
+                    result += side.vertices.capacity() * sizeof(Vertex*) + side.edges.capacity() * sizeof(Edge*);
+                }
+                return result;
+            }
+        protected:
+            void registerTestCases() {
+                registerTestCase(&BrushGeometryBenchmark::benchmarkPointerGeometry);
+                registerTestCase(&BrushGeometryBenchmark::benchmarkCompactGeometry);
+                registerTestCase(&BrushGeometryBenchmark::benchmarkLoadMap);
+            }
+
+            void setup() {
+                m_seed = 1;
+                m_worldBounds = BBoxf(Vec3f(-16384.0f, -16384.0f, -16384.0f), Vec3f(16384.0f, 16384.0f, 16384.0f));
+
+                m_bounds.clear();
+                m_clipFaces.clear();
+                for (size_t i = 0; i < BrushCount; i++) {
+                    const Vec3f min = Vec3f(random(-4096.0f, 4096.0f), random(-4096.0f, 4096.0f), random(-512.0f, 512.0f)).rounded();
+                    const Vec3f size = Vec3f(random(32.0f, 256.0f), random(32.0f, 256.0f), random(32.0f, 128.0f)).rounded();
+                    const BBoxf bounds(min, min + size);
+                    m_bounds.push_back(bounds);
+
+                    FaceList clipFaces;
+                    clipFaces.push_back(clipFace(bounds, bounds.min));
+                    clipFaces.push_back(clipFace(bounds, bounds.max));
+                    m_clipFaces.push_back(clipFaces);
+                }
+                m_mapText = createMapText();
+            }
+
+            void teardown() {
+                deleteFaces(m_clipFaces);
+                m_bounds.clear();
+                m_mapText.clear();
+            }
+        public:
+            BrushGeometryBenchmark() :
+            m_seed(1) {}
+
+            void benchmarkPointerGeometry() {
+                FaceListList faces = createFaces();
+                FaceListList clipFaces = copyClipFaces();
+                GeometryList geometries;
+                geometries.reserve(BrushCount);
+
+                startTimer();
+                for (size_t i = 0; i < BrushCount; i++) {
+                    FaceSet droppedFaces;
+                    BrushGeometry* geometry = new BrushGeometry(m_worldBounds);
+                    geometry->addFaces(faces[i], droppedFaces);
+                    geometries.push_back(geometry);
+                }
+                report("Build pointer brush geometry", static_cast<double>(BrushCount), "brushes");
+
+                size_t clips = 0;
+                startTimer();
+                for (size_t i = 0; i < BrushCount; i++) {
+                    FaceSet droppedFaces;
+                    for (size_t j = 0; j < clipFaces[i].size(); j++) {
+                        if (geometries[i]->addFace(*clipFaces[i][j], droppedFaces) == BrushGeometry::Split)
+                            clips++;
+                    }
+                }
+                report("Clip pointer brush geometry", static_cast<double>(clips), "faces");
+
+                size_t memory = 0;
+                for (size_t i = 0; i < BrushCount; i++) {
+                    faces[i].insert(faces[i].end(), clipFaces[i].begin(), clipFaces[i].end());
+                    clipFaces[i].clear();
+                    memory += memoryUsage(*geometries[i]);
+                }
+                std::cout << "Pointer brush geometry memory: " << memory / 1024 << " KB per " << BrushCount << " brushes" << std::endl;
+
+                size_t moves = 0;
+                startTimer();
+                for (size_t i = 0; i < BrushCount; i++) {
+                    BrushGeometry& geometry = *geometries[i];
+                    const Vec3f::List vertexPositions(1, geometry.vertices[0]->position);
+                    const Vec3f delta = (geometry.center - vertexPositions[0]) / 4.0f;
+                    if (geometry.canMoveVertices(m_worldBounds, vertexPositions, delta)) {
+                        FaceSet newFaces, droppedFaces;
+                        geometry.moveVertices(m_worldBounds, vertexPositions, delta, newFaces, droppedFaces);
+                        updateFaces(faces[i], newFaces, droppedFaces);
+                        moves++;
+                    }
+                }
+                report("Move pointer brush geometry vertices", static_cast<double>(moves), "vertices");
+                assert(moves > 0);
+
+                Utility::deleteAll(geometries);
+                deleteFaces(faces);
+                deleteFaces(clipFaces);
+            }
+
+            void benchmarkCompactGeometry() {
+                FaceListList faces = createFaces();
+                FaceListList clipFaces = copyClipFaces();
+                CompactGeometryList geometries;
+                geometries.reserve(BrushCount);
+
+                startTimer();
+                for (size_t i = 0; i < BrushCount; i++) {
+                    FaceSet droppedFaces;
+                    CompactBrushGeometry* geometry = new CompactBrushGeometry(m_worldBounds);
+                    geometry->addFaces(faces[i], droppedFaces);
+                    geometries.push_back(geometry);
+                }
+                report("Build compact brush geometry", static_cast<double>(BrushCount), "brushes");
+
+                size_t clips = 0;
+                startTimer();
+                for (size_t i = 0; i < BrushCount; i++) {
+                    FaceSet droppedFaces;
+                    for (size_t j = 0; j < clipFaces[i].size(); j++) {
+                        if (geometries[i]->addFace(*clipFaces[i][j], droppedFaces) == BrushGeometry::Split)
+                            clips++;
+                    }
+                }
+                report("Clip compact brush geometry", static_cast<double>(clips), "faces");
+
+                size_t memory = 0;
+                for (size_t i = 0; i < BrushCount; i++) {
+                    faces[i].insert(faces[i].end(), clipFaces[i].begin(), clipFaces[i].end());
+                    clipFaces[i].clear();
+                    memory += geometries[i]->memoryUsage();
+                }
+                std::cout << "Compact brush geometry memory: " << memory / 1024 << " KB per " << BrushCount << " brushes" << std::endl;
+
+                size_t moves = 0;
+                startTimer();
+                for (size_t i = 0; i < BrushCount; i++) {
+                    CompactBrushGeometry& geometry = *geometries[i];
+                    const Vec3f::List vertexPositions(1, geometry.vertices()[0]);
+                    const Vec3f delta = (geometry.center() - vertexPositions[0]) / 4.0f;
+                    if (geometry.canMoveVertices(m_worldBounds, vertexPositions, delta)) {
+                        FaceSet newFaces, droppedFaces;
+                        geometry.moveVertices(m_worldBounds, vertexPositions, delta, newFaces, droppedFaces);
+                        updateFaces(faces[i], newFaces, droppedFaces);
+                        moves++;
+                    }
+                }
+                report("Move compact brush geometry vertices", static_cast<double>(moves), "vertices");
+                assert(moves > 0);
+
+                Utility::deleteAll(geometries);
+                deleteFaces(faces);
+                deleteFaces(clipFaces);
+            }
+
+            void benchmarkLoadMap() {
+                FaceListList faces;
+                GeometryList geometries;
+                faces.reserve(BrushCount);
+                geometries.reserve(BrushCount);
+
+                startTimer();
+                size_t faceCount = loadMap(geometries, faces);
+                report("Load map into pointer brush geometry", static_cast<double>(faceCount), "faces");
+                assert(geometries.size() == BrushCount);
+
+                Utility::deleteAll(geometries);
+                deleteFaces(faces);
+
+                CompactGeometryList compactGeometries;
+                compactGeometries.reserve(BrushCount);
+                faces.reserve(BrushCount);
+
+                startTimer();
+                faceCount = loadMap(compactGeometries, faces);
+                report("Load map into compact brush geometry", static_cast<double>(faceCount), "faces");
+                assert(compactGeometries.size() == BrushCount);
+
+                Utility::deleteAll(compactGeometries);
+                deleteFaces(faces);
+            }
+        };
+    }
+}
+
+#endif
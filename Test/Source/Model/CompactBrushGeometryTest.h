@@ -0,0 +1,447 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TrenchBroom_CompactBrushGeometryTest_h
+#define TrenchBroom_CompactBrushGeometryTest_h
+
+#include "TestSuite.h"
+#include "Model/BrushGeometry.h"
+#include "Model/CompactBrushGeometry.h"
+#include "Model/Face.h"
+#include "Utility/List.h"
+#include "Utility/VecMath.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace TrenchBroom::VecMath;
+
+namespace TrenchBroom {
+    namespace Model {
+        class CompactBrushGeometryTest : public TestSuite<CompactBrushGeometryTest> {
+        private:
+            BBoxf m_worldBounds;
+
+            FaceList boxFaces(const BBoxf& bounds) {
+                const Vec3f& min = bounds.min;
+                const Vec3f& max = bounds.max;
+
+                FaceList faces;
+                faces.push_back(new Face(m_worldBounds, false, min, Vec3f(min.x(), min.y(), max.z()), Vec3f(max.x(), min.y(), min.z()), ""));
+                faces.push_back(new Face(m_worldBounds, false, min, Vec3f(min.x(), max.y(), min.z()), Vec3f(min.x(), min.y(), max.z()), ""));
+                faces.push_back(new Face(m_worldBounds, false, min, Vec3f(max.x(), min.y(), min.z()), Vec3f(min.x(), max.y(), min.z()), ""));
+                faces.push_back(new Face(m_worldBounds, false, max, Vec3f(min.x(), max.y(), max.z()), Vec3f(max.x(), max.y(), min.z()), ""));
+                faces.push_back(new Face(m_worldBounds, false, max, Vec3f(max.x(), max.y(), min.z()), Vec3f(max.x(), min.y(), max.z()), ""));
+                faces.push_back(new Face(m_worldBounds, false, max, Vec3f(max.x(), min.y(), max.z()), Vec3f(min.x(), max.y(), max.z()), ""));
+                return faces;
+            }
+
+            FaceList copyFaces(const FaceList& faces) {
+                FaceList result;
+                for (size_t i = 0; i < faces.size(); i++)
+                    result.push_back(new Face(*faces[i]));
+                return result;
+            }
+
+            void updateFaces(FaceList& faces, const FaceSet& newFaces, const FaceSet& droppedFaces) {
+                FaceSet::const_iterator it, end;
+                for (it = droppedFaces.begin(), end = droppedFaces.end(); it != end; ++it) {
+                    Face* face = *it;
+                    faces.erase(std::remove(faces.begin(), faces.end(), face), faces.end());
+                    delete face;
+                }
+                faces.insert(faces.end(), newFaces.begin(), newFaces.end());
+            }
+
+            void assertSameGeometry(const BrushGeometry& geometry, const CompactBrushGeometry& compact) {
+                assert(geometry.vertices.size() == compact.vertices().size());
+                for (size_t i = 0; i < geometry.vertices.size(); i++)
+                    assert(geometry.vertices[i]->position == compact.vertices()[i]);
+
+                assert(geometry.edges.size() == compact.edges().size());
+                for (size_t i = 0; i < geometry.edges.size(); i++) {
+                    assert(geometry.edges[i]->start->position == compact.vertices()[compact.edges()[i].start]);
+                    assert(geometry.edges[i]->end->position == compact.vertices()[compact.edges()[i].end]);
+                }
+
+                assert(geometry.sides.size() == compact.sides().size());
+                for (size_t i = 0; i < geometry.sides.size(); i++) {
+                    const Side& side = *geometry.sides[i];
+                    assert(side.vertices.size() == compact.sides()[i].count);
+                    for (size_t j = 0; j < side.vertices.size(); j++)
+                        assert(side.vertices[j]->position == compact.sideVertex(i, j));
+                }
+
+                assert(geometry.bounds.min == compact.bounds().min);
+                assert(geometry.bounds.max == compact.bounds().max);
+            }
+
+            void assertEquivalent(const BrushGeometry& geometry, const CompactBrushGeometry& compact) {
+                assertSameGeometry(geometry, compact);
+                for (size_t i = 0; i < geometry.sides.size(); i++)
+                    assert(geometry.sides[i]->face == compact.sides()[i].face);
+            }
+
+            FaceInfo sideInfo(const BrushGeometry& geometry, const Vec3f& normal) {
+                for (size_t i = 0; i < geometry.sides.size(); i++)
+                    if (geometry.sides[i]->face->boundary().normal == normal)
+                        return geometry.sides[i]->info();
+                assert(false);
+                return FaceInfo();
+            }
+        protected:
+            void registerTestCases() {
+                registerTestCase(&CompactBrushGeometryTest::testBounds);
+                registerTestCase(&CompactBrushGeometryTest::testAddFaces);
+                registerTestCase(&CompactBrushGeometryTest::testNullBrush);
+                registerTestCase(&CompactBrushGeometryTest::testMoveVertices);
+                registerTestCase(&CompactBrushGeometryTest::testMergeVertices);
+                registerTestCase(&CompactBrushGeometryTest::testMoveEdgesAndFaces);
+                registerTestCase(&CompactBrushGeometryTest::testSplitEdge);
+                registerTestCase(&CompactBrushGeometryTest::testSplitFace);
+                registerTestCase(&CompactBrushGeometryTest::testCorrectAndSnap);
+                registerTestCase(&CompactBrushGeometryTest::testConversion);
+            }
+        public:
+            CompactBrushGeometryTest() :
+            m_worldBounds(Vec3f(-4096.0f, -4096.0f, -4096.0f), Vec3f(4096.0f, 4096.0f, 4096.0f)) {}
+
+            void testBounds() {
+                const BBoxf bounds(Vec3f(-16.0f, -32.0f, 0.0f), Vec3f(16.0f, 32.0f, 64.0f));
+                BrushGeometry geometry(bounds);
+                CompactBrushGeometry compact(bounds);
+
+                assertEquivalent(geometry, compact);
+                assert(compact.center() == geometry.center);
+                assert(!compact.closed());
+            }
+
+            void testAddFaces() {
+                const BBoxf bounds(Vec3f(-64.0f, -64.0f, -64.0f), Vec3f(64.0f, 64.0f, 64.0f));
+                FaceList faces = boxFaces(bounds);
+
+                // cut off two corners and add a duplicate of the first face
+                faces.push_back(new Face(m_worldBounds, false, Vec3f(32.0f, 64.0f, 64.0f), Vec3f(64.0f, 64.0f, 16.0f), Vec3f(64.0f, 32.0f, 64.0f), ""));
+                faces.push_back(new Face(m_worldBounds, false, Vec3f(-40.0f, -64.0f, -64.0f), Vec3f(-64.0f, -40.0f, -64.0f), Vec3f(-64.0f, -64.0f, -24.0f), ""));
+                faces.push_back(new Face(*faces[0]));
+
+                FaceList compactFaces = copyFaces(faces);
+
+                FaceSet droppedFaces;
+                BrushGeometry geometry(m_worldBounds);
+                geometry.addFaces(faces, droppedFaces);
+                assert(droppedFaces.size() == 1);
+
+                FaceSet compactDroppedFaces;
+                CompactBrushGeometry compact(m_worldBounds);
+                compact.addFaces(compactFaces, compactDroppedFaces);
+                assert(compactDroppedFaces.size() == 1);
+                assert(*compactDroppedFaces.begin() == compactFaces.back());
+
+                assert(compact.vertices().size() == 12);
+                assert(compact.sides().size() == 8);
+                assert(compact.closed());
+
+                // the faces differ, so compare everything else
+                for (size_t i = 0; i < geometry.sides.size(); i++)
+                    geometry.sides[i]->face = compactFaces[findElement(faces, geometry.sides[i]->face)];
+                assertEquivalent(geometry, compact);
+                for (size_t i = 0; i < geometry.sides.size(); i++)
+                    geometry.sides[i]->face = NULL;
+
+                Utility::deleteAll(faces);
+                Utility::deleteAll(compactFaces);
+            }
+
+            void testNullBrush() {
+                FaceList faces = boxFaces(BBoxf(Vec3f(-64.0f, -64.0f, -64.0f), Vec3f(64.0f, 64.0f, 64.0f)));
+                faces.push_back(new Face(m_worldBounds, false, Vec3f(0.0f, 0.0f, 128.0f), Vec3f(1.0f, 0.0f, 128.0f), Vec3f(0.0f, 1.0f, 128.0f), ""));
+
+                FaceSet droppedFaces;
+                CompactBrushGeometry compact(m_worldBounds);
+
+                bool thrown = false;
+                try {
+                    compact.addFaces(faces, droppedFaces);
+                } catch (GeometryException&) {
+                    thrown = true;
+                }
+                assert(thrown);
+
+                Utility::deleteAll(faces);
+            }
+
+            void testMoveVertices() {
+                const BBoxf bounds(Vec3f(-64.0f, -64.0f, -64.0f), Vec3f(64.0f, 64.0f, 64.0f));
+                FaceList faces = boxFaces(bounds);
+                FaceList compactFaces = copyFaces(faces);
+
+                FaceSet droppedFaces;
+                BrushGeometry geometry(m_worldBounds);
+                geometry.addFaces(faces, droppedFaces);
+                CompactBrushGeometry compact(m_worldBounds);
+                compact.addFaces(compactFaces, droppedFaces);
+                assert(droppedFaces.empty());
+
+                const Vec3f::List vertexPositions(1, bounds.max);
+                const Vec3f delta(-32.0f, 0.0f, 0.0f);
+                assert(geometry.canMoveVertices(m_worldBounds, vertexPositions, delta));
+                assert(compact.canMoveVertices(m_worldBounds, vertexPositions, delta));
+
+                FaceSet newFaces, compactNewFaces, compactDroppedFaces;
+                const Vec3f::List newPositions = geometry.moveVertices(m_worldBounds, vertexPositions, delta, newFaces, droppedFaces);
+                const Vec3f::List compactNewPositions = compact.moveVertices(m_worldBounds, vertexPositions, delta, compactNewFaces, compactDroppedFaces);
+                assert(compactNewPositions == newPositions);
+                assert(compactNewPositions.size() == 1);
+                assert(compactNewPositions[0] == bounds.max + delta);
+                assert(compactNewFaces.size() == newFaces.size());
+                assert(compactDroppedFaces.size() == droppedFaces.size());
+
+                assertSameGeometry(geometry, compact);
+                assert(compact.vertices().size() == 8);
+                assert(compact.closed());
+                assert(compact.bounds().max == bounds.max);
+
+                // the faces of the compact geometry are never bound to its sides
+                for (size_t i = 0; i < compactFaces.size(); i++)
+                    assert(compactFaces[i]->side() == NULL);
+
+                updateFaces(faces, newFaces, droppedFaces);
+                updateFaces(compactFaces, compactNewFaces, compactDroppedFaces);
+                assert(compactFaces.size() == faces.size());
+                assert(compactFaces.size() == compact.sides().size());
+
+                Utility::deleteAll(faces);
+                Utility::deleteAll(compactFaces);
+            }
+
+            void testMergeVertices() {
+                const BBoxf bounds(Vec3f(-64.0f, -64.0f, -64.0f), Vec3f(64.0f, 64.0f, 64.0f));
+                FaceList faces = boxFaces(bounds);
+                FaceList compactFaces = copyFaces(faces);
+
+                FaceSet droppedFaces;
+                BrushGeometry geometry(m_worldBounds);
+                geometry.addFaces(faces, droppedFaces);
+                CompactBrushGeometry compact(m_worldBounds);
+                compact.addFaces(compactFaces, droppedFaces);
+
+                // dragging a corner onto its neighbour merges the two vertices
+                const Vec3f::List vertexPositions(1, bounds.max);
+                const Vec3f delta(-128.0f, 0.0f, 0.0f);
+                assert(geometry.canMoveVertices(m_worldBounds, vertexPositions, delta));
+                assert(compact.canMoveVertices(m_worldBounds, vertexPositions, delta));
+
+                FaceSet newFaces, compactNewFaces, compactDroppedFaces;
+                const Vec3f::List newPositions = geometry.moveVertices(m_worldBounds, vertexPositions, delta, newFaces, droppedFaces);
+                const Vec3f::List compactNewPositions = compact.moveVertices(m_worldBounds, vertexPositions, delta, compactNewFaces, compactDroppedFaces);
+                assert(compactNewPositions == newPositions);
+                assert(compactNewFaces.size() == newFaces.size());
+                assert(compactDroppedFaces.size() == droppedFaces.size());
+
+                assertSameGeometry(geometry, compact);
+                assert(compact.vertices().size() == 7);
+                assert(compact.closed());
+
+                updateFaces(faces, newFaces, droppedFaces);
+                updateFaces(compactFaces, compactNewFaces, compactDroppedFaces);
+                Utility::deleteAll(faces);
+                Utility::deleteAll(compactFaces);
+            }
+
+            void testMoveEdgesAndFaces() {
+                const BBoxf bounds(Vec3f(-64.0f, -64.0f, -64.0f), Vec3f(64.0f, 64.0f, 64.0f));
+                FaceList faces = boxFaces(bounds);
+                FaceList compactFaces = copyFaces(faces);
+
+                FaceSet droppedFaces;
+                BrushGeometry geometry(m_worldBounds);
+                geometry.addFaces(faces, droppedFaces);
+                CompactBrushGeometry compact(m_worldBounds);
+                compact.addFaces(compactFaces, droppedFaces);
+
+                const EdgeInfoList edgeInfos(1, EdgeInfo(bounds.max, Vec3f(bounds.max.x(), bounds.min.y(), bounds.max.z())));
+                const Vec3f edgeDelta(0.0f, 0.0f, 32.0f);
+                assert(geometry.canMoveEdges(m_worldBounds, edgeInfos, edgeDelta));
+                assert(compact.canMoveEdges(m_worldBounds, edgeInfos, edgeDelta));
+
+                FaceSet newFaces, compactNewFaces, compactDroppedFaces;
+                const EdgeInfoList newEdgeInfos = geometry.moveEdges(m_worldBounds, edgeInfos, edgeDelta, newFaces, droppedFaces);
+                const EdgeInfoList compactNewEdgeInfos = compact.moveEdges(m_worldBounds, edgeInfos, edgeDelta, compactNewFaces, compactDroppedFaces);
+                assert(compactNewEdgeInfos == newEdgeInfos);
+                assertSameGeometry(geometry, compact);
+                assert(compact.closed());
+
+                updateFaces(faces, newFaces, droppedFaces);
+                updateFaces(compactFaces, compactNewFaces, compactDroppedFaces);
+
+                const FaceInfoList faceInfos(1, sideInfo(geometry, Vec3f::NegZ));
+                const Vec3f faceDelta(0.0f, 0.0f, -16.0f);
+                assert(geometry.canMoveFaces(m_worldBounds, faceInfos, faceDelta));
+                assert(compact.canMoveFaces(m_worldBounds, faceInfos, faceDelta));
+                assert(!compact.canMoveFaces(m_worldBounds, faceInfos, Vec3f(0.0f, 0.0f, -8192.0f)));
+
+                const FaceInfoList newFaceInfos = geometry.moveFaces(m_worldBounds, faceInfos, faceDelta, newFaces, droppedFaces);
+                const FaceInfoList compactNewFaceInfos = compact.moveFaces(m_worldBounds, faceInfos, faceDelta, compactNewFaces, compactDroppedFaces);
+                assert(compactNewFaceInfos == newFaceInfos);
+                assertSameGeometry(geometry, compact);
+                assert(compact.bounds().min.z() == bounds.min.z() - 16.0f);
+
+                updateFaces(faces, newFaces, droppedFaces);
+                updateFaces(compactFaces, compactNewFaces, compactDroppedFaces);
+                Utility::deleteAll(faces);
+                Utility::deleteAll(compactFaces);
+            }
+
+            void testSplitEdge() {
+                const BBoxf bounds(Vec3f(-64.0f, -64.0f, -64.0f), Vec3f(64.0f, 64.0f, 64.0f));
+                FaceList faces = boxFaces(bounds);
+                FaceList compactFaces = copyFaces(faces);
+
+                FaceSet droppedFaces;
+                BrushGeometry geometry(m_worldBounds);
+                geometry.addFaces(faces, droppedFaces);
+                CompactBrushGeometry compact(m_worldBounds);
+                compact.addFaces(compactFaces, droppedFaces);
+
+                const EdgeInfo edgeInfo(bounds.max, Vec3f(bounds.max.x(), bounds.min.y(), bounds.max.z()));
+                const Vec3f delta(16.0f, 0.0f, 16.0f);
+                assert(!compact.canSplitEdge(m_worldBounds, edgeInfo, -delta));
+                assert(geometry.canSplitEdge(m_worldBounds, edgeInfo, delta));
+                assert(compact.canSplitEdge(m_worldBounds, edgeInfo, delta));
+
+                FaceSet newFaces, compactNewFaces, compactDroppedFaces;
+                const Vec3f newPosition = geometry.splitEdge(m_worldBounds, edgeInfo, delta, newFaces, droppedFaces);
+                const Vec3f compactNewPosition = compact.splitEdge(m_worldBounds, edgeInfo, delta, compactNewFaces, compactDroppedFaces);
+                assert(compactNewPosition == newPosition);
+                assert(compactNewPosition == edgeInfo.center() + delta);
+                assert(compactNewFaces.size() == newFaces.size());
+                assert(compactDroppedFaces.size() == droppedFaces.size());
+
+                assertSameGeometry(geometry, compact);
+                assert(compact.vertices().size() == 9);
+                assert(compact.closed());
+
+                updateFaces(faces, newFaces, droppedFaces);
+                updateFaces(compactFaces, compactNewFaces, compactDroppedFaces);
+                Utility::deleteAll(faces);
+                Utility::deleteAll(compactFaces);
+            }
+
+            void testSplitFace() {
+                const BBoxf bounds(Vec3f(-64.0f, -64.0f, -64.0f), Vec3f(64.0f, 64.0f, 64.0f));
+                FaceList faces = boxFaces(bounds);
+                FaceList compactFaces = copyFaces(faces);
+
+                FaceSet droppedFaces;
+                BrushGeometry geometry(m_worldBounds);
+                geometry.addFaces(faces, droppedFaces);
+                CompactBrushGeometry compact(m_worldBounds);
+                compact.addFaces(compactFaces, droppedFaces);
+
+                const FaceInfo faceInfo = sideInfo(geometry, Vec3f::PosZ);
+                const Vec3f delta(0.0f, 0.0f, 32.0f);
+                assert(!compact.canSplitFace(m_worldBounds, faceInfo, Vec3f(32.0f, 0.0f, 0.0f)));
+                assert(geometry.canSplitFace(m_worldBounds, faceInfo, delta));
+                assert(compact.canSplitFace(m_worldBounds, faceInfo, delta));
+
+                FaceSet newFaces, compactNewFaces, compactDroppedFaces;
+                const Vec3f newPosition = geometry.splitFace(m_worldBounds, faceInfo, delta, newFaces, droppedFaces);
+                const Vec3f compactNewPosition = compact.splitFace(m_worldBounds, faceInfo, delta, compactNewFaces, compactDroppedFaces);
+                assert(compactNewPosition == newPosition);
+                assert(compactNewPosition == Vec3f(0.0f, 0.0f, bounds.max.z()) + delta);
+                assert(compactNewFaces.size() == newFaces.size());
+                assert(compactDroppedFaces.size() == droppedFaces.size());
+
+                assertSameGeometry(geometry, compact);
+                assert(compact.vertices().size() == 9);
+                assert(compact.sides().size() == 9);
+                assert(compact.closed());
+
+                updateFaces(faces, newFaces, droppedFaces);
+                updateFaces(compactFaces, compactNewFaces, compactDroppedFaces);
+                assert(compactFaces.size() == compact.sides().size());
+                Utility::deleteAll(faces);
+                Utility::deleteAll(compactFaces);
+            }
+
+            void testCorrectAndSnap() {
+                const BBoxf bounds(Vec3f(-64.0f, -64.0f, -64.0f), Vec3f(64.0f, 64.0f, 64.0f));
+                FaceList faces = boxFaces(bounds);
+                FaceList compactFaces = copyFaces(faces);
+
+                FaceSet droppedFaces;
+                BrushGeometry geometry(m_worldBounds);
+                geometry.addFaces(faces, droppedFaces);
+                CompactBrushGeometry compact(m_worldBounds);
+                compact.addFaces(compactFaces, droppedFaces);
+
+                const Vec3f::List vertexPositions(1, bounds.max);
+                const Vec3f delta(-16.0005f, -3.0f, 0.0f);
+                FaceSet newFaces, compactNewFaces, compactDroppedFaces;
+                geometry.moveVertices(m_worldBounds, vertexPositions, delta, newFaces, droppedFaces);
+                compact.moveVertices(m_worldBounds, vertexPositions, delta, compactNewFaces, compactDroppedFaces);
+                updateFaces(faces, newFaces, droppedFaces);
+                updateFaces(compactFaces, compactNewFaces, compactDroppedFaces);
+                assertSameGeometry(geometry, compact);
+
+                geometry.correct(newFaces, droppedFaces, Math<float>::CorrectEpsilon);
+                compact.correct(compactNewFaces, compactDroppedFaces, Math<float>::CorrectEpsilon);
+                updateFaces(faces, newFaces, droppedFaces);
+                updateFaces(compactFaces, compactNewFaces, compactDroppedFaces);
+                assertSameGeometry(geometry, compact);
+                assert(std::find(compact.vertices().begin(), compact.vertices().end(), Vec3f(48.0f, 61.0f, 64.0f)) != compact.vertices().end());
+
+                geometry.snap(newFaces, droppedFaces, 16);
+                compact.snap(compactNewFaces, compactDroppedFaces, 16);
+                updateFaces(faces, newFaces, droppedFaces);
+                updateFaces(compactFaces, compactNewFaces, compactDroppedFaces);
+                assertSameGeometry(geometry, compact);
+                assert(compact.bounds().max == bounds.max);
+                assert(compact.closed());
+
+                Utility::deleteAll(faces);
+                Utility::deleteAll(compactFaces);
+            }
+
+            void testConversion() {
+                const BBoxf bounds(Vec3f(-64.0f, -64.0f, -64.0f), Vec3f(64.0f, 64.0f, 64.0f));
+                FaceList faces = boxFaces(bounds);
+                faces.push_back(new Face(m_worldBounds, false, Vec3f(32.0f, 64.0f, 64.0f), Vec3f(64.0f, 64.0f, 16.0f), Vec3f(64.0f, 32.0f, 64.0f), ""));
+
+                FaceSet droppedFaces;
+                CompactBrushGeometry compact(m_worldBounds);
+                compact.addFaces(faces, droppedFaces);
+
+                BrushGeometry* geometry = compact.toBrushGeometry();
+                assertEquivalent(*geometry, compact);
+                assert(geometry->closed());
+
+                CompactBrushGeometry copy(*geometry);
+                assertEquivalent(*geometry, copy);
+                assert(copy.memoryUsage() > 0);
+
+                delete geometry;
+                Utility::deleteAll(faces);
+            }
+        };
+    }
+}
+
+#endif
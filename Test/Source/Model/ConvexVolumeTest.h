@@ -0,0 +1,232 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TrenchBroom_ConvexVolumeTest_h
+#define TrenchBroom_ConvexVolumeTest_h
+
+#include "TestSuite.h"
+#include "Model/Brush.h"
+#include "Model/ConvexVolume.h"
+#include "Utility/VecMath.h"
+
+#include <cassert>
+
+using namespace TrenchBroom::VecMath;
+
+namespace TrenchBroom {
+    namespace Model {
+        class ConvexVolumeTest : public TestSuite<ConvexVolumeTest> {
+        private:
+            BBoxf m_worldBounds;
+            unsigned int m_seed;
+            
+            BBoxf box(float minX, float minY, float minZ, float maxX, float maxY, float maxZ) {
+                return BBoxf(Vec3f(minX, minY, minZ), Vec3f(maxX, maxY, maxZ));
+            }
+            
+            float random(float min, float max) {
+                // a fixed sequence so that failures can be reproduced
+                m_seed = m_seed * 1103515245 + 12345;
+                return min + (max - min) * ((m_seed >> 8) & 0xFFFF) / 65535.0f;
+            }
+            
+            Brush* randomBrush(const Vec3f& center, float minSize, float maxSize) {
+                const Vec3f size(random(minSize, maxSize), random(minSize, maxSize), random(minSize, maxSize));
+                Brush* brush = new Brush(m_worldBounds, false, BBoxf(-size / 2.0f, size / 2.0f), NULL);
+                
+                const Vec3f axis = Vec3f(random(-1.0f, 1.0f), random(-1.0f, 1.0f), random(0.1f, 1.0f)).normalized();
+                const Mat4f rotation = rotationMatrix(random(0.0f, 3.0f), axis);
+                brush->transform(translationMatrix(center) * rotation, rotation, false, false);
+                return brush;
+            }
+        protected:
+            void registerTestCases() {
+                registerTestCase(&ConvexVolumeTest::testDisjointBoxes);
+                registerTestCase(&ConvexVolumeTest::testTouchingBoxes);
+                registerTestCase(&ConvexVolumeTest::testOverlappingBoxes);
+                registerTestCase(&ConvexVolumeTest::testContainedBoxes);
+                registerTestCase(&ConvexVolumeTest::testFaceSharingBoxes);
+                registerTestCase(&ConvexVolumeTest::testSlivers);
+                registerTestCase(&ConvexVolumeTest::testEdgeSeparation);
+                registerTestCase(&ConvexVolumeTest::testAgainstBrush);
+            }
+        public:
+            ConvexVolumeTest() :
+            m_worldBounds(Vec3f(-4096.0f, -4096.0f, -4096.0f), Vec3f(4096.0f, 4096.0f, 4096.0f)),
+            m_seed(1) {}
+            
+            void testDisjointBoxes() {
+                const ConvexVolume a(box(0.0f, 0.0f, 0.0f, 32.0f, 32.0f, 32.0f));
+                const ConvexVolume b(box(33.0f, 0.0f, 0.0f, 64.0f, 32.0f, 32.0f));
+                const ConvexVolume c(box(-64.0f, -64.0f, -64.0f, -1.0f, -1.0f, -1.0f));
+                
+                assert(!a.intersects(b));
+                assert(!a.touches(b));
+                assert(!b.intersects(a));
+                assert(!a.intersects(c));
+                assert(!a.touches(c));
+                assert(!a.contains(b));
+                assert(!b.contains(a));
+            }
+            
+            void testTouchingBoxes() {
+                const ConvexVolume a(box(0.0f, 0.0f, 0.0f, 32.0f, 32.0f, 32.0f));
+                // touching at an edge and at a vertex
+                const ConvexVolume edge(box(32.0f, 32.0f, 0.0f, 64.0f, 64.0f, 32.0f));
+                const ConvexVolume vertex(box(32.0f, 32.0f, 32.0f, 64.0f, 64.0f, 64.0f));
+                
+                assert(!a.intersects(edge));
+                assert(a.touches(edge));
+                assert(edge.touches(a));
+                assert(!a.intersects(vertex));
+                assert(a.touches(vertex));
+                assert(vertex.touches(a));
+            }
+            
+            void testOverlappingBoxes() {
+                const ConvexVolume a(box(0.0f, 0.0f, 0.0f, 32.0f, 32.0f, 32.0f));
+                const ConvexVolume b(box(16.0f, 16.0f, 16.0f, 48.0f, 48.0f, 48.0f));
+                // crosses a without containing any of the vertices of a
+                const ConvexVolume c(box(8.0f, 8.0f, -16.0f, 24.0f, 24.0f, 48.0f));
+                
+                assert(a.intersects(b));
+                assert(b.intersects(a));
+                assert(a.touches(b));
+                assert(a.intersects(c));
+                assert(c.intersects(a));
+                assert(!a.contains(b));
+                assert(!a.contains(c));
+                assert(!c.contains(a));
+            }
+            
+            void testContainedBoxes() {
+                const ConvexVolume outer(box(0.0f, 0.0f, 0.0f, 64.0f, 64.0f, 64.0f));
+                const ConvexVolume inner(box(16.0f, 16.0f, 16.0f, 32.0f, 32.0f, 32.0f));
+                // shares three faces with the outer box
+                const ConvexVolume corner(box(0.0f, 0.0f, 0.0f, 16.0f, 16.0f, 16.0f));
+                
+                assert(outer.contains(inner));
+                assert(!inner.contains(outer));
+                assert(outer.intersects(inner));
+                assert(inner.intersects(outer));
+                assert(outer.contains(corner));
+                assert(outer.intersects(corner));
+                assert(outer.contains(outer));
+            }
+            
+            void testFaceSharingBoxes() {
+                const ConvexVolume a(box(0.0f, 0.0f, 0.0f, 32.0f, 32.0f, 32.0f));
+                const ConvexVolume b(box(32.0f, 0.0f, 0.0f, 64.0f, 32.0f, 32.0f));
+                // shares only part of a face
+                const ConvexVolume c(box(8.0f, 8.0f, 32.0f, 16.0f, 16.0f, 40.0f));
+                
+                assert(!a.intersects(b));
+                assert(!b.intersects(a));
+                assert(a.touches(b));
+                assert(b.touches(a));
+                assert(!a.contains(b));
+                assert(!a.intersects(c));
+                assert(a.touches(c));
+            }
+            
+            void testSlivers() {
+                const ConvexVolume a(box(0.0f, 0.0f, 0.0f, 32.0f, 32.0f, 32.0f));
+                // flat volumes have no interior of their own
+                const ConvexVolume crossing(box(-8.0f, -8.0f, 16.0f, 40.0f, 40.0f, 16.0f));
+                const ConvexVolume onFace(box(8.0f, 8.0f, 32.0f, 24.0f, 24.0f, 32.0f));
+                const ConvexVolume above(box(8.0f, 8.0f, 33.0f, 24.0f, 24.0f, 33.0f));
+                const ConvexVolume inside(box(8.0f, 8.0f, 16.0f, 24.0f, 24.0f, 16.0f));
+                
+                assert(a.intersects(crossing));
+                assert(crossing.intersects(a));
+                assert(!a.intersects(onFace));
+                assert(a.touches(onFace));
+                assert(!a.touches(above));
+                assert(a.contains(inside));
+                assert(!inside.contains(a));
+                
+                // a thin brush which crosses the box diagonally
+                Brush sliver(m_worldBounds, false, box(-32.0f, -0.0625f, 8.0f, 32.0f, 0.0625f, 24.0f), NULL);
+                const Mat4f rotation = rotationMatrix(Math<float>::Pi / 4.0f, Vec3f::PosZ);
+                sliver.transform(translationMatrix(Vec3f(16.0f, 16.0f, 0.0f)) * rotation, rotation, false, false);
+                const ConvexVolume diagonal(sliver);
+                assert(a.intersects(diagonal));
+                assert(diagonal.intersects(a));
+                assert(!a.contains(diagonal));
+            }
+            
+            void testEdgeSeparation() {
+                /*
+                 * Two crossed rods with a diamond profile whose ridges run along the X and the Y axis. No face plane
+                 * separates them, only the cross product of the ridges does. The whole setup is tilted so that the
+                 * bounds overlap, too.
+                 */
+                const Mat4f tilt = rotationMatrix(Math<float>::Pi / 6.0f, Vec3f(1.0f, 1.0f, 0.0f).normalized());
+                const Mat4f firstRotation = tilt * rotationMatrix(Math<float>::Pi / 4.0f, Vec3f::PosX);
+                const Mat4f secondRotation = tilt * rotationMatrix(Math<float>::Pi / 4.0f, Vec3f::PosY);
+                
+                Brush first(m_worldBounds, false, box(-64.0f, -8.0f, -8.0f, 64.0f, 8.0f, 8.0f), NULL);
+                first.transform(firstRotation, firstRotation, false, false);
+                const ConvexVolume a(first);
+                
+                // the ridges are 8 * sqrt(2) away from the axes of the rods
+                Brush apart(m_worldBounds, false, box(-8.0f, -64.0f, -8.0f, 8.0f, 64.0f, 8.0f), NULL);
+                apart.transform(tilt * translationMatrix(Vec3f(0.0f, 0.0f, 24.0f)) * rotationMatrix(Math<float>::Pi / 4.0f, Vec3f::PosY), secondRotation, false, false);
+                const ConvexVolume b(apart);
+                assert(a.bounds().intersects(b.bounds()));
+                assert(!a.intersects(b));
+                assert(!a.touches(b));
+                assert(!first.intersectsBrush(apart));
+                
+                Brush crossing(m_worldBounds, false, box(-8.0f, -64.0f, -8.0f, 8.0f, 64.0f, 8.0f), NULL);
+                crossing.transform(tilt * translationMatrix(Vec3f(0.0f, 0.0f, 20.0f)) * rotationMatrix(Math<float>::Pi / 4.0f, Vec3f::PosY), secondRotation, false, false);
+                const ConvexVolume c(crossing);
+                assert(a.intersects(c));
+                assert(first.intersectsBrush(crossing));
+            }
+            
+            void testAgainstBrush() {
+                for (unsigned int i = 0; i < 200; i++) {
+                    Brush* first = randomBrush(Vec3f(random(-48.0f, 48.0f), random(-48.0f, 48.0f), random(-48.0f, 48.0f)), 8.0f, 64.0f);
+                    Brush* second = randomBrush(Vec3f(random(-48.0f, 48.0f), random(-48.0f, 48.0f), random(-48.0f, 48.0f)), 8.0f, 64.0f);
+                    // usually inside of the first brush
+                    Brush* third = randomBrush(first->center() + Vec3f(random(-2.0f, 2.0f), random(-2.0f, 2.0f), random(-2.0f, 2.0f)), 1.0f, 6.0f);
+                    const ConvexVolume a(*first);
+                    const ConvexVolume b(*second);
+                    const ConvexVolume c(*third);
+                    
+                    // the brushes count touching as intersecting
+                    assert(a.touches(b) == first->intersectsBrush(*second));
+                    assert(b.touches(a) == second->intersectsBrush(*first));
+                    assert(a.touches(c) == first->intersectsBrush(*third));
+                    assert(a.contains(b) == first->containsBrush(*second));
+                    assert(b.contains(a) == second->containsBrush(*first));
+                    assert(a.contains(c) == first->containsBrush(*third));
+                    assert(c.contains(a) == third->containsBrush(*first));
+                    
+                    delete first;
+                    delete second;
+                    delete third;
+                }
+            }
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,213 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TrenchBroom_EntityFilterBenchmark_h
+#define TrenchBroom_EntityFilterBenchmark_h
+
+#include "Benchmark.h"
+#include "Model/Brush.h"
+#include "Model/Entity.h"
+#include "Model/Filter.h"
+#include "Model/Map.h"
+#include "Utility/VecMath.h"
+#include "View/ViewOptions.h"
+
+#include <cassert>
+#include <sstream>
+
+using namespace TrenchBroom::VecMath;
+
+namespace TrenchBroom {
+    namespace Model {
+        class EntityFilterBenchmark : public Benchmark<EntityFilterBenchmark> {
+        private:
+            static const size_t EntityCount = 20000;
+            static const size_t Passes = 50;
+            static const size_t PatternPasses = 5;
+            
+            BBoxf m_worldBounds;
+            Map* m_map;
+            unsigned int m_seed;
+            
+            inline float random(float min, float max) {
+                m_seed = m_seed * 1103515245 + 12345;
+                return min + (max - min) * static_cast<float>((m_seed >> 16) & 0x7FFF) / 32767.0f;
+            }
+            
+            inline String number(const String& prefix, size_t i) const {
+                std::stringstream str;
+                str << prefix << i;
+                return str.str();
+            }
+        protected:
+            void registerTestCases() {
+                registerTestCase(&EntityFilterBenchmark::benchmarkWellKnownKeyLookup);
+                registerTestCase(&EntityFilterBenchmark::benchmarkKeyLookup);
+                registerTestCase(&EntityFilterBenchmark::benchmarkDefaultFilter);
+                registerTestCase(&EntityFilterBenchmark::benchmarkFilterPattern);
+            }
+            
+            void setup() {
+                m_seed = 1;
+                m_worldBounds = BBoxf(Vec3f(-16384.0f, -16384.0f, -16384.0f), Vec3f(16384.0f, 16384.0f, 16384.0f));
+                m_map = new Map(m_worldBounds, false);
+                
+                Entity* worldspawn = new Entity(m_worldBounds);
+                worldspawn->setProperty(Entity::ClassnameKey, Entity::WorldspawnClassname);
+                m_map->addEntity(*worldspawn);
+                
+                // a mix of lights, triggers and monsters with the keys that real maps use
+                for (size_t i = 0; i < EntityCount; i++) {
+                    const Vec3f origin = Vec3f(random(-4096.0f, 4096.0f), random(-4096.0f, 4096.0f), random(-512.0f, 512.0f)).rounded();
+                    Entity* entity = new Entity(m_worldBounds);
+                    switch (i % 4) {
+                        case 0:
+                            entity->setProperty(Entity::ClassnameKey, "light");
+                            entity->setProperty(Entity::OriginKey, origin, true);
+                            entity->setProperty("light", "300");
+                            entity->setProperty("_color", "1 0.8 0.6");
+                            entity->setProperty("wait", "1");
+                            break;
+                        case 1: {
+                            entity->setProperty(Entity::ClassnameKey, "trigger_multiple");
+                            entity->setProperty(Entity::TargetKey, number("t", i + 1));
+                            entity->setProperty("sounds", "1");
+                            entity->setProperty(Entity::MessageKey, "Hello");
+                            const Vec3f size = Vec3f(random(8.0f, 256.0f), random(8.0f, 256.0f), random(8.0f, 128.0f)).rounded();
+                            entity->addBrush(*new Brush(m_worldBounds, false, BBoxf(origin, origin + size), NULL));
+                            break;
+                        }
+                        default:
+                            entity->setProperty(Entity::ClassnameKey, i % 4 == 2 ? "monster_ogre" : "info_notnull");
+                            entity->setProperty(Entity::OriginKey, origin, true);
+                            entity->setProperty(Entity::AngleKey, "90");
+                            entity->setProperty(Entity::TargetnameKey, number("t", i));
+                            entity->setProperty("wait", "2");
+                            entity->setProperty("delay", "0.5");
+                            entity->setProperty("speed", "100");
+                            entity->setProperty("count", "3");
+                            entity->setProperty("health", "50");
+                            entity->setProperty("dmg", "10");
+                            entity->setProperty("noise", "misc/null.wav");
+                            entity->setProperty("_extra", "1");
+                            break;
+                    }
+                    entity->setProperty(Entity::SpawnFlagsKey, static_cast<int>(i % 8));
+                    m_map->addEntity(*entity);
+                }
+            }
+            
+            void teardown() {
+                delete m_map;
+                m_map = NULL;
+            }
+        public:
+            EntityFilterBenchmark() :
+            m_map(NULL) {}
+            
+            void benchmarkWellKnownKeyLookup() {
+                const EntityList& entities = m_map->entities();
+                size_t count = 0;
+                startTimer();
+                for (size_t pass = 0; pass < Passes; pass++) {
+                    EntityList::const_iterator it, end;
+                    for (it = entities.begin(), end = entities.end(); it != end; ++it) {
+                        const Entity& entity = **it;
+                        if (entity.classname() != NULL)
+                            count++;
+                        if (entity.propertyForKey(PropertyKeyTable::TargetnameAtom) != NULL)
+                            count++;
+                        if (entity.propertyForKey(PropertyKeyTable::SpawnFlagsAtom) != NULL)
+                            count++;
+                        if (entity.rotated())
+                            count++;
+                    }
+                }
+                report("Look up well known keys", static_cast<double>(Passes * entities.size()), "entities");
+                assert(count > 0);
+            }
+            
+            void benchmarkKeyLookup() {
+                const EntityList& entities = m_map->entities();
+                size_t count = 0;
+                startTimer();
+                for (size_t pass = 0; pass < Passes; pass++) {
+                    EntityList::const_iterator it, end;
+                    for (it = entities.begin(), end = entities.end(); it != end; ++it) {
+                        const Entity& entity = **it;
+                        if (entity.propertyForKey(Entity::OriginKey) != NULL)
+                            count++;
+                        if (entity.propertyForKey("wait") != NULL)
+                            count++;
+                        if (entity.propertyForKey("_extra") != NULL)
+                            count++;
+                        if (entity.propertyForKey("_missing") != NULL)
+                            count++;
+                    }
+                }
+                report("Look up keys by name", static_cast<double>(Passes * entities.size()), "entities");
+                assert(count > 0);
+            }
+            
+            void benchmarkDefaultFilter() {
+                View::ViewOptions viewOptions;
+                viewOptions.setShowTriggerBrushes(false);
+                DefaultFilter filter(viewOptions);
+                
+                const EntityList& entities = m_map->entities();
+                size_t visible = 0;
+                startTimer();
+                for (size_t pass = 0; pass < Passes; pass++) {
+                    EntityList::const_iterator it, end;
+                    for (it = entities.begin(), end = entities.end(); it != end; ++it) {
+                        const Entity& entity = **it;
+                        if (filter.entityVisible(entity))
+                            visible++;
+                        const BrushList& brushes = entity.brushes();
+                        for (size_t i = 0; i < brushes.size(); i++)
+                            if (filter.brushVisible(*brushes[i]))
+                                visible++;
+                    }
+                }
+                report("Evaluate default filter", static_cast<double>(Passes * entities.size()), "entities");
+                assert(visible > 0);
+            }
+            
+            void benchmarkFilterPattern() {
+                View::ViewOptions viewOptions;
+                viewOptions.setFilterPattern("ogre");
+                DefaultFilter filter(viewOptions);
+                
+                const EntityList& entities = m_map->entities();
+                size_t visible = 0;
+                startTimer();
+                for (size_t pass = 0; pass < PatternPasses; pass++) {
+                    EntityList::const_iterator it, end;
+                    for (it = entities.begin(), end = entities.end(); it != end; ++it)
+                        if (filter.entityVisible(**it))
+                            visible++;
+                }
+                report("Evaluate filter pattern", static_cast<double>(PatternPasses * entities.size()), "entities");
+                assert(visible == PatternPasses * EntityCount / 4);
+            }
+        };
+    }
+}
+
+#endif
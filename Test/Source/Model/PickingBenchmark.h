@@ -0,0 +1,134 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TrenchBroom_PickingBenchmark_h
+#define TrenchBroom_PickingBenchmark_h
+
+#include "Benchmark.h"
+#include "Model/Brush.h"
+#include "Model/Bvh.h"
+#include "Model/Entity.h"
+#include "Model/Map.h"
+#include "Model/Octree.h"
+#include "Model/Picker.h"
+#include "Utility/VecMath.h"
+
+#include <cassert>
+#include <vector>
+
+using namespace TrenchBroom::VecMath;
+
+namespace TrenchBroom {
+    namespace Model {
+        class PickingBenchmark : public Benchmark<PickingBenchmark> {
+        private:
+            typedef std::vector<Rayf> RayList;
+            
+            BBoxf m_worldBounds;
+            Map* m_map;
+            RayList m_rays;
+            unsigned int m_seed;
+            
+            inline float random(float min, float max) {
+                m_seed = m_seed * 1103515245 + 12345;
+                return min + (max - min) * static_cast<float>((m_seed >> 16) & 0x7FFF) / 32767.0f;
+            }
+        protected:
+            void registerTestCases() {
+                registerTestCase(&PickingBenchmark::benchmarkOctree);
+                registerTestCase(&PickingBenchmark::benchmarkBvh);
+            }
+            
+            void setup() {
+                m_seed = 1;
+                m_worldBounds = BBoxf(Vec3f(-16384.0f, -16384.0f, -16384.0f), Vec3f(16384.0f, 16384.0f, 16384.0f));
+                m_map = new Map(m_worldBounds, false);
+                
+                Entity* worldspawn = new Entity(m_worldBounds);
+                worldspawn->setProperty(Entity::ClassnameKey, Entity::WorldspawnClassname);
+                for (size_t i = 0; i < 20000; i++) {
+                    const Vec3f min = Vec3f(random(-4096.0f, 4096.0f), random(-4096.0f, 4096.0f), random(-512.0f, 512.0f)).rounded();
+                    const Vec3f size = Vec3f(random(8.0f, 256.0f), random(8.0f, 256.0f), random(8.0f, 128.0f)).rounded();
+                    worldspawn->addBrush(*new Brush(m_worldBounds, false, BBoxf(min, min + size), NULL));
+                }
+                m_map->addEntity(*worldspawn);
+                
+                for (size_t i = 0; i < 1000; i++) {
+                    Entity* entity = new Entity(m_worldBounds);
+                    entity->setProperty(Entity::ClassnameKey, "light");
+                    entity->setProperty(Entity::OriginKey, Vec3f(random(-4096.0f, 4096.0f), random(-4096.0f, 4096.0f), random(-512.0f, 512.0f)).rounded(), true);
+                    m_map->addEntity(*entity);
+                }
+                
+                m_rays.clear();
+                for (size_t i = 0; i < 1000; i++) {
+                    const Vec3f origin(random(-4096.0f, 4096.0f), random(-4096.0f, 4096.0f), random(-512.0f, 512.0f));
+                    const Vec3f direction(random(-1.0f, 1.0f), random(-1.0f, 1.0f), random(-0.5f, 0.5f));
+                    m_rays.push_back(Rayf(origin, direction.normalized()));
+                }
+            }
+            
+            void teardown() {
+                delete m_map;
+                m_map = NULL;
+            }
+        public:
+            PickingBenchmark() :
+            m_map(NULL) {}
+            
+            void benchmarkOctree() {
+                Octree octree(*m_map);
+                octree.loadMap();
+                
+                size_t hits = 0;
+                startTimer();
+                RayList::const_iterator it, end;
+                for (it = m_rays.begin(), end = m_rays.end(); it != end; ++it) {
+                    const Rayf& ray = *it;
+                    PickResult pickResult;
+                    MapObjectList objects = octree.intersect(ray);
+                    for (size_t i = 0; i < objects.size(); i++)
+                        objects[i]->pick(ray, pickResult);
+                    hits += objects.size();
+                }
+                report("Pick with octree", static_cast<double>(m_rays.size()), "rays");
+                assert(hits > 0);
+            }
+            
+            void benchmarkBvh() {
+                Bvh bvh(*m_map);
+                bvh.loadMap();
+                Picker picker(bvh);
+                
+                size_t count = 0;
+                startTimer();
+                RayList::const_iterator it, end;
+                for (it = m_rays.begin(), end = m_rays.end(); it != end; ++it) {
+                    PickResult* pickResult = picker.pick(*it);
+                    delete pickResult;
+                    count++;
+                }
+                report("Pick with bounding volume hierarchy", static_cast<double>(m_rays.size()), "rays");
+                assert(count == m_rays.size());
+            }
+        };
+    }
+}
+
+#endif
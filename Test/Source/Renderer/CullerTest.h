@@ -0,0 +1,118 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TrenchBroom_CullerTest_h
+#define TrenchBroom_CullerTest_h
+
+#include "TestSuite.h"
+#include "Renderer/Culler.h"
+#include "Utility/VecMath.h"
+
+#include <cassert>
+
+using namespace TrenchBroom::VecMath;
+
+namespace TrenchBroom {
+    namespace Renderer {
+        class CullerTest : public TestSuite<CullerTest> {
+        private:
+            // a camera at the origin which looks along the X axis, set up like Camera::validate does it
+            void update(Culler& culler, float maxDistance) {
+                const Vec3f position = Vec3f::Null;
+                const Mat4f projection = perspectiveMatrix(90.0f, 1.0f, 8192.0f, 800, 600);
+                const Mat4f view = viewMatrix(Vec3f::PosX, Vec3f::PosZ) * translationMatrix(-position);
+                culler.update(projection, view, position, maxDistance);
+            }
+            
+            inline BBoxf box(const Vec3f& center, float size) {
+                const Vec3f extents(size / 2.0f, size / 2.0f, size / 2.0f);
+                return BBoxf(center - extents, center + extents);
+            }
+        protected:
+            void registerTestCases() {
+                registerTestCase(&CullerTest::testFrustum);
+                registerTestCase(&CullerTest::testDistance);
+                registerTestCase(&CullerTest::testStats);
+            }
+        public:
+            void testFrustum() {
+                Culler culler;
+                update(culler, 0.0f);
+                
+                assert(!culler.culled(box(Vec3f(512.0f, 0.0f, 0.0f), 64.0f)));
+                assert(!culler.culled(box(Vec3f::Null, 64.0f)));
+                assert(culler.culled(box(Vec3f(-512.0f, 0.0f, 0.0f), 64.0f)));
+                assert(culler.culled(box(Vec3f(512.0f, 1024.0f, 0.0f), 64.0f)));
+                assert(culler.culled(box(Vec3f(512.0f, -1024.0f, 0.0f), 64.0f)));
+                assert(culler.culled(box(Vec3f(512.0f, 0.0f, 1024.0f), 64.0f)));
+                assert(culler.culled(box(Vec3f(512.0f, 0.0f, -1024.0f), 64.0f)));
+                assert(culler.culled(box(Vec3f(10000.0f, 0.0f, 0.0f), 64.0f)));
+                
+                // boxes which reach into the frustum are not culled
+                assert(!culler.culled(box(Vec3f(512.0f, 1024.0f, 0.0f), 1200.0f)));
+                assert(!culler.culled(BBoxf(Vec3f(-1000.0f, -10.0f, -10.0f), Vec3f(2.0f, 10.0f, 10.0f))));
+                
+                culler.disable();
+                assert(!culler.culled(box(Vec3f(-512.0f, 0.0f, 0.0f), 64.0f)));
+            }
+            
+            void testDistance() {
+                Culler culler;
+                update(culler, 1000.0f);
+                
+                assert(!culler.culled(box(Vec3f(512.0f, 0.0f, 0.0f), 64.0f)));
+                assert(culler.culled(box(Vec3f(2000.0f, 0.0f, 0.0f), 64.0f)));
+                
+                // the distance is measured to the closest point of the box
+                assert(!culler.culled(BBoxf(Vec3f(990.0f, -10.0f, -10.0f), Vec3f(3000.0f, 10.0f, 10.0f))));
+                assert(culler.maxDistance() == 1000.0f);
+                
+                update(culler, 0.0f);
+                assert(!culler.culled(box(Vec3f(2000.0f, 0.0f, 0.0f), 64.0f)));
+                assert(culler.maxDistance() == 0.0f);
+                
+                update(culler, 1000.0f);
+                culler.disable();
+                assert(culler.maxDistance() == 0.0f);
+            }
+            
+            void testStats() {
+                Culler culler;
+                update(culler, 0.0f);
+                
+                assert(!culler.cullChunk(box(Vec3f(512.0f, 0.0f, 0.0f), 64.0f)));
+                assert(culler.cullChunk(box(Vec3f(-512.0f, 0.0f, 0.0f), 64.0f)));
+                assert(culler.cullChunk(box(Vec3f(-512.0f, 0.0f, 0.0f), 64.0f)));
+                assert(culler.cullEntity(box(Vec3f(-512.0f, 0.0f, 0.0f), 16.0f)));
+                
+                assert(culler.chunkStats().drawn == 1);
+                assert(culler.chunkStats().culled == 2);
+                assert(culler.entityStats().drawn == 0);
+                assert(culler.entityStats().culled == 1);
+                
+                update(culler, 0.0f);
+                assert(culler.chunkStats().drawn == 0);
+                assert(culler.chunkStats().culled == 0);
+                assert(culler.entityStats().culled == 0);
+            }
+        };
+    }
+}
+
+#endif
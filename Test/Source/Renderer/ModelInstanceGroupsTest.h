@@ -0,0 +1,149 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TrenchBroom_ModelInstanceGroupsTest_h
+#define TrenchBroom_ModelInstanceGroupsTest_h
+
+#include "TestSuite.h"
+#include "Renderer/ModelInstanceGroups.h"
+#include "Utility/VecMath.h"
+
+#include <cassert>
+
+using namespace TrenchBroom::VecMath;
+
+namespace TrenchBroom {
+    namespace Renderer {
+        class ModelInstanceGroupsTest : public TestSuite<ModelInstanceGroupsTest> {
+        private:
+            typedef ModelInstanceGroups<int, int> Groups;
+            
+            inline Vec3f position(int instance) {
+                return Vec3f(static_cast<float>(instance), 0.0f, 0.0f);
+            }
+        protected:
+            void registerTestCases() {
+                registerTestCase(&ModelInstanceGroupsTest::testGrouping);
+                registerTestCase(&ModelInstanceGroupsTest::testRemove);
+                registerTestCase(&ModelInstanceGroupsTest::testDirtyRange);
+            }
+        public:
+            void testGrouping() {
+                const Quatf rotation(0.0f, Vec3f::PosZ);
+                Groups groups;
+                groups.addInstance(1, 10, position(10), rotation);
+                groups.addInstance(2, 20, position(20), rotation);
+                groups.addInstance(1, 11, position(11), rotation);
+                
+                assert(groups.instanceCount() == 3);
+                assert(groups.groups().size() == 2);
+                
+                Groups::Group* group = groups.group(1);
+                assert(group != NULL);
+                assert(group->instanceCount() == 2);
+                assert(group->instance(0) == 10);
+                assert(group->instance(1) == 11);
+                assert(group->positions()[1] == Vec4f(11.0f, 0.0f, 0.0f, 1.0f));
+                assert(group->rotations()[1] == Vec4f(rotation.v.x(), rotation.v.y(), rotation.v.z(), rotation.s));
+                
+                // adding an instance again moves it to the new group
+                groups.addInstance(2, 11, position(11), rotation);
+                assert(groups.instanceCount() == 3);
+                assert(groups.group(1)->instanceCount() == 1);
+                assert(groups.group(2)->instanceCount() == 2);
+                assert(groups.group(2)->instance(1) == 11);
+                
+                groups.clear();
+                assert(groups.empty());
+                assert(groups.group(1) == NULL);
+            }
+            
+            void testRemove() {
+                const Quatf rotation(0.0f, Vec3f::PosZ);
+                Groups groups;
+                for (int i = 0; i < 4; i++)
+                    groups.addInstance(1, i, position(i), rotation);
+                
+                // the last instance fills the gap, and its slot is updated
+                assert(groups.removeInstance(1));
+                assert(!groups.removeInstance(1));
+                Groups::Group* group = groups.group(1);
+                assert(group->instanceCount() == 3);
+                assert(group->instance(1) == 3);
+                assert(group->positions()[1] == Vec4f(3.0f, 0.0f, 0.0f, 1.0f));
+                
+                assert(groups.setTransformation(3, Vec3f(5.0f, 0.0f, 0.0f), rotation));
+                assert(group->positions()[1] == Vec4f(5.0f, 0.0f, 0.0f, 1.0f));
+                
+                assert(groups.removeInstance(0));
+                assert(groups.removeInstance(2));
+                assert(groups.removeInstance(3));
+                assert(groups.group(1) == NULL);
+                assert(groups.empty());
+            }
+            
+            void testDirtyRange() {
+                const Quatf rotation(0.0f, Vec3f::PosZ);
+                Groups groups;
+                for (int i = 0; i < 8; i++)
+                    groups.addInstance(1, i, position(i), rotation);
+                
+                Groups::Group* group = groups.group(1);
+                assert(group->dirty());
+                assert(group->dirtyBegin() == 0);
+                assert(group->dirtyEnd() == 8);
+                group->validate();
+                assert(!group->dirty());
+                
+                // unchanged transformations do not mark an instance
+                assert(!groups.setTransformation(2, position(2), rotation));
+                assert(!group->dirty());
+                
+                assert(groups.setTransformation(2, position(2), Quatf(1.0f, Vec3f::PosZ)));
+                assert(groups.setTransformation(5, position(6), rotation));
+                assert(group->dirtyBegin() == 2);
+                assert(group->dirtyEnd() == 6);
+                group->validate();
+                
+                assert(group->setVisible(3, false));
+                assert(!group->setVisible(3, false));
+                assert(!group->visible(3));
+                assert(group->positions()[3].w() == 0.0f);
+                assert(group->dirtyBegin() == 3);
+                assert(group->dirtyEnd() == 4);
+                
+                // moving a transformation keeps the visibility
+                assert(groups.setTransformation(3, position(4), rotation));
+                assert(!group->visible(3));
+                group->validate();
+                
+                // removing the last instance leaves nothing to upload
+                assert(groups.removeInstance(7));
+                assert(!group->dirty());
+                
+                // removing the first instance marks the slot which the last instance moved into
+                assert(groups.removeInstance(0));
+                assert(group->dirtyBegin() == 0);
+                assert(group->dirtyEnd() == 1);
+            }
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,158 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TrenchBroom_TexturedPolygonSorterBenchmark_h
+#define TrenchBroom_TexturedPolygonSorterBenchmark_h
+
+#include "Benchmark.h"
+#include "Renderer/TexturedPolygonSorter.h"
+
+#include <cassert>
+#include <map>
+#include <vector>
+
+namespace TrenchBroom {
+    namespace Renderer {
+        class TexturedPolygonSorterBenchmark : public Benchmark<TexturedPolygonSorterBenchmark> {
+        private:
+            class BenchmarkTexture {
+            private:
+                size_t m_index;
+            public:
+                BenchmarkTexture(size_t index) :
+                m_index(index) {}
+                
+                inline size_t index() const {
+                    return m_index;
+                }
+            };
+            
+            class BenchmarkFace {
+            public:
+                BenchmarkTexture* texture;
+                size_t vertexCount;
+                
+                BenchmarkFace(BenchmarkTexture* i_texture, size_t i_vertexCount) :
+                texture(i_texture),
+                vertexCount(i_vertexCount) {}
+            };
+            
+            typedef std::vector<BenchmarkTexture*> TextureList;
+            typedef std::vector<BenchmarkFace> FaceList;
+            typedef TexturedPolygonSorter<BenchmarkTexture, const BenchmarkFace*> FaceSorter;
+            
+            static const size_t TextureCount = 600;
+            static const size_t FaceCount = 300000;
+            static const size_t RebuildCount = 20;
+            
+            TextureList m_textures;
+            FaceList m_faces;
+            unsigned int m_seed;
+            
+            inline size_t random(size_t max) {
+                m_seed = m_seed * 1103515245 + 12345;
+                return ((m_seed >> 16) & 0x7FFF) % max;
+            }
+        protected:
+            void registerTestCases() {
+                registerTestCase(&TexturedPolygonSorterBenchmark::benchmarkMapBatching);
+                registerTestCase(&TexturedPolygonSorterBenchmark::benchmarkCountingSortBatching);
+            }
+            
+            void setup() {
+                m_seed = 1;
+                for (size_t i = 0; i < TextureCount; i++)
+                    m_textures.push_back(new BenchmarkTexture(i));
+                
+                // faces of the same brush tend to share textures, so they come in runs
+                m_faces.reserve(FaceCount);
+                while (m_faces.size() < FaceCount) {
+                    BenchmarkTexture* texture = m_textures[random(TextureCount)];
+                    const size_t runLength = 1 + random(6);
+                    for (size_t i = 0; i < runLength && m_faces.size() < FaceCount; i++)
+                        m_faces.push_back(BenchmarkFace(texture, 3 + random(4)));
+                }
+            }
+            
+            void teardown() {
+                for (size_t i = 0; i < m_textures.size(); i++)
+                    delete m_textures[i];
+                m_textures.clear();
+                m_faces.clear();
+            }
+        public:
+            TexturedPolygonSorterBenchmark() :
+            m_seed(1) {}
+            
+            /*
+             * Batches the faces like the sorter did before it used dense texture indices: a map from texture to a
+             * vector of faces.
+             */
+            void benchmarkMapBatching() {
+                typedef std::vector<const BenchmarkFace*> FaceCollection;
+                typedef std::map<BenchmarkTexture*, FaceCollection> FaceCollectionMap;
+                
+                size_t checksum = 0;
+                startTimer();
+                for (size_t i = 0; i < RebuildCount; i++) {
+                    FaceCollectionMap collections;
+                    FaceCollectionMap::iterator last = collections.end();
+                    FaceList::const_iterator faceIt, faceEnd;
+                    for (faceIt = m_faces.begin(), faceEnd = m_faces.end(); faceIt != faceEnd; ++faceIt) {
+                        const BenchmarkFace& face = *faceIt;
+                        if (last == collections.end() || last->first != face.texture)
+                            last = collections.insert(std::make_pair(face.texture, FaceCollection())).first;
+                        last->second.push_back(&face);
+                    }
+                    
+                    FaceCollectionMap::const_iterator collectionIt, collectionEnd;
+                    for (collectionIt = collections.begin(), collectionEnd = collections.end(); collectionIt != collectionEnd; ++collectionIt)
+                        checksum += collectionIt->second.size();
+                }
+                report("Batch faces with map", static_cast<double>(RebuildCount * m_faces.size()), "faces");
+                assert(checksum == RebuildCount * m_faces.size());
+            }
+            
+            void benchmarkCountingSortBatching() {
+                size_t checksum = 0;
+                startTimer();
+                for (size_t i = 0; i < RebuildCount; i++) {
+                    FaceSorter sorter;
+                    FaceList::const_iterator faceIt, faceEnd;
+                    for (faceIt = m_faces.begin(), faceEnd = m_faces.end(); faceIt != faceEnd; ++faceIt) {
+                        const BenchmarkFace& face = *faceIt;
+                        sorter.addPolygon(face.texture, &face, face.vertexCount);
+                    }
+                    
+                    const FaceSorter::PolygonCollectionList& collections = sorter.collections();
+                    FaceSorter::PolygonCollectionList::const_iterator collectionIt, collectionEnd;
+                    for (collectionIt = collections.begin(), collectionEnd = collections.end(); collectionIt != collectionEnd; ++collectionIt) {
+                        const FaceSorter::PolygonCollection& collection = collectionIt->second;
+                        assert(collection.polygon(0)->texture == collectionIt->first);
+                        checksum += collection.polygonCount();
+                    }
+                }
+                report("Batch faces with counting sort", static_cast<double>(RebuildCount * m_faces.size()), "faces");
+                assert(checksum == RebuildCount * m_faces.size());
+            }
+        };
+    }
+}
+
+#endif
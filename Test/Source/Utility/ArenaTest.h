@@ -0,0 +1,103 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TrenchBroom_ArenaTest_h
+#define TrenchBroom_ArenaTest_h
+
+#include "TestSuite.h"
+#include "Utility/Arena.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace TrenchBroom {
+    namespace Utility {
+        class ArenaTest : public TestSuite<ArenaTest> {
+        protected:
+            void registerTestCases() {
+                registerTestCase(&ArenaTest::testAllocateAndDeallocate);
+                registerTestCase(&ArenaTest::testStats);
+                registerTestCase(&ArenaTest::testLargeBlocks);
+            }
+        public:
+            void testAllocateAndDeallocate() {
+                typedef std::pair<unsigned char*, size_t> Block;
+                std::vector<Block> blocks;
+                for (size_t i = 0; i < 10000; i++) {
+                    const size_t size = 1 + i % Arena::MaxBlockSize;
+                    unsigned char* block = static_cast<unsigned char*>(Arena::allocate(size));
+                    assert(reinterpret_cast<size_t>(block) % Arena::Granularity == 0);
+                    std::memset(block, static_cast<int>(i % 256), size);
+                    blocks.push_back(Block(block, size));
+                }
+                
+                for (size_t i = 0; i < blocks.size(); i++) {
+                    assert(blocks[i].first[0] == i % 256);
+                    assert(blocks[i].first[blocks[i].second - 1] == i % 256);
+                }
+                
+                // release in random order, then allocate again to reuse the released blocks
+                std::random_shuffle(blocks.begin(), blocks.end());
+                for (size_t i = 0; i < blocks.size() / 2; i++)
+                    Arena::deallocate(blocks[i].first, blocks[i].second);
+                for (size_t i = 0; i < blocks.size() / 2; i++)
+                    blocks[i].first = static_cast<unsigned char*>(Arena::allocate(blocks[i].second));
+                
+                std::vector<Block> sorted = blocks;
+                std::sort(sorted.begin(), sorted.end());
+                for (size_t i = 1; i < sorted.size(); i++)
+                    assert(sorted[i - 1].first + sorted[i - 1].second <= sorted[i].first);
+                
+                for (size_t i = 0; i < blocks.size(); i++)
+                    Arena::deallocate(blocks[i].first, blocks[i].second);
+            }
+            
+            void testStats() {
+                const Arena::Stats before = Arena::stats();
+                
+                std::vector<void*> blocks;
+                for (size_t i = 0; i < 1000; i++)
+                    blocks.push_back(Arena::allocate(24));
+                
+                const Arena::Stats during = Arena::stats();
+                assert(during.liveObjects == before.liveObjects + 1000);
+                assert(during.liveBytes == before.liveBytes + 1000 * 32);
+                assert(during.reservedBytes >= during.liveBytes);
+                
+                for (size_t i = 0; i < blocks.size(); i++)
+                    Arena::deallocate(blocks[i], 24);
+                
+                const Arena::Stats after = Arena::stats();
+                assert(after.liveObjects == before.liveObjects);
+                assert(after.liveBytes == before.liveBytes);
+            }
+            
+            void testLargeBlocks() {
+                const Arena::Stats before = Arena::stats();
+                void* block = Arena::allocate(Arena::MaxBlockSize + 1);
+                std::memset(block, 0, Arena::MaxBlockSize + 1);
+                assert(Arena::stats().liveObjects == before.liveObjects);
+                Arena::deallocate(block, Arena::MaxBlockSize + 1);
+            }
+        };
+    }
+}
+
+#endif
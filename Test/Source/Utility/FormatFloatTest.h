@@ -0,0 +1,98 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TrenchBroom_FormatFloatTest_h
+#define TrenchBroom_FormatFloatTest_h
+
+#include "TestSuite.h"
+#include "Utility/FormatFloat.h"
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+namespace TrenchBroom {
+    namespace Utility {
+        class FormatFloatTest : public TestSuite<FormatFloatTest> {
+        private:
+            void assertFormat(float value, int precision) {
+                char expected[128];
+                std::sprintf(expected, "%.*g", precision, static_cast<double>(value));
+                
+                String actual;
+                appendFloat(actual, value, precision);
+                assert(actual == expected);
+            }
+            
+            void assertFormat(float value) {
+                assertFormat(value, 100);
+                assertFormat(value, 6);
+            }
+        protected:
+            void registerTestCases() {
+                registerTestCase(&FormatFloatTest::testTypicalValues);
+                registerTestCase(&FormatFloatTest::testSpecialValues);
+                registerTestCase(&FormatFloatTest::testBitPatterns);
+            }
+        public:
+            void testTypicalValues() {
+                for (int i = -4096; i <= 4096; i++) {
+                    assertFormat(static_cast<float>(i));
+                    assertFormat(i / 8.0f);
+                    assertFormat(i / 3.0f);
+                    assertFormat(i * 0.001f);
+                    assertFormat(i * 1024.0f);
+                }
+                
+                assertFormat(0.0001f);
+                assertFormat(0.00001f);
+                assertFormat(123456.0f);
+                assertFormat(1234567.0f);
+                assertFormat(1.0f / 65536.0f);
+                assertFormat(1.0f / 131072.0f);
+            }
+            
+            void testSpecialValues() {
+                assertFormat(0.0f);
+                assertFormat(-0.0f);
+                assertFormat(std::numeric_limits<float>::min());
+                assertFormat(std::numeric_limits<float>::denorm_min());
+                assertFormat(std::numeric_limits<float>::max());
+                assertFormat(-std::numeric_limits<float>::max());
+                assertFormat(std::numeric_limits<float>::infinity());
+                assertFormat(-std::numeric_limits<float>::infinity());
+            }
+            
+            void testBitPatterns() {
+                unsigned int bits = 1;
+                for (size_t i = 0; i < 100000; i++) {
+                    bits = bits * 1664525u + 1013904223u;
+                    
+                    float value;
+                    std::memcpy(&value, &bits, sizeof(value));
+                    if (value == value)
+                        assertFormat(value);
+                }
+            }
+        };
+    }
+}
+
+#endif
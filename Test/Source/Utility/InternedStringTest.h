@@ -0,0 +1,101 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TrenchBroom_InternedStringTest_h
+#define TrenchBroom_InternedStringTest_h
+
+#include "TestSuite.h"
+#include "Utility/InternedString.h"
+
+#include <cassert>
+#include <sstream>
+
+namespace TrenchBroom {
+    namespace Utility {
+        class InternedStringTest : public TestSuite<InternedStringTest> {
+        protected:
+            void registerTestCases() {
+                registerTestCase(&InternedStringTest::testEquality);
+                registerTestCase(&InternedStringTest::testGrow);
+                registerTestCase(&InternedStringTest::testFind);
+            }
+        public:
+            void testEquality() {
+                const InternedString empty;
+                assert(empty.empty());
+                assert(empty == InternedString(""));
+                
+                const String name("wall_brick");
+                const InternedString first(name);
+                const InternedString second(String("wall_") + "brick");
+                assert(first == second);
+                assert(&first.str() == &second.str());
+                assert(first.str() == name);
+                assert(first != InternedString("WALL_BRICK"));
+                assert(first != empty);
+            }
+            
+            void testGrow() {
+                size_t countBefore, bytesBefore;
+                InternedString::statistics(countBefore, bytesBefore);
+                
+                InternedStringList handles;
+                for (size_t i = 0; i < 5000; i++) {
+                    std::stringstream str;
+                    str << "interned_string_test_" << i;
+                    handles.push_back(InternedString(str.str()));
+                }
+                
+                size_t countAfter, bytesAfter;
+                InternedString::statistics(countAfter, bytesAfter);
+                assert(countAfter == countBefore + 5000);
+                assert(bytesAfter > bytesBefore);
+                
+                // the strings must not move when the table grows
+                for (size_t i = 0; i < handles.size(); i++) {
+                    std::stringstream str;
+                    str << "interned_string_test_" << i;
+                    assert(handles[i] == InternedString(str.str()));
+                    assert(handles[i].str() == str.str());
+                }
+            }
+            
+            void testFind() {
+                InternedString result;
+                assert(!InternedString::find("interned_string_find_test", result));
+                assert(result.empty());
+                
+                size_t countBefore, bytesBefore;
+                InternedString::statistics(countBefore, bytesBefore);
+                const InternedString first("interned_string_find_test");
+                const InternedString second("interned_string_find_test_2");
+                
+                // the indices are dense and follow the order of interning
+                assert(first.index() == countBefore);
+                assert(second.index() == countBefore + 1);
+                
+                assert(InternedString::find("interned_string_find_test", result));
+                assert(result == first);
+                assert(result.index() == first.index());
+            }
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,132 @@
+/*
+ Copyright (C) 2010-2012 Kristian Duske
+
+ This file is part of TrenchBroom.
+
+ TrenchBroom is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ TrenchBroom is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TrenchBroom_PackedPolygonTest_h
+#define TrenchBroom_PackedPolygonTest_h
+
+#include "TestSuite.h"
+#include "Utility/PackedPolygon.h"
+
+#include <cmath>
+#include <cstdlib>
+
+namespace TrenchBroom {
+    namespace VecMath {
+        class PackedPolygonTest : public TestSuite<PackedPolygonTest> {
+        protected:
+            void registerTestCases() {
+                registerTestCase(&PackedPolygonTest::testSquare);
+                registerTestCase(&PackedPolygonTest::testVertex);
+                registerTestCase(&PackedPolygonTest::testLargePolygon);
+                registerTestCase(&PackedPolygonTest::testSseMatchesScalar);
+            }
+            
+            void setSquare(PackedPolygon& polygon, float x, float y) {
+                polygon.reset(4);
+                polygon.setVertex(0, -1.0f - x, -1.0f - y);
+                polygon.setVertex(1, -1.0f - x,  1.0f - y);
+                polygon.setVertex(2,  1.0f - x,  1.0f - y);
+                polygon.setVertex(3,  1.0f - x, -1.0f - y);
+            }
+            
+            void setCircle(PackedPolygon& polygon, size_t count, float radius, float x, float y) {
+                polygon.reset(count);
+                for (size_t i = 0; i < count; i++) {
+                    const float angle = 2.0f * Math<float>::Pi * static_cast<float>(i) / static_cast<float>(count);
+                    polygon.setVertex(i, radius * std::cos(angle) - x, radius * std::sin(angle) - y);
+                }
+            }
+            
+            float random(float min, float max) {
+                return min + (max - min) * static_cast<float>(std::rand()) / static_cast<float>(RAND_MAX);
+            }
+        public:
+            void testSquare() {
+                PackedPolygon polygon;
+                
+                setSquare(polygon, 0.0f, 0.0f);
+                assert(polygon.containsOrigin(false));
+                assert(polygon.containsOrigin(true));
+                
+                setSquare(polygon, 0.5f, -0.5f);
+                assert(polygon.containsOrigin(false));
+                assert(polygon.containsOrigin(true));
+                
+                setSquare(polygon, 2.0f, 0.0f);
+                assert(!polygon.containsOrigin(false));
+                assert(!polygon.containsOrigin(true));
+                
+                setSquare(polygon, 0.0f, -1.5f);
+                assert(!polygon.containsOrigin(false));
+                assert(!polygon.containsOrigin(true));
+            }
+            
+            void testVertex() {
+                PackedPolygon polygon;
+                
+                setSquare(polygon, 1.0f, 1.0f);
+                assert(polygon.containsOrigin(false));
+                assert(polygon.containsOrigin(true));
+                
+                setSquare(polygon, -1.0f, 1.0f);
+                assert(polygon.containsOrigin(false));
+                assert(polygon.containsOrigin(true));
+            }
+            
+            void testLargePolygon() {
+                PackedPolygon polygon;
+                
+                setCircle(polygon, 100, 10.0f, 0.0f, 0.0f);
+                assert(polygon.containsOrigin(false));
+                assert(polygon.containsOrigin(true));
+                
+                setCircle(polygon, 100, 10.0f, 11.0f, 0.0f);
+                assert(!polygon.containsOrigin(false));
+                assert(!polygon.containsOrigin(true));
+                
+                // switching back to the fixed size arrays
+                setSquare(polygon, 0.0f, 0.0f);
+                assert(polygon.containsOrigin(true));
+            }
+            
+            void testSseMatchesScalar() {
+                PackedPolygon polygon;
+                
+                std::srand(4711);
+                for (size_t i = 0; i < 20000; i++) {
+                    const size_t count = 3 + static_cast<size_t>(std::rand()) % 12;
+                    const float radius = random(0.5f, 64.0f);
+                    setCircle(polygon, count, radius, random(-1.5f, 1.5f) * radius, random(-1.5f, 1.5f) * radius);
+                    assert(polygon.containsOrigin(true) == polygon.containsOrigin(false));
+                }
+                
+                // integer coordinates produce vertices and edges that lie exactly on the axes
+                for (size_t i = 0; i < 20000; i++) {
+                    const size_t count = 3 + static_cast<size_t>(std::rand()) % 12;
+                    polygon.reset(count);
+                    for (size_t j = 0; j < count; j++)
+                        polygon.setVertex(j, std::floor(random(-4.0f, 4.0f)), std::floor(random(-4.0f, 4.0f)));
+                    assert(polygon.containsOrigin(true) == polygon.containsOrigin(false));
+                }
+            }
+        };
+    }
+}
+
+#endif
@@ -17,11 +17,30 @@
  along with TrenchBroom.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <cstring>
 #include <iostream>
 
 #include "TestSuite.h"
+#include "Controller/BrushSnapshotTest.h"
+#include "Controller/VertexHandleGridBenchmark.h"
+#include "IO/EntityDefinitionCacheTest.h"
+#include "IO/MapTokenizerBenchmark.h"
+#include "IO/StreamTokenizerTest.h"
+#include "Model/AliasTest.h"
+#include "Model/BrushGeometryBenchmark.h"
+#include "Model/CompactBrushGeometryTest.h"
+#include "Model/ConvexVolumeTest.h"
+#include "Model/EntityFilterBenchmark.h"
+#include "Model/PickingBenchmark.h"
+#include "Renderer/CullerTest.h"
+#include "Renderer/ModelInstanceGroupsTest.h"
+#include "Renderer/TexturedPolygonSorterBenchmark.h"
+#include "Utility/ArenaTest.h"
 #include "Utility/FindIntegerPlanePointsTest.h"
+#include "Utility/FormatFloatTest.h"
+#include "Utility/InternedStringTest.h"
 #include "Utility/MatTest.h"
+#include "Utility/PackedPolygonTest.h"
 #include "Utility/PlaneTest.h"
 #include "Utility/VecTest.h"
 
@@ -37,11 +56,67 @@ int main(int argc, const char * argv[]) {
     VecMath::PlaneTest planeTest;
     planeTest.run();
     
+    VecMath::PackedPolygonTest packedPolygonTest;
+    packedPolygonTest.run();
+    
+    Utility::ArenaTest arenaTest;
+    arenaTest.run();
+    
+    Utility::InternedStringTest internedStringTest;
+    internedStringTest.run();
+    
+    Utility::FormatFloatTest formatFloatTest;
+    formatFloatTest.run();
+    
+    IO::StreamTokenizerTest streamTokenizerTest;
+    streamTokenizerTest.run();
+    
+    IO::EntityDefinitionCacheTest entityDefinitionCacheTest;
+    entityDefinitionCacheTest.run();
+    
+    Model::AliasTest aliasTest;
+    aliasTest.run();
+    
+    Model::CompactBrushGeometryTest compactBrushGeometryTest;
+    compactBrushGeometryTest.run();
+    
+    Model::ConvexVolumeTest convexVolumeTest;
+    convexVolumeTest.run();
+    
+    Controller::BrushSnapshotTest brushSnapshotTest;
+    brushSnapshotTest.run();
+    
+    Renderer::CullerTest cullerTest;
+    cullerTest.run();
+    
+    Renderer::ModelInstanceGroupsTest modelInstanceGroupsTest;
+    modelInstanceGroupsTest.run();
+    
     /*
     VecMath::FindIntegerPlanePointsTest planePointsTest;
     planePointsTest.run();
     */
     
+    if (argc > 1 && std::strcmp(argv[1], "--benchmark") == 0) {
+        Controller::VertexHandleGridBenchmark vertexHandleGridBenchmark;
+        vertexHandleGridBenchmark.run();
+        
+        IO::MapTokenizerBenchmark mapTokenizerBenchmark;
+        mapTokenizerBenchmark.run();
+        
+        Model::EntityFilterBenchmark entityFilterBenchmark;
+        entityFilterBenchmark.run();
+        
+        Model::BrushGeometryBenchmark brushGeometryBenchmark;
+        brushGeometryBenchmark.run();
+        
+        Model::PickingBenchmark pickingBenchmark;
+        pickingBenchmark.run();
+        
+        Renderer::TexturedPolygonSorterBenchmark texturedPolygonSorterBenchmark;
+        texturedPolygonSorterBenchmark.run();
+    }
+    
     return 0;
 }
 